@@ -0,0 +1,100 @@
+// Benchmark dos ambientes de treinamento (veja envbatch.h): passos de
+// ambiente por segundo com uma única thread e com o pool completo. Os
+// ambientes são dirigidos por uma política simples, que acelera e esterça na
+// direção do raio mais longo, e a recompensa média por episódio é mostrada
+// para conferir que os ambientes fazem sentido. Deve ser executado de
+// "bin/Linux", como o jogo, para encontrar os arquivos de "data/".
+
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+#include "simulation.h"
+#include "envbatch.h"
+#include "benchbuild.h"
+
+namespace {
+
+const int measured_steps = 600;
+
+// Esterça para o raio mais longo e freia quando a pista à frente é curta
+void Policy(const std::vector<float>& observations, std::vector<float>& actions, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* rays = &observations[i * ENV_OBSERVATION_SIZE + 8];
+        int best = 0;
+        for (int k = 1; k < ENV_RAYS; ++k)
+            if (rays[k] > rays[best])
+                best = k;
+        float steer = (best - (ENV_RAYS - 1) * 0.5f) / ((ENV_RAYS - 1) * 0.5f);
+        float ahead = rays[ENV_RAYS / 2];
+        actions[i * ENV_ACTION_SIZE + 0] = steer;
+        actions[i * ENV_ACTION_SIZE + 1] = ahead > 0.5f ? 1.0f : (ahead > 0.25f ? 0.3f : -0.5f);
+    }
+}
+
+void Measure(ThreadPool& pool, size_t count, EnvPhysics physics, double* steps_per_second, double* mean_score)
+{
+    EnvBatch envs;
+    EnvBatch_Init(envs, count, physics);
+
+    std::vector<float>   observations(count * ENV_OBSERVATION_SIZE);
+    std::vector<float>   actions(count * ENV_ACTION_SIZE);
+    std::vector<float>   rewards(count);
+    std::vector<uint8_t> dones(count);
+    EnvBatch_Observe(envs, pool, observations.data());
+
+    double step_time = 0.0;
+    for (int step = 0; step < measured_steps; ++step)
+    {
+        Policy(observations, actions, count);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        EnvBatch_Step(envs, pool, actions.data(), observations.data(), rewards.data(), dones.data());
+        step_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double score = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        score += envs.score[i];
+    *steps_per_second = measured_steps * (double)count / step_time;
+    *mean_score = score / count;
+}
+
+} // namespace
+
+int main()
+{
+    Bench_CheckBuild();
+
+    ObjModel trackmodel("../../data/track/track.obj");
+    ObjModel planemodel("../../data/plane/plane.obj");
+    Simulation_BuildTrack(&trackmodel, &planemodel);
+    if (g_RacingLine.points.empty())
+        return 1;
+    InitializeBonusObjects();
+
+    ThreadPool single; // Sem threads auxiliares
+    ThreadPool_Start(g_ThreadPool);
+
+    // Os dois modelos de física, para mostrar o custo do modelo de pneus
+    const EnvPhysics physics[] = { ENV_PHYSICS_TIRE, ENV_PHYSICS_KINEMATIC };
+    const char* physics_names[] = { "pneus", "cinemático" };
+    const size_t sizes[] = { 64, 1024, 8192 };
+    printf("\n%12s %10s %22s %22s %16s\n", "física", "ambientes", "passos/s (1 thread)", "passos/s (pool)", "pontuação média");
+    for (size_t p = 0; p < sizeof(physics) / sizeof(physics[0]); ++p)
+    {
+        for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k)
+        {
+            double one, many, score;
+            Measure(single, sizes[k], physics[p], &one, &score);
+            Measure(g_ThreadPool, sizes[k], physics[p], &many, &score);
+            printf("%12s %10d %22.0f %22.0f %16.1f\n", physics_names[p], (int)sizes[k], one, many, score);
+        }
+    }
+    printf("Pool com %d threads, %d passos de %.1f s simulados por ambiente.\n",
+           ThreadPool_Size(g_ThreadPool), measured_steps, measured_steps * SIMULATION_TIMESTEP);
+
+    Simulation_Shutdown();
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Benchmark da frota de IA: passos de simulação por segundo para 1, 16, 64 e
+// 256 carros, com uma única thread e com o pool completo, e o custo do
+// sweep-and-prune entre carros comparado ao teste de todos os pares. Deve ser
+// executado de "bin/Linux", como o jogo, para encontrar os arquivos de "data/".
+
+#include <cstdio>
+#include <chrono>
+
+#include "simulation.h"
+#include "broadphase.h"
+#include "collisions.h"
+#include "benchbuild.h"
+
+namespace {
+
+const int warmup_steps   = 120;
+const int measured_steps = 1200;
+
+double MeasureStepsPerSecond(ThreadPool& pool, size_t cars)
+{
+    Fleet fleet;
+    Fleet_Init(fleet, cars, g_RacingLine, 0.0f);
+    for (int i = 0; i < warmup_steps; ++i)
+        Fleet_Step(fleet, g_RacingLine, pool, SIMULATION_TIMESTEP);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < measured_steps; ++i)
+        Fleet_Step(fleet, g_RacingLine, pool, SIMULATION_TIMESTEP);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return measured_steps / seconds;
+}
+
+struct BroadphaseResult
+{
+    double sweep_us;     // Tempo médio do sweep-and-prune por passo
+    double brute_us;     // Tempo médio do teste de todos os pares por passo
+    double pairs;        // Pares candidatos por passo
+    double swaps;        // Trocas do insertion sort por passo
+};
+
+BroadphaseResult MeasureBroadphase(ThreadPool& pool, size_t cars)
+{
+    Fleet fleet;
+    Fleet_Init(fleet, cars, g_RacingLine, 0.0f);
+    for (int i = 0; i < warmup_steps; ++i)
+        Fleet_Step(fleet, g_RacingLine, pool, SIMULATION_TIMESTEP);
+
+    SweepAndPrune sap;
+    SweepAndPrune_Resize(sap, cars);
+    std::vector<glm::vec3> bbox_min(cars), bbox_max(cars);
+
+    BroadphaseResult result = { 0.0, 0.0, 0.0, 0.0 };
+    size_t brute_pairs = 0;
+    const int steps = measured_steps / 4;
+    for (int step = 0; step < steps; ++step)
+    {
+        Fleet_Step(fleet, g_RacingLine, pool, SIMULATION_TIMESTEP);
+        for (size_t i = 0; i < cars; ++i)
+        {
+            OrientedBox box = car_oriented_box(glm::vec3(fleet.x[i], fleet.y[i], fleet.z[i]), fleet.rotation_angle[i]);
+            oriented_box_bounds(box, &bbox_min[i], &bbox_max[i]);
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < cars; ++i)
+        {
+            sap.min_x[i] = bbox_min[i].x;
+            sap.max_x[i] = bbox_max[i].x;
+            sap.min_z[i] = bbox_min[i].z;
+            sap.max_z[i] = bbox_max[i].z;
+        }
+        SweepAndPrune_Update(sap);
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+        for (size_t a = 0; a < cars; ++a)
+            for (size_t b = a + 1; b < cars; ++b)
+                if (bbox_min[a].x <= bbox_max[b].x && bbox_min[b].x <= bbox_max[a].x &&
+                    bbox_min[a].z <= bbox_max[b].z && bbox_min[b].z <= bbox_max[a].z)
+                    ++brute_pairs;
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        result.sweep_us += std::chrono::duration<double, std::micro>(middle - start).count();
+        result.brute_us += std::chrono::duration<double, std::micro>(end - middle).count();
+        result.pairs    += sap.pairs.size();
+        result.swaps    += sap.swaps;
+    }
+
+    // Os dois métodos devem encontrar exatamente os mesmos pares
+    if (brute_pairs != (size_t)result.pairs)
+        fprintf(stderr, "ERROR: Sweep-and-prune found %.0f pairs, brute force found %d.\n", result.pairs, (int)brute_pairs);
+
+    result.sweep_us /= steps;
+    result.brute_us /= steps;
+    result.pairs    /= steps;
+    result.swaps    /= steps;
+    return result;
+}
+
+} // namespace
+
+int main()
+{
+    Bench_CheckBuild();
+
+    ObjModel trackmodel("../../data/track/track.obj");
+    ObjModel planemodel("../../data/plane/plane.obj");
+    Simulation_BuildTrack(&trackmodel, &planemodel);
+    if (g_RacingLine.points.empty())
+        return 1;
+
+    ThreadPool single; // Sem threads auxiliares
+    ThreadPool_Start(g_ThreadPool);
+
+    const size_t sizes[] = { 1, 16, 64, 256 };
+    printf("\n%8s %16s %16s %20s\n", "carros", "passos/s (1 th)", "passos/s (pool)", "carros*passos/s");
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k)
+    {
+        double one  = MeasureStepsPerSecond(single, sizes[k]);
+        double many = MeasureStepsPerSecond(g_ThreadPool, sizes[k]);
+        printf("%8d %16.0f %16.0f %20.0f\n", (int)sizes[k], one, many, many * sizes[k]);
+    }
+    printf("Pool com %d threads. Orçamento de tempo real: %.0f passos/s.\n",
+           ThreadPool_Size(g_ThreadPool), 1.0 / SIMULATION_TIMESTEP);
+
+    const size_t broadphase_sizes[] = { 16, 64, 128, 256, 1024 };
+    printf("\n%8s %16s %16s %10s %10s\n", "carros", "sweep (us)", "todos pares (us)", "pares", "trocas");
+    for (size_t k = 0; k < sizeof(broadphase_sizes) / sizeof(broadphase_sizes[0]); ++k)
+    {
+        BroadphaseResult r = MeasureBroadphase(g_ThreadPool, broadphase_sizes[k]);
+        printf("%8d %16.2f %16.2f %10.1f %10.1f\n", (int)broadphase_sizes[k], r.sweep_us, r.brute_us, r.pairs, r.swaps);
+    }
+
+    Simulation_Shutdown();
+    return 0;
+}
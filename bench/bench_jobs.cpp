@@ -0,0 +1,124 @@
+// Benchmark do sistema de tarefas (veja threadpool.h): custo de criar e
+// esperar tarefas vazias, quantas tarefas são roubadas por outras threads, o
+// custo fixo de um ThreadPool_ParallelFor() e o de uma cadeia de tarefas com
+// dependências. Não usa os arquivos de "data/". O número de threads
+// auxiliares pode ser passado como argumento (padrão: núcleos menos um).
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <thread>
+
+#include "threadpool.h"
+#include "benchbuild.h"
+
+namespace {
+
+const int repetitions = 20;
+
+std::thread::id  main_thread;
+std::atomic<int> stolen(0);
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void EmptyJob(void*, size_t, size_t)
+{
+}
+
+// Trabalho de ~1 microssegundo, contando as tarefas que rodaram fora da
+// thread que as criou
+void SmallJob(void* context, size_t, size_t)
+{
+    volatile float* sink = static_cast<volatile float*>(context);
+    float x = 1.0f;
+    for (int i = 0; i < 200; ++i)
+        x = x * 1.0001f + 0.5f;
+    *sink = x;
+    if (std::this_thread::get_id() != main_thread)
+        stolen.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Nanossegundos por tarefa para criar "count" tarefas e esperar todas
+double MeasureSpawn(ThreadPool& pool, ThreadPoolTask task, void* context, int count)
+{
+    double best = 1e30;
+    for (int r = 0; r < repetitions; ++r)
+    {
+        JobCounter counter;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i)
+            Job_Spawn(pool, task, context, &counter);
+        Job_Wait(pool, counter);
+        double seconds = Seconds(start);
+        if (seconds < best)
+            best = seconds;
+    }
+    return best * 1e9 / count;
+}
+
+// Microssegundos por ThreadPool_ParallelFor() vazio sobre "count" índices
+double MeasureParallelFor(ThreadPool& pool, size_t count, size_t grain)
+{
+    const int calls = 1000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+        ThreadPool_ParallelFor(pool, count, grain, EmptyJob, NULL);
+    return Seconds(start) * 1e6 / calls;
+}
+
+// Microssegundos para uma cadeia de "groups" grupos de "width" tarefas, em
+// que cada grupo só começa quando o anterior termina
+double MeasureChain(ThreadPool& pool, int groups, int width, float* sink)
+{
+    JobCounter counters[64];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int g = 0; g < groups; ++g)
+        for (int i = 0; i < width; ++i)
+            Job_Spawn(pool, SmallJob, sink, &counters[g], g > 0 ? &counters[g - 1] : NULL);
+    Job_Wait(pool, counters[groups - 1]);
+    return Seconds(start) * 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench_CheckBuild();
+    main_thread = std::this_thread::get_id();
+
+    ThreadPool single; // Sem threads auxiliares
+    ThreadPool pool;
+    ThreadPool_Start(pool, argc > 1 ? atoi(argv[1]) : 0);
+    volatile float sink = 0.0f;
+    float chain_sink = 0.0f;
+
+    printf("Pool com %d threads.\n", ThreadPool_Size(pool));
+
+    const int counts[] = { 64, 1024, 4000 };
+    printf("\n%8s %16s %16s %16s %10s\n", "tarefas", "vazia 1 th (ns)", "vazia pool (ns)", "1 us pool (ns)", "roubadas");
+    for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); ++k)
+    {
+        double one   = MeasureSpawn(single, EmptyJob, NULL, counts[k]);
+        double many  = MeasureSpawn(pool, EmptyJob, NULL, counts[k]);
+        stolen = 0;
+        double small = MeasureSpawn(pool, SmallJob, (void*)&sink, counts[k]);
+        printf("%8d %16.1f %16.1f %16.1f %9.0f%%\n", counts[k], one, many, small,
+               100.0 * stolen.load() / ((double)counts[k] * repetitions));
+    }
+
+    const size_t ranges[] = { 1024, 65536, 1048576 };
+    printf("\n%8s %8s %16s %16s\n", "índices", "bloco", "1 th (us)", "pool (us)");
+    for (size_t k = 0; k < sizeof(ranges) / sizeof(ranges[0]); ++k)
+        printf("%8d %8d %16.2f %16.2f\n", (int)ranges[k], 256,
+               MeasureParallelFor(single, ranges[k], 256), MeasureParallelFor(pool, ranges[k], 256));
+
+    printf("\nCadeia de 64 grupos de 16 tarefas de ~1 us: %.0f us (1 th), %.0f us (pool).\n",
+           MeasureChain(single, 64, 16, &chain_sink), MeasureChain(pool, 64, 16, &chain_sink));
+
+    ThreadPool_Stop(pool);
+    return 0;
+}
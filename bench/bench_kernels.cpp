@@ -0,0 +1,271 @@
+// Micro-benchmarks das funções mais usadas do núcleo do jogo: testes de
+// colisão (collisions.h), matrizes (matrices.h), BezierCurve::evaluate(),
+// ComputeNormals(), a montagem dos triângulos de BuildTrianglesAndAddToVirtualScene()
+// (BuildTriangleMesh()), ComputeCarAABB() e o posicionamento dos caracteres
+// de TextRendering_PrintString() (TextLayout_BuildQuads()). Para cada um
+// mostra o tempo e as alocações (veja alloctrack.h) por operação e a vazão.
+// "--json <arquivo>" grava os resultados, com a configuração da compilação
+// (veja benchbuild.h), para comparar entre versões. Deve ser executado de
+// "bin/Linux", como o jogo, para encontrar o modelo da pista em "data/"; sem
+// ele, os benchmarks de malha são pulados.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include "matrices.h"
+#include "collisions.h"
+#include "bonus.h"
+#include "objmodel.h"
+#include "simulation.h"
+#include "textlayout.h"
+#include "alloctrack.h"
+#include "json.h"
+#include "benchbuild.h"
+
+namespace {
+
+const double min_batch_seconds = 0.02; // Duração mínima de uma medida
+const int    repetitions       = 5;    // Medidas por benchmark; vale a melhor
+
+#define NUM_INPUTS 1024 // Entradas diferentes usadas em sequência
+
+volatile float g_Sink; // Impede que o compilador descarte os resultados
+
+struct BenchResult
+{
+    const char* name;
+    const char* unit;          // O que é contado em items_per_op
+    double      items_per_op;
+    double      ns_per_op;
+    double      allocs_per_op;
+    uint64_t    iterations;    // Operações por medida
+};
+
+std::vector<BenchResult> g_Results;
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Executa "op(i)" para i de 0 a iterations - 1, somando os resultados
+template <typename Op>
+double RunBatch(Op& op, uint64_t iterations)
+{
+    float sum = 0.0f;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i)
+        sum += op((size_t)i);
+    double seconds = Seconds(start);
+    g_Sink = sum;
+    return seconds;
+}
+
+// Mede "op", que recebe o número da operação e retorna um valor qualquer
+// calculado a partir do resultado. O número de operações por medida dobra até
+// a medida durar min_batch_seconds.
+template <typename Op>
+void Bench(const char* name, const char* unit, double items_per_op, Op op)
+{
+    uint64_t iterations = 1;
+    while (RunBatch(op, iterations) < min_batch_seconds && iterations < ((uint64_t)1 << 32))
+        iterations *= 2;
+
+    double best = 1e30;
+    AllocCounters allocations = AllocTrack_Read();
+    for (int r = 0; r < repetitions; ++r)
+    {
+        double seconds = RunBatch(op, iterations);
+        if (seconds < best)
+            best = seconds;
+    }
+
+    BenchResult result;
+    result.name          = name;
+    result.unit          = unit;
+    result.items_per_op  = items_per_op;
+    result.ns_per_op     = best * 1e9 / iterations;
+    result.allocs_per_op = (double)AllocTrack_Since(allocations) / ((double)iterations * repetitions);
+    result.iterations    = iterations;
+    g_Results.push_back(result);
+
+    printf("%-28s %12.1f %10.2f %12.2f M %s/s\n", name, result.ns_per_op, result.allocs_per_op,
+           items_per_op * 1e3 / result.ns_per_op, unit);
+    fflush(stdout);
+}
+
+bool WriteJson(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot write \"%s\".\n", filename);
+        return false;
+    }
+
+    // A configuração vai junto para que resultados de compilações diferentes
+    // (ex: Debug e Release) não sejam comparados por engano
+    fprintf(file, "{\n  \"build_type\": ");
+    Json_WriteString(file, BENCH_BUILD_TYPE);
+    fprintf(file, ",\n  \"compiler\": ");
+    Json_WriteString(file, BENCH_COMPILER);
+    fprintf(file, ",\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < g_Results.size(); ++i)
+    {
+        const BenchResult& result = g_Results[i];
+        fprintf(file, "    {\"name\": ");
+        Json_WriteString(file, result.name);
+        fprintf(file, ", \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f, \"items_per_op\": %.0f, "
+                      "\"items_per_second\": %.0f, \"unit\": ",
+                result.ns_per_op, result.allocs_per_op, result.items_per_op,
+                result.items_per_op * 1e9 / result.ns_per_op);
+        Json_WriteString(file, result.unit);
+        fprintf(file, ", \"iterations\": %llu}%s\n",
+                (unsigned long long)result.iterations, i + 1 < g_Results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+// Números pseudoaleatórios em [lo, hi), iguais em todas as execuções
+float Random(uint32_t& state, float lo, float hi)
+{
+    state = state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(state >> 8) / (float)(1u << 24);
+}
+
+glm::vec3 RandomPoint(uint32_t& state, float extent)
+{
+    return glm::vec3(Random(state, -extent, extent), Random(state, 0.0f, 2.0f), Random(state, -extent, extent));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const char* json_filename = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json_filename = argv[++i];
+    }
+
+    Bench_CheckBuild();
+
+    // Entradas dos testes: caixas, pontos e carros espalhados em uma região
+    // pequena o suficiente para que parte dos testes dê interseção
+    uint32_t state = 12345;
+    static glm::vec3   box_min[NUM_INPUTS], box_max[NUM_INPUTS], points[NUM_INPUTS];
+    static OrientedBox boxes[NUM_INPUTS];
+    static Car         cars[NUM_INPUTS];
+    static glm::vec4   directions[NUM_INPUTS];
+    for (size_t i = 0; i < NUM_INPUTS; ++i)
+    {
+        box_min[i] = RandomPoint(state, 5.0f);
+        box_max[i] = box_min[i] + glm::vec3(Random(state, 0.5f, 3.0f), Random(state, 0.5f, 3.0f), Random(state, 0.5f, 3.0f));
+        points[i]  = RandomPoint(state, 5.0f);
+        boxes[i]   = car_oriented_box(RandomPoint(state, 4.0f), Random(state, 0.0f, 6.28f));
+
+        cars[i] = Car();
+        cars[i].carPosition    = RandomPoint(state, 100.0f);
+        cars[i].rotation_angle = Random(state, 0.0f, 6.28f);
+
+        directions[i] = glm::vec4(Random(state, -1.0f, 1.0f), Random(state, -1.0f, 1.0f), Random(state, -1.0f, 1.0f), 0.0f);
+    }
+
+    printf("%-28s %12s %10s %14s\n", "benchmark", "ns/op", "allocs/op", "vazão");
+
+    Bench("cube_cilinder_intersect", "testes", 1, [&](size_t i) {
+        size_t k = i % NUM_INPUTS;
+        return (float)cube_cilinder_intersect(box_min[k], box_max[k], points[k], 0.5f);
+    });
+    Bench("point_cube_intersect", "testes", 1, [&](size_t i) {
+        size_t k = i % NUM_INPUTS;
+        return (float)point_cube_intersect(points[k], box_min[k], box_max[k]);
+    });
+    Bench("cube_sphere_intersect", "testes", 1, [&](size_t i) {
+        size_t k = i % NUM_INPUTS;
+        return (float)cube_sphere_intersect(box_min[k], box_max[k], points[k], 0.5f);
+    });
+    Bench("obb_obb_intersect", "testes", 1, [&](size_t i) {
+        glm::vec3 separation(0.0f);
+        bool hit = obb_obb_intersect(boxes[i % NUM_INPUTS], boxes[(i + 1) % NUM_INPUTS], &separation);
+        return (float)hit + separation.x;
+    });
+
+    Bench("Matrix_Camera_View", "matrizes", 1, [&](size_t i) {
+        size_t k = i % NUM_INPUTS;
+        glm::vec4 position = glm::vec4(points[k], 1.0f);
+        glm::mat4 view = Matrix_Camera_View(position, directions[k], glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+        return view[3][0] + view[2][2];
+    });
+    Bench("Matrix_Rotate", "matrizes", 1, [&](size_t i) {
+        size_t k = i % NUM_INPUTS;
+        glm::mat4 rotation = Matrix_Rotate(points[k].x, directions[k]);
+        return rotation[0][0] + rotation[2][1];
+    });
+    Bench("Matrix_Perspective", "matrizes", 1, [&](size_t i) {
+        size_t k = i % NUM_INPUTS;
+        glm::mat4 projection = Matrix_Perspective(1.0f + 0.1f * directions[k].x, 1.25f, -0.1f, -500.0f);
+        return projection[0][0] + projection[2][3];
+    });
+
+    BezierCurve curve = {
+        glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 2.0f, 0.0f),
+        glm::vec3(3.0f, 2.0f, 1.0f), glm::vec3(4.0f, 0.0f, 1.0f)
+    };
+    Bench("BezierCurve::evaluate", "pontos", 1, [&](size_t i) {
+        glm::vec3 p = curve.evaluate((float)(i % NUM_INPUTS) / NUM_INPUTS);
+        return p.x + p.y;
+    });
+
+    Bench("ComputeCarAABB", "caixas", 1, [&](size_t i) {
+        std::pair<glm::vec3, glm::vec3> bbox = ComputeCarAABB(cars[i % NUM_INPUTS]);
+        return bbox.first.x + bbox.second.z;
+    });
+
+    // Texto parecido com o mostrado a cada quadro (veja TextRendering_ShowVelocity())
+    static const char* const text = "Velocidade: 123.45 km/h  Pontos: 6789  60.00 fps";
+    const size_t text_length = strlen(text);
+    std::vector<TextVertex> text_vertices(6 * text_length);
+    Bench("TextLayout_BuildQuads", "caracteres", (double)text_length, [&](size_t i) {
+        float x = -1.0f + 0.001f * (float)(i % NUM_INPUTS);
+        size_t count = TextLayout_BuildQuads(text, text_length, x, 0.9f, 0.002f, 0.0025f, text_vertices.data());
+        return text_vertices[count - 1].x;
+    });
+
+    try
+    {
+        ObjModel track_model("../../data/track/track.obj");
+        size_t triangles = 0;
+        for (size_t shape = 0; shape < track_model.shapes.size(); ++shape)
+            triangles += track_model.shapes[shape].mesh.num_face_vertices.size();
+
+        // As normais são apagadas antes de cada operação, senão ComputeNormals()
+        // não faz nada
+        Bench("ComputeNormals", "triângulos", (double)triangles, [&](size_t) {
+            track_model.attrib.normals.clear();
+            ComputeNormals(&track_model);
+            return track_model.attrib.normals[0];
+        });
+
+        TriangleMesh mesh;
+        Bench("BuildTriangleMesh", "triângulos", (double)triangles, [&](size_t) {
+            BuildTriangleMesh(&track_model, mesh);
+            return mesh.model_coefficients[0];
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        fprintf(stderr, "WARNING: Track model not found; skipping ComputeNormals and BuildTriangleMesh.\n");
+    }
+
+    if (json_filename != NULL && !WriteJson(json_filename))
+        return EXIT_FAILURE;
+    return 0;
+}
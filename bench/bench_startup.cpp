@@ -0,0 +1,180 @@
+// Benchmark da inicialização do jogo (veja startup.h): executa o jogo com
+// "--startup-exit", que fecha logo depois do primeiro quadro sem mostrar a
+// janela, e tira a média do tempo de cada fase em várias execuções. As
+// execuções "frias" começam sem os arquivos no cache de páginas do sistema
+// (escrevendo em /proc/sys/vm/drop_caches, o que exige root no Linux); as
+// "quentes" vêm logo depois de outra execução. Deve rodar na pasta do
+// executável do jogo, pois os caminhos de "data/" são relativos a ela.
+// O número de execuções de cada tipo pode ser passado como argumento
+// (padrão: 5).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+namespace {
+
+#ifdef _WIN32
+const char* const command = "main.exe --startup-exit --startup-json bench_startup.json > bench_startup.log 2>&1";
+#else
+const char* const command = "./main --startup-exit --startup-json bench_startup.json > bench_startup.log 2>&1";
+#endif
+
+#define MAX_PHASES 32
+
+// Soma, em todas as execuções, do tempo de cada fase (as fases repetidas,
+// como "ler obj", somadas em cada execução)
+struct StartupRuns
+{
+    int    runs;
+    double process_ms; // Do lançamento do processo até ele terminar
+    double total_ms;   // Do início de main() até o fim do primeiro quadro
+    char   names[MAX_PHASES][64];
+    double phase_ms[MAX_PHASES];
+    int    num_phases;
+};
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int PhaseIndex(StartupRuns& runs, const char* name)
+{
+    for (int i = 0; i < runs.num_phases; ++i)
+        if (strcmp(runs.names[i], name) == 0)
+            return i;
+    if (runs.num_phases == MAX_PHASES)
+        return -1;
+    strncpy(runs.names[runs.num_phases], name, sizeof(runs.names[0]) - 1);
+    runs.names[runs.num_phases][sizeof(runs.names[0]) - 1] = '\0';
+    return runs.num_phases++;
+}
+
+// Lê o JSON gravado por Startup_WriteJson(), que tem uma fase por linha
+bool ReadTimings(StartupRuns& runs, const char* filename)
+{
+    FILE* file = fopen(filename, "r");
+    if (file == NULL)
+        return false;
+
+    bool found = false;
+    char line[1024];
+    while (fgets(line, sizeof(line), file))
+    {
+        const char* total = strstr(line, "\"total_ms\": ");
+        if (total != NULL)
+        {
+            runs.total_ms += atof(total + strlen("\"total_ms\": "));
+            found = true;
+        }
+
+        const char* name = strstr(line, "\"name\": \"");
+        const char* duration = strstr(line, "\"duration_ms\": ");
+        if (name == NULL || duration == NULL)
+            continue;
+
+        name += strlen("\"name\": \"");
+        char buffer[64];
+        size_t length = strcspn(name, "\"");
+        if (length >= sizeof(buffer))
+            length = sizeof(buffer) - 1;
+        memcpy(buffer, name, length);
+        buffer[length] = '\0';
+
+        int index = PhaseIndex(runs, buffer);
+        if (index >= 0)
+            runs.phase_ms[index] += atof(duration + strlen("\"duration_ms\": "));
+    }
+    fclose(file);
+    return found;
+}
+
+// Tira os arquivos do cache de páginas. Retorna false se não for possível.
+bool DropPageCache()
+{
+#ifdef __linux__
+    if (std::system("sync") != 0)
+        return false;
+    FILE* file = fopen("/proc/sys/vm/drop_caches", "w");
+    if (file == NULL)
+        return false;
+    bool ok = fputs("3\n", file) >= 0;
+    return fclose(file) == 0 && ok;
+#else
+    return false;
+#endif
+}
+
+bool Run(StartupRuns& runs)
+{
+    remove("bench_startup.json");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int status = std::system(command);
+    double elapsed = Milliseconds(start);
+
+    if (status != 0 || !ReadTimings(runs, "bench_startup.json"))
+    {
+        fprintf(stderr, "ERROR: \"%s\" failed (see bench_startup.log).\n", command);
+        return false;
+    }
+    runs.process_ms += elapsed;
+    runs.runs += 1;
+    return true;
+}
+
+double Average(double sum, int runs)
+{
+    return runs > 0 ? sum / runs : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 5;
+    if (count < 1)
+        count = 1;
+
+    static StartupRuns cold, warm;
+
+    bool drop = DropPageCache();
+    if (!drop)
+        fprintf(stderr, "WARNING: Cannot drop the page cache (not root?); skipping cold runs.\n");
+
+    for (int i = 0; i < count && drop; ++i)
+    {
+        if (!DropPageCache() || !Run(cold))
+            return EXIT_FAILURE;
+    }
+
+    // A primeira execução só aquece o cache
+    static StartupRuns discard;
+    if (!Run(discard))
+        return EXIT_FAILURE;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!Run(warm))
+            return EXIT_FAILURE;
+    }
+
+    // As fases das execuções frias aparecem primeiro, mas todas as execuções
+    // têm as mesmas fases
+    StartupRuns& names = cold.runs > 0 ? cold : warm;
+    printf("\nMédia de %d execuções (ms):\n%-22s %10s %10s\n", count, "fase", "fria", "quente");
+    for (int i = 0; i < names.num_phases; ++i)
+    {
+        int c = PhaseIndex(cold, names.names[i]);
+        int w = PhaseIndex(warm, names.names[i]);
+        printf("%-22s %10.2f %10.2f\n", names.names[i], c >= 0 ? Average(cold.phase_ms[c], cold.runs) : 0.0,
+               w >= 0 ? Average(warm.phase_ms[w], warm.runs) : 0.0);
+    }
+    printf("%-22s %10.2f %10.2f\n", "até o primeiro quadro", Average(cold.total_ms, cold.runs),
+           Average(warm.total_ms, warm.runs));
+    printf("%-22s %10.2f %10.2f\n", "processo", Average(cold.process_ms, cold.runs),
+           Average(warm.process_ms, warm.runs));
+    if (cold.runs == 0)
+        printf("(sem execuções frias)\n");
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef BENCHBUILD_H
+#define BENCHBUILD_H
+
+#include <cstdio>
+
+// Configuração com que o benchmark foi compilado. Os resultados só podem ser
+// comparados entre compilações iguais: o Makefile e o CMakeLists.txt
+// compilam os benchmarks e o núcleo com -O2 e NDEBUG, mas um benchmark
+// compilado de outra forma (ex: junto com o núcleo de Debug) mede código de
+// depuração, várias vezes mais lento.
+
+#ifdef NDEBUG
+#define BENCH_BUILD_TYPE "release"
+#else
+#define BENCH_BUILD_TYPE "debug"
+#endif
+
+#if defined(__clang__)
+#define BENCH_COMPILER "clang " __clang_version__
+#elif defined(__GNUC__)
+#define BENCH_COMPILER "gcc " __VERSION__
+#elif defined(_MSC_VER)
+#define BENCH_STRINGIFY2(x) #x
+#define BENCH_STRINGIFY(x)  BENCH_STRINGIFY2(x)
+#define BENCH_COMPILER "msvc " BENCH_STRINGIFY(_MSC_VER)
+#else
+#define BENCH_COMPILER "desconhecido"
+#endif
+
+// Avisa se o benchmark foi compilado sem NDEBUG
+inline void Bench_CheckBuild()
+{
+#ifndef NDEBUG
+    fprintf(stderr, "WARNING: Benchmark built without NDEBUG; results measure debug code and are not comparable.\n");
+#endif
+    printf("Compilação: %s, %s\n", BENCH_BUILD_TYPE, BENCH_COMPILER);
+}
+
+#endif // BENCHBUILD_H
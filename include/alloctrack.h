@@ -0,0 +1,27 @@
+#ifndef ALLOCTRACK_H
+#define ALLOCTRACK_H
+
+#include <cstdint>
+
+// Contagem das alocações no heap.
+//
+// src/alloctrack.cpp substitui os operadores globais new e delete por versões
+// que contam as chamadas antes de repassá-las para malloc()/free(). O laço do
+// jogo e o modo headless leem os contadores antes e depois de cada quadro (ou
+// passo) para mostrar quantas alocações ele fez; depois da inicialização, o
+// esperado é zero. Os contadores são atômicos e valem para todas as threads.
+
+struct AllocCounters
+{
+    uint64_t allocations; // Chamadas de new/new[]
+    uint64_t frees;       // Chamadas de delete/delete[] com ponteiro não nulo
+    uint64_t bytes;       // Bytes pedidos por todas as alocações
+};
+
+// Valores atuais dos contadores, desde o início do programa
+AllocCounters AllocTrack_Read();
+
+// Alocações feitas desde a leitura "since"
+uint64_t AllocTrack_Since(const AllocCounters& since);
+
+#endif // ALLOCTRACK_H
@@ -0,0 +1,70 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+// Alocador para dados temporários.
+//
+// A memória é reservada uma única vez, direto do sistema operacional
+// (Memory_Reserve()), opcionalmente em páginas grandes ("huge pages"), e
+// nunca passa pelo heap depois disso (veja alloctrack.h).
+//
+// FrameArena: alocador linear. Cada alocação só avança um ponteiro, e tudo é
+// liberado de uma vez por Arena_Reset(), chamada ao fim de cada quadro (ou
+// passo da simulação). Serve para dados que vivem um quadro: vértices de
+// texto, listas de desenho, caixas de colisão de um passo.
+//
+// A arena guarda o maior uso já visto ("high water mark"), mostrado por
+// Arena_PrintStats() ao fim do jogo, para dimensionar a capacidade. Não é
+// thread-safe: cada thread deve usar a sua.
+
+// Reserva pelo menos "*bytes" bytes zerados, alinhados a uma página, e
+// arredonda "*bytes" para o tamanho realmente reservado. Com "huge_pages",
+// tenta usar páginas grandes e, se o sistema não permitir, usa páginas
+// normais; "*got_huge_pages" (se não for NULL) diz qual foi usada. Retorna
+// NULL se não houver memória.
+void* Memory_Reserve(size_t* bytes, bool huge_pages, bool* got_huge_pages);
+
+// Devolve a memória de Memory_Reserve(), com o tamanho arredondado
+void  Memory_Release(void* memory, size_t bytes);
+
+struct FrameArena
+{
+    const char* name;        // Usado nas estatísticas
+    uint8_t*    base;
+    size_t      capacity;
+    size_t      used;
+    size_t      high_water;  // Maior "used" antes de um Arena_Reset()
+    uint64_t    failures;    // Alocações recusadas por falta de espaço
+    bool        huge_pages;
+};
+
+bool  Arena_Init(FrameArena& arena, const char* name, size_t capacity, bool huge_pages = false);
+void  Arena_Free(FrameArena& arena);
+
+// Retorna NULL (e conta uma falha) se não houver espaço; o chamador decide se
+// descarta o dado ou usa outro caminho.
+void* Arena_Alloc(FrameArena& arena, size_t size, size_t alignment = 16);
+
+// Libera tudo o que foi alocado desde o último Arena_Reset()
+void  Arena_Reset(FrameArena& arena);
+
+void  Arena_PrintStats(const FrameArena& arena);
+
+// "count" objetos de tipo T, construídos com o construtor padrão. T não deve
+// precisar de destrutor: nada é destruído no Arena_Reset().
+template <typename T>
+T* Arena_New(FrameArena& arena, size_t count)
+{
+    void* memory = Arena_Alloc(arena, sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+    if (memory == NULL)
+        return NULL;
+    T* items = static_cast<T*>(memory);
+    for (size_t i = 0; i < count; ++i)
+        new (&items[i]) T();
+    return items;
+}
+
+#endif // ARENA_H
@@ -0,0 +1,90 @@
+#ifndef BONUS_H
+#define BONUS_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "ecs.h"
+
+// Objetos bônus animados ao longo de curvas de Bézier.
+//
+// Cada curva ("forma") é reparametrizada pelo comprimento de arco através de
+// uma tabela construída uma única vez, para que os bônus andem com velocidade
+// constante ao longo dela. A posição de um bônus é uma função analítica do
+// tempo global: nada é integrado passo a passo, e bônus inativos ou fora da
+// tela nunca são avaliados.
+//
+// As formas ficam em BonusSystem; cada bônus é uma entidade do cenário (veja
+// ecs.h) com os componentes BezierMover e ScoringTrigger, e as funções abaixo
+// percorrem os vetores desses componentes, avaliando quatro bônus por vez com
+// SSE.
+
+// Número de amostras da tabela comprimento de arco -> parâmetro t
+#define BONUS_ARC_TABLE_SIZE 256
+
+struct BezierCurve {
+    glm::vec3 p0; // Starting point
+    glm::vec3 p1; // Control point 1
+    glm::vec3 p2; // Control point 2
+    glm::vec3 p3; // Ending point
+
+    // Evaluate the Bezier curve at parameter t ∈ [0, 1]
+    glm::vec3 evaluate(float t) const {
+        float u = 1.0f - t;
+        float tt = t * t;
+        float uu = u * u;
+        float uuu = uu * u;
+        float ttt = tt * t;
+
+        glm::vec3 point = uuu * p0;
+        point += 3.0f * uu * t * p1;
+        point += 3.0f * u * tt * p2;
+        point += ttt * p3;
+
+        return point;
+    }
+};
+
+// Curva compartilhada por vários bônus, relativa à posição de cada um
+struct BonusShape
+{
+    glm::vec3 coefficients[4]; // Curva na base de potências: c0 + c1 t + c2 t^2 + c3 t^3
+    float     length;          // Comprimento de arco, em metros
+    glm::vec3 center;          // Esfera que contém a curva inteira
+    float     radius;
+    float     arc_to_t[BONUS_ARC_TABLE_SIZE + 1]; // t em frações iguais do comprimento
+};
+
+struct BonusSystem
+{
+    std::vector<BonusShape> shapes;
+};
+
+// Adiciona uma curva e constrói sua tabela de comprimento de arco. Retorna o
+// índice da forma.
+uint32_t Bonus_AddShape(BonusSystem& bonuses, const BezierCurve& curve);
+
+void Bonus_Clear(BonusSystem& bonuses);
+
+// Movimento que percorre a forma "shape", transladada para "origin", a
+// "speed" metros por segundo, começando na fração "phase" da curva.
+BezierMover Bonus_Mover(const BonusSystem& bonuses, uint32_t shape, glm::vec3 origin, float phase, float speed);
+
+// Posição de um bônus no instante "time".
+glm::vec3 Bonus_Position(const BonusSystem& bonuses, const BezierMover& mover, double time);
+
+// Escreve em transforms[i].position a posição de cada um dos "count" bônus
+// ativos no instante "time". Os inativos não são avaliados.
+void Bonus_EvaluateBatch(const BonusSystem& bonuses, const BezierMover* movers, const ScoringTrigger* triggers,
+                         Transform* transforms, size_t count, double time);
+
+// Desativa todos os bônus ativos que tocam a caixa [bbox_min, bbox_max] no
+// instante "time" e retorna quantos foram coletados. Somente os bônus cuja
+// curva inteira está próxima da caixa têm a posição avaliada.
+int Bonus_Collect(const BonusSystem& bonuses, const BezierMover* movers, ScoringTrigger* triggers, size_t count,
+                  glm::vec3 bbox_min, glm::vec3 bbox_max, double time);
+
+#endif // BONUS_H
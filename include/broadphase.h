@@ -0,0 +1,69 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+// Fase ampla ("broadphase") das colisões entre carros: sweep-and-prune sobre
+// as caixas alinhadas aos eixos (AABBs) de cada carro, no plano XZ.
+//
+// Os corpos são mantidos ordenados pelo início da caixa em X e em Z. Como os
+// carros andam pouco entre dois passos, as ordens do passo anterior já estão
+// quase corretas e um insertion sort as corrige em tempo praticamente linear.
+// A varredura é feita no eixo em que os carros estão mais espalhados, e só os
+// pares que se sobrepõem nos dois eixos seguem para o teste exato (veja
+// obb_obb_intersect() em collisions.h).
+
+struct SweepAndPrune
+{
+    // Caixa de cada corpo, preenchida pelo chamador antes de cada atualização
+    std::vector<float> min_x, max_x;
+    std::vector<float> min_z, max_z;
+
+    std::vector<uint32_t> order_x; // Corpos ordenados por min_x
+    std::vector<uint32_t> order_z; // Corpos ordenados por min_z
+
+    // Pares candidatos (a < b) encontrados na última atualização
+    std::vector<std::pair<uint32_t, uint32_t> > pairs;
+
+    size_t swaps; // Trocas feitas pelo insertion sort na última atualização
+};
+
+// Define o número de corpos. Se mudar, as ordens são reiniciadas.
+void SweepAndPrune_Resize(SweepAndPrune& sap, size_t count);
+
+// Reordena os corpos e recalcula os pares candidatos. Não faz alocações
+// depois que o vetor de pares atingir o seu tamanho máximo.
+void SweepAndPrune_Update(SweepAndPrune& sap);
+
+// Estado dos contatos entre pares de corpos, para que um toque que dura
+// vários passos conte como um único evento. Um par entra em contato no
+// primeiro passo em que se toca e sai depois de "exit_steps" passos seguidos
+// sem se tocar; essa folga evita que dois carros afastados pela resolução do
+// contato e empurrados de volta no passo seguinte gerem um evento por passo.
+struct ContactPair
+{
+    uint32_t a, b;      // a < b
+    uint32_t last_step; // Último passo em que o par se tocou
+};
+
+struct ContactTracker
+{
+    std::vector<ContactPair> active; // Ordenados por (a, b)
+    uint32_t                 step;
+    uint32_t                 exit_steps;
+};
+
+// Esquece todos os contatos e reserva espaço para os de "count" corpos
+void Contacts_Reset(ContactTracker& tracker, size_t count, uint32_t exit_steps);
+
+// Registra que "a" e "b" se tocam no passo atual. Retorna true se o contato
+// começou agora.
+bool Contacts_Touch(ContactTracker& tracker, uint32_t a, uint32_t b);
+
+// Fim do passo: remove os pares que saíram de contato e retorna quantos
+uint32_t Contacts_EndStep(ContactTracker& tracker);
+
+#endif // BROADPHASE_H
@@ -0,0 +1,75 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Bounding Volume Hierarchy sobre triângulos estáticos (pista e grama),
+// utilizada para consultar a altura e a normal do chão embaixo de cada roda.
+//
+// A árvore é construída uma única vez com a heurística SAH (Surface Area
+// Heuristic) e armazenada "achatada" em um vetor, em pré-ordem: o filho da
+// esquerda de um nó interno é sempre o nó seguinte, e somente o índice do
+// filho da direita é guardado. Cada nó ocupa 32 bytes (dois por linha de cache).
+
+// Número máximo de raios testados juntos durante a travessia. Raios coerentes
+// (ex: as quatro rodas do mesmo carro) percorrem a árvore uma única vez.
+#define BVH_PACKET_SIZE 4
+
+struct BvhNode
+{
+    float    bbox_min[3];
+    uint32_t index;  // Nó interno: filho da direita. Folha: primeiro triângulo.
+    float    bbox_max[3];
+    uint32_t count : 30; // Número de triângulos da folha (0 para nós internos)
+    uint32_t axis  : 2;  // Eixo da divisão, usado para percorrer os filhos em ordem
+};
+
+// Triângulo pré-processado para o teste de Möller-Trumbore.
+struct BvhTriangle
+{
+    glm::vec3 v0;
+    glm::vec3 edge1; // v1 - v0
+    glm::vec3 edge2; // v2 - v0
+};
+
+struct BVH
+{
+    std::vector<BvhNode>     nodes;
+    std::vector<BvhTriangle> triangles;
+};
+
+// Raio com origem, direção e distância máxima. Um "tmax" pequeno transforma o
+// raio em um segmento curto, o que poda a travessia muito mais cedo.
+struct BvhRay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float     tmax;
+};
+
+struct BvhHit
+{
+    float     t;        // Distância ao longo do raio
+    glm::vec3 position; // Ponto de interseção
+    glm::vec3 normal;   // Normal geométrica, virada contra o raio
+    int       triangle; // Índice do triângulo atingido, ou -1 se não houve interseção
+};
+
+// Constrói a árvore a partir de uma lista de vértices, três por triângulo,
+// já em coordenadas globais.
+void BVH_Build(BVH& bvh, const std::vector<glm::vec3>& triangle_vertices);
+
+// Retorna a interseção mais próxima de um raio.
+bool BVH_Raycast(const BVH& bvh, const BvhRay& ray, BvhHit* hit);
+
+// Testa "count" raios, em pacotes de BVH_PACKET_SIZE. Não faz alocações.
+void BVH_RaycastBatch(const BVH& bvh, const BvhRay* rays, BvhHit* hits, size_t count);
+
+// Testa "count" segmentos from[i] -> to[i]. Não faz alocações.
+void BVH_SegmentBatch(const BVH& bvh, const glm::vec3* from, const glm::vec3* to, BvhHit* hits, size_t count);
+
+#endif // BVH_H
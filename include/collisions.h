@@ -4,16 +4,34 @@
 
 #include <glm/glm.hpp>
 
+// Cilindro vertical de altura infinita: "center.y" é ignorado
 bool cube_cilinder_intersect(glm::vec3 min, glm::vec3 max, glm::vec3 center, float radius);
 
 bool point_cube_intersect(glm::vec3 point, glm::vec3 min, glm::vec3 max); 
 
 bool cube_sphere_intersect(glm::vec3 min, glm::vec3 max, glm::vec3 center, float radius);
 
-bool cube_cilinder_intersect_tree(glm::vec3 min, glm::vec3 max);
+bool cube_sphere_intersect_bonus(glm::vec3 min, glm::vec3 max, glm::vec3 pos);
 
-bool cube_cilinder_intersect_outdoor(glm::vec3 min, glm::vec3 max);
+extern float bonus_radius;
 
-bool cube_sphere_intersect_bonus(glm::vec3 min, glm::vec3 max, glm::vec3 pos);
+// Caixa orientada (OBB) que só gira em torno do eixo Y, como os carros
+struct OrientedBox
+{
+    glm::vec3 center;
+    glm::vec3 half_extents;   // Meias dimensões nos eixos locais (x, y, z)
+    float     rotation_angle; // Rotação em torno de Y, como Car::rotation_angle
+};
+
+// Caixa orientada da carroceria de um carro na posição e rotação dadas
+OrientedBox car_oriented_box(glm::vec3 position, float rotation_angle);
+
+// Caixa alinhada aos eixos que envolve a caixa orientada
+void oriented_box_bounds(const OrientedBox& box, glm::vec3* min, glm::vec3* max);
+
+// carro com carro (OBB x OBB, teorema dos eixos separadores). Se houver
+// interseção e "separation" não for nulo, retorna nele o menor deslocamento,
+// no plano XZ, que afasta "b" de "a".
+bool obb_obb_intersect(const OrientedBox& a, const OrientedBox& b, glm::vec3* separation);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "threadpool.h"
+
+// Entidades do cenário (objetos da pista, colisores, linha de chegada,
+// bônus) guardadas por arquétipo.
+//
+// Uma entidade é só um identificador com um conjunto de componentes.
+// Entidades com exatamente o mesmo conjunto formam um arquétipo, que guarda
+// um vetor contíguo para cada um dos seus componentes: a linha "r" de todos
+// os vetores é a mesma entidade. Os sistemas percorrem esses vetores em
+// sequência, sem ponteiros nem desvios por entidade, e sistemas que não
+// escrevem o que outro lê ou escreve rodam ao mesmo tempo, divididos entre as
+// threads de um ThreadPool (veja World_RunSystems()).
+//
+// Destruir uma entidade move a última linha do arquétipo para o lugar dela:
+// a ordem das linhas muda, mas os identificadores das outras continuam
+// valendo. Identificadores de entidades destruídas são reaproveitados.
+//
+// Os componentes são dados simples (copiados com memcpy, sem construtores
+// nem destrutores) e começam zerados.
+
+enum ComponentType
+{
+    COMPONENT_TRANSFORM       = 0,
+    COMPONENT_COLLIDER        = 1,
+    COMPONENT_RENDERABLE      = 2,
+    COMPONENT_BEZIER_MOVER    = 3,
+    COMPONENT_SCORING_TRIGGER = 4,
+    COMPONENT_TYPE_COUNT
+};
+
+typedef uint32_t ComponentMask;
+#define COMPONENT_BIT(type) (1u << (type))
+
+struct Transform
+{
+    glm::vec3 position;
+    float     rotation; // Radianos, em torno de Y
+    float     scale;    // Uniforme
+};
+
+// Cilindro vertical de altura infinita centrado no Transform
+struct Collider
+{
+    float radius;
+};
+
+// Conjunto de malhas desenhado para a entidade (veja DrawScene() em main.cpp)
+enum RenderMesh
+{
+    MESH_TREE        = 0,
+    MESH_OUTDOOR     = 1,
+    MESH_FINISH_LINE = 2,
+    MESH_BONUS       = 3,
+    MESH_COUNT
+};
+
+struct Renderable
+{
+    uint8_t   mesh;    // RenderMesh
+    uint8_t   visible;
+    glm::mat4 model;   // Calculada a partir do Transform antes de desenhar
+};
+
+// Percorre uma das curvas de BonusSystem (veja bonus.h), transladada para
+// "origin", em função do tempo simulado
+struct BezierMover
+{
+    uint32_t  shape;
+    float     phase;  // Fração da curva percorrida no tempo 0
+    float     rate;   // Voltas na curva por segundo
+    glm::vec3 origin;
+};
+
+enum TriggerKind
+{
+    TRIGGER_BONUS       = 0,
+    TRIGGER_FINISH_LINE = 1
+};
+
+// Área que pontua quando o carro a toca
+struct ScoringTrigger
+{
+    uint8_t   kind;   // TriggerKind
+    uint8_t   active; // Bônus já coletados ficam inativos até a próxima volta
+    glm::vec3 extent; // Meias dimensões da caixa; para bônus, extent.x é o raio da esfera
+};
+
+// Associação entre o tipo C++ de cada componente e o seu ComponentType
+template <typename T> struct ComponentTraits;
+template <> struct ComponentTraits<Transform>      { static const ComponentType type = COMPONENT_TRANSFORM; };
+template <> struct ComponentTraits<Collider>       { static const ComponentType type = COMPONENT_COLLIDER; };
+template <> struct ComponentTraits<Renderable>     { static const ComponentType type = COMPONENT_RENDERABLE; };
+template <> struct ComponentTraits<BezierMover>    { static const ComponentType type = COMPONENT_BEZIER_MOVER; };
+template <> struct ComponentTraits<ScoringTrigger> { static const ComponentType type = COMPONENT_SCORING_TRIGGER; };
+
+typedef uint32_t Entity;
+#define ENTITY_NONE 0xFFFFFFFFu
+
+struct Archetype
+{
+    ComponentMask        mask;
+    size_t               count;
+    std::vector<Entity>  entities;                      // Entidade de cada linha
+    std::vector<uint8_t> columns[COMPONENT_TYPE_COUNT]; // Vazio se o componente não faz parte
+};
+
+// Processa as linhas [begin, end) de um arquétipo
+typedef void (*SystemFunction)(void* context, Archetype& archetype, size_t begin, size_t end);
+
+struct System
+{
+    const char*    name;
+    ComponentMask  required; // Arquétipos processados: os que têm todos estes componentes
+    ComponentMask  reads;
+    ComponentMask  writes;
+    SystemFunction function;
+    void*          context;
+};
+
+// Um bloco de linhas de um arquétipo para um sistema (veja World_RunSystems())
+struct SystemJob
+{
+    const System* system;
+    uint32_t      archetype;
+    size_t        begin, end;
+};
+
+struct World
+{
+    std::vector<Archetype> archetypes;
+
+    // Arquétipo e linha de cada entidade; archetype == ENTITY_NONE se livre
+    std::vector<uint32_t> entity_archetype;
+    std::vector<uint32_t> entity_row;
+    std::vector<Entity>   free_entities;
+
+    // Reaproveitado a cada World_RunSystems()
+    std::vector<SystemJob> jobs;
+};
+
+// Destrói todas as entidades e arquétipos
+void World_Clear(World& world);
+
+// Reserva espaço para "count" entidades a mais com os componentes "mask"
+void World_Reserve(World& world, ComponentMask mask, size_t count);
+
+Entity World_Create(World& world, ComponentMask mask);
+void   World_Destroy(World& world, Entity entity);
+bool   World_IsAlive(const World& world, Entity entity);
+
+// Destrói todas as entidades com exatamente os componentes "mask"
+void World_DestroyAll(World& world, ComponentMask mask);
+
+// Arquétipo com exatamente os componentes "mask", ou NULL. O ponteiro vale
+// até o próximo World_Create() com um conjunto de componentes novo.
+Archetype* World_FindArchetype(World& world, ComponentMask mask);
+
+// Número de entidades vivas
+size_t World_Count(const World& world);
+
+// Vetor do componente T no arquétipo (NULL se o arquétipo não o tem)
+template <typename T>
+T* World_Column(Archetype& archetype)
+{
+    std::vector<uint8_t>& column = archetype.columns[ComponentTraits<T>::type];
+    return column.empty() ? NULL : reinterpret_cast<T*>(column.data());
+}
+
+template <typename T>
+const T* World_Column(const Archetype& archetype)
+{
+    const std::vector<uint8_t>& column = archetype.columns[ComponentTraits<T>::type];
+    return column.empty() ? NULL : reinterpret_cast<const T*>(column.data());
+}
+
+// Componente T de uma entidade, ou NULL se ela não o tem
+template <typename T>
+T* World_Get(World& world, Entity entity)
+{
+    if (!World_IsAlive(world, entity))
+        return NULL;
+    T* column = World_Column<T>(world.archetypes[world.entity_archetype[entity]]);
+    return column == NULL ? NULL : &column[world.entity_row[entity]];
+}
+
+// Executa os sistemas na ordem dada. Sistemas consecutivos que não entram em
+// conflito (nenhum escreve um componente que outro lê ou escreve) formam uma
+// fase; as linhas de todos os arquétipos de uma fase são divididas em blocos
+// de até "grain" linhas e distribuídas entre as threads de "pool". Uma fase só
+// começa quando a anterior termina.
+void World_RunSystems(World& world, ThreadPool& pool, const System* systems, size_t count, size_t grain);
+
+#endif // ECS_H
@@ -0,0 +1,97 @@
+#ifndef ENVBATCH_H
+#define ENVBATCH_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "fleet.h"
+#include "ecs.h"
+#include "threadpool.h"
+
+// Ambientes independentes para treinar agentes de direção.
+//
+// Cada ambiente tem o seu carro, os seus bônus, a sua pontuação e o seu
+// relógio. Os carros ficam em um Fleet (estrutura de vetores) e, por padrão,
+// usam o mesmo modelo de pneus do carro do jogador (Tire_Step()), para que o
+// que o agente aprende valha no jogo. A altura do chão não é calculada, pois
+// não influencia o resultado. Uma única chamada de EnvBatch_Step() avança
+// todos os ambientes, divididos entre as threads de um ThreadPool, e escreve as
+// observações, recompensas e fins de episódio direto nos buffers do chamador.
+//
+// Depende da pista e dos bônus já carregados (Simulation_BuildTrack() e
+// InitializeBonusObjects()).
+
+// Raios de distância até a borda da pista, espalhados à frente do carro
+#define ENV_RAYS 9
+
+// Comprimento máximo de cada raio, em metros
+#define ENV_RAY_LENGTH 30.0f
+
+// Observação de cada ambiente, em floats:
+//   x, z, vx, vz, sin(rotação), cos(rotação), velocidade, ângulo das rodas,
+//   e ENV_RAYS distâncias até a borda, em frações de ENV_RAY_LENGTH.
+#define ENV_OBSERVATION_SIZE (8 + ENV_RAYS)
+
+// Ação de cada ambiente, em floats: esterçamento (-1 direita, 1 esquerda) e
+// acelerador (-1 freio, 1 acelerador).
+#define ENV_ACTION_SIZE 2
+
+// Um episódio termina depois deste número de passos, ou quando o carro se
+// afasta mais de ENV_MAX_OFF_TRACK metros da pista.
+#define ENV_MAX_EPISODE_STEPS 7200
+#define ENV_MAX_OFF_TRACK     5.0f
+
+// Física dos carros dos ambientes
+enum EnvPhysics
+{
+    // Modelo de pneus do jogador (veja tire.h), com os mesmos comandos e a
+    // mesma velocidade de esterçamento do teclado.
+    ENV_PHYSICS_TIRE,
+
+    // Modelo cinemático dos adversários (Fleet_MoveCar()): sem derrapagem,
+    // bem mais rápido, para quem precisa de mais passos por segundo do que de
+    // fidelidade ao jogo.
+    ENV_PHYSICS_KINEMATIC
+};
+
+struct EnvBatch
+{
+    size_t     count;
+    EnvPhysics physics;
+    Fleet      cars;
+
+    // Estado do modelo de pneus que o Fleet não guarda (ENV_PHYSICS_TIRE)
+    std::vector<float> vx, vz;    // Velocidade no plano XZ
+    std::vector<float> ax, az;    // Aceleração do passo anterior (transferência de carga)
+    std::vector<float> yaw_rate;
+
+    std::vector<float>    time;      // Tempo simulado do episódio de cada ambiente
+    std::vector<uint32_t> steps;     // Passos do episódio atual
+    std::vector<float>    progress;  // Distância percorrida na trajetória (com voltas)
+    std::vector<float>    score;     // Soma das recompensas do episódio atual
+
+    size_t                   bonuses;       // Bônus de g_Scene por ambiente
+    std::vector<BezierMover> bonus_movers;  // Cópia dos movimentos dos bônus de g_Scene
+    std::vector<uint8_t>     bonus_active;  // count * bonuses
+};
+
+// Cria "count" ambientes, todos na largada, com a física "physics"
+void EnvBatch_Init(EnvBatch& envs, size_t count, EnvPhysics physics = ENV_PHYSICS_TIRE);
+
+// Reinicia o ambiente "i" (carro na largada, bônus ativos, pontuação zerada)
+void EnvBatch_Reset(EnvBatch& envs, size_t i);
+
+// Escreve a observação atual de todos os ambientes em "observations"
+// (count * ENV_OBSERVATION_SIZE floats)
+void EnvBatch_Observe(const EnvBatch& envs, ThreadPool& pool, float* observations);
+
+// Avança todos os ambientes um passo de SIMULATION_TIMESTEP com as ações de
+// "actions" (count * ENV_ACTION_SIZE floats). Escreve a recompensa de cada
+// ambiente (metros percorridos na trajetória, +10 por bônus e -1 por segundo
+// fora da pista) e se o episódio terminou. Ambientes que terminaram são
+// reiniciados, e a observação escrita já é a do novo episódio.
+void EnvBatch_Step(EnvBatch& envs, ThreadPool& pool, const float* actions,
+                   float* observations, float* rewards, uint8_t* dones);
+
+#endif // ENVBATCH_H
@@ -0,0 +1,92 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "trackfield.h"
+#include "threadpool.h"
+
+// Frota de carros controlados pela IA.
+//
+// Os carros são guardados como estrutura de vetores (SoA), um vetor por
+// campo, e atualizados em blocos distribuídos entre as threads de um
+// ThreadPool. Cada carro segue a trajetória de corrida (RacingLine) com um
+// controlador "pure pursuit" e um modelo cinemático de bicicleta; a altura e a
+// superfície do chão vêm das mesmas consultas usadas pelo carro do jogador.
+// Um carro que alcança outro da frota na mesma faixa desvia para o lado para
+// ultrapassá-lo e, se estiver perto demais, reduz até a velocidade dele. O
+// carro do jogador não é evitado; os toques com ele são resolvidos pela
+// simulação (veja ResolveCarContacts()).
+
+// Trajetória fechada ao redor da pista, com pontos a cada ~1 m
+struct RacingLine
+{
+    std::vector<glm::vec2> points;      // (x, z)
+    std::vector<float>     distance;    // Distância acumulada até cada ponto
+    std::vector<float>     speed_limit; // Velocidade máxima em cada ponto, em m/s
+    float                  length;
+};
+
+struct FleetTrackSlot
+{
+    float    distance; // Distância ao longo da trajetória
+    float    lateral;  // Deslocamento para a esquerda da trajetória
+    float    speed;
+    uint32_t car;
+};
+
+struct Fleet
+{
+    size_t count;
+
+    std::vector<float>    x, y, z;
+    std::vector<float>    rotation_angle;       // Guinada, como Car::rotation_angle
+    std::vector<float>    front_wheel_angle;    // Esterçamento (positivo para a esquerda)
+    std::vector<float>    wheel_rotation_angle;
+    std::vector<float>    speed;
+    std::vector<float>    max_speed;  // Velocidade máxima de cada piloto
+    std::vector<uint32_t> waypoint;   // Ponto da trajetória mais próximo
+    std::vector<uint32_t> laps;       // Voltas completadas
+
+    // Posição dos carros na trajetória no início do passo, ordenada pela
+    // distância percorrida, para que cada carro encontre os que estão à sua
+    // frente sem ler os campos que outras threads estão escrevendo. Refeita
+    // a cada Fleet_Step().
+    std::vector<FleetTrackSlot> by_distance;
+    std::vector<uint32_t>       rank; // Índice de cada carro em by_distance
+};
+
+// Traça a linha central da pista caminhando pelo campo de distâncias a partir
+// de "start" na direção "direction" (no plano XZ), suaviza a linha para
+// cortar as curvas sem sair do asfalto e calcula o limite de velocidade de
+// cada ponto pela curvatura. Retorna false se não conseguir fechar a volta.
+bool RacingLine_Build(RacingLine& line, const TrackField& field, glm::vec2 start, glm::vec2 direction);
+
+// Cria "count" carros em grid de largada, em duas filas atrás de "start_distance"
+// (distância ao longo da trajetória).
+void Fleet_Init(Fleet& fleet, size_t count, const RacingLine& line, float start_distance);
+
+// Avança todos os carros um passo de "deltaTime" segundos.
+void Fleet_Step(Fleet& fleet, const RacingLine& line, ThreadPool& pool, float deltaTime);
+
+// Partes de Fleet_Step() para um único carro, também usadas pelos ambientes
+// de treinamento (veja envbatch.h). Nenhuma delas faz alocações nem escreve
+// fora dos campos do carro "i", então podem rodar em paralelo.
+
+// Atualiza o ponto da trajetória mais próximo do carro (e as voltas
+// completadas) e retorna o seu índice.
+uint32_t Fleet_TrackProgress(Fleet& fleet, size_t i, const RacingLine& line);
+
+// Física do carro: "steer" de -1 (direita) a 1 (esquerda), em fração do
+// esterçamento máximo, e "throttle" de -1 (freio) a 1 (acelerador). Inclui
+// a aderência da superfície e a colisão com os objetos estáticos.
+void Fleet_MoveCar(Fleet& fleet, size_t i, float steer, float throttle, float deltaTime);
+
+// Apoia o carro no chão, com uma consulta à BVH por roda
+void Fleet_UpdateHeight(Fleet& fleet, size_t i);
+
+#endif // FLEET_H
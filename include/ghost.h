@@ -0,0 +1,93 @@
+#ifndef GHOST_H
+#define GHOST_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Carros "fantasma": a melhor volta de cada pista é gravada como uma
+// sequência de poses quantizadas (posição, guinada e ângulos das rodas) e
+// salva em disco. Na sessão seguinte o arquivo é mapeado em memória e as poses
+// são decodificadas sob demanda, com interpolação, sem nenhuma alocação por
+// quadro. Vários fantasmas podem ser reproduzidos ao mesmo tempo.
+
+// Uma pose a cada GHOST_FRAME_STEPS passos da simulação (30 por segundo)
+#define GHOST_FRAME_STEPS 4
+
+// Pose decodificada
+struct GhostPose
+{
+    glm::vec3 position;
+    float     rotation_angle;       // Guinada do carro
+    float     front_wheel_angle;    // Esterçamento das rodas dianteiras
+    float     wheel_rotation_angle; // Rotação das rodas em torno do eixo
+};
+
+// Pose quantizada, como armazenada no arquivo (12 bytes). A posição é
+// relativa a GhostFileHeader::origin, em unidades de "position_scale"
+// metros; os ângulos são frações de uma volta completa.
+struct GhostFrame
+{
+    int16_t  x, y, z;
+    uint16_t rotation_angle;
+    int16_t  front_wheel_angle;
+    uint16_t wheel_rotation_angle;
+};
+
+struct GhostFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frame_count;
+    float    frame_interval; // Segundos entre duas poses
+    float    lap_time;       // Tempo da volta gravada, em segundos
+    float    origin[3];
+    float    position_scale;
+};
+
+// Arquivo de fantasma mapeado em memória, somente para leitura.
+struct GhostPlayer
+{
+    const GhostFileHeader* header;
+    const GhostFrame*      frames;
+
+    void*  mapping; // Endereço e tamanho do mapeamento
+    size_t size;
+#ifdef _WIN32
+    void*  file_handle;
+    void*  mapping_handle;
+#else
+    int    fd;
+#endif
+};
+
+// Grava as poses da volta atual e salva a volta em disco sempre que ela for
+// mais rápida que a melhor já salva.
+struct GhostRecorder
+{
+    const char*            filename;
+    float                  best_lap_time;
+    std::vector<GhostPose> poses;
+    size_t                 laps;      // Voltas completadas na última chamada
+    double                 lap_start; // g_LapStartTime na última chamada
+    uint64_t               steps;     // Passos desde o início da volta
+};
+
+// Mapeia "filename" em memória. Retorna false se o arquivo não existir ou
+// não for válido.
+bool Ghost_Open(GhostPlayer& ghost, const char* filename);
+void Ghost_Close(GhostPlayer& ghost);
+
+// Pose do fantasma "time" segundos após o início da volta. Antes do início e
+// depois do fim da volta, o fantasma fica parado na primeira/última pose.
+void Ghost_Sample(const GhostPlayer& ghost, float time, GhostPose* pose);
+
+// Lê o tempo da volta salva em "filename", se houver, e prepara a gravação.
+void Ghost_BeginRecording(GhostRecorder& recorder, const char* filename);
+
+// Deve ser chamada logo após cada Simulation_Step().
+void Ghost_RecordStep(GhostRecorder& recorder);
+
+#endif // GHOST_H
@@ -0,0 +1,66 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/glad.h>
+
+// Cópia do estado do contexto OpenGL que descarta as chamadas que não mudam
+// nada: bind do programa, VAO, buffer, textura ou sampler que já está ligado,
+// glEnable() do que já está ligado, uniform com o valor que o programa já
+// tem, e assim por diante.
+//
+// Todo o código de desenho muda o estado por estas funções, e nunca chamando
+// o OpenGL diretamente, senão a cópia deixa de corresponder ao contexto. Cada
+// trecho do desenho declara o estado de que precisa em vez de restaurar o
+// anterior quando termina: o texto liga o blending e usa GL_ALWAYS no teste
+// de profundidade, e o início de cada quadro volta ao estado do desenho 3D.
+// Como as chamadas repetidas são descartadas, o texto, por exemplo, só muda o
+// estado na primeira string de cada quadro.
+//
+// Estado que ainda não foi definido por estas funções é desconhecido: a
+// primeira chamada sempre chega ao OpenGL. Somente uma thread por vez pode
+// usar o contexto (a do desenho, no jogo).
+
+#define GL_STATE_TEXTURE_UNITS 32
+#define GL_STATE_PROGRAMS      8  // Programas com os valores dos uniforms guardados
+#define GL_STATE_UNIFORMS      64 // Locations de uniforms guardadas por programa
+#define GL_STATE_UNIFORM_BINDINGS 16 // Pontos de ligação de uniform buffers guardados
+
+void GlState_UseProgram(GLuint program);
+
+// Apaga o programa e esquece os valores dos seus uniforms (o mesmo id pode
+// ser reaproveitado pelo próximo programa criado)
+void GlState_DeleteProgram(GLuint program);
+
+void GlState_BindVertexArray(GLuint vertex_array);
+void GlState_DeleteVertexArray(GLuint vertex_array);
+
+// GL_ELEMENT_ARRAY_BUFFER faz parte do VAO, e por isso sempre chega ao OpenGL
+void GlState_BindBuffer(GLenum target, GLuint buffer);
+void GlState_DeleteBuffer(GLuint buffer);
+
+// Liga o buffer ao ponto "index" de GL_UNIFORM_BUFFER. Como no OpenGL, também
+// o liga ao próprio GL_UNIFORM_BUFFER; outros alvos sempre chegam ao OpenGL.
+void GlState_BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+void GlState_BindTexture(GLuint unit, GLenum target, GLuint texture);
+void GlState_BindSampler(GLuint unit, GLuint sampler);
+
+// GL_DEPTH_TEST, GL_BLEND e GL_CULL_FACE são guardados; outros sempre chegam
+// ao OpenGL
+void GlState_Enable(GLenum cap);
+void GlState_Disable(GLenum cap);
+
+void GlState_BlendFunc(GLenum sfactor, GLenum dfactor);
+void GlState_DepthFunc(GLenum func);
+void GlState_DepthMask(GLboolean flag);
+void GlState_CullFace(GLenum mode);
+void GlState_FrontFace(GLenum mode);
+void GlState_PolygonMode(GLenum mode); // GL_FRONT_AND_BACK, o único do perfil core
+
+// Uniforms do programa atual
+void GlState_Uniform1i(GLint location, GLint value);
+void GlState_Uniform1f(GLint location, GLfloat value);
+void GlState_Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+void GlState_UniformMatrix4fv(GLint location, const GLfloat* value);
+
+#endif // GLSTATE_H
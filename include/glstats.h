@@ -0,0 +1,318 @@
+#ifndef GLSTATS_H
+#define GLSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "profiler.h"
+
+// Estatísticas das chamadas OpenGL de cada quadro: quantas chamadas de cada
+// tipo chegaram ao driver, quantas foram descartadas por repetir o estado
+// que o contexto já tinha (bind do mesmo VAO, glEnable() de algo já ligado,
+// uniform com o mesmo valor, ...) e quantos bytes foram enviados para
+// buffers, separadas pela zona do profiler em que a chamada foi feita (veja
+// g_ProfileZone em profiler.h).
+//
+// Incluído depois de glad.h, este arquivo troca as funções OpenGL usadas
+// pelo desenho por versões que contam as chamadas antes de chamar o driver.
+// As descartadas são contadas por glstate.cpp, que é quem conhece o estado
+// do contexto (veja glstate.h). Só é compilado com GL_STATS_ENABLED igual a
+// 1 (builds Debug do CMake, ou "make GL_STATS=1"); nos outros casos as
+// funções OpenGL não mudam e GlStats_EndFrame() e GlStats_Print() não fazem
+// nada. A tecla G imprime o relatório do último quadro.
+//
+// Somente uma thread por vez pode usar o contexto (a do desenho, no jogo).
+
+#ifndef GL_STATS_ENABLED
+#define GL_STATS_ENABLED 0
+#endif
+
+enum GlStatsCall
+{
+    GL_STATS_DRAW,         // glDrawElements(), glDrawArrays()
+    GL_STATS_UNIFORM,      // glUniform*()
+    GL_STATS_PROGRAM,      // glUseProgram()
+    GL_STATS_BIND_VAO,     // glBindVertexArray()
+    GL_STATS_BIND_BUFFER,  // glBindBuffer(), glBindBufferBase()
+    GL_STATS_BIND_TEXTURE, // glActiveTexture(), glBindTexture(), glBindSampler()
+    GL_STATS_ENABLE,       // glEnable(), glDisable()
+    GL_STATS_STATE,        // glDepthFunc(), glDepthMask(), glBlendFunc(), glCullFace(), glFrontFace(), glPolygonMode()
+    GL_STATS_UPLOAD,       // glBufferData(), glBufferSubData()
+    GL_STATS_CREATE,       // glGen*(), glDelete*() de VAOs e buffers
+    GL_STATS_CALL_COUNT
+};
+
+#define GL_STATS_ZONES (PROFILER_MAX_ZONES + 1) // A última é "fora de qualquer zona"
+
+struct GlStatsFrame
+{
+    uint32_t calls[GL_STATS_ZONES][GL_STATS_CALL_COUNT];     // Chegaram ao driver
+    uint32_t redundant[GL_STATS_ZONES][GL_STATS_CALL_COUNT]; // Descartadas por glstate.cpp
+    uint64_t bytes[GL_STATS_ZONES];
+};
+
+struct GlStats
+{
+    GlStatsFrame current; // Quadro atual
+    GlStatsFrame last;    // Último quadro terminado (veja GlStats_EndFrame())
+};
+
+extern GlStats g_GlStats;
+
+// Termina o quadro atual: as estatísticas dele passam a ser as do relatório
+void GlStats_EndFrame();
+
+// Imprime as estatísticas do último quadro, por zona
+void GlStats_Print();
+
+#if GL_STATS_ENABLED
+
+inline int GlStats_Zone()
+{
+    return g_ProfileZone < PROFILER_MAX_ZONES ? g_ProfileZone : PROFILER_MAX_ZONES;
+}
+
+inline void GlStats_Count(GlStatsCall call)
+{
+    g_GlStats.current.calls[GlStats_Zone()][call] += 1;
+}
+
+// Chamada que não chegou ao driver por repetir o estado atual
+inline void GlStats_CountRedundant(GlStatsCall call)
+{
+    g_GlStats.current.redundant[GlStats_Zone()][call] += 1;
+}
+
+inline void GlStats_CountUpload(GLsizeiptr size)
+{
+    g_GlStats.current.bytes[GlStats_Zone()] += (uint64_t)size;
+    GlStats_Count(GL_STATS_UPLOAD);
+}
+
+inline void GlStats_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    GlStats_Count(GL_STATS_DRAW);
+    glad_glDrawElements(mode, count, type, indices);
+}
+
+inline void GlStats_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    GlStats_Count(GL_STATS_DRAW);
+    glad_glDrawArrays(mode, first, count);
+}
+
+inline void GlStats_glUniform1i(GLint location, GLint v0)
+{
+    GlStats_Count(GL_STATS_UNIFORM);
+    glad_glUniform1i(location, v0);
+}
+
+inline void GlStats_glUniform1f(GLint location, GLfloat v0)
+{
+    GlStats_Count(GL_STATS_UNIFORM);
+    glad_glUniform1f(location, v0);
+}
+
+inline void GlStats_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    GlStats_Count(GL_STATS_UNIFORM);
+    glad_glUniform4f(location, v0, v1, v2, v3);
+}
+
+inline void GlStats_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    GlStats_Count(GL_STATS_UNIFORM);
+    glad_glUniformMatrix4fv(location, count, transpose, value);
+}
+
+inline void GlStats_glUseProgram(GLuint program)
+{
+    GlStats_Count(GL_STATS_PROGRAM);
+    glad_glUseProgram(program);
+}
+
+inline void GlStats_glBindVertexArray(GLuint array)
+{
+    GlStats_Count(GL_STATS_BIND_VAO);
+    glad_glBindVertexArray(array);
+}
+
+inline void GlStats_glBindBuffer(GLenum target, GLuint buffer)
+{
+    GlStats_Count(GL_STATS_BIND_BUFFER);
+    glad_glBindBuffer(target, buffer);
+}
+
+inline void GlStats_glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    GlStats_Count(GL_STATS_BIND_BUFFER);
+    glad_glBindBufferBase(target, index, buffer);
+}
+
+inline void GlStats_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    GlStats_CountUpload(data != NULL ? size : 0);
+    glad_glBufferData(target, size, data, usage);
+}
+
+inline void GlStats_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    GlStats_CountUpload(size);
+    glad_glBufferSubData(target, offset, size, data);
+}
+
+inline void GlStats_glActiveTexture(GLenum texture)
+{
+    GlStats_Count(GL_STATS_BIND_TEXTURE);
+    glad_glActiveTexture(texture);
+}
+
+inline void GlStats_glBindTexture(GLenum target, GLuint texture)
+{
+    GlStats_Count(GL_STATS_BIND_TEXTURE);
+    glad_glBindTexture(target, texture);
+}
+
+inline void GlStats_glBindSampler(GLuint unit, GLuint sampler)
+{
+    GlStats_Count(GL_STATS_BIND_TEXTURE);
+    glad_glBindSampler(unit, sampler);
+}
+
+inline void GlStats_glEnable(GLenum cap)
+{
+    GlStats_Count(GL_STATS_ENABLE);
+    glad_glEnable(cap);
+}
+
+inline void GlStats_glDisable(GLenum cap)
+{
+    GlStats_Count(GL_STATS_ENABLE);
+    glad_glDisable(cap);
+}
+
+inline void GlStats_glDepthFunc(GLenum func)
+{
+    GlStats_Count(GL_STATS_STATE);
+    glad_glDepthFunc(func);
+}
+
+inline void GlStats_glDepthMask(GLboolean flag)
+{
+    GlStats_Count(GL_STATS_STATE);
+    glad_glDepthMask(flag);
+}
+
+inline void GlStats_glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    GlStats_Count(GL_STATS_STATE);
+    glad_glBlendFunc(sfactor, dfactor);
+}
+
+inline void GlStats_glCullFace(GLenum mode)
+{
+    GlStats_Count(GL_STATS_STATE);
+    glad_glCullFace(mode);
+}
+
+inline void GlStats_glFrontFace(GLenum mode)
+{
+    GlStats_Count(GL_STATS_STATE);
+    glad_glFrontFace(mode);
+}
+
+inline void GlStats_glPolygonMode(GLenum face, GLenum mode)
+{
+    GlStats_Count(GL_STATS_STATE);
+    glad_glPolygonMode(face, mode);
+}
+
+inline void GlStats_glGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    GlStats_Count(GL_STATS_CREATE);
+    glad_glGenVertexArrays(n, arrays);
+}
+
+inline void GlStats_glGenBuffers(GLsizei n, GLuint* buffers)
+{
+    GlStats_Count(GL_STATS_CREATE);
+    glad_glGenBuffers(n, buffers);
+}
+
+inline void GlStats_glDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    GlStats_Count(GL_STATS_CREATE);
+    glad_glDeleteVertexArrays(n, arrays);
+}
+
+inline void GlStats_glDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    GlStats_Count(GL_STATS_CREATE);
+    glad_glDeleteBuffers(n, buffers);
+}
+
+#undef glDrawElements
+#undef glDrawArrays
+#undef glUniform1i
+#undef glUniform1f
+#undef glUniform4f
+#undef glUniformMatrix4fv
+#undef glUseProgram
+#undef glBindVertexArray
+#undef glBindBuffer
+#undef glBindBufferBase
+#undef glBufferData
+#undef glBufferSubData
+#undef glActiveTexture
+#undef glBindTexture
+#undef glBindSampler
+#undef glEnable
+#undef glDisable
+#undef glDepthFunc
+#undef glDepthMask
+#undef glBlendFunc
+#undef glCullFace
+#undef glFrontFace
+#undef glPolygonMode
+#undef glGenVertexArrays
+#undef glGenBuffers
+#undef glDeleteVertexArrays
+#undef glDeleteBuffers
+
+#define glDrawElements       GlStats_glDrawElements
+#define glDrawArrays         GlStats_glDrawArrays
+#define glUniform1i          GlStats_glUniform1i
+#define glUniform1f          GlStats_glUniform1f
+#define glUniform4f          GlStats_glUniform4f
+#define glUniformMatrix4fv   GlStats_glUniformMatrix4fv
+#define glUseProgram         GlStats_glUseProgram
+#define glBindVertexArray    GlStats_glBindVertexArray
+#define glBindBuffer         GlStats_glBindBuffer
+#define glBindBufferBase     GlStats_glBindBufferBase
+#define glBufferData         GlStats_glBufferData
+#define glBufferSubData      GlStats_glBufferSubData
+#define glActiveTexture      GlStats_glActiveTexture
+#define glBindTexture        GlStats_glBindTexture
+#define glBindSampler        GlStats_glBindSampler
+#define glEnable             GlStats_glEnable
+#define glDisable            GlStats_glDisable
+#define glDepthFunc          GlStats_glDepthFunc
+#define glDepthMask          GlStats_glDepthMask
+#define glBlendFunc          GlStats_glBlendFunc
+#define glCullFace           GlStats_glCullFace
+#define glFrontFace          GlStats_glFrontFace
+#define glPolygonMode        GlStats_glPolygonMode
+#define glGenVertexArrays    GlStats_glGenVertexArrays
+#define glGenBuffers         GlStats_glGenBuffers
+#define glDeleteVertexArrays GlStats_glDeleteVertexArrays
+#define glDeleteBuffers      GlStats_glDeleteBuffers
+
+#else
+
+inline void GlStats_CountRedundant(GlStatsCall) {}
+
+#endif // GL_STATS_ENABLED
+
+#endif // GLSTATS_H
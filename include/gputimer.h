@@ -0,0 +1,42 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+// Tempo de GPU de cada passo do desenho, medido com queries GL_TIME_ELAPSED.
+//
+// Os resultados só são lidos GPU_TIMER_LATENCY quadros depois, quando a GPU
+// já terminou o quadro medido, para que a leitura nunca espere por ela. Eles
+// vão para o profiler (veja profiler.h) como zonas "gpu ..." de uma thread a
+// mais, "GPU": aparecem no painel da tecla P e nos traces. Com a extensão
+// ARB_pipeline_statistics_query, o número de execuções do vertex shader e do
+// fragment shader de cada passo vira um contador do profiler.
+//
+// Os passos não podem ser aninhados (o OpenGL só permite uma query
+// GL_TIME_ELAPSED ativa de cada vez). Sem o profiler ligado, nada é medido.
+
+enum GpuPass
+{
+    GPU_PASS_CAR,    // Carro do jogador
+    GPU_PASS_PROPS,  // Adversários e objetos do cenário
+    GPU_PASS_SKYBOX,
+    GPU_PASS_GROUND, // Pista e grama
+    GPU_PASS_GHOSTS,
+    GPU_PASS_TEXT,   // Texto e painel do profiler
+    GPU_PASS_COUNT
+};
+
+#define GPU_TIMER_LATENCY 4 // Quadros entre medir um passo e ler o resultado
+
+// Cria as queries. Chamada com o contexto OpenGL atual.
+void GpuTimer_Init();
+
+// Lê os resultados prontos. Chamada no início de cada quadro, antes do
+// primeiro GpuTimer_BeginPass().
+void GpuTimer_BeginFrame();
+
+void GpuTimer_BeginPass(GpuPass pass);
+void GpuTimer_EndPass();
+
+// A GPU conta as execuções dos shaders (ARB_pipeline_statistics_query)?
+bool GpuTimer_HasPipelineStatistics();
+
+#endif // GPUTIMER_H
@@ -0,0 +1,38 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Modo "headless": executa a simulação do jogo sem janela e sem OpenGL, o
+// mais rápido possível, a partir de um roteiro de teclas. Útil para medir
+// desempenho, comparar mudanças na física e gerar voltas de referência.
+//
+// Uso: main --headless <roteiro.txt> [--laps N] [--max-steps N] [--record <arquivo>]
+//      main --headless --replay <arquivo>
+//      (outras opções: --ghost <arquivo>, --bonuses N, --opponents N,
+//      --assert-no-alloc)
+//
+// Cada linha do roteiro tem o formato "<passos> <teclas>", onde <teclas> é
+// uma combinação de W, S, A, D e R (voltar no tempo, veja
+// Simulation_Rewind()), ou "-" para nenhuma tecla. Cada passo dura
+// SIMULATION_TIMESTEP segundos. Linhas iniciadas por '#' são ignoradas.
+// O roteiro é repetido até completar o número de voltas pedido.
+//
+// Com "--record", as entradas são gravadas em um replay (veja replay.h). Com
+// "--replay", um replay gravado aqui ou no jogo é reproduzido até o fim e os
+// checksums do estado são conferidos a cada segundo simulado; "--bonuses" e
+// "--opponents" vêm do replay e, se passados, devem ser iguais aos gravados.
+// Com "--ghost", a melhor volta é salva como fantasma (veja ghost.h).
+// "--bonuses N" espalha N bônus pela pista, para testes de carga, e
+// "--opponents N" coloca N adversários da IA na pista (veja fleet.h).
+//
+// As alocações no heap feitas pelo laço da simulação depois de um
+// aquecimento são sempre mostradas (veja alloctrack.h); com
+// "--assert-no-alloc", qualquer alocação faz o programa terminar com erro,
+// assim como uma execução curta demais para passar do aquecimento. O laço do
+// jogo com janela tem a sua própria opção "--assert-no-alloc <quadros>" (veja
+// main.cpp).
+// Gravar um fantasma ("--ghost") em voltas de mais de 2 minutos ainda pode
+// alocar, quando o buffer de poses precisa crescer.
+
+int Headless_Run(int argc, char* argv[]);
+
+#endif // HEADLESS_H
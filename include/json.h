@@ -0,0 +1,15 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdio>
+
+// Funções comuns aos arquivos JSON gravados pelo jogo e pelos benchmarks
+// (trace do profiler, tempos da inicialização, resultados dos benchmarks).
+// As chaves desses arquivos são sempre em inglês, com a unidade no fim do
+// nome (ex: "duration_ms", "ns_per_op").
+
+// Grava "text" entre aspas, escapando aspas, barras invertidas e caracteres
+// de controle. NULL é gravado como "".
+void Json_WriteString(FILE* file, const char* text);
+
+#endif // JSON_H
@@ -0,0 +1,37 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <cstdint>
+
+// Medida de latências (ex: do evento de teclado até a troca de buffers do
+// quadro que mostra o seu efeito, veja RenderThread() em main.cpp), em
+// microssegundos. As amostras vão para um histograma de tamanho fixo, então
+// Latency_Add() não aloca memória e os percentis saem sem guardar cada
+// amostra. Não é thread-safe: cada sonda deve ser usada por uma única thread.
+
+#define LATENCY_BUCKET_US 250 // Largura de cada faixa do histograma
+#define LATENCY_BUCKETS   400 // Amostras acima de 100 ms vão para a última faixa
+
+struct LatencyProbe
+{
+    const char* name;    // Usado por Latency_Print()
+    uint64_t    samples;
+    double      sum_us;
+    double      max_us;
+    double      last_us;
+    uint32_t    buckets[LATENCY_BUCKETS];
+};
+
+void Latency_Init(LatencyProbe& probe, const char* name);
+
+// Registra uma amostra, em segundos
+void Latency_Add(LatencyProbe& probe, double seconds);
+
+// Menor latência (em microssegundos, arredondada para cima até o fim da
+// faixa) que é maior ou igual a "fraction" das amostras. Zero sem amostras.
+double Latency_Percentile(const LatencyProbe& probe, double fraction);
+
+// Imprime o número de amostras, a média, p50, p99 e o máximo
+void Latency_Print(const LatencyProbe& probe);
+
+#endif // LATENCY_H
@@ -0,0 +1,76 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Descrição da pista: objetos do cenário, colisores, bônus e linha de
+// chegada, lidos de um arquivo de texto (data/level/level.txt) em vez de
+// espalhados pelo código.
+//
+// Na primeira execução o texto é interpretado e o resultado é salvo em um
+// arquivo binário ao lado dele; nas seguintes o binário é lido direto para os
+// vetores abaixo, desde que o texto não tenha mudado (mesmo esquema do campo
+// de distâncias, veja trackfield.h).
+//
+// Tudo fica em estruturas de vetores: as entidades do cenário desenhadas e
+// testadas pelo jogo são criadas a partir delas (veja g_Scene em
+// simulation.h), e as colisões usam uma grade uniforme sobre os colisores,
+// então acrescentar mil árvores é só acrescentar mil linhas ao arquivo.
+//
+// Formato do texto, uma entrada por linha ('#' inicia um comentário; ângulos
+// em graus em torno de Y, escala uniforme, ambos opcionais):
+//
+//   tree     x y z [rotação] [escala]   árvore, com um colisor no tronco
+//   outdoor  x y z [rotação] [escala]   outdoor, com um colisor em cada poste
+//   finish   x y z [rotação] [escala]   linha de chegada (e a sua área de detecção)
+//   collider x z raio                   colisor invisível (cilindro vertical)
+//   bonus    x y z                      bônus
+
+enum PropKind
+{
+    PROP_TREE        = 0,
+    PROP_OUTDOOR     = 1,
+    PROP_FINISH_LINE = 2,
+    PROP_KIND_COUNT
+};
+
+struct Level
+{
+    // Objetos desenhados
+    std::vector<uint8_t> prop_kind;     // PropKind
+    std::vector<float>   prop_x, prop_y, prop_z;
+    std::vector<float>   prop_rotation; // Radianos, em torno de Y
+    std::vector<float>   prop_scale;
+
+    // Colisores: cilindros verticais de altura infinita
+    std::vector<float> collider_x, collider_z, collider_radius;
+
+    // Bônus
+    std::vector<float> bonus_x, bonus_y, bonus_z;
+
+    // Área que conta uma volta ao ser atravessada
+    glm::vec3 finish_min, finish_max;
+
+    // Grade uniforme sobre os colisores (montada ao carregar, não é salva):
+    // os colisores da célula c são grid_items[grid_start[c] .. grid_start[c+1]).
+    glm::vec2             grid_origin;
+    float                 grid_cell_size;
+    int                   grid_width, grid_height;
+    float                 grid_max_radius;
+    std::vector<uint32_t> grid_start;
+    std::vector<uint32_t> grid_items;
+};
+
+// Lê "binary_filename" ou, se ele não existir ou tiver sido gerado a partir
+// de outro texto, interpreta "text_filename" e salva o binário. Retorna false
+// (com uma mensagem de erro) se o texto não puder ser lido ou tiver erros.
+bool Level_Load(Level& level, const char* text_filename, const char* binary_filename);
+
+// Se a caixa (alinhada aos eixos) toca algum colisor. Só lê o Level, então
+// pode ser chamada de várias threads ao mesmo tempo.
+bool Level_Intersect(const Level& level, glm::vec3 bbox_min, glm::vec3 bbox_max);
+
+#endif // LEVEL_H
@@ -0,0 +1,105 @@
+#ifndef OBJMODEL_H
+#define OBJMODEL_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+// Headers da biblioteca para carregar modelos obj
+#include <tiny_obj_loader.h>
+
+// Estrutura que representa um modelo geométrico carregado a partir de um
+// arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
+
+struct ObjModel
+{
+    tinyobj::attrib_t                 attrib;
+    std::vector<tinyobj::shape_t>     shapes;
+    std::vector<tinyobj::material_t>  materials;
+
+    // Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
+    // Veja: https://github.com/syoyo/tinyobjloader
+    ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true)
+    {
+        printf("Carregando objetos do arquivo \"%s\"...\n", filename);
+
+        // Se basepath == NULL, então setamos basepath como o dirname do
+        // filename, para que os arquivos MTL sejam corretamente carregados caso
+        // estejam no mesmo diretório dos arquivos OBJ.
+        std::string fullpath(filename);
+        std::string dirname;
+        if (basepath == NULL)
+        {
+            auto i = fullpath.find_last_of("/");
+            if (i != std::string::npos)
+            {
+                dirname = fullpath.substr(0, i+1);
+                basepath = dirname.c_str();
+            }
+        }
+
+        std::string warn;
+        std::string err;
+        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, basepath, triangulate);
+
+        if (!err.empty())
+            fprintf(stderr, "\n%s\n", err.c_str());
+
+        if (!ret)
+            throw std::runtime_error("Erro ao carregar modelo.");
+
+        for (size_t shape = 0; shape < shapes.size(); ++shape)
+        {
+            if (shapes[shape].name.empty())
+            {
+                fprintf(stderr,
+                        "*********************************************\n"
+                        "Erro: Objeto sem nome dentro do arquivo '%s'.\n"
+                        "Veja https://www.inf.ufrgs.br/~eslgastal/fcg-faq-etc.html#Modelos-3D-no-formato-OBJ .\n"
+                        "*********************************************\n",
+                    filename);
+                throw std::runtime_error("Objeto sem nome.");
+            }
+            printf("- Objeto '%s'\n", shapes[shape].name.c_str());
+        }
+
+        printf("OK.\n");
+    }
+};
+
+void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
+
+// Um objeto (shape) de uma TriangleMesh
+struct TriangleMeshObject
+{
+    std::string name;
+    size_t      first_index; // Posição do primeiro índice em TriangleMesh::indices
+    size_t      num_indices;
+    glm::vec3   bbox_min;
+    glm::vec3   bbox_max;
+};
+
+// Triângulos de um ObjModel no formato dos buffers da GPU, montados sem
+// OpenGL por BuildTriangleMesh() e enviados por
+// BuildTrianglesAndAddToVirtualScene() em main.cpp
+struct TriangleMesh
+{
+    std::vector<uint32_t>           indices;
+    std::vector<float>              model_coefficients;   // vec4 por vértice
+    std::vector<float>              normal_coefficients;  // vec4 por vértice, se o modelo tem normais
+    std::vector<float>              texture_coefficients; // vec2 por vértice, se o modelo tem coordenadas de textura
+    std::vector<TriangleMeshObject> objects;
+};
+
+// Monta "mesh" a partir do modelo. Os vetores são reaproveitados.
+void BuildTriangleMesh(const ObjModel* model, TriangleMesh& mesh);
+
+// Adiciona os triângulos de um objeto de um ObjModel, transformados pela
+// matriz "model", à lista usada na construção da BVH do chão.
+void AddObjModelTrianglesToList(ObjModel* model, const char* object_name, glm::mat4 transform, std::vector<glm::vec3>& triangles);
+
+#endif // OBJMODEL_H
@@ -0,0 +1,225 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "spsc.h"
+
+// Medição do tempo de CPU de trechos ("zonas") do jogo, quadro a quadro.
+//
+// PROFILE_ZONE("nome") mede o tempo até o fim do bloco em que aparece. Cada
+// medida vai para uma fila sem travas da thread que a fez (veja spsc.h), e
+// uma única thread (a do desenho, no jogo) chama Profiler_EndFrame() ao fim
+// de cada quadro: ela esvazia as filas de todas as threads e soma o tempo de
+// cada zona no quadro. Os últimos PROFILER_HISTORY quadros ficam guardados
+// para os percentis e o gráfico do tempo de quadro (veja profileroverlay.cpp).
+//
+// PROFILE_COUNT("nome", n) soma n a um contador do quadro atual (chamadas de
+// desenho, bytes enviados à GPU, ...). Os nomes das zonas e dos contadores
+// aparecem no painel, cuja fonte só tem ASCII: não use acentos.
+// Profiler_BeginCapture() grava as zonas e os contadores dos próximos quadros
+// em um arquivo JSON no formato "trace event" do Chrome, que pode ser aberto
+// em chrome://tracing ou no Perfetto (https://ui.perfetto.dev).
+//
+// Compilado com PROFILER_ENABLED igual a 0 (opção PROFILER do CMake, ou
+// "make PROFILER=0"), PROFILE_ZONE() não gera código. Compilado, mas com o
+// profiler desligado (Profiler_SetEnabled()), cada zona custa uma leitura
+// atômica. Zonas aninhadas são medidas separadamente: o tempo da interna
+// também conta na externa.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_MAX_ZONES      64
+#define PROFILER_MAX_THREADS    32
+#define PROFILER_QUEUE_CAPACITY 4096 // Medidas por thread entre dois Profiler_EndFrame()
+#define PROFILER_HISTORY        240  // Quadros guardados
+#define PROFILER_MAX_COUNTERS   32
+#define PROFILER_CAPTURE_FRAMES 300  // Quadros de uma captura, se não especificado
+#define PROFILER_NO_ZONE        0xFFFF // Fora de qualquer zona (veja g_ProfileZone)
+
+struct ProfileEvent
+{
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    uint16_t zone;
+};
+
+// Medida guardada por uma captura, com a thread que a fez
+struct ProfileCaptureEvent
+{
+    ProfileEvent event;
+    uint8_t      thread; // Índice em Profiler::threads
+};
+
+// Quadro guardado por uma captura
+struct ProfileCaptureFrame
+{
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    int64_t  counters[PROFILER_MAX_COUNTERS];
+};
+
+// Fila de medidas de uma thread, criada na primeira zona que ela mede
+struct ProfileThread
+{
+    const char*                                        name;    // Veja Profiler_SetThreadName()
+    std::atomic<uint64_t>                              dropped; // Medidas perdidas com a fila cheia
+    SpscQueue<ProfileEvent, PROFILER_QUEUE_CAPACITY>   events;
+
+    ProfileThread() : name(NULL), dropped(0) {}
+};
+
+struct Profiler
+{
+    std::atomic<bool> enabled;
+
+    // Zonas e threads conhecidas. Só crescem, protegidas por "registry".
+    std::mutex             registry;
+    const char*            zone_names[PROFILER_MAX_ZONES];
+    std::atomic<int>       zone_count;
+    ProfileThread*         threads[PROFILER_MAX_THREADS];
+    std::atomic<int>       thread_count;
+    const char*            counter_names[PROFILER_MAX_COUNTERS];
+    std::atomic<int>       counter_count;
+
+    // Contadores do quadro atual, somados por qualquer thread
+    std::atomic<int64_t>   counters[PROFILER_MAX_COUNTERS];
+
+    // Usados somente pela thread que chama Profiler_EndFrame()
+    uint64_t frames;                                        // Quadros terminados
+    uint64_t frame_begin_ns;                                // Início do quadro atual
+    float    frame_ms[PROFILER_HISTORY];                    // Duração de cada quadro
+    float    zone_ms[PROFILER_MAX_ZONES][PROFILER_HISTORY]; // Tempo de cada zona em cada quadro
+    uint32_t zone_calls[PROFILER_MAX_ZONES];                // Medidas de cada zona no último quadro
+    int64_t  counter_values[PROFILER_MAX_COUNTERS];         // Contadores do último quadro
+
+    // Captura em andamento (veja Profiler_BeginCapture())
+    const char*                      capture_filename;
+    int                              capture_remaining;  // Quadros que faltam; 0 sem captura
+    uint64_t                         capture_begin_ns;
+    uint64_t                         capture_dropped;    // Medidas que não couberam no espaço reservado
+    std::vector<ProfileCaptureEvent> capture_events;
+    std::vector<ProfileCaptureFrame> capture_frames;
+
+    Profiler() : enabled(false), zone_count(0), thread_count(0), counter_count(0), frames(0), frame_begin_ns(0),
+                 capture_filename(NULL), capture_remaining(0), capture_begin_ns(0),
+                 capture_dropped(0)
+    {
+        for (int c = 0; c < PROFILER_MAX_COUNTERS; ++c)
+        {
+            counters[c] = 0;
+            counter_values[c] = 0;
+        }
+    }
+};
+
+extern Profiler g_Profiler;
+
+// Zona mais interna em que a thread atual está, ou PROFILER_NO_ZONE. Usada
+// para separar as estatísticas das chamadas OpenGL por zona (veja glstats.h).
+extern thread_local uint16_t g_ProfileZone;
+
+// Relógio monotônico em nanossegundos
+uint64_t Profiler_Now();
+
+void Profiler_SetEnabled(bool enabled);
+
+// Índice da zona "name" (a mesma string literal em todas as chamadas)
+uint16_t Profiler_RegisterZone(const char* name);
+
+// Índice do contador "name" (a mesma string literal em todas as chamadas)
+uint16_t Profiler_RegisterCounter(const char* name);
+
+// Nome da thread atual nos relatórios (string literal)
+void Profiler_SetThreadName(const char* name);
+
+// Soma "amount" ao contador no quadro atual. Use PROFILE_COUNT().
+inline void Profiler_Count(uint16_t counter, int64_t amount)
+{
+    if (g_Profiler.enabled.load(std::memory_order_relaxed))
+        g_Profiler.counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+// Fila para medidas que não são do tempo de CPU de uma thread (como as da
+// GPU, veja gputimer.h), mostrada como uma thread a mais nos relatórios.
+// Como nas threads, só uma thread pode registrar medidas nela.
+ProfileThread* Profiler_AddTrack(const char* name);
+
+// Registra uma medida da thread atual (veja ProfileScope)
+void Profiler_Record(uint16_t zone, uint64_t begin_ns, uint64_t end_ns);
+
+// Registra uma medida em uma fila de Profiler_AddTrack()
+void Profiler_RecordOn(ProfileThread* track, uint16_t zone, uint64_t begin_ns, uint64_t end_ns);
+
+// Termina o quadro atual: esvazia as filas de todas as threads e guarda o
+// tempo de cada zona, os contadores e a duração do quadro (desde o
+// Profiler_EndFrame() anterior). Se este é o último quadro de uma captura,
+// escreve o arquivo.
+void Profiler_EndFrame();
+
+// Grava os próximos "frames" quadros em "filename" (string que precisa
+// existir até o fim da captura). Chamada pela mesma thread que chama
+// Profiler_EndFrame(), ou antes dela começar. Retorna false se já há uma
+// captura em andamento.
+bool Profiler_BeginCapture(const char* filename, int frames);
+
+// Escreve as medidas capturadas no formato "trace event" do Chrome
+bool Profiler_WriteCapture(const char* filename);
+
+// Quadros guardados no histórico (até PROFILER_HISTORY)
+size_t Profiler_HistorySize();
+
+// Índice no histórico do i-ésimo quadro guardado, do mais antigo (0) ao mais novo
+size_t Profiler_HistoryIndex(size_t i);
+
+// Menor duração de quadro, em ms, maior ou igual a "fraction" dos quadros do histórico
+float Profiler_FramePercentile(float fraction);
+
+// Tempo médio da zona por quadro no histórico, em ms
+float Profiler_ZoneAverage(int zone);
+
+// Mede o tempo de vida do objeto. Use PROFILE_ZONE().
+struct ProfileScope
+{
+    uint16_t zone;
+    uint16_t parent; // g_ProfileZone antes desta zona
+    uint64_t begin_ns;
+
+    explicit ProfileScope(uint16_t zone) : zone(zone), parent(g_ProfileZone)
+    {
+        g_ProfileZone = zone;
+        begin_ns = g_Profiler.enabled.load(std::memory_order_relaxed) ? Profiler_Now() : 0;
+    }
+
+    ~ProfileScope()
+    {
+        if (begin_ns != 0)
+            Profiler_Record(zone, begin_ns, Profiler_Now());
+        g_ProfileZone = parent;
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) \
+    static const uint16_t PROFILE_CONCAT(profile_zone_, __LINE__) = Profiler_RegisterZone(name); \
+    ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_zone_, __LINE__))
+#define PROFILE_COUNT(name, amount) \
+    do { \
+        static const uint16_t profile_counter = Profiler_RegisterCounter(name); \
+        Profiler_Count(profile_counter, (int64_t)(amount)); \
+    } while (0)
+#else
+#define PROFILE_ZONE(name) do { } while (0)
+#define PROFILE_COUNT(name, amount) do { } while (0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,87 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+// Gravação e reprodução determinística das entradas do jogador.
+//
+// Como a simulação avança em passos fixos (veja SIMULATION_TIMESTEP), basta
+// gravar a máscara de entradas (INPUT_KEY_W, ...) de cada passo para
+// reproduzir uma partida exatamente, tanto na janela quanto no modo headless.
+//
+// O arquivo começa com um ReplayHeader, que também guarda o número de
+// adversários e de bônus da partida (eles mudam os checksums), seguido de uma sequência de registros:
+//   - Trecho:   1 byte com a máscara de entradas (bit 7 zerado) e o número de
+//               passos consecutivos com essa máscara, como inteiro variável
+//               (7 bits por byte, LEB128).
+//   - Checksum: 1 byte REPLAY_CHECKSUM_TAG, o número do passo (LEB128) e o
+//               Simulation_Checksum() após aquele passo (4 bytes).
+// Entradas mantidas por muitos passos ocupam poucos bytes: um segundo de
+// aceleração em linha reta são 3 bytes.
+
+// A cada quantos passos um checksum do estado é gravado (1 s de jogo)
+#define REPLAY_CHECKSUM_INTERVAL 120
+
+#define REPLAY_CHECKSUM_TAG 0x80
+
+struct ReplayHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    float    timestep;          // SIMULATION_TIMESTEP na gravação
+    uint32_t checksum_interval;
+    int32_t  opponents;         // Veja Simulation_SpawnOpponents()
+    int32_t  bonuses;           // Veja InitializeBonusObjects(); 0 usa os da pista
+};
+
+struct ReplayRecorder
+{
+    FILE*    file;
+    uint8_t  input;  // Máscara do trecho atual
+    uint64_t run;    // Passos no trecho atual
+    uint64_t steps;  // Total de passos gravados
+};
+
+struct ReplayPlayer
+{
+    std::vector<uint8_t> data;
+    ReplayHeader header;
+    size_t   offset;
+    uint8_t  input;      // Máscara do trecho atual
+    uint64_t remaining;  // Passos restantes no trecho atual
+    uint64_t steps;      // Passos já reproduzidos
+    uint64_t checksums;  // Checksums conferidos
+    bool     desync;     // Algum checksum não conferiu
+};
+
+// Abre "filename" para gravação de uma partida com "opponents" adversários e
+// "bonuses" bônus. Retorna false se não for possível criá-lo.
+bool Replay_BeginRecording(ReplayRecorder& recorder, const char* filename, int opponents, int bonuses);
+
+// Grava a entrada de um passo. Deve ser chamada logo após Simulation_Step(),
+// para que os checksums reflitam o estado depois do passo.
+void Replay_RecordStep(ReplayRecorder& recorder, uint8_t input);
+
+// Grava o trecho pendente e fecha o arquivo.
+void Replay_EndRecording(ReplayRecorder& recorder);
+
+// Lê o replay inteiro para a memória.
+bool Replay_Load(ReplayPlayer& player, const char* filename);
+
+// Usa o número de adversários e de bônus gravados no replay. Valores já
+// escolhidos pelo usuário (maiores ou iguais a zero) devem ser iguais aos
+// gravados; senão retorna false. Deve ser chamada antes de
+// InitializeBonusObjects() e Simulation_SpawnOpponents().
+bool Replay_ApplySetup(const ReplayPlayer& player, int* opponents, int* bonuses);
+
+// Entrada do próximo passo. Retorna false quando o replay terminou.
+bool Replay_NextInput(ReplayPlayer& player, uint8_t* input);
+
+// Confere o checksum gravado para o passo que acabou de ser simulado, se
+// houver. Deve ser chamada logo após Simulation_Step(). Retorna false na
+// primeira divergência.
+bool Replay_VerifyStep(ReplayPlayer& player);
+
+#endif // REPLAY_H
@@ -0,0 +1,239 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+// Lógica do jogo independente de OpenGL/GLFW: carro, objetos bônus,
+// pontuação e colisões. É compilada na biblioteca "core", usada tanto pela
+// janela (main.cpp) quanto pelo modo headless (headless.cpp).
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "trackfield.h"
+#include "objmodel.h"
+#include "bonus.h"
+#include "fleet.h"
+#include "threadpool.h"
+#include "snapshot.h"
+#include "arena.h"
+#include "level.h"
+#include "ecs.h"
+
+#define PI 3.141592f
+
+// A simulação sempre avança em passos fixos deste tamanho (em segundos), para
+// que o resultado não dependa da taxa de quadros.
+#define SIMULATION_TIMESTEP (1.0f / 120.0f)
+
+#define TIMEOUT_FINISH_LINE 5.0f
+
+// Alturas em que a pista e a grama são desenhadas
+#define TRACK_HEIGHT -0.98f
+#define PLANE_HEIGHT -1.0f
+
+// Altura da origem do carro em relação ao chão
+#define CAR_RIDE_HEIGHT 0.03f
+
+struct Car
+{
+    glm::vec3 carPosition; 
+    glm::vec3 carVelocity;
+    glm::vec3 carAcceleration;
+    glm::vec3 carDirection;
+    
+    float speed; // Velocidade atual do carro
+    float acceleration; // Aceleração (ou RPM) do carro
+    float acceleration_rate; // Taxa de aceleração
+    float deceleration_rate; // Taxa de desaceleração
+    
+    float max_speed; // Velocidade máxima do carro
+    float max_acceleration; // Aceleracao Máxima do carro
+    
+    float wheel_rotation_angle; // Angulo atual de rotacao das rodas (foi feita simplificacao de todas rodas terem a mesma rotacao)
+    float rotation_angle; // Angulo de rotacao do carro
+
+    float yaw_rate; // Velocidade de rotação do carro em torno do eixo vertical, em rad/s
+    float drift_angle; // Ângulo entre a direção do carro e a direção do movimento (veja tire.h)
+
+    float front_wheel_angle; // Angulo atual de rotação das rodas dianteiras
+    float max_front_wheel_angle; // Ângulo máximo de rotação das rodas dianteiras
+    float negative_camber_angle; // Ângulo de cambagem das rodas
+
+    glm::vec3 frontLeftWheelPosition; // Posição da roda dianteira esquerda
+    glm::vec3 frontRightWheelPosition; // Posição da roda dianteira direita
+    glm::vec3 rearLeftWheelPosition; // Posição da roda traseira esquerda
+    glm::vec3 rearRightWheelPosition; // Posição da roda traseira direita
+
+    glm::mat4 frontLeftWheelTransform; 
+    glm::mat4 frontRightWheelTransform; 
+    glm::mat4 rearLeftWheelTransform; 
+    glm::mat4 rearRightWheelTransform; 
+
+    glm::vec3 groundNormal; // Normal média do chão embaixo das quatro rodas
+    TrackSample surface; // Superfície embaixo do centro do carro (veja g_TrackField)
+
+    int pontuation;
+    float pontuation_multiplier;
+
+    // Construtor
+    Car() 
+        : carPosition(0.0f, -0.95f, 0.0f),
+          carVelocity(0.0f, 0.0f, 0.0f), 
+          carAcceleration(0.0f, 0.0f, 0.0f), 
+          carDirection(0.0f, 0.0f, -1.0f),
+          speed(0.0f), 
+          acceleration(0.0f), 
+          acceleration_rate(10.0f), 
+          deceleration_rate(5.0f),
+          max_speed(20.0f), 
+          max_acceleration(20.0f),
+          wheel_rotation_angle(0.0f),
+          rotation_angle(0.0f),
+          yaw_rate(0.0f),
+          drift_angle(0.0f),
+          front_wheel_angle(0.0f),
+          max_front_wheel_angle(glm::radians(40.0f)),
+          negative_camber_angle(glm::radians(10.0f)),
+          frontLeftWheelPosition(-1.11f, -0.5503f, 0.1809f),
+          frontRightWheelPosition(-1.11f, 0.5393f, 0.1858f),          
+          rearLeftWheelPosition(0.5940f, -0.5501f, 0.19642f ),
+          rearRightWheelPosition(0.59399f, 0.54683f, 0.20197f),
+          frontLeftWheelTransform(1.0f),
+          frontRightWheelTransform(1.0f),
+          rearLeftWheelTransform(1.0f),
+          rearRightWheelTransform(1.0f),
+          groundNormal(0.0f, 1.0f, 0.0f),
+          surface(),
+          pontuation(0),
+          pontuation_multiplier(1.0f)
+    {}
+};
+
+extern Car car;
+
+// Curvas percorridas pelos bônus (veja bonus.h)
+extern BonusSystem g_Bonuses;
+
+// Entidades do cenário (veja ecs.h): objetos e colisores da pista, linha de
+// chegada e bônus, criadas a partir de g_Level e de InitializeBonusObjects().
+// Os componentes de cada tipo de entidade:
+#define ENTITY_PROP        (COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_RENDERABLE))
+#define ENTITY_COLLIDER    (COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_COLLIDER))
+#define ENTITY_FINISH_LINE (ENTITY_PROP | COMPONENT_BIT(COMPONENT_SCORING_TRIGGER))
+#define ENTITY_BONUS       (ENTITY_FINISH_LINE | COMPONENT_BIT(COMPONENT_BEZIER_MOVER))
+extern World g_Scene;
+
+// Adversários controlados pela IA e a trajetória que eles seguem (veja
+// fleet.h). As threads do pool são usadas para atualizar a frota.
+extern RacingLine g_RacingLine;
+extern Fleet g_Fleet;
+extern ThreadPool g_ThreadPool;
+
+// Número de contatos entre carros (adversários e jogador) desde o início. Um
+// toque que dura vários passos conta uma vez (veja ContactTracker em
+// broadphase.h), mas é resolvido em todos eles.
+extern uint32_t g_CarContacts;
+
+// Memória temporária de um passo da simulação (caixas de colisão dos carros),
+// liberada no início de cada Simulation_Step(). Veja arena.h. Tem pelo
+// menos SIMULATION_STEP_ARENA_BYTES, ou mais se a frota precisar.
+#define SIMULATION_STEP_ARENA_BYTES (4 * 1024 * 1024)
+extern FrameArena g_StepArena;
+
+// BVH sobre os triângulos da pista e da grama, usada para encontrar a altura
+// do chão embaixo de cada roda. Veja UpdateCarGroundContact().
+extern BVH g_TrackBVH;
+
+// Campo de distâncias até a borda da pista e tipo de superfície, gerado a
+// partir de "track.obj" e salvo em disco. Veja trackfield.h.
+extern TrackField g_TrackField;
+
+// Objetos, colisores, bônus e linha de chegada, lidos de
+// "data/level/level.txt". Veja level.h.
+extern Level g_Level;
+
+// Tempo simulado desde o início, em segundos. Substitui glfwGetTime() em
+// toda a lógica do jogo.
+extern double g_SimulationTime;
+
+// Tempos de cada volta completada, em segundos
+extern std::vector<float> g_LapTimes;
+
+// Instante (em g_SimulationTime) em que a volta atual começou
+extern double g_LapStartTime;
+
+// Carrega a descrição da pista, cria as suas entidades e constrói a BVH do
+// chão e o campo de superfícies a partir dos modelos da pista e da grama, já
+// carregados.
+void Simulation_BuildTrack(ObjModel* trackmodel, ObjModel* planemodel);
+
+// Atualiza a posição dos bônus no instante g_SimulationTime e a matriz de
+// modelo e a visibilidade de cada entidade desenhada (Renderable). Chamada
+// antes de desenhar; não altera o estado da simulação.
+void Simulation_UpdateScene();
+
+// Entrada do jogador em um passo da simulação, como máscara de bits. É o que
+// é gravado nos replays (veja replay.h).
+#define INPUT_KEY_W          0x01
+#define INPUT_KEY_S          0x02
+#define INPUT_KEY_A          0x04
+#define INPUT_KEY_D          0x08
+#define INPUT_RESET          0x10 // Tecla espaço: reinicia o carro
+#define INPUT_CAMERA_TOGGLE  0x20 // Tecla L: alterna o tipo de câmera (não afeta a simulação)
+#define INPUT_REWIND         0x40 // Backspace: volta no tempo enquanto pressionada
+#define INPUT_MASK           0x7f
+
+// Cria "count" adversários no grid de largada, atrás do jogador
+void Simulation_SpawnOpponents(int count);
+
+// Encerra as threads auxiliares. Deve ser chamada antes de sair do programa.
+void Simulation_Shutdown();
+
+// Avança a simulação em um passo de "deltaTime" segundos
+void Simulation_Step(uint8_t input, float deltaTime);
+
+// Quantos segundos do passado ficam guardados para voltar no tempo, quantos
+// passos cada passo com INPUT_REWIND volta, e o espaço reservado para os
+// deltas (veja snapshot.h). Um passo com o carro em movimento ocupa em torno
+// de 80 bytes.
+#define REWIND_SECONDS     10
+#define REWIND_SPEED       2
+#define REWIND_DELTA_BYTES (REWIND_SECONDS * 120 * 96)
+
+// Fotografias dos últimos REWIND_SECONDS segundos, uma por passo
+extern SnapshotRing g_Rewind;
+
+// Copia o estado da partida do jogador (carro, pontuação, voltas e relógios)
+// para "snapshot", e os bônus coletados para "bonus_active" (um bit por bônus,
+// veja Snapshot_BonusWords()), e de volta. Os adversários não fazem parte da
+// fotografia.
+void Simulation_CaptureSnapshot(SimulationSnapshot* snapshot, uint32_t* bonus_active);
+void Simulation_ApplySnapshot(const SimulationSnapshot& snapshot, const uint32_t* bonus_active);
+
+// Volta "steps" passos no tempo, ou quantos estiverem guardados. Retorna o
+// número de passos que voltou.
+int Simulation_Rewind(int steps);
+
+// Hash FNV-1a do estado da simulação (carro, bônus, tempo e pontuação). Duas
+// execuções com as mesmas entradas devem produzir a mesma sequência de hashes.
+uint32_t Simulation_Checksum();
+
+// Cria os bônus das curvas da pista. Se "count" for maior que o número de
+// curvas, os bônus restantes são espalhados pelo asfalto (usado para testes
+// de carga, veja a opção "--bonuses" do modo headless).
+void InitializeBonusObjects(int count = 0);
+
+std::pair<glm::vec3, glm::vec3> ComputeCarAABB(const Car& car);
+void resetCar();
+
+// Atualizacoes no carro
+void UpdateCarSpeedAndPosition(Car &car, bool key_W_pressed, bool key_S_pressed, bool key_A_pressed, bool key_D_pressed, float deltaTime);
+void UpdateFrontWheelsAngle(Car &car, bool key_A_pressed, bool key_D_pressed, float deltaTime);
+void UpdateWheelsRotation(Car &car, float deltaTime);
+void UpdatePontuation(Car &car, float deltaTime);
+void UpdateCarGroundContact(Car &car);
+
+#endif // SIMULATION_H
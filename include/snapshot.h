@@ -0,0 +1,96 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Fotografias ("snapshots") do estado da simulação, usadas para voltar no
+// tempo (veja Simulation_Rewind()).
+//
+// Um SimulationSnapshot é uma struct simples, copiável byte a byte, com tudo
+// o que evolui na partida do jogador: carro, pontuação, voltas e relógios.
+// Os bônus coletados vão junto, como um bit por bônus em palavras de 32 bits
+// (veja Snapshot_BonusWords()), cujo número é definido por Snapshot_Init().
+// O SnapshotRing guarda uma fotografia por passo: a cada
+// SNAPSHOT_KEYFRAME_INTERVAL passos uma fotografia completa ("keyframe") e,
+// nos outros passos, somente as palavras de 32 bits que mudaram em relação
+// ao keyframe. Restaurar qualquer passo custa um keyframe e um delta, O(1).
+
+// Passos entre duas fotografias completas
+#define SNAPSHOT_KEYFRAME_INTERVAL 32
+
+struct SimulationSnapshot
+{
+    // Relógios (veja simulation.h)
+    double simulation_time;
+    double lap_start_time;
+    double last_bonus;
+
+    // Carro
+    glm::vec3 position;
+    glm::vec3 velocity;
+    glm::vec3 acceleration_vector;
+    glm::vec3 direction;
+    glm::vec3 ground_normal;
+    float     speed;
+    float     acceleration;
+    float     wheel_rotation_angle;
+    float     rotation_angle;
+    float     yaw_rate;
+    float     drift_angle;
+    float     front_wheel_angle;
+
+    // Pontuação
+    int32_t  pontuation;
+    float    pontuation_multiplier;
+    uint32_t laps;
+    uint32_t can_receive_finish_line;
+};
+
+struct SnapshotRing
+{
+    size_t capacity;    // Número máximo de passos guardados
+    size_t bonus_count; // Bônus guardados em cada fotografia
+    size_t words;       // Palavras de 32 bits de uma fotografia com os bônus
+
+    std::vector<uint32_t> keyframes;   // Buffer circular de fotografias completas, "words" palavras cada
+    std::vector<uint8_t>  bytes;       // Buffer circular de deltas
+    std::vector<uint64_t> delta_start; // Por passo: posição absoluta do delta em "bytes"
+    std::vector<uint32_t> delta_size;  // Por passo: tamanho do delta, em bytes
+    std::vector<uint32_t> current;     // Fotografia sendo codificada ou decodificada
+    std::vector<uint8_t>  record;      // Delta sendo codificado ou decodificado
+
+    uint64_t steps;   // Passos gravados (o último é "steps - 1")
+    uint64_t oldest;  // Passo mais antigo que ainda pode ser restaurado
+    uint64_t written; // Bytes de delta escritos desde o início
+};
+
+// Palavras de 32 bits com um bit por bônus
+size_t Snapshot_BonusWords(size_t bonus_count);
+
+// Prepara o buffer para "capacity" passos de fotografias com "bonus_count"
+// bônus, com "delta_bytes" bytes para as palavras que mudaram (a máscara de
+// cada delta, que cresce com o número de bônus, é reservada à parte). Se os
+// deltas forem maiores que o esperado, os passos mais antigos são
+// descartados antes de completar "capacity".
+void Snapshot_Init(SnapshotRing& ring, size_t capacity, size_t delta_bytes, size_t bonus_count);
+
+// Descarta todos os passos gravados
+void Snapshot_Clear(SnapshotRing& ring);
+
+// Grava a fotografia do passo atual, com Snapshot_BonusWords() palavras em
+// "bonus_active". Não faz alocações.
+void Snapshot_Push(SnapshotRing& ring, const SimulationSnapshot& snapshot, const uint32_t* bonus_active);
+
+// Quantos passos antes do último ainda podem ser restaurados
+size_t Snapshot_Available(const SnapshotRing& ring);
+
+// Restaura em "out" e "bonus_active" a fotografia de "steps_back" passos
+// antes da última e descarta as mais novas, que deixam de existir. Retorna
+// false (sem alterar nada) se o passo já foi descartado.
+bool Snapshot_Rewind(SnapshotRing& ring, size_t steps_back, SimulationSnapshot* out, uint32_t* bonus_active);
+
+#endif // SNAPSHOT_H
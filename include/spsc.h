@@ -0,0 +1,90 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <atomic>
+#include <cstddef>
+
+// Comunicação sem travas entre exatamente duas threads: uma que produz e uma
+// que consome. Usadas pelo laço do jogo (veja main.cpp) para levar os eventos
+// de teclado e mouse da thread principal para as threads da simulação e do
+// desenho, e o estado de cada passo da simulação para a thread do desenho.
+
+// Fila circular de até N itens. Somente a thread produtora chama
+// SpscQueue_Push(), e somente a consumidora chama SpscQueue_Pop().
+template <typename T, size_t N>
+struct SpscQueue
+{
+    T                   items[N];
+    std::atomic<size_t> head; // Próximo item a ser lido
+    std::atomic<size_t> tail; // Próxima posição a ser escrita
+
+    SpscQueue() : head(0), tail(0) {}
+};
+
+// Retorna false (e descarta o item) se a fila está cheia
+template <typename T, size_t N>
+bool SpscQueue_Push(SpscQueue<T, N>& queue, const T& item)
+{
+    size_t tail = queue.tail.load(std::memory_order_relaxed);
+    if (tail - queue.head.load(std::memory_order_acquire) >= N)
+        return false;
+    queue.items[tail % N] = item;
+    queue.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// Retorna false se a fila está vazia
+template <typename T, size_t N>
+bool SpscQueue_Pop(SpscQueue<T, N>& queue, T* item)
+{
+    size_t head = queue.head.load(std::memory_order_relaxed);
+    if (head == queue.tail.load(std::memory_order_acquire))
+        return false;
+    *item = queue.items[head % N];
+    queue.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Três cópias de um estado: o produtor escreve em uma ("back"), o consumidor
+// lê outra ("front"), e a terceira ("middle") guarda o último estado
+// publicado. Publicar e pegar o estado mais novo são só uma troca atômica de
+// índices, então nenhuma das threads espera pela outra: o consumidor sempre
+// vê o estado completo mais recente, e estados intermediários que ele não
+// chegou a ler são descartados.
+#define TRIPLE_BUFFER_FRESH 4 // Em "middle": publicado e ainda não lido
+
+template <typename T>
+struct TripleBuffer
+{
+    T                buffers[3];
+    std::atomic<int> middle;
+    int              back;  // Somente o produtor usa
+    int              front; // Somente o consumidor usa
+
+    TripleBuffer() : middle(1), back(0), front(2) {}
+};
+
+// Estado a ser preenchido pelo produtor antes de TripleBuffer_Publish()
+template <typename T>
+T& TripleBuffer_Back(TripleBuffer<T>& buffer)
+{
+    return buffer.buffers[buffer.back];
+}
+
+template <typename T>
+void TripleBuffer_Publish(TripleBuffer<T>& buffer)
+{
+    buffer.back = buffer.middle.exchange(buffer.back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+// Estado publicado mais recente. Continua válido (e pode ser modificado pelo
+// consumidor) até a próxima chamada.
+template <typename T>
+T& TripleBuffer_Front(TripleBuffer<T>& buffer)
+{
+    if (buffer.middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH)
+        buffer.front = buffer.middle.exchange(buffer.front, std::memory_order_acq_rel) & 3;
+    return buffer.buffers[buffer.front];
+}
+
+#endif // SPSC_H
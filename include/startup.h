@@ -0,0 +1,54 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <cstddef>
+
+// Tempo de cada fase da inicialização do jogo (criação da janela, shaders,
+// cada imagem decodificada e enviada para a GPU, cada modelo lido, ...), até
+// o primeiro quadro. Como o carregamento é feito por tarefas em paralelo
+// (veja threadpool.h), cada fase guarda em qual thread rodou, e as fases
+// podem se sobrepor. Pode ser usado por qualquer thread.
+//
+// Startup_Print() imprime a tabela das fases, e Startup_WriteJson() a grava
+// para o benchmark da inicialização (veja bench/bench_startup.cpp).
+
+#define STARTUP_MAX_PHASES  128
+#define STARTUP_MAX_THREADS 64
+
+struct StartupPhase
+{
+    const char* name;
+    const char* detail;   // Ex: o arquivo carregado, ou NULL. Não é copiado.
+    double      begin_ms; // Desde Startup_Init()
+    double      end_ms;   // Negativo enquanto a fase não terminou
+    int         thread;   // 0 é a thread que chamou Startup_Init()
+};
+
+// Zera as fases e começa a contar o tempo
+void Startup_Init();
+
+// Começa uma fase, retornando o índice a ser passado para Startup_End(), ou
+// -1 se já há STARTUP_MAX_PHASES fases
+int Startup_Begin(const char* name, const char* detail = NULL);
+void Startup_End(int phase);
+
+// Milissegundos desde Startup_Init()
+double Startup_Now();
+
+// Tabela com o início, a duração e a thread de cada fase, e a soma das
+// durações das fases de mesmo nome
+void Startup_Print();
+
+// Grava as fases em JSON, uma por linha. Retorna false se o arquivo não
+// pôde ser criado.
+bool Startup_WriteJson(const char* filename);
+
+// Mede a fase do escopo atual
+struct StartupScope
+{
+    int phase;
+    StartupScope(const char* name, const char* detail = NULL) : phase(Startup_Begin(name, detail)) {}
+    ~StartupScope() { Startup_End(phase); }
+};
+
+#endif // STARTUP_H
@@ -0,0 +1,34 @@
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <cstddef>
+
+// Posicionamento dos caracteres do texto na tela, sem OpenGL: cada caractere
+// vira dois triângulos com as coordenadas da sua imagem na textura da fonte
+// (dejavufont.h). O desenho fica em textrendering.cpp. A fonte é definida em
+// dejavufont.h, que só pode ser incluído por um arquivo (src/textlayout.cpp).
+
+struct TextVertex
+{
+    float x, y; // Posição em NDC
+    float s, t; // Coordenada na textura da fonte
+};
+
+// Dados da fonte usados pelo desenho do texto
+struct TextFont
+{
+    size_t               tex_width, tex_height;
+    const unsigned char* tex_data;     // Um byte por texel
+    float                height;       // Altura de uma linha, em pixels
+    float                char_advance; // Largura de um caractere, em pixels
+};
+
+const TextFont& TextLayout_Font();
+
+// Escreve em "vertices" os triângulos dos "length" primeiros caracteres de
+// "str", começando em (x, y) e com a escala (sx, sy) de pixels para NDC.
+// "vertices" deve ter espaço para 6 * length vértices. Caracteres que não
+// existem na fonte são ignorados. Retorna o número de vértices escritos.
+size_t TextLayout_BuildQuads(const char* str, size_t length, float x, float y, float sx, float sy, TextVertex* vertices);
+
+#endif // TEXTLAYOUT_H
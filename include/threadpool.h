@@ -0,0 +1,131 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+
+// Sistema de tarefas ("jobs") com roubo de trabalho, usado por todo o jogo
+// para dividir trabalho entre os núcleos: laços independentes (ex: atualizar
+// cada carro da frota de IA), sistemas do cenário e o carregamento dos
+// modelos e texturas.
+//
+// Cada thread auxiliar tem a sua fila dupla (deque) de tarefas: ela empilha e
+// desempilha no fim da sua fila, sem travas, e quando a fila esvazia rouba do
+// começo da fila de outra thread. A thread que chamou ThreadPool_Start()
+// também tem uma fila e trabalha enquanto espera (Job_Wait()), assim como até
+// THREADPOOL_MAX_ATTACHED threads que chamarem ThreadPool_AttachThread() (ex:
+// a thread da simulação, que divide a frota a cada passo). As demais threads
+// entregam tarefas por uma fila compartilhada, protegida por uma trava, que
+// aloca memória a cada tarefa.
+//
+// A conclusão de um grupo de tarefas é acompanhada por um JobCounter: cada
+// tarefa criada com ele o incrementa e o decrementa ao terminar. Uma tarefa
+// também pode depender de um contador, e só começa quando ele chega a zero.
+//
+// Tarefas que precisam da thread principal (ex: chamadas OpenGL) vão para uma
+// fila separada, executada por ThreadPool_RunMainThreadJobs() ou enquanto a
+// thread principal espera em Job_Wait().
+
+// Processa os índices [begin, end) de um laço. Tarefas simples recebem [0, 1).
+typedef void (*ThreadPoolTask)(void* context, size_t begin, size_t end);
+
+// Número de tarefas que cabem na fila de cada thread. Com a fila cheia, a
+// tarefa é executada na hora por quem a criou, ou, se a sua dependência ainda
+// não terminou, entregue pela fila compartilhada.
+#define JOB_QUEUE_CAPACITY 4096
+
+// Threads, além da que chamou ThreadPool_Start(), que podem ter fila própria
+#define THREADPOOL_MAX_ATTACHED 2
+
+struct JobCounter
+{
+    std::atomic<int> pending;
+
+    JobCounter() : pending(0) {}
+};
+
+struct Job
+{
+    ThreadPoolTask task;
+    void*          context;
+    size_t         begin, end;
+    JobCounter*    counter;    // Decrementado ao terminar, ou NULL
+    JobCounter*    dependency; // A tarefa só começa quando chegar a zero, ou NULL
+};
+
+// Fila de Chase-Lev: o dono usa "bottom", os ladrões disputam "top"
+struct JobQueue
+{
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    Job                  jobs[JOB_QUEUE_CAPACITY];
+};
+
+struct ThreadPool
+{
+    std::vector<std::thread> workers;
+    std::vector<JobQueue*>   queues;  // queues[0] é da thread que chamou ThreadPool_Start(), seguida
+                                      // das auxiliares e das reservadas a ThreadPool_AttachThread()
+    std::thread::id          owner;
+    std::atomic<int>         attached; // Filas de ThreadPool_AttachThread() já entregues
+
+    // Tarefas entregues por threads sem fila própria
+    std::mutex       shared_mutex;
+    std::deque<Job>  shared_jobs;
+
+    // Tarefas que só podem rodar na thread principal
+    std::mutex       main_mutex;
+    std::vector<Job> main_jobs;
+
+    // Threads auxiliares dormem quando não há tarefas
+    std::mutex              sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<int>        queued;   // Tarefas em alguma fila (aproximado)
+    std::atomic<int>        sleeping;
+    std::atomic<bool>       quit;
+
+    ThreadPool() : attached(0), queued(0), sleeping(0), quit(false) {}
+};
+
+// Inicia "threads" threads auxiliares. Com 0, usa o número de núcleos menos um.
+void ThreadPool_Start(ThreadPool& pool, int threads = 0);
+void ThreadPool_Stop(ThreadPool& pool);
+
+// Dá à thread atual uma fila própria, para que as tarefas que ela cria (ex:
+// os blocos de ThreadPool_ParallelFor()) não passem pela fila compartilhada.
+// Deve ser chamada depois de ThreadPool_Start(), e a thread não pode terminar
+// com tarefas na fila. Retorna false se as THREADPOOL_MAX_ATTACHED filas já
+// foram entregues ou se o pool não foi iniciado.
+bool ThreadPool_AttachThread(ThreadPool& pool);
+
+// Número de threads que participam de um laço, incluindo a que chama
+int ThreadPool_Size(const ThreadPool& pool);
+
+// Executa "task" sobre [0, count) em blocos de até "grain" índices. Laços com
+// um único bloco (ou um pool sem threads) rodam direto na thread que chama;
+// os outros são divididos ao meio recursivamente, e as metades podem ser
+// roubadas por outras threads. Só retorna quando todos os blocos terminaram.
+void ThreadPool_ParallelFor(ThreadPool& pool, size_t count, size_t grain, ThreadPoolTask task, void* context);
+
+// Cria uma tarefa que chama task(context, 0, 1). "counter" (se não for NULL)
+// é incrementado agora e decrementado quando a tarefa terminar; se
+// "dependency" não for NULL, a tarefa só começa quando ele chegar a zero.
+// Sem threads auxiliares, a tarefa roda na hora.
+void Job_Spawn(ThreadPool& pool, ThreadPoolTask task, void* context, JobCounter* counter, JobCounter* dependency = NULL);
+
+// Como Job_Spawn(), mas a tarefa só roda na thread que chamou ThreadPool_Start()
+void Job_SpawnOnMainThread(ThreadPool& pool, ThreadPoolTask task, void* context, JobCounter* counter);
+
+// Executa tarefas até "counter" chegar a zero
+void Job_Wait(ThreadPool& pool, JobCounter& counter);
+
+// Executa as tarefas da fila da thread principal. Retorna quantas executou.
+int ThreadPool_RunMainThreadJobs(ThreadPool& pool);
+
+#endif // THREADPOOL_H
@@ -0,0 +1,44 @@
+#ifndef TIRE_H
+#define TIRE_H
+
+// Modelo de pneus do carro do jogador.
+//
+// Cada roda tem o seu próprio ângulo de deriva ("slip angle"), calculado a
+// partir da velocidade do ponto de contato, e a força lateral vem da "fórmula
+// mágica" de Pacejka. A carga em cada roda muda com a aceleração (os pneus de
+// fora da curva e os traseiros na aceleração ficam mais carregados), e a força
+// longitudinal (tração e freio) divide a aderência com a lateral em uma
+// elipse de atrito: acelerar forte em curva faz a traseira escorregar.
+//
+// As quatro rodas são calculadas juntas, uma roda por posição de um registro
+// SSE, então o custo é praticamente o de uma roda só. A integração é feita em
+// TIRE_SUBSTEPS sub-passos por passo da simulação.
+
+// Sub-passos por passo da simulação (120 Hz * 4 = 480 Hz)
+#define TIRE_SUBSTEPS 4
+
+// Parâmetros da fórmula mágica: F = D sin(C atan(B a - E (B a - atan(B a)))),
+// com D = atrito * carga na roda.
+#define TIRE_PACEJKA_B 10.0f
+#define TIRE_PACEJKA_C 1.9f
+#define TIRE_PACEJKA_E 0.97f
+
+struct Car;
+
+// Comandos do motorista em um passo
+struct TireControls
+{
+    float throttle; // 0 a 1 (tecla W)
+    float brake;    // 0 a 1 (tecla S; dá ré quando o carro está parado)
+};
+
+// Avança a dinâmica do carro em "deltaTime" segundos: velocidade, rotação,
+// velocidade de guinada e posição. "grip" é a aderência relativa da
+// superfície embaixo do carro (veja TrackSample::friction).
+void Tire_Step(Car& car, const TireControls& controls, float grip, float deltaTime);
+
+// Força lateral da fórmula mágica para um ângulo de deriva (em radianos) e um
+// pico "peak" (em newtons). Mesma aproximação usada no caminho vetorizado.
+float Tire_LateralForce(float slip_angle, float peak);
+
+#endif // TIRE_H
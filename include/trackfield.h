@@ -0,0 +1,59 @@
+#ifndef TRACKFIELD_H
+#define TRACKFIELD_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Campo 2D (plano XZ) pré-computado ao redor da pista. Cada célula guarda a
+// distância com sinal até a borda da pista (negativa dentro do asfalto,
+// positiva fora) e o tipo de superfície. Assim, física, IA e pontuação
+// consultam "estou na pista?" com uma única interpolação bilinear, sem tocar
+// nos triângulos de "track.obj".
+//
+// O campo é gerado na primeira execução e salvo em disco; nas seguintes ele é
+// lido do arquivo, desde que a geometria da pista não tenha mudado.
+
+enum SurfaceType
+{
+    SURFACE_GRASS   = 0,
+    SURFACE_ASPHALT = 1,
+    SURFACE_COUNT
+};
+
+struct TrackField
+{
+    glm::vec2 origin;    // Canto (x,z) mínimo do campo, em coordenadas globais
+    float     cell_size; // Tamanho de cada célula, em metros
+    int       width;     // Número de células em X
+    int       height;    // Número de células em Z
+
+    std::vector<float>   distance; // width*height distâncias com sinal
+    std::vector<uint8_t> surface;  // width*height valores de SurfaceType
+};
+
+struct TrackSample
+{
+    float       distance;  // Distância com sinal até a borda da pista
+    SurfaceType surface;
+    float       friction;  // Aderência relativa da superfície (asfalto = 1)
+    bool        off_track;
+};
+
+// Carrega o campo de "cache_filename" ou, se o arquivo não existir ou tiver
+// sido gerado a partir de outra geometria, rasteriza os triângulos da pista
+// (três vértices por triângulo, em coordenadas globais) e salva o resultado.
+// Sem triângulos, deixa o campo vazio (tudo é asfalto) e retorna false.
+bool TrackField_LoadOrBake(TrackField& field, const std::vector<glm::vec3>& track_triangles,
+                           const char* cache_filename, float cell_size, float margin);
+
+// Distância com sinal interpolada bilinearmente. Fora do campo, retorna a
+// distância da célula mais próxima da borda.
+float TrackField_Distance(const TrackField& field, float x, float z);
+
+// Consulta completa: distância, superfície, atrito e se está fora da pista.
+// Com o campo vazio, retorna asfalto na borda da pista (distância 0).
+TrackSample TrackField_Sample(const TrackField& field, float x, float z);
+
+#endif // TRACKFIELD_H
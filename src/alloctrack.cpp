@@ -0,0 +1,90 @@
+#include "alloctrack.h"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+namespace {
+
+// Inicializados com zero antes de qualquer construtor estático, que já pode
+// alocar memória
+std::atomic<uint64_t> g_Allocations(0);
+std::atomic<uint64_t> g_Frees(0);
+std::atomic<uint64_t> g_Bytes(0);
+
+void* Allocate(size_t size)
+{
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    g_Bytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size == 0 ? 1 : size);
+}
+
+void Release(void* pointer)
+{
+    if (pointer == NULL)
+        return;
+    g_Frees.fetch_add(1, std::memory_order_relaxed);
+    free(pointer);
+}
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    void* pointer = Allocate(size);
+    if (pointer == NULL)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    void* pointer = Allocate(size);
+    if (pointer == NULL)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    Release(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    Release(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    Release(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    Release(pointer);
+}
+
+AllocCounters AllocTrack_Read()
+{
+    AllocCounters counters;
+    counters.allocations = g_Allocations.load(std::memory_order_relaxed);
+    counters.frees       = g_Frees.load(std::memory_order_relaxed);
+    counters.bytes       = g_Bytes.load(std::memory_order_relaxed);
+    return counters;
+}
+
+uint64_t AllocTrack_Since(const AllocCounters& since)
+{
+    return g_Allocations.load(std::memory_order_relaxed) - since.allocations;
+}
@@ -0,0 +1,156 @@
+#include "arena.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t huge_page_size = 2 * 1024 * 1024;
+
+size_t RoundUp(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+size_t PageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+} // namespace
+
+void* Memory_Reserve(size_t* bytes, bool huge_pages, bool* got_huge_pages)
+{
+    if (got_huge_pages != NULL)
+        *got_huge_pages = false;
+
+#ifdef _WIN32
+    if (huge_pages && GetLargePageMinimum() > 0)
+    {
+        // Exige o privilégio SeLockMemoryPrivilege; sem ele, VirtualAlloc falha
+        size_t size = RoundUp(*bytes, GetLargePageMinimum());
+        void* memory = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (memory != NULL)
+        {
+            *bytes = size;
+            if (got_huge_pages != NULL)
+                *got_huge_pages = true;
+            return memory;
+        }
+    }
+
+    size_t size = RoundUp(*bytes, PageSize());
+    void* memory = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (memory != NULL)
+        *bytes = size;
+    return memory;
+#else
+#ifdef MAP_HUGETLB
+    if (huge_pages)
+    {
+        // Só funciona se o sistema tiver páginas grandes reservadas
+        // (/proc/sys/vm/nr_hugepages)
+        size_t size = RoundUp(*bytes, huge_page_size);
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            *bytes = size;
+            if (got_huge_pages != NULL)
+                *got_huge_pages = true;
+            return memory;
+        }
+    }
+#endif
+
+    size_t size = RoundUp(*bytes, PageSize());
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    // Sem páginas reservadas, pedimos ao kernel que use páginas grandes
+    // transparentes quando puder
+    if (huge_pages)
+        madvise(memory, size, MADV_HUGEPAGE);
+#endif
+    *bytes = size;
+    return memory;
+#endif
+}
+
+void Memory_Release(void* memory, size_t bytes)
+{
+    if (memory == NULL)
+        return;
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, bytes);
+#endif
+}
+
+bool Arena_Init(FrameArena& arena, const char* name, size_t capacity, bool huge_pages)
+{
+    arena.name       = name;
+    arena.used       = 0;
+    arena.high_water = 0;
+    arena.failures   = 0;
+    arena.capacity   = capacity;
+    arena.base       = static_cast<uint8_t*>(Memory_Reserve(&arena.capacity, huge_pages, &arena.huge_pages));
+    if (arena.base == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot reserve %zu bytes for arena \"%s\".\n", capacity, name);
+        arena.capacity = 0;
+        return false;
+    }
+    return true;
+}
+
+void Arena_Free(FrameArena& arena)
+{
+    Memory_Release(arena.base, arena.capacity);
+    arena.base     = NULL;
+    arena.capacity = 0;
+    arena.used     = 0;
+}
+
+void* Arena_Alloc(FrameArena& arena, size_t size, size_t alignment)
+{
+    size_t offset = RoundUp(arena.used, alignment);
+    if (arena.base == NULL || offset + size > arena.capacity)
+    {
+        ++arena.failures;
+        return NULL;
+    }
+    arena.used = offset + size;
+    return arena.base + offset;
+}
+
+void Arena_Reset(FrameArena& arena)
+{
+    if (arena.used > arena.high_water)
+        arena.high_water = arena.used;
+    arena.used = 0;
+}
+
+void Arena_PrintStats(const FrameArena& arena)
+{
+    size_t high_water = arena.used > arena.high_water ? arena.used : arena.high_water;
+    printf("Arena \"%s\": pico de %.1f de %.1f KiB%s", arena.name, high_water / 1024.0, arena.capacity / 1024.0,
+           arena.huge_pages ? " (páginas grandes)" : "");
+    if (arena.failures > 0)
+        printf(", %llu alocações recusadas", (unsigned long long)arena.failures);
+    printf(".\n");
+}
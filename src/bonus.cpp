@@ -0,0 +1,203 @@
+#include "bonus.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "collisions.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BONUS_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Amostras usadas para medir o comprimento de arco de cada curva
+const int arc_samples = 1024;
+
+inline glm::vec3 EvaluateShape(const BonusShape& shape, float t)
+{
+    const glm::vec3* c = shape.coefficients;
+    return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+}
+
+// Parâmetro t da curva na fração "u" do comprimento de arco
+inline float ArcToT(const BonusShape& shape, float u)
+{
+    float f = u * BONUS_ARC_TABLE_SIZE;
+    int   i = std::min((int)f, BONUS_ARC_TABLE_SIZE - 1);
+    float a = shape.arc_to_t[i];
+    float b = shape.arc_to_t[i + 1];
+    return a + (b - a) * (f - (float)i);
+}
+
+// Fração da curva percorrida no instante "time"
+inline float CurveFraction(const BezierMover& mover, float time)
+{
+    float u = mover.phase + mover.rate * time;
+    return u - std::floor(u);
+}
+
+} // namespace
+
+uint32_t Bonus_AddShape(BonusSystem& bonuses, const BezierCurve& curve)
+{
+    BonusShape shape;
+    shape.coefficients[0] = curve.p0;
+    shape.coefficients[1] = 3.0f * (curve.p1 - curve.p0);
+    shape.coefficients[2] = 3.0f * (curve.p0 - 2.0f * curve.p1 + curve.p2);
+    shape.coefficients[3] = curve.p3 - 3.0f * curve.p2 + 3.0f * curve.p1 - curve.p0;
+
+    // Comprimento acumulado em "arc_samples" segmentos
+    std::vector<float> cumulative(arc_samples + 1);
+    cumulative[0] = 0.0f;
+    glm::vec3 previous = curve.p0;
+    for (int i = 1; i <= arc_samples; ++i)
+    {
+        glm::vec3 p = curve.evaluate((float)i / arc_samples);
+        cumulative[i] = cumulative[i - 1] + glm::length(p - previous);
+        previous = p;
+    }
+    shape.length = cumulative[arc_samples];
+
+    // Inverte a função comprimento(t) em frações iguais do comprimento total
+    int j = 0;
+    for (int k = 0; k <= BONUS_ARC_TABLE_SIZE; ++k)
+    {
+        float target = shape.length * k / BONUS_ARC_TABLE_SIZE;
+        while (j < arc_samples - 1 && cumulative[j + 1] < target)
+            ++j;
+        float segment = cumulative[j + 1] - cumulative[j];
+        float s = segment > 0.0f ? (target - cumulative[j]) / segment : 0.0f;
+        shape.arc_to_t[k] = std::min(1.0f, std::max(0.0f, (j + s) / arc_samples));
+    }
+
+    // A curva está contida no fecho convexo dos pontos de controle
+    glm::vec3 points[4] = { curve.p0, curve.p1, curve.p2, curve.p3 };
+    glm::vec3 bmin = points[0], bmax = points[0];
+    for (int i = 1; i < 4; ++i)
+    {
+        bmin = glm::min(bmin, points[i]);
+        bmax = glm::max(bmax, points[i]);
+    }
+    shape.center = 0.5f * (bmin + bmax);
+    shape.radius = 0.0f;
+    for (int i = 0; i < 4; ++i)
+        shape.radius = std::max(shape.radius, glm::length(points[i] - shape.center));
+
+    bonuses.shapes.push_back(shape);
+    return (uint32_t)bonuses.shapes.size() - 1;
+}
+
+void Bonus_Clear(BonusSystem& bonuses)
+{
+    bonuses.shapes.clear();
+}
+
+BezierMover Bonus_Mover(const BonusSystem& bonuses, uint32_t shape, glm::vec3 origin, float phase, float speed)
+{
+    const BonusShape& s = bonuses.shapes[shape];
+    BezierMover mover;
+    mover.shape = shape;
+    mover.phase = phase - std::floor(phase);
+    mover.rate = s.length > 0.0f ? std::fabs(speed) / s.length : 0.0f;
+    mover.origin = origin;
+    return mover;
+}
+
+glm::vec3 Bonus_Position(const BonusSystem& bonuses, const BezierMover& mover, double time)
+{
+    const BonusShape& shape = bonuses.shapes[mover.shape];
+    float t = ArcToT(shape, CurveFraction(mover, (float)time));
+    return EvaluateShape(shape, t) + mover.origin;
+}
+
+void Bonus_EvaluateBatch(const BonusSystem& bonuses, const BezierMover* movers, const ScoringTrigger* triggers,
+                         Transform* transforms, size_t count, double time)
+{
+    size_t i = 0;
+
+#ifdef BONUS_USE_SSE
+    const __m128 t_time  = _mm_set1_ps((float)time);
+    const __m128 t_table = _mm_set1_ps((float)BONUS_ARC_TABLE_SIZE);
+    const __m128i max_index = _mm_set1_epi32(BONUS_ARC_TABLE_SIZE - 1);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        if (!(triggers[i].active | triggers[i + 1].active | triggers[i + 2].active | triggers[i + 3].active))
+            continue;
+
+        const BezierMover* m = &movers[i];
+
+        // u = frac(phase + rate * time). Os valores são sempre positivos, então
+        // truncar é o mesmo que arredondar para baixo.
+        __m128 phase = _mm_setr_ps(m[0].phase, m[1].phase, m[2].phase, m[3].phase);
+        __m128 rate  = _mm_setr_ps(m[0].rate, m[1].rate, m[2].rate, m[3].rate);
+        __m128 u = _mm_add_ps(phase, _mm_mul_ps(rate, t_time));
+        u = _mm_sub_ps(u, _mm_cvtepi32_ps(_mm_cvttps_epi32(u)));
+
+        // Consulta à tabela de comprimento de arco
+        __m128  f     = _mm_mul_ps(u, t_table);
+        __m128i index = _mm_cvttps_epi32(f);
+        index = _mm_sub_epi32(index, _mm_and_si128(_mm_cmpgt_epi32(index, max_index), _mm_sub_epi32(index, max_index)));
+        __m128  frac  = _mm_sub_ps(f, _mm_cvtepi32_ps(index));
+
+        int lane_index[4];
+        _mm_storeu_si128((__m128i*)lane_index, index);
+        const BonusShape* s[4] = {
+            &bonuses.shapes[m[0].shape], &bonuses.shapes[m[1].shape],
+            &bonuses.shapes[m[2].shape], &bonuses.shapes[m[3].shape]
+        };
+        __m128 a = _mm_setr_ps(s[0]->arc_to_t[lane_index[0]],     s[1]->arc_to_t[lane_index[1]],
+                               s[2]->arc_to_t[lane_index[2]],     s[3]->arc_to_t[lane_index[3]]);
+        __m128 b = _mm_setr_ps(s[0]->arc_to_t[lane_index[0] + 1], s[1]->arc_to_t[lane_index[1] + 1],
+                               s[2]->arc_to_t[lane_index[2] + 1], s[3]->arc_to_t[lane_index[3] + 1]);
+        __m128 t = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), frac));
+
+        // Avaliação de Horner, um eixo por vez
+        float out[3][4];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            __m128 c[4];
+            for (int k = 0; k < 4; ++k)
+                c[k] = _mm_setr_ps(s[0]->coefficients[k][axis], s[1]->coefficients[k][axis],
+                                   s[2]->coefficients[k][axis], s[3]->coefficients[k][axis]);
+            __m128 origin = _mm_setr_ps(m[0].origin[axis], m[1].origin[axis], m[2].origin[axis], m[3].origin[axis]);
+            __m128 p = _mm_add_ps(_mm_mul_ps(c[3], t), c[2]);
+            p = _mm_add_ps(_mm_mul_ps(p, t), c[1]);
+            p = _mm_add_ps(_mm_mul_ps(p, t), c[0]);
+            _mm_storeu_ps(out[axis], _mm_add_ps(p, origin));
+        }
+        for (int lane = 0; lane < 4; ++lane)
+            transforms[i + lane].position = glm::vec3(out[0][lane], out[1][lane], out[2][lane]);
+    }
+#endif
+
+    for (; i < count; ++i)
+        if (triggers[i].active)
+            transforms[i].position = Bonus_Position(bonuses, movers[i], time);
+}
+
+int Bonus_Collect(const BonusSystem& bonuses, const BezierMover* movers, ScoringTrigger* triggers, size_t count,
+                  glm::vec3 bbox_min, glm::vec3 bbox_max, double time)
+{
+    int collected = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!triggers[i].active)
+            continue;
+
+        // Teste grosseiro com a esfera que contém a curva inteira
+        const BonusShape& shape = bonuses.shapes[movers[i].shape];
+        float radius = triggers[i].extent.x;
+        if (!cube_sphere_intersect(bbox_min, bbox_max, shape.center + movers[i].origin, shape.radius + radius))
+            continue;
+
+        if (cube_sphere_intersect(bbox_min, bbox_max, Bonus_Position(bonuses, movers[i], time), radius))
+        {
+            triggers[i].active = 0;
+            ++collected;
+        }
+    }
+    return collected;
+}
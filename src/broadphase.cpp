@@ -0,0 +1,135 @@
+#include "broadphase.h"
+
+#include <algorithm>
+
+namespace {
+
+// Insertion sort de "order" pela chave "key". Estável, então corpos com a
+// mesma chave mantêm a ordem anterior e o resultado é determinístico.
+size_t InsertionSort(std::vector<uint32_t>& order, const std::vector<float>& key)
+{
+    size_t swaps = 0;
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        uint32_t body = order[i];
+        float    value = key[body];
+        size_t   j = i;
+        while (j > 0 && key[order[j - 1]] > value)
+        {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = body;
+        swaps += i - j;
+    }
+    return swaps;
+}
+
+// Variância dos centros das caixas em um eixo
+float Spread(const std::vector<float>& lo, const std::vector<float>& hi)
+{
+    size_t n = lo.size();
+    float sum = 0.0f, sum_sq = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+    {
+        float c = 0.5f * (lo[i] + hi[i]);
+        sum += c;
+        sum_sq += c * c;
+    }
+    float mean = sum / n;
+    return sum_sq / n - mean * mean;
+}
+
+bool PairBefore(const ContactPair& pair, const std::pair<uint32_t, uint32_t>& key)
+{
+    return pair.a < key.first || (pair.a == key.first && pair.b < key.second);
+}
+
+} // namespace
+
+void SweepAndPrune_Resize(SweepAndPrune& sap, size_t count)
+{
+    if (sap.order_x.size() == count)
+        return;
+
+    sap.min_x.assign(count, 0.0f);
+    sap.max_x.assign(count, 0.0f);
+    sap.min_z.assign(count, 0.0f);
+    sap.max_z.assign(count, 0.0f);
+    sap.order_x.resize(count);
+    sap.order_z.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        sap.order_x[i] = sap.order_z[i] = (uint32_t)i;
+    sap.pairs.clear();
+    // Na pista cada carro encosta em poucos outros; com esta reserva os pares
+    // não crescem durante a corrida (veja alloctrack.h)
+    sap.pairs.reserve(4 * count);
+    sap.swaps = 0;
+}
+
+void SweepAndPrune_Update(SweepAndPrune& sap)
+{
+    sap.pairs.clear();
+    size_t n = sap.order_x.size();
+    if (n < 2)
+        return;
+
+    // As duas ordens são mantidas sempre, para que trocar o eixo da
+    // varredura não custe uma ordenação completa.
+    sap.swaps = InsertionSort(sap.order_x, sap.min_x) + InsertionSort(sap.order_z, sap.min_z);
+
+    bool along_x = Spread(sap.min_x, sap.max_x) >= Spread(sap.min_z, sap.max_z);
+    const std::vector<uint32_t>& order = along_x ? sap.order_x : sap.order_z;
+    const std::vector<float>& lo       = along_x ? sap.min_x : sap.min_z;
+    const std::vector<float>& hi       = along_x ? sap.max_x : sap.max_z;
+    const std::vector<float>& other_lo = along_x ? sap.min_z : sap.min_x;
+    const std::vector<float>& other_hi = along_x ? sap.max_z : sap.max_x;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t a = order[i];
+        for (size_t j = i + 1; j < n && lo[order[j]] <= hi[a]; ++j)
+        {
+            uint32_t b = order[j];
+            if (other_lo[a] <= other_hi[b] && other_lo[b] <= other_hi[a])
+                sap.pairs.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+        }
+    }
+}
+
+void Contacts_Reset(ContactTracker& tracker, size_t count, uint32_t exit_steps)
+{
+    tracker.active.clear();
+    tracker.active.reserve(4 * count);
+    tracker.step = 0;
+    tracker.exit_steps = exit_steps;
+}
+
+bool Contacts_Touch(ContactTracker& tracker, uint32_t a, uint32_t b)
+{
+    std::pair<uint32_t, uint32_t> key(std::min(a, b), std::max(a, b));
+    std::vector<ContactPair>::iterator it = std::lower_bound(tracker.active.begin(), tracker.active.end(), key, PairBefore);
+    if (it != tracker.active.end() && it->a == key.first && it->b == key.second)
+    {
+        it->last_step = tracker.step;
+        return false;
+    }
+
+    ContactPair pair = { key.first, key.second, tracker.step };
+    tracker.active.insert(it, pair);
+    return true;
+}
+
+uint32_t Contacts_EndStep(ContactTracker& tracker)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < tracker.active.size(); ++i)
+    {
+        if (tracker.step - tracker.active[i].last_step <= tracker.exit_steps)
+            tracker.active[kept++] = tracker.active[i];
+    }
+    uint32_t exits = (uint32_t)(tracker.active.size() - kept);
+    tracker.active.resize(kept);
+    ++tracker.step;
+    return exits;
+}
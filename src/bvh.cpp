@@ -0,0 +1,400 @@
+#include "bvh.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+
+// Parâmetros da construção por SAH
+#define BVH_SAH_BINS     12   // Número de "baldes" testados por eixo
+#define BVH_MAX_LEAF     4    // Folhas com até este número de triângulos não são divididas
+#define BVH_MAX_DEPTH    64   // Tamanho da pilha de travessia; a árvore tem no máximo esta profundidade
+#define BVH_COST_TRAVERSAL 1.0f
+#define BVH_COST_TRIANGLE  1.0f
+
+// Maior número de triângulos que cabe em BvhNode::count. Uma folha forçada
+// (no limite de profundidade, ou com todos os centróides no mesmo ponto) pode
+// conter todos os triângulos da árvore.
+#define BVH_MAX_TRIANGLES ((1u << 30) - 1)
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode must fill half a cache line");
+
+namespace {
+
+struct Bounds
+{
+    glm::vec3 min;
+    glm::vec3 max;
+
+    Bounds()
+        : min(std::numeric_limits<float>::max()),
+          max(std::numeric_limits<float>::lowest())
+    {}
+
+    void grow(const glm::vec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const Bounds& b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    float area() const
+    {
+        glm::vec3 d = max - min;
+        if (d.x < 0.0f || d.y < 0.0f || d.z < 0.0f)
+            return 0.0f;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+// Dados temporários usados somente durante a construção
+struct BuildTriangle
+{
+    Bounds    bounds;
+    glm::vec3 centroid;
+};
+
+struct Builder
+{
+    const std::vector<glm::vec3>& vertices;
+    std::vector<BuildTriangle>    primitives;
+    std::vector<uint32_t>         order;
+    std::vector<BvhNode>&         nodes;
+
+    Builder(const std::vector<glm::vec3>& v, std::vector<BvhNode>& n)
+        : vertices(v), nodes(n)
+    {}
+
+    void build(uint32_t node_index, uint32_t begin, uint32_t end, int depth);
+};
+
+void SetNodeBounds(BvhNode& node, const Bounds& b)
+{
+    node.bbox_min[0] = b.min.x; node.bbox_min[1] = b.min.y; node.bbox_min[2] = b.min.z;
+    node.bbox_max[0] = b.max.x; node.bbox_max[1] = b.max.y; node.bbox_max[2] = b.max.z;
+}
+
+void Builder::build(uint32_t node_index, uint32_t begin, uint32_t end, int depth)
+{
+    Bounds bounds;
+    Bounds centroid_bounds;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        bounds.grow(primitives[order[i]].bounds);
+        centroid_bounds.grow(primitives[order[i]].centroid);
+    }
+
+    SetNodeBounds(nodes[node_index], bounds);
+
+    uint32_t count = end - begin;
+
+    // Procuramos a melhor divisão entre os três eixos, agrupando os centróides
+    // em BVH_SAH_BINS baldes e avaliando o custo SAH de cada fronteira.
+    int   best_axis  = -1;
+    int   best_split = 0;
+    float best_cost  = std::numeric_limits<float>::max();
+
+    // Abaixo do nível BVH_MAX_DEPTH - 1 todo nó é folha: a travessia empilha
+    // no máximo um irmão por nível, então a pilha de BVH_MAX_DEPTH entradas
+    // nunca transborda
+    if (count > BVH_MAX_LEAF && depth + 1 < BVH_MAX_DEPTH)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+            if (extent <= 0.0f)
+                continue;
+
+            Bounds   bin_bounds[BVH_SAH_BINS];
+            uint32_t bin_count[BVH_SAH_BINS] = { 0 };
+            float    scale = BVH_SAH_BINS / extent;
+
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const BuildTriangle& p = primitives[order[i]];
+                int b = std::min(BVH_SAH_BINS - 1, (int)((p.centroid[axis] - centroid_bounds.min[axis]) * scale));
+                bin_bounds[b].grow(p.bounds);
+                bin_count[b] += 1;
+            }
+
+            // Varreduras da esquerda para a direita e vice-versa, acumulando
+            // áreas e contagens de cada lado da fronteira.
+            float    left_area[BVH_SAH_BINS - 1];
+            uint32_t left_count[BVH_SAH_BINS - 1];
+            Bounds   acc;
+            uint32_t n = 0;
+            for (int b = 0; b < BVH_SAH_BINS - 1; ++b)
+            {
+                acc.grow(bin_bounds[b]);
+                n += bin_count[b];
+                left_area[b]  = acc.area();
+                left_count[b] = n;
+            }
+
+            acc = Bounds();
+            n = 0;
+            for (int b = BVH_SAH_BINS - 1; b > 0; --b)
+            {
+                acc.grow(bin_bounds[b]);
+                n += bin_count[b];
+                if (left_count[b - 1] == 0 || n == 0)
+                    continue;
+                float cost = left_area[b - 1] * left_count[b - 1] + acc.area() * n;
+                if (cost < best_cost)
+                {
+                    best_cost  = cost;
+                    best_axis  = axis;
+                    best_split = b;
+                }
+            }
+        }
+    }
+
+    float parent_area = bounds.area();
+    float leaf_cost   = BVH_COST_TRIANGLE * count;
+    float split_cost  = (parent_area > 0.0f)
+                      ? BVH_COST_TRAVERSAL + BVH_COST_TRIANGLE * best_cost / parent_area
+                      : std::numeric_limits<float>::max();
+
+    if (best_axis < 0 || (split_cost >= leaf_cost && count <= 4 * BVH_MAX_LEAF))
+    {
+        nodes[node_index].index = begin;
+        nodes[node_index].count = count;
+        nodes[node_index].axis  = 0;
+        return;
+    }
+
+    float extent = centroid_bounds.max[best_axis] - centroid_bounds.min[best_axis];
+    float scale  = BVH_SAH_BINS / extent;
+    float minval = centroid_bounds.min[best_axis];
+    uint32_t* middle = std::partition(order.data() + begin, order.data() + end,
+        [&](uint32_t i) {
+            int b = std::min(BVH_SAH_BINS - 1, (int)((primitives[i].centroid[best_axis] - minval) * scale));
+            return b < best_split;
+        });
+    uint32_t mid = (uint32_t)(middle - order.data());
+
+    // Filho da esquerda logo após o pai; o da direita depois de toda a
+    // subárvore da esquerda.
+    uint32_t left = (uint32_t)nodes.size();
+    nodes.push_back(BvhNode());
+    build(left, begin, mid, depth + 1);
+
+    uint32_t right = (uint32_t)nodes.size();
+    nodes.push_back(BvhNode());
+    build(right, mid, end, depth + 1);
+
+    nodes[node_index].index = right;
+    nodes[node_index].count = 0;
+    nodes[node_index].axis  = (uint32_t)best_axis;
+}
+
+// Teste raio x AABB pelo método dos "slabs"
+inline bool RayBoxIntersect(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inv_dir, float tmax)
+{
+    float tmin = 0.0f;
+    for (int a = 0; a < 3; ++a)
+    {
+        float t0 = (node.bbox_min[a] - origin[a]) * inv_dir[a];
+        float t1 = (node.bbox_max[a] - origin[a]) * inv_dir[a];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tmin = std::max(tmin, t0);
+        tmax = std::min(tmax, t1);
+    }
+    return tmin <= tmax;
+}
+
+// Teste raio x triângulo de Möller-Trumbore. Retorna a distância ou infinito.
+inline float RayTriangleIntersect(const BvhTriangle& tri, const glm::vec3& origin, const glm::vec3& direction)
+{
+    const float epsilon = 1e-8f;
+    glm::vec3 p = glm::cross(direction, tri.edge2);
+    float det = glm::dot(tri.edge1, p);
+    if (std::fabs(det) < epsilon)
+        return std::numeric_limits<float>::infinity();
+
+    float inv_det = 1.0f / det;
+    glm::vec3 s = origin - tri.v0;
+    float u = glm::dot(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f)
+        return std::numeric_limits<float>::infinity();
+
+    glm::vec3 q = glm::cross(s, tri.edge1);
+    float v = glm::dot(direction, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f)
+        return std::numeric_limits<float>::infinity();
+
+    float t = glm::dot(tri.edge2, q) * inv_det;
+    return (t >= 0.0f) ? t : std::numeric_limits<float>::infinity();
+}
+
+// Percorre a árvore uma vez para até BVH_PACKET_SIZE raios. Um nó é visitado
+// se pelo menos um raio do pacote atinge a sua caixa.
+void RaycastPacket(const BVH& bvh, const BvhRay* rays, BvhHit* hits, size_t n)
+{
+    glm::vec3 inv_dir[BVH_PACKET_SIZE];
+    float     closest[BVH_PACKET_SIZE];
+
+    for (size_t r = 0; r < n; ++r)
+    {
+        inv_dir[r] = 1.0f / rays[r].direction;
+        closest[r] = rays[r].tmax;
+        hits[r].t = std::numeric_limits<float>::infinity();
+        hits[r].triangle = -1;
+    }
+
+    if (bvh.nodes.empty())
+        return;
+
+    uint32_t stack[BVH_MAX_DEPTH];
+    int      top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const BvhNode& node = bvh.nodes[stack[--top]];
+
+        unsigned mask = 0;
+        for (size_t r = 0; r < n; ++r)
+            if (RayBoxIntersect(node, rays[r].origin, inv_dir[r], closest[r]))
+                mask |= 1u << r;
+
+        if (mask == 0)
+            continue;
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.index; i < node.index + node.count; ++i)
+            {
+                const BvhTriangle& tri = bvh.triangles[i];
+                for (size_t r = 0; r < n; ++r)
+                {
+                    if (!(mask & (1u << r)))
+                        continue;
+                    float t = RayTriangleIntersect(tri, rays[r].origin, rays[r].direction);
+                    if (t < closest[r])
+                    {
+                        closest[r] = t;
+                        hits[r].t = t;
+                        hits[r].triangle = (int)i;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Empilhamos primeiro o filho mais distante, segundo o sentido do
+        // primeiro raio ativo, para visitar o mais próximo antes.
+        int first = 0;
+        while (!(mask & (1u << first)))
+            ++first;
+
+        uint32_t left  = (uint32_t)(&node - bvh.nodes.data()) + 1;
+        uint32_t right = node.index;
+        if (rays[first].direction[node.axis] < 0.0f)
+            std::swap(left, right);
+
+        stack[top++] = right;
+        stack[top++] = left;
+    }
+
+    for (size_t r = 0; r < n; ++r)
+    {
+        if (hits[r].triangle < 0)
+            continue;
+        const BvhTriangle& tri = bvh.triangles[hits[r].triangle];
+        glm::vec3 normal = glm::normalize(glm::cross(tri.edge1, tri.edge2));
+        if (glm::dot(normal, rays[r].direction) > 0.0f)
+            normal = -normal;
+        hits[r].position = rays[r].origin + hits[r].t * rays[r].direction;
+        hits[r].normal   = normal;
+    }
+}
+
+} // namespace
+
+void BVH_Build(BVH& bvh, const std::vector<glm::vec3>& triangle_vertices)
+{
+    bvh.nodes.clear();
+    bvh.triangles.clear();
+
+    size_t num_triangles = triangle_vertices.size() / 3;
+    if (num_triangles == 0)
+        return;
+    if (num_triangles > BVH_MAX_TRIANGLES)
+    {
+        fprintf(stderr, "ERROR: BVH supports at most %u triangles, got %zu; BVH not built.\n",
+                BVH_MAX_TRIANGLES, num_triangles);
+        return;
+    }
+
+    Builder builder(triangle_vertices, bvh.nodes);
+    builder.primitives.resize(num_triangles);
+    builder.order.resize(num_triangles);
+
+    for (size_t i = 0; i < num_triangles; ++i)
+    {
+        BuildTriangle& p = builder.primitives[i];
+        p.bounds.grow(triangle_vertices[3*i + 0]);
+        p.bounds.grow(triangle_vertices[3*i + 1]);
+        p.bounds.grow(triangle_vertices[3*i + 2]);
+        p.centroid = (triangle_vertices[3*i + 0] + triangle_vertices[3*i + 1] + triangle_vertices[3*i + 2]) / 3.0f;
+        builder.order[i] = (uint32_t)i;
+    }
+
+    bvh.nodes.reserve(2 * num_triangles);
+    bvh.nodes.push_back(BvhNode());
+    builder.build(0, 0, (uint32_t)num_triangles, 0);
+
+    // Reordenamos os triângulos para que cada folha referencie um intervalo
+    // contíguo de memória.
+    bvh.triangles.resize(num_triangles);
+    for (size_t i = 0; i < num_triangles; ++i)
+    {
+        uint32_t src = builder.order[i];
+        BvhTriangle& tri = bvh.triangles[i];
+        tri.v0    = triangle_vertices[3*src + 0];
+        tri.edge1 = triangle_vertices[3*src + 1] - tri.v0;
+        tri.edge2 = triangle_vertices[3*src + 2] - tri.v0;
+    }
+}
+
+bool BVH_Raycast(const BVH& bvh, const BvhRay& ray, BvhHit* hit)
+{
+    RaycastPacket(bvh, &ray, hit, 1);
+    return hit->triangle >= 0;
+}
+
+void BVH_RaycastBatch(const BVH& bvh, const BvhRay* rays, BvhHit* hits, size_t count)
+{
+    for (size_t base = 0; base < count; base += BVH_PACKET_SIZE)
+    {
+        size_t n = std::min(count - base, (size_t)BVH_PACKET_SIZE);
+        RaycastPacket(bvh, rays + base, hits + base, n);
+    }
+}
+
+void BVH_SegmentBatch(const BVH& bvh, const glm::vec3* from, const glm::vec3* to, BvhHit* hits, size_t count)
+{
+    for (size_t base = 0; base < count; base += BVH_PACKET_SIZE)
+    {
+        size_t n = std::min(count - base, (size_t)BVH_PACKET_SIZE);
+
+        BvhRay rays[BVH_PACKET_SIZE];
+        for (size_t r = 0; r < n; ++r)
+        {
+            glm::vec3 d = to[base + r] - from[base + r];
+            float length = glm::length(d);
+            rays[r].origin    = from[base + r];
+            rays[r].direction = (length > 0.0f) ? d / length : glm::vec3(0.0f, -1.0f, 0.0f);
+            rays[r].tmax      = length;
+        }
+        RaycastPacket(bvh, rays, hits + base, n);
+    }
+}
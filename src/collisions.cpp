@@ -3,74 +3,26 @@
 #include <vector>
 #include <algorithm>
 #include <cstdio>
+#include <cmath>
+#include <limits>
 
-float tree_radius = 0.27f;       
-float outdoor_radius = 0.2f;
 float bonus_radius = 0.1f; 
 
-std::vector<glm::vec3> tree_positions = {
-    glm::vec3(6.0f,-1.0f,-8.0f), 
-    glm::vec3(-6.0f,-1.0f,-8.0f),
-    glm::vec3(78.0f, -1.0f, -74.0f),
-    glm::vec3(96.0f, -1.0f, -74.0f),
-    glm::vec3(17.0f, -1.0f, -70.0f),
-    glm::vec3(41.0f, -1.0f, -42.0f),
-    glm::vec3(47.0f, -1.0f, -4.0f),
-    glm::vec3(39.0f, -1.0f, 31.0f),
-    glm::vec3(10.0f, -1.0f, 35.0f)
-};
-
-std::vector<glm::vec3> outdoor_positions = {
-    glm::vec3(6.0f, 0.0f, -30.0f),
-    glm::vec3(-6.0f, 0.0f, -30.0f),
-    glm::vec3(31.68f, 0.0f, -100.0f),
-    glm::vec3(28.32f, 0.0f, -100.0f),
-    glm::vec3(22.0f, 0.0f, -42.32f),
-    glm::vec3(22.0f, 0.0f, -45.68f),
-    glm::vec3(-1.43f, 0.0f, 53.57f),
-    glm::vec3(1.43f, 0.0f, 56.43f)
-};
-
-
 /*    
         carro com linha de chegada (cubo x plano)
         carro com pista (cubo x sla oq (deve ser plano, essa vai ser foda) (talvez tu pode tentar com a grama que nao vai ta em contato direto))
 */
 
+// carro com árvores, postes e outros colisores da pista (cubo x cilindro
+// vertical de altura infinita: só o plano XZ importa, veja level.h)
 bool cube_cilinder_intersect(glm::vec3 min, glm::vec3 max, glm::vec3 center, float radius){
     float closest_x = std::max(min.x, std::min(center.x, max.x));
-    float closest_y = std::max(min.y, std::min(center.y, max.y));
     float closest_z = std::max(min.z, std::min(center.z, max.z));
 
-    glm::vec3 closest_point = glm::vec3(closest_x, closest_y, closest_z);
-
-    float distance = glm::distance(glm::vec3(center.x, center.y, center.z), closest_point);
-
-    if(distance <= radius){
-        return true;
-    }
+    float dx = center.x - closest_x;
+    float dz = center.z - closest_z;
 
-    return false;
-}
-
-// carro com arvore -> tree_body (cubo x cilindro)
-bool cube_cilinder_intersect_tree(glm::vec3 min, glm::vec3 max){
-    for (const auto& pos : tree_positions) {
-        if(cube_cilinder_intersect(min, max, pos, tree_radius)){
-            return true;
-        }
-    }
-    return false;
-}
-
-// carro com outdoor -> outdoor_post1/2 (cubo x cilindro)
-bool cube_cilinder_intersect_outdoor(glm::vec3 min, glm::vec3 max){
-    for (const auto& pos : outdoor_positions) {
-        if(cube_cilinder_intersect(min, max, pos, outdoor_radius)){
-            return true;
-        }
-    }
-    return false;
+    return dx*dx + dz*dz <= radius*radius;
 }
 
 // carro com linha de chegada (ponto x cubo)
@@ -100,6 +52,68 @@ bool cube_sphere_intersect_bonus(glm::vec3 min, glm::vec3 max, glm::vec3 pos){
     return false;
 }
 
+// Mesmas dimensões usadas em ComputeCarAABB(): 1.28 m de largura, 0.8 m de
+// altura, de 1.8 m à frente até 1.3 m atrás da origem do carro.
+OrientedBox car_oriented_box(glm::vec3 position, float rotation_angle){
+    float s = sin(rotation_angle);
+    float c = cos(rotation_angle);
+
+    OrientedBox box;
+    box.center = position + glm::vec3(-0.25f * s, 0.4f, -0.25f * c);
+    box.half_extents = glm::vec3(0.64f, 0.4f, 1.55f);
+    box.rotation_angle = rotation_angle;
+    return box;
+}
+
+void oriented_box_bounds(const OrientedBox& box, glm::vec3* min, glm::vec3* max){
+    float s = fabs(sin(box.rotation_angle));
+    float c = fabs(cos(box.rotation_angle));
+    glm::vec3 extent(box.half_extents.x * c + box.half_extents.z * s,
+                     box.half_extents.y,
+                     box.half_extents.x * s + box.half_extents.z * c);
+    *min = box.center - extent;
+    *max = box.center + extent;
+}
+
+// carro com carro (OBB x OBB)
+bool obb_obb_intersect(const OrientedBox& a, const OrientedBox& b, glm::vec3* separation){
+    // As caixas só giram em torno de Y: primeiro a altura, depois os quatro
+    // eixos candidatos no plano XZ (os eixos locais X e Z de cada caixa).
+    glm::vec3 d = b.center - a.center;
+    if (fabs(d.y) > a.half_extents.y + b.half_extents.y)
+        return false;
+
+    float sa = sin(a.rotation_angle), ca = cos(a.rotation_angle);
+    float sb = sin(b.rotation_angle), cb = cos(b.rotation_angle);
+    glm::vec2 axes_a[2] = { glm::vec2(ca, -sa), glm::vec2(sa, ca) };
+    glm::vec2 axes_b[2] = { glm::vec2(cb, -sb), glm::vec2(sb, cb) };
+    glm::vec2 extent_a(a.half_extents.x, a.half_extents.z);
+    glm::vec2 extent_b(b.half_extents.x, b.half_extents.z);
+    glm::vec2 offset(d.x, d.z);
+
+    float min_overlap = std::numeric_limits<float>::max();
+    glm::vec2 min_axis(0.0f);
+    for (int k = 0; k < 4; ++k)
+    {
+        glm::vec2 axis = (k < 2) ? axes_a[k] : axes_b[k - 2];
+        float ra = extent_a.x * fabs(glm::dot(axes_a[0], axis)) + extent_a.y * fabs(glm::dot(axes_a[1], axis));
+        float rb = extent_b.x * fabs(glm::dot(axes_b[0], axis)) + extent_b.y * fabs(glm::dot(axes_b[1], axis));
+        float distance = glm::dot(offset, axis);
+        float overlap = ra + rb - fabs(distance);
+        if (overlap < 0.0f)
+            return false;
+        if (overlap < min_overlap)
+        {
+            min_overlap = overlap;
+            min_axis = (distance < 0.0f) ? -axis : axis;
+        }
+    }
+
+    if (separation != NULL)
+        *separation = glm::vec3(min_axis.x, 0.0f, min_axis.y) * min_overlap;
+    return true;
+}
+
 
 // carro com pista (cubo x sla oq (deve ser plano, essa vai ser foda) (talvez tu pode tentar com a grama que nao vai ta em contato direto))
 
@@ -0,0 +1,193 @@
+#include "ecs.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+const size_t component_size[COMPONENT_TYPE_COUNT] = {
+    sizeof(Transform),
+    sizeof(Collider),
+    sizeof(Renderable),
+    sizeof(BezierMover),
+    sizeof(ScoringTrigger)
+};
+
+uint32_t FindOrCreateArchetype(World& world, ComponentMask mask)
+{
+    for (size_t i = 0; i < world.archetypes.size(); ++i)
+        if (world.archetypes[i].mask == mask)
+            return (uint32_t)i;
+
+    world.archetypes.push_back(Archetype());
+    Archetype& archetype = world.archetypes.back();
+    archetype.mask = mask;
+    archetype.count = 0;
+    return (uint32_t)world.archetypes.size() - 1;
+}
+
+// Sistemas que podem rodar ao mesmo tempo
+bool Conflict(const System& a, const System& b)
+{
+    return (a.writes & (b.reads | b.writes)) != 0 || (b.writes & a.reads) != 0;
+}
+
+void RunJobs(void* context, size_t begin, size_t end)
+{
+    World& world = *static_cast<World*>(context);
+    for (size_t i = begin; i < end; ++i)
+    {
+        const SystemJob& job = world.jobs[i];
+        job.system->function(job.system->context, world.archetypes[job.archetype], job.begin, job.end);
+    }
+}
+
+} // namespace
+
+void World_Clear(World& world)
+{
+    world.archetypes.clear();
+    world.entity_archetype.clear();
+    world.entity_row.clear();
+    world.free_entities.clear();
+}
+
+void World_Reserve(World& world, ComponentMask mask, size_t count)
+{
+    Archetype& archetype = world.archetypes[FindOrCreateArchetype(world, mask)];
+    archetype.entities.reserve(archetype.count + count);
+    for (int c = 0; c < COMPONENT_TYPE_COUNT; ++c)
+        if (mask & COMPONENT_BIT(c))
+            archetype.columns[c].reserve((archetype.count + count) * component_size[c]);
+}
+
+Entity World_Create(World& world, ComponentMask mask)
+{
+    uint32_t index = FindOrCreateArchetype(world, mask);
+    Archetype& archetype = world.archetypes[index];
+
+    Entity entity;
+    if (!world.free_entities.empty())
+    {
+        entity = world.free_entities.back();
+        world.free_entities.pop_back();
+    }
+    else
+    {
+        entity = (Entity)world.entity_archetype.size();
+        world.entity_archetype.push_back(ENTITY_NONE);
+        world.entity_row.push_back(0);
+    }
+
+    uint32_t row = (uint32_t)archetype.count++;
+    archetype.entities.push_back(entity);
+    for (int c = 0; c < COMPONENT_TYPE_COUNT; ++c)
+        if (mask & COMPONENT_BIT(c))
+            archetype.columns[c].resize(archetype.count * component_size[c], 0);
+
+    world.entity_archetype[entity] = index;
+    world.entity_row[entity] = row;
+    return entity;
+}
+
+void World_Destroy(World& world, Entity entity)
+{
+    if (!World_IsAlive(world, entity))
+        return;
+
+    Archetype& archetype = world.archetypes[world.entity_archetype[entity]];
+    size_t row  = world.entity_row[entity];
+    size_t last = archetype.count - 1;
+
+    // A última linha ocupa o lugar da removida
+    if (row != last)
+    {
+        for (int c = 0; c < COMPONENT_TYPE_COUNT; ++c)
+        {
+            std::vector<uint8_t>& column = archetype.columns[c];
+            if (!column.empty())
+                memcpy(&column[row * component_size[c]], &column[last * component_size[c]], component_size[c]);
+        }
+        Entity moved = archetype.entities[last];
+        archetype.entities[row] = moved;
+        world.entity_row[moved] = (uint32_t)row;
+    }
+
+    archetype.count = last;
+    archetype.entities.pop_back();
+    for (int c = 0; c < COMPONENT_TYPE_COUNT; ++c)
+        if (!archetype.columns[c].empty())
+            archetype.columns[c].resize(last * component_size[c]);
+
+    world.entity_archetype[entity] = ENTITY_NONE;
+    world.free_entities.push_back(entity);
+}
+
+bool World_IsAlive(const World& world, Entity entity)
+{
+    return entity < world.entity_archetype.size() && world.entity_archetype[entity] != ENTITY_NONE;
+}
+
+void World_DestroyAll(World& world, ComponentMask mask)
+{
+    Archetype* archetype = World_FindArchetype(world, mask);
+    if (archetype == NULL)
+        return;
+
+    // De trás para frente, para que nenhuma linha precise ser movida
+    while (archetype->count > 0)
+        World_Destroy(world, archetype->entities[archetype->count - 1]);
+}
+
+Archetype* World_FindArchetype(World& world, ComponentMask mask)
+{
+    for (size_t i = 0; i < world.archetypes.size(); ++i)
+        if (world.archetypes[i].mask == mask)
+            return &world.archetypes[i];
+    return NULL;
+}
+
+size_t World_Count(const World& world)
+{
+    return world.entity_archetype.size() - world.free_entities.size();
+}
+
+void World_RunSystems(World& world, ThreadPool& pool, const System* systems, size_t count, size_t grain)
+{
+    if (grain == 0)
+        grain = 1;
+
+    size_t first = 0;
+    while (first < count)
+    {
+        // Fase: o maior grupo de sistemas consecutivos sem conflitos entre si
+        size_t last = first + 1;
+        for (; last < count; ++last)
+        {
+            bool conflict = false;
+            for (size_t s = first; s < last && !conflict; ++s)
+                conflict = Conflict(systems[s], systems[last]);
+            if (conflict)
+                break;
+        }
+
+        world.jobs.clear();
+        for (size_t s = first; s < last; ++s)
+        {
+            for (size_t a = 0; a < world.archetypes.size(); ++a)
+            {
+                const Archetype& archetype = world.archetypes[a];
+                if ((archetype.mask & systems[s].required) != systems[s].required)
+                    continue;
+                for (size_t begin = 0; begin < archetype.count; begin += grain)
+                {
+                    SystemJob job = { &systems[s], (uint32_t)a, begin, std::min(begin + grain, archetype.count) };
+                    world.jobs.push_back(job);
+                }
+            }
+        }
+
+        ThreadPool_ParallelFor(pool, world.jobs.size(), 1, RunJobs, &world);
+        first = last;
+    }
+}
@@ -0,0 +1,277 @@
+#include "envbatch.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include "collisions.h"
+#include "simulation.h"
+#include "tire.h"
+
+namespace {
+
+const size_t env_grain = 64; // Ambientes por bloco de trabalho
+
+// Velocidade de esterçamento do teclado (veja UpdateFrontWheelsAngle())
+const float tire_steer_rate = 200.0f * PI / 180.0f;
+
+struct StepContext
+{
+    EnvBatch*    envs;
+    const float* actions;
+    float*       observations;
+    float*       rewards;
+    uint8_t*     dones;
+};
+
+// Distância ao longo de cada raio até sair da pista. O campo guarda a
+// distância até a borda mais próxima, então é seguro avançar por ela
+// ("sphere tracing") sem atravessar a borda.
+void WriteObservation(const EnvBatch& envs, size_t i, float* out)
+{
+    const Fleet& cars = envs.cars;
+    float heading = cars.rotation_angle[i];
+    float s = std::sin(heading), c = std::cos(heading);
+    glm::vec2 position(cars.x[i], cars.z[i]);
+
+    out[0] = position.x;
+    out[1] = position.y;
+    if (envs.physics == ENV_PHYSICS_TIRE)
+    {
+        out[2] = envs.vx[i];
+        out[3] = envs.vz[i];
+    }
+    else
+    {
+        out[2] = -s * cars.speed[i];
+        out[3] = -c * cars.speed[i];
+    }
+    out[4] = s;
+    out[5] = c;
+    out[6] = cars.speed[i];
+    out[7] = cars.front_wheel_angle[i];
+
+    for (int k = 0; k < ENV_RAYS; ++k)
+    {
+        // De 90 graus à direita até 90 graus à esquerda
+        float angle = heading + (k - (ENV_RAYS - 1) * 0.5f) * (PI / (ENV_RAYS - 1));
+        glm::vec2 direction(-std::sin(angle), -std::cos(angle));
+        float t = 0.0f;
+        for (int iteration = 0; iteration < 32 && t < ENV_RAY_LENGTH; ++iteration)
+        {
+            glm::vec2 p = position + direction * t;
+            float distance = TrackField_Distance(g_TrackField, p.x, p.y);
+            if (distance >= 0.0f)
+                break;
+            t += std::max(-distance, 0.1f);
+        }
+        out[8 + k] = std::min(t, ENV_RAY_LENGTH) / ENV_RAY_LENGTH;
+    }
+}
+
+// Bônus coletados pelo carro do ambiente "i" neste passo
+int CollectBonuses(EnvBatch& envs, size_t i)
+{
+    const Fleet& cars = envs.cars;
+    glm::vec3 bbox_min(cars.x[i] - 1.2f, cars.y[i] - 0.3f, cars.z[i] - 1.2f);
+    glm::vec3 bbox_max(cars.x[i] + 1.2f, cars.y[i] + 1.0f, cars.z[i] + 1.2f);
+
+    int collected = 0;
+    uint8_t* active = &envs.bonus_active[i * envs.bonuses];
+    for (size_t b = 0; b < envs.bonuses; ++b)
+    {
+        if (!active[b])
+            continue;
+
+        const BezierMover& mover = envs.bonus_movers[b];
+        const BonusShape& shape = g_Bonuses.shapes[mover.shape];
+        if (!cube_sphere_intersect(bbox_min, bbox_max, shape.center + mover.origin, shape.radius + bonus_radius))
+            continue;
+
+        if (cube_sphere_intersect(bbox_min, bbox_max, Bonus_Position(g_Bonuses, mover, envs.time[i]), bonus_radius))
+        {
+            active[b] = 0;
+            ++collected;
+        }
+    }
+    return collected;
+}
+
+// Avança o carro do ambiente "i" com o modelo de pneus do jogador. "body"
+// é um Car de rascunho com as dimensões e taxas padrão; só os campos que
+// Tire_Step() lê e escreve são copiados de e para os vetores do ambiente.
+void MoveTireCar(EnvBatch& envs, size_t i, Car& body, float steer, float throttle, float dt)
+{
+    Fleet& cars = envs.cars;
+    steer    = std::max(-1.0f, std::min(1.0f, steer));
+    throttle = std::max(-1.0f, std::min(1.0f, throttle));
+
+    float target = steer * body.max_front_wheel_angle;
+    float steer_delta = std::max(-tire_steer_rate * dt, std::min(tire_steer_rate * dt, target - cars.front_wheel_angle[i]));
+
+    glm::vec3 position(cars.x[i], cars.y[i], cars.z[i]);
+    body.carPosition       = position;
+    body.carVelocity       = glm::vec3(envs.vx[i], 0.0f, envs.vz[i]);
+    body.carAcceleration   = glm::vec3(envs.ax[i], 0.0f, envs.az[i]);
+    body.rotation_angle    = cars.rotation_angle[i];
+    body.yaw_rate          = envs.yaw_rate[i];
+    body.front_wheel_angle = cars.front_wheel_angle[i] + steer_delta;
+    body.max_speed         = cars.max_speed[i];
+
+    TireControls controls;
+    controls.throttle = std::max(throttle, 0.0f);
+    controls.brake    = std::max(-throttle, 0.0f);
+    TrackSample surface = TrackField_Sample(g_TrackField, position.x, position.z);
+    Tire_Step(body, controls, surface.friction, dt);
+
+    // Colisão com os objetos estáticos: o carro para
+    glm::vec3 bbox_min(body.carPosition.x - 1.2f, position.y - 0.3f, body.carPosition.z - 1.2f);
+    glm::vec3 bbox_max(body.carPosition.x + 1.2f, position.y + 1.0f, body.carPosition.z + 1.2f);
+    if (Level_Intersect(g_Level, bbox_min, bbox_max))
+    {
+        body.carPosition = position;
+        body.carVelocity = glm::vec3(0.0f);
+        body.carAcceleration = glm::vec3(0.0f);
+        body.yaw_rate = 0.0f;
+    }
+
+    float speed = glm::length(body.carVelocity);
+    cars.x[i] = body.carPosition.x;
+    cars.z[i] = body.carPosition.z;
+    cars.rotation_angle[i] = body.rotation_angle;
+    cars.front_wheel_angle[i] = body.front_wheel_angle;
+    cars.speed[i] = speed;
+    cars.wheel_rotation_angle[i] += speed * dt / 0.4f;
+    envs.vx[i] = body.carVelocity.x;
+    envs.vz[i] = body.carVelocity.z;
+    envs.ax[i] = body.carAcceleration.x;
+    envs.az[i] = body.carAcceleration.z;
+    envs.yaw_rate[i] = body.yaw_rate;
+}
+
+void StepEnvs(void* context, size_t begin, size_t end)
+{
+    const StepContext& ctx  = *static_cast<StepContext*>(context);
+    EnvBatch&          envs = *ctx.envs;
+    Fleet&             cars = envs.cars;
+    const float        dt   = SIMULATION_TIMESTEP;
+    Car                body;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const float* action = &ctx.actions[i * ENV_ACTION_SIZE];
+        if (envs.physics == ENV_PHYSICS_TIRE)
+            MoveTireCar(envs, i, body, action[0], action[1], dt);
+        else
+            Fleet_MoveCar(cars, i, action[0], action[1], dt);
+
+        // Recompensa: avanço na trajetória, inclusive ao completar a volta
+        uint32_t laps = cars.laps[i];
+        uint32_t wp = Fleet_TrackProgress(cars, i, g_RacingLine);
+        float distance = g_RacingLine.distance[wp] + g_RacingLine.length * cars.laps[i];
+        float reward = distance - envs.progress[i];
+        envs.progress[i] = distance;
+
+        // Cada volta reativa os bônus do ambiente, como no jogo
+        if (cars.laps[i] != laps)
+            std::fill(&envs.bonus_active[i * envs.bonuses], &envs.bonus_active[i * envs.bonuses] + envs.bonuses, (uint8_t)1);
+        reward += 10.0f * CollectBonuses(envs, i);
+
+        float edge = TrackField_Distance(g_TrackField, cars.x[i], cars.z[i]);
+        if (edge > 0.0f)
+            reward -= dt;
+
+        envs.time[i] += dt;
+        envs.steps[i] += 1;
+        envs.score[i] += reward;
+
+        bool done = envs.steps[i] >= ENV_MAX_EPISODE_STEPS || edge > ENV_MAX_OFF_TRACK;
+        if (done)
+            EnvBatch_Reset(envs, i);
+
+        ctx.rewards[i] = reward;
+        ctx.dones[i] = done ? 1 : 0;
+        WriteObservation(envs, i, &ctx.observations[i * ENV_OBSERVATION_SIZE]);
+    }
+}
+
+void ObserveEnvs(void* context, size_t begin, size_t end)
+{
+    const StepContext& ctx = *static_cast<StepContext*>(context);
+    for (size_t i = begin; i < end; ++i)
+        WriteObservation(*ctx.envs, i, &ctx.observations[i * ENV_OBSERVATION_SIZE]);
+}
+
+} // namespace
+
+void EnvBatch_Init(EnvBatch& envs, size_t count, EnvPhysics physics)
+{
+    if (g_RacingLine.points.size() < 2)
+    {
+        fprintf(stderr, "ERROR: Environments need the racing line; no environments created.\n");
+        count = 0;
+    }
+
+    envs.count = count;
+    envs.physics = physics;
+    Fleet_Init(envs.cars, count, g_RacingLine, 0.0f);
+    envs.vx.assign(count, 0.0f);
+    envs.vz.assign(count, 0.0f);
+    envs.ax.assign(count, 0.0f);
+    envs.az.assign(count, 0.0f);
+    envs.yaw_rate.assign(count, 0.0f);
+    envs.time.assign(count, 0.0f);
+    envs.steps.assign(count, 0);
+    envs.progress.assign(count, 0.0f);
+    envs.score.assign(count, 0.0f);
+    // Os bônus de cada ambiente são os da pista, com o seu próprio estado
+    envs.bonus_movers.clear();
+    if (const Archetype* bonuses = World_FindArchetype(g_Scene, ENTITY_BONUS))
+        envs.bonus_movers.assign(World_Column<BezierMover>(*bonuses), World_Column<BezierMover>(*bonuses) + bonuses->count);
+    envs.bonuses = envs.bonus_movers.size();
+    envs.bonus_active.assign(count * envs.bonuses, 1);
+
+    for (size_t i = 0; i < count; ++i)
+        EnvBatch_Reset(envs, i);
+}
+
+void EnvBatch_Reset(EnvBatch& envs, size_t i)
+{
+    Fleet& cars = envs.cars;
+    const RacingLine& line = g_RacingLine;
+
+    // Todos os ambientes começam na largada, parados, alinhados com a trajetória
+    glm::vec2 tangent = glm::normalize(line.points[1] - line.points[0]);
+    cars.x[i] = line.points[0].x;
+    cars.y[i] = TRACK_HEIGHT + CAR_RIDE_HEIGHT;
+    cars.z[i] = line.points[0].y;
+    cars.rotation_angle[i] = std::atan2(-tangent.x, -tangent.y);
+    cars.front_wheel_angle[i] = 0.0f;
+    cars.wheel_rotation_angle[i] = 0.0f;
+    cars.speed[i] = 0.0f;
+    cars.max_speed[i] = car.max_speed;
+    cars.waypoint[i] = 0;
+    cars.laps[i] = 0;
+    envs.vx[i] = envs.vz[i] = 0.0f;
+    envs.ax[i] = envs.az[i] = 0.0f;
+    envs.yaw_rate[i] = 0.0f;
+
+    envs.time[i] = 0.0f;
+    envs.steps[i] = 0;
+    envs.progress[i] = 0.0f;
+    envs.score[i] = 0.0f;
+    std::fill(&envs.bonus_active[i * envs.bonuses], &envs.bonus_active[i * envs.bonuses] + envs.bonuses, (uint8_t)1);
+}
+
+void EnvBatch_Observe(const EnvBatch& envs, ThreadPool& pool, float* observations)
+{
+    StepContext context = { const_cast<EnvBatch*>(&envs), NULL, observations, NULL, NULL };
+    ThreadPool_ParallelFor(pool, envs.count, env_grain, ObserveEnvs, &context);
+}
+
+void EnvBatch_Step(EnvBatch& envs, ThreadPool& pool, const float* actions,
+                   float* observations, float* rewards, uint8_t* dones)
+{
+    StepContext context = { &envs, actions, observations, rewards, dones };
+    ThreadPool_ParallelFor(pool, envs.count, env_grain, StepEnvs, &context);
+}
@@ -0,0 +1,401 @@
+#include "fleet.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "bvh.h"
+#include "collisions.h"
+#include "simulation.h"
+#include "profiler.h"
+
+namespace {
+
+const float wheelbase       = 1.7f;  // Distância entre eixos, em metros
+const float max_steer       = glm::radians(40.0f);
+const float steer_rate      = 3.0f;  // rad/s
+const float acceleration    = 10.0f; // m/s^2
+const float braking         = 12.0f; // m/s^2
+const float lateral_grip    = 8.0f;  // Aceleração lateral máxima nas curvas, m/s^2
+const float edge_margin     = 1.5f;  // Distância mínima da trajetória até a borda da pista
+const float avoid_distance  = 14.0f; // Carros à frente mais perto que isso são evitados
+const float follow_distance = 6.0f;  // Abaixo disso, acompanha a velocidade do carro da frente
+const float lane_width      = 2.4f;  // Diferença lateral abaixo da qual dois carros se tocam
+const int   fleet_grain     = 16;    // Carros por bloco de trabalho
+
+// Reamostra uma linha fechada com pontos a cada "spacing" metros
+void Resample(std::vector<glm::vec2>& points, float spacing)
+{
+    size_t n = points.size();
+    float total = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+        total += glm::length(points[(i + 1) % n] - points[i]);
+
+    int count = std::max(3, (int)std::floor(total / spacing + 0.5f));
+    float step = total / count;
+
+    std::vector<glm::vec2> result;
+    result.reserve(count);
+    size_t segment = 0;
+    float  segment_start = 0.0f;
+    for (int k = 0; k < count; ++k)
+    {
+        float target = k * step;
+        float segment_length = glm::length(points[(segment + 1) % n] - points[segment]);
+        while (segment_start + segment_length < target && segment + 1 < n)
+        {
+            segment_start += segment_length;
+            ++segment;
+            segment_length = glm::length(points[(segment + 1) % n] - points[segment]);
+        }
+        float t = segment_length > 0.0f ? (target - segment_start) / segment_length : 0.0f;
+        result.push_back(glm::mix(points[segment], points[(segment + 1) % n], std::min(t, 1.0f)));
+    }
+    points.swap(result);
+}
+
+// Curvatura do círculo que passa por a, b e c
+float Curvature(glm::vec2 a, glm::vec2 b, glm::vec2 c)
+{
+    glm::vec2 ab = b - a, bc = c - b, ca = a - c;
+    float cross = ab.x * bc.y - ab.y * bc.x;
+    float denominator = glm::length(ab) * glm::length(bc) * glm::length(ca);
+    return denominator > 0.0f ? 2.0f * std::fabs(cross) / denominator : 0.0f;
+}
+
+struct StepContext
+{
+    Fleet*            fleet;
+    const RacingLine* line;
+    float             deltaTime;
+};
+
+bool SlotBefore(const FleetTrackSlot& a, const FleetTrackSlot& b)
+{
+    return a.distance < b.distance || (a.distance == b.distance && a.car < b.car);
+}
+
+void StepCars(void* context, size_t begin, size_t end)
+{
+    const StepContext& ctx  = *static_cast<StepContext*>(context);
+    Fleet&             f    = *ctx.fleet;
+    const RacingLine&  line = *ctx.line;
+    const float        dt   = ctx.deltaTime;
+    const uint32_t     n    = (uint32_t)line.points.size();
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        glm::vec2 position(f.x[i], f.z[i]);
+        uint32_t wp = Fleet_TrackProgress(f, i, line);
+
+        // Ponto alvo à frente na trajetória
+        float lookahead = 4.0f + 0.5f * f.speed[i];
+        uint32_t target = wp;
+        float walked = 0.0f;
+        while (walked < lookahead)
+        {
+            uint32_t next = (target + 1) % n;
+            walked += glm::length(line.points[next] - line.points[target]);
+            target = next;
+        }
+
+        // Carro mais próximo à frente na mesma faixa, se houver
+        const FleetTrackSlot& self = f.by_distance[f.rank[i]];
+        const FleetTrackSlot* blocker = NULL;
+        float gap = 0.0f;
+        for (size_t k = 1; k < f.count; ++k)
+        {
+            const FleetTrackSlot& other = f.by_distance[(f.rank[i] + k) % f.count];
+            gap = other.distance - self.distance;
+            if (gap < 0.0f)
+                gap += line.length;
+            if (gap > avoid_distance)
+                break;
+            if (std::fabs(other.lateral - self.lateral) < lane_width)
+            {
+                blocker = &other;
+                break;
+            }
+        }
+
+        // Para ultrapassar, o alvo vai para o lado do carro da frente mais
+        // próximo da trajetória
+        glm::vec2 target_point = line.points[target];
+        if (blocker != NULL)
+        {
+            float pass_left  = blocker->lateral + lane_width;
+            float pass_right = blocker->lateral - lane_width;
+            float lateral = std::fabs(pass_left) < std::fabs(pass_right) ? pass_left : pass_right;
+            glm::vec2 tangent = glm::normalize(line.points[(target + 1) % n] - line.points[target]);
+            target_point += glm::vec2(-tangent.y, tangent.x) * lateral;
+        }
+
+        // Pure pursuit: esterçamento que leva o carro ao alvo em um arco
+        float heading = f.rotation_angle[i];
+        glm::vec2 forward(-std::sin(heading), -std::cos(heading));
+        glm::vec2 right(std::cos(heading), -std::sin(heading));
+        glm::vec2 to_target = target_point - position;
+        float alpha = std::atan2(glm::dot(to_target, right), glm::dot(to_target, forward));
+        float steer = -std::atan(2.0f * wheelbase * std::sin(alpha) / lookahead);
+
+        // Acelerador para chegar à velocidade limitada pelo piloto, pela
+        // superfície e pela curva à frente
+        float friction = TrackField_Sample(g_TrackField, position.x, position.y).friction;
+        float target_speed = std::min(f.max_speed[i] * friction, line.speed_limit[target]);
+        if (blocker != NULL && gap < follow_distance)
+            target_speed = std::min(target_speed, blocker->speed);
+        float difference = target_speed - f.speed[i];
+        float throttle = difference >= 0.0f ? difference / (acceleration * friction * dt)
+                                            : difference / (braking * dt);
+
+        Fleet_MoveCar(f, i, steer / max_steer, throttle, dt);
+        Fleet_UpdateHeight(f, i);
+    }
+}
+
+} // namespace
+
+bool RacingLine_Build(RacingLine& line, const TrackField& field, glm::vec2 start, glm::vec2 direction)
+{
+    // 1. Caminha pela pista, corrigindo a posição em direção ao ponto mais
+    //    distante das bordas em cada seção transversal.
+    std::vector<glm::vec2> points;
+    glm::vec2 p = start;
+    glm::vec2 d = glm::normalize(direction);
+    points.push_back(p);
+    bool closed = false;
+    for (int k = 0; k < 10000 && !closed; ++k)
+    {
+        glm::vec2 q = p + d;
+        glm::vec2 normal(-d.y, d.x);
+        float best_offset = 0.0f;
+        float best_distance = TrackField_Distance(field, q.x, q.y);
+        for (float offset = -6.0f; offset <= 6.0f; offset += 0.25f)
+        {
+            glm::vec2 s = q + normal * offset;
+            float distance = TrackField_Distance(field, s.x, s.y);
+            if (distance < best_distance - 1e-3f)
+            {
+                best_distance = distance;
+                best_offset = offset;
+            }
+        }
+        q += normal * best_offset * 0.3f;
+        d = glm::normalize(q - p);
+        p = q;
+        points.push_back(p);
+        closed = k > 50 && glm::length(p - start) < 1.5f;
+    }
+    if (!closed)
+        return false;
+    points.pop_back();
+    Resample(points, 1.0f);
+
+    // 2. Suaviza a linha (o que corta as curvas), sem chegar perto da borda
+    size_t n = points.size();
+    std::vector<glm::vec2> smoothed(n);
+    for (int iteration = 0; iteration < 300; ++iteration)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            glm::vec2 average = 0.5f * (points[(i + n - 1) % n] + points[(i + 1) % n]);
+            glm::vec2 candidate = glm::mix(points[i], average, 0.5f);
+            smoothed[i] = TrackField_Distance(field, candidate.x, candidate.y) < -edge_margin ? candidate : points[i];
+        }
+        points.swap(smoothed);
+    }
+    Resample(points, 1.0f);
+    n = points.size();
+
+    // 3. Limite de velocidade pela curvatura, e frenagem antecipada: cada
+    //    ponto é limitado pela velocidade da qual se consegue frear até o
+    //    limite do ponto seguinte. Duas voltas para propagar pelo fechamento.
+    line.points = points;
+    line.distance.resize(n);
+    line.speed_limit.resize(n);
+    line.length = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+    {
+        line.distance[i] = line.length;
+        line.length += glm::length(points[(i + 1) % n] - points[i]);
+
+        float curvature = Curvature(points[(i + n - 1) % n], points[i], points[(i + 1) % n]);
+        line.speed_limit[i] = curvature > 1e-4f ? std::min(100.0f, std::sqrt(lateral_grip / curvature)) : 100.0f;
+    }
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (size_t k = n; k-- > 0;)
+        {
+            size_t next = (k + 1) % n;
+            float ds = glm::length(points[next] - points[k]);
+            line.speed_limit[k] = std::min(line.speed_limit[k], std::sqrt(line.speed_limit[next] * line.speed_limit[next] + 2.0f * braking * ds));
+        }
+    }
+
+    printf("Trajetória de corrida: %d pontos, %.0f m.\n", (int)n, line.length);
+    return true;
+}
+
+void Fleet_Init(Fleet& fleet, size_t count, const RacingLine& line, float start_distance)
+{
+    fleet.count = count;
+    fleet.x.assign(count, 0.0f);
+    fleet.y.assign(count, TRACK_HEIGHT + CAR_RIDE_HEIGHT);
+    fleet.z.assign(count, 0.0f);
+    fleet.rotation_angle.assign(count, 0.0f);
+    fleet.front_wheel_angle.assign(count, 0.0f);
+    fleet.wheel_rotation_angle.assign(count, 0.0f);
+    fleet.speed.assign(count, 0.0f);
+    fleet.max_speed.assign(count, 0.0f);
+    fleet.waypoint.assign(count, 0);
+    fleet.laps.assign(count, 0);
+    fleet.by_distance.resize(count);
+    fleet.rank.assign(count, 0);
+
+    size_t n = line.points.size();
+    if (n == 0)
+        return;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Duas filas, a cada 6 m, começando 8 m atrás da largada
+        float s = start_distance - 8.0f - 6.0f * (float)(i / 2);
+        s = std::fmod(s, line.length);
+        if (s < 0.0f)
+            s += line.length;
+
+        size_t k = std::upper_bound(line.distance.begin(), line.distance.end(), s) - line.distance.begin();
+        k = (k + n - 1) % n;
+        glm::vec2 tangent = glm::normalize(line.points[(k + 1) % n] - line.points[k]);
+        glm::vec2 side(-tangent.y, tangent.x);
+        glm::vec2 p = line.points[k] + side * ((i % 2) ? -1.5f : 1.5f);
+
+        fleet.x[i] = p.x;
+        fleet.z[i] = p.y;
+        fleet.rotation_angle[i] = std::atan2(-tangent.x, -tangent.y);
+        fleet.waypoint[i] = (uint32_t)k;
+
+        // Pilotos com velocidades máximas diferentes, de forma determinística
+        fleet.max_speed[i] = 17.0f + 3.0f * (float)((i * 7919) % 100) / 100.0f;
+    }
+}
+
+uint32_t Fleet_TrackProgress(Fleet& f, size_t i, const RacingLine& line)
+{
+    // Avança o ponto mais próximo da trajetória (coerência temporal: o carro
+    // anda no máximo alguns pontos por passo)
+    const uint32_t n = (uint32_t)line.points.size();
+    glm::vec2 position(f.x[i], f.z[i]);
+    uint32_t wp = f.waypoint[i];
+    for (uint32_t k = 0; k < n; ++k)
+    {
+        uint32_t next = (wp + 1) % n;
+        glm::vec2 a = line.points[wp] - position, b = line.points[next] - position;
+        if (glm::dot(b, b) >= glm::dot(a, a))
+            break;
+        wp = next;
+        if (wp == 0)
+            ++f.laps[i];
+    }
+    f.waypoint[i] = wp;
+    return wp;
+}
+
+void Fleet_MoveCar(Fleet& f, size_t i, float steer, float throttle, float dt)
+{
+    steer    = std::max(-1.0f, std::min(1.0f, steer));
+    throttle = std::max(-1.0f, std::min(1.0f, throttle));
+
+    glm::vec2 position(f.x[i], f.z[i]);
+    float steer_delta = std::max(-steer_rate * dt, std::min(steer_rate * dt, steer * max_steer - f.front_wheel_angle[i]));
+    f.front_wheel_angle[i] += steer_delta;
+
+    // Acelerador positivo acelera (menos na grama), negativo freia. Acima do
+    // limite da superfície o carro perde velocidade como se freasse.
+    TrackSample surface = TrackField_Sample(g_TrackField, position.x, position.y);
+    float speed = f.speed[i];
+    speed += throttle >= 0.0f ? throttle * acceleration * surface.friction * dt : throttle * braking * dt;
+    if (speed > f.max_speed[i] * surface.friction)
+        speed = std::max(f.max_speed[i] * surface.friction, speed - braking * dt);
+    speed = std::max(speed, 0.0f);
+
+    float heading = f.rotation_angle[i] + speed * std::tan(f.front_wheel_angle[i]) / wheelbase * dt;
+    glm::vec2 forward(-std::sin(heading), -std::cos(heading));
+    glm::vec2 moved = position + forward * speed * dt;
+
+    // Colisão com os objetos estáticos: o carro para
+    glm::vec3 bbox_min(moved.x - 1.2f, f.y[i] - 0.3f, moved.y - 1.2f);
+    glm::vec3 bbox_max(moved.x + 1.2f, f.y[i] + 1.0f, moved.y + 1.2f);
+    if (Level_Intersect(g_Level, bbox_min, bbox_max))
+    {
+        moved = position;
+        speed = 0.0f;
+    }
+
+    f.x[i] = moved.x;
+    f.z[i] = moved.y;
+    f.rotation_angle[i] = heading;
+    f.speed[i] = speed;
+    f.wheel_rotation_angle[i] += speed * dt / 0.4f;
+}
+
+void Fleet_UpdateHeight(Fleet& f, size_t i)
+{
+    // Altura do chão embaixo das quatro rodas, em um único pacote
+    float heading = f.rotation_angle[i];
+    glm::vec2 position(f.x[i], f.z[i]);
+    glm::vec2 forward(-std::sin(heading), -std::cos(heading));
+    glm::vec2 side(-forward.y, forward.x);
+    glm::vec2 wheel[4] = {
+        position + forward * 1.1f + side * 0.55f, position + forward * 1.1f - side * 0.55f,
+        position - forward * 0.6f + side * 0.55f, position - forward * 0.6f - side * 0.55f
+    };
+    glm::vec3 from[4], to[4];
+    for (int w = 0; w < 4; ++w)
+    {
+        from[w] = glm::vec3(wheel[w].x, f.y[i] + 1.0f, wheel[w].y);
+        to[w]   = glm::vec3(wheel[w].x, f.y[i] - 2.0f, wheel[w].y);
+    }
+    BvhHit hits[4];
+    BVH_SegmentBatch(g_TrackBVH, from, to, hits, 4);
+    float height = 0.0f;
+    int   num_hits = 0;
+    for (int w = 0; w < 4; ++w)
+    {
+        if (hits[w].triangle >= 0)
+        {
+            height += hits[w].position.y;
+            ++num_hits;
+        }
+    }
+    if (num_hits > 0)
+        f.y[i] = height / num_hits + CAR_RIDE_HEIGHT;
+}
+
+void Fleet_Step(Fleet& fleet, const RacingLine& line, ThreadPool& pool, float deltaTime)
+{
+    PROFILE_ZONE("fleet");
+
+    if (fleet.count == 0 || line.points.empty())
+        return;
+
+    // Posições na trajetória no início do passo (veja Fleet::by_distance).
+    // Empates são desfeitos pelo índice, para que a ordem seja determinística.
+    const size_t n = line.points.size();
+    for (size_t i = 0; i < fleet.count; ++i)
+    {
+        uint32_t wp = fleet.waypoint[i];
+        glm::vec2 tangent = glm::normalize(line.points[(wp + 1) % n] - line.points[wp]);
+        glm::vec2 offset = glm::vec2(fleet.x[i], fleet.z[i]) - line.points[wp];
+        FleetTrackSlot& slot = fleet.by_distance[i];
+        slot.distance = line.distance[wp] + glm::dot(offset, tangent);
+        slot.lateral  = glm::dot(offset, glm::vec2(-tangent.y, tangent.x));
+        slot.speed    = fleet.speed[i];
+        slot.car      = (uint32_t)i;
+    }
+    std::sort(fleet.by_distance.begin(), fleet.by_distance.end(), SlotBefore);
+    for (size_t k = 0; k < fleet.count; ++k)
+        fleet.rank[fleet.by_distance[k].car] = (uint32_t)k;
+
+    StepContext context = { &fleet, &line, deltaTime };
+    ThreadPool_ParallelFor(pool, fleet.count, fleet_grain, StepCars, &context);
+}
@@ -0,0 +1,326 @@
+#include "ghost.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "simulation.h"
+
+#define GHOST_MAGIC   0x54534847u // "GHST"
+#define GHOST_VERSION 1u
+
+namespace {
+
+const float two_pi = 2.0f * PI;
+
+// Ângulo em [0, 2pi) <-> 16 bits sem sinal
+inline uint16_t QuantizeTurn(float angle)
+{
+    float turns = angle / two_pi;
+    turns -= std::floor(turns);
+    return (uint16_t)((uint32_t)(turns * 65536.0f + 0.5f) & 0xffff);
+}
+
+inline float DequantizeTurn(uint16_t value)
+{
+    return value * (two_pi / 65536.0f);
+}
+
+// Ângulo em [-pi, pi] <-> 16 bits com sinal
+inline int16_t QuantizeSigned(float angle)
+{
+    float v = std::max(-1.0f, std::min(1.0f, angle / PI));
+    return (int16_t)std::floor(v * 32767.0f + 0.5f);
+}
+
+inline float DequantizeSigned(int16_t value)
+{
+    return value * (PI / 32767.0f);
+}
+
+// Interpola dois ângulos pelo menor arco
+inline float LerpAngle(float a, float b, float t)
+{
+    float d = std::fmod(b - a, two_pi);
+    if (d > PI)
+        d -= two_pi;
+    else if (d < -PI)
+        d += two_pi;
+    return a + d * t;
+}
+
+void DecodeFrame(const GhostFileHeader& header, const GhostFrame& frame, GhostPose* pose)
+{
+    pose->position = glm::vec3(header.origin[0], header.origin[1], header.origin[2])
+                   + glm::vec3(frame.x, frame.y, frame.z) * header.position_scale;
+    pose->rotation_angle       = DequantizeTurn(frame.rotation_angle);
+    pose->front_wheel_angle    = DequantizeSigned(frame.front_wheel_angle);
+    pose->wheel_rotation_angle = DequantizeTurn(frame.wheel_rotation_angle);
+}
+
+float ReadLapTime(const char* filename)
+{
+    GhostFileHeader header;
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return std::numeric_limits<float>::max();
+
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+           && header.magic == GHOST_MAGIC && header.version == GHOST_VERSION;
+    fclose(file);
+    return ok ? header.lap_time : std::numeric_limits<float>::max();
+}
+
+bool SaveGhost(const GhostRecorder& recorder, float lap_time)
+{
+    const std::vector<GhostPose>& poses = recorder.poses;
+
+    glm::vec3 bmin( std::numeric_limits<float>::max());
+    glm::vec3 bmax(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < poses.size(); ++i)
+    {
+        bmin = glm::min(bmin, poses[i].position);
+        bmax = glm::max(bmax, poses[i].position);
+    }
+
+    GhostFileHeader header;
+    header.magic          = GHOST_MAGIC;
+    header.version        = GHOST_VERSION;
+    header.frame_count    = (uint32_t)poses.size();
+    header.frame_interval = GHOST_FRAME_STEPS * SIMULATION_TIMESTEP;
+    header.lap_time       = lap_time;
+    glm::vec3 origin = 0.5f * (bmin + bmax);
+    header.origin[0] = origin.x;
+    header.origin[1] = origin.y;
+    header.origin[2] = origin.z;
+    float extent = std::max(0.5f * glm::length(bmax - bmin), 1.0f);
+    header.position_scale = extent / 32767.0f;
+
+    // Gravamos em um arquivo temporário e renomeamos, para não invalidar um
+    // mapeamento do arquivo anterior que esteja sendo reproduzido.
+    char temporary[1024];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", recorder.filename);
+    FILE* file = fopen(temporary, "wb");
+    if (file == NULL)
+        return false;
+
+    fwrite(&header, sizeof(header), 1, file);
+    for (size_t i = 0; i < poses.size(); ++i)
+    {
+        glm::vec3 p = (poses[i].position - origin) / header.position_scale;
+        GhostFrame frame;
+        frame.x = (int16_t)std::floor(p.x + 0.5f);
+        frame.y = (int16_t)std::floor(p.y + 0.5f);
+        frame.z = (int16_t)std::floor(p.z + 0.5f);
+        frame.rotation_angle       = QuantizeTurn(poses[i].rotation_angle);
+        frame.front_wheel_angle    = QuantizeSigned(poses[i].front_wheel_angle);
+        frame.wheel_rotation_angle = QuantizeTurn(poses[i].wheel_rotation_angle);
+        fwrite(&frame, sizeof(frame), 1, file);
+    }
+    bool ok = ferror(file) == 0;
+    fclose(file);
+
+#ifdef _WIN32
+    // No Windows, rename() não substitui um arquivo existente
+    remove(recorder.filename);
+#endif
+    return ok && rename(temporary, recorder.filename) == 0;
+}
+
+void PushPose(GhostRecorder& recorder)
+{
+    GhostPose pose;
+    pose.position             = car.carPosition;
+    pose.rotation_angle       = car.rotation_angle;
+    pose.front_wheel_angle    = car.front_wheel_angle;
+    pose.wheel_rotation_angle = car.wheel_rotation_angle;
+    recorder.poses.push_back(pose);
+}
+
+} // namespace
+
+bool Ghost_Open(GhostPlayer& ghost, const char* filename)
+{
+    ghost.header  = NULL;
+    ghost.frames  = NULL;
+    ghost.mapping = NULL;
+    ghost.size    = 0;
+
+#ifdef _WIN32
+    ghost.file_handle    = INVALID_HANDLE_VALUE;
+    ghost.mapping_handle = NULL;
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    ghost.file_handle = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(GhostFileHeader))
+    {
+        Ghost_Close(ghost);
+        return false;
+    }
+    ghost.size = (size_t)size.QuadPart;
+
+    ghost.mapping_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (ghost.mapping_handle != NULL)
+        ghost.mapping = MapViewOfFile(ghost.mapping_handle, FILE_MAP_READ, 0, 0, 0);
+#else
+    ghost.fd = open(filename, O_RDONLY);
+    if (ghost.fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(ghost.fd, &info) != 0 || info.st_size < (off_t)sizeof(GhostFileHeader))
+    {
+        Ghost_Close(ghost);
+        return false;
+    }
+    ghost.size = (size_t)info.st_size;
+
+    void* mapping = mmap(NULL, ghost.size, PROT_READ, MAP_PRIVATE, ghost.fd, 0);
+    ghost.mapping = (mapping == MAP_FAILED) ? NULL : mapping;
+#endif
+
+    if (ghost.mapping == NULL)
+    {
+        Ghost_Close(ghost);
+        return false;
+    }
+
+    const GhostFileHeader* header = static_cast<const GhostFileHeader*>(ghost.mapping);
+    if (header->magic != GHOST_MAGIC || header->version != GHOST_VERSION || header->frame_count == 0
+        || ghost.size < sizeof(GhostFileHeader) + (size_t)header->frame_count * sizeof(GhostFrame))
+    {
+        fprintf(stderr, "WARNING: Invalid ghost file \"%s\".\n", filename);
+        Ghost_Close(ghost);
+        return false;
+    }
+
+    ghost.header = header;
+    ghost.frames = reinterpret_cast<const GhostFrame*>(header + 1);
+    printf("Fantasma \"%s\": volta de %.3f s, %u poses.\n", filename, header->lap_time, header->frame_count);
+    return true;
+}
+
+void Ghost_Close(GhostPlayer& ghost)
+{
+#ifdef _WIN32
+    if (ghost.mapping != NULL)
+        UnmapViewOfFile(ghost.mapping);
+    if (ghost.mapping_handle != NULL)
+        CloseHandle(ghost.mapping_handle);
+    if (ghost.file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(ghost.file_handle);
+    ghost.mapping_handle = NULL;
+    ghost.file_handle    = INVALID_HANDLE_VALUE;
+#else
+    if (ghost.mapping != NULL)
+        munmap(ghost.mapping, ghost.size);
+    if (ghost.fd >= 0)
+        close(ghost.fd);
+    ghost.fd = -1;
+#endif
+    ghost.mapping = NULL;
+    ghost.header  = NULL;
+    ghost.frames  = NULL;
+    ghost.size    = 0;
+}
+
+void Ghost_Sample(const GhostPlayer& ghost, float time, GhostPose* pose)
+{
+    const GhostFileHeader& header = *ghost.header;
+    uint32_t last = header.frame_count - 1;
+
+    float f = std::max(0.0f, time / header.frame_interval);
+    uint32_t i = (uint32_t)std::min(f, (float)last);
+    if (i >= last)
+    {
+        DecodeFrame(header, ghost.frames[last], pose);
+        return;
+    }
+
+    GhostPose a, b;
+    DecodeFrame(header, ghost.frames[i], &a);
+    DecodeFrame(header, ghost.frames[i + 1], &b);
+    float t = f - (float)i;
+
+    pose->position             = a.position + (b.position - a.position) * t;
+    pose->rotation_angle       = LerpAngle(a.rotation_angle, b.rotation_angle, t);
+    pose->front_wheel_angle    = a.front_wheel_angle + (b.front_wheel_angle - a.front_wheel_angle) * t;
+    pose->wheel_rotation_angle = LerpAngle(a.wheel_rotation_angle, b.wheel_rotation_angle, t);
+}
+
+void Ghost_BeginRecording(GhostRecorder& recorder, const char* filename)
+{
+    recorder.filename      = filename;
+    recorder.best_lap_time = ReadLapTime(filename);
+    recorder.poses.clear();
+    recorder.poses.reserve(60 * 30 * 2); // Voltas de até 2 minutos sem realocar
+    recorder.laps      = g_LapTimes.size();
+    recorder.lap_start = g_LapStartTime;
+    recorder.steps     = 0;
+    PushPose(recorder);
+}
+
+void Ghost_RecordStep(GhostRecorder& recorder)
+{
+    if (recorder.filename == NULL)
+        return;
+
+    if (g_LapTimes.size() > recorder.laps)
+    {
+        float lap_time = g_LapTimes.back();
+        // Uma volta em que o jogador voltou no tempo para antes da largada não
+        // tem poses desde o início e não é salva
+        size_t lap_frames = (size_t)(lap_time / (SIMULATION_TIMESTEP * GHOST_FRAME_STEPS));
+        if (lap_time < recorder.best_lap_time && recorder.poses.size() > 1 && recorder.poses.size() >= lap_frames)
+        {
+            if (SaveGhost(recorder, lap_time))
+            {
+                recorder.best_lap_time = lap_time;
+                printf("Nova melhor volta (%.3f s) salva em \"%s\".\n", lap_time, recorder.filename);
+            }
+            else
+            {
+                fprintf(stderr, "WARNING: Cannot write ghost file \"%s\".\n", recorder.filename);
+            }
+        }
+    }
+
+    // Passos simulados desde o início da volta. Se o jogador voltou no tempo
+    // (veja Simulation_Rewind()), as poses do futuro são descartadas.
+    uint64_t lap_steps = (uint64_t)((g_SimulationTime - g_LapStartTime) / SIMULATION_TIMESTEP + 0.5);
+
+    // Uma nova volta começou (linha de chegada ou carro reiniciado)
+    if (g_LapStartTime != recorder.lap_start)
+    {
+        recorder.poses.clear();
+        recorder.steps = 0;
+        PushPose(recorder);
+    }
+    else if (lap_steps < recorder.steps)
+    {
+        recorder.steps = lap_steps;
+        recorder.poses.resize(lap_steps / GHOST_FRAME_STEPS + 1);
+    }
+    else if (++recorder.steps % GHOST_FRAME_STEPS == 0)
+    {
+        PushPose(recorder);
+    }
+
+    recorder.laps      = g_LapTimes.size();
+    recorder.lap_start = g_LapStartTime;
+}
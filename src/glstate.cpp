@@ -0,0 +1,336 @@
+// Cópia do estado do contexto OpenGL (veja glstate.h). As chamadas que
+// chegam ao OpenGL passam pelas estatísticas de glstats.h, as descartadas são
+// contadas por GlStats_CountRedundant(), e os uniforms enviados são contados
+// pelo profiler.
+#include <cstring>
+
+#include "glstate.h"
+#include "glstats.h"
+#include "profiler.h"
+
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu // Estado ainda não definido
+
+namespace {
+
+struct GlStateUniform
+{
+    bool    valid;
+    uint8_t size;
+    uint8_t value[16 * sizeof(GLfloat)];
+};
+
+struct GlStateProgram
+{
+    GLuint         program; // 0 se a entrada está livre
+    GlStateUniform uniforms[GL_STATE_UNIFORMS];
+};
+
+// Capacidades guardadas por GlState_Enable()/GlState_Disable()
+const GLenum cached_caps[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE };
+const int num_cached_caps = sizeof(cached_caps) / sizeof(cached_caps[0]);
+
+struct GlState
+{
+    GLuint          program;
+    GlStateProgram* program_state; // Uniforms do programa atual, ou NULL
+    GlStateProgram  programs[GL_STATE_PROGRAMS];
+    int             next_program;  // Próxima entrada a ser reaproveitada
+    GLuint          vertex_array;
+    GLuint          array_buffer;
+    GLuint          uniform_buffer;
+    GLuint          uniform_bindings[GL_STATE_UNIFORM_BINDINGS];
+    GLuint          active_texture;
+    GLuint          textures[GL_STATE_TEXTURE_UNITS];
+    GLenum          texture_targets[GL_STATE_TEXTURE_UNITS];
+    GLuint          samplers[GL_STATE_TEXTURE_UNITS];
+    GLuint          caps[num_cached_caps];
+    GLuint          blend_src;
+    GLuint          blend_dst;
+    GLuint          depth_func;
+    GLuint          depth_mask;
+    GLuint          cull_face;
+    GLuint          front_face;
+    GLuint          polygon_mode;
+
+    GlState()
+        : program(GL_STATE_UNKNOWN), program_state(NULL), next_program(0), vertex_array(GL_STATE_UNKNOWN),
+          array_buffer(GL_STATE_UNKNOWN), uniform_buffer(GL_STATE_UNKNOWN), active_texture(GL_STATE_UNKNOWN),
+          blend_src(GL_STATE_UNKNOWN), blend_dst(GL_STATE_UNKNOWN), depth_func(GL_STATE_UNKNOWN),
+          depth_mask(GL_STATE_UNKNOWN), cull_face(GL_STATE_UNKNOWN), front_face(GL_STATE_UNKNOWN),
+          polygon_mode(GL_STATE_UNKNOWN)
+    {
+        memset(programs, 0, sizeof(programs));
+        for (int i = 0; i < GL_STATE_TEXTURE_UNITS; ++i)
+        {
+            textures[i] = GL_STATE_UNKNOWN;
+            texture_targets[i] = GL_STATE_UNKNOWN;
+            samplers[i] = GL_STATE_UNKNOWN;
+        }
+        for (int i = 0; i < num_cached_caps; ++i)
+            caps[i] = GL_STATE_UNKNOWN;
+        for (int i = 0; i < GL_STATE_UNIFORM_BINDINGS; ++i)
+            uniform_bindings[i] = GL_STATE_UNKNOWN;
+    }
+};
+
+GlState g_GlState;
+
+// Atualiza "state" com "value", retornando true se ele mudou. Se não mudou,
+// a chamada é contada como descartada em "call".
+bool Change(GLuint& state, GLuint value, GlStatsCall call)
+{
+    if (state == value)
+    {
+        GlStats_CountRedundant(call);
+        return false;
+    }
+    state = value;
+    return true;
+}
+
+// Valores dos uniforms de "program", guardados em uma de GL_STATE_PROGRAMS
+// entradas. Quando não há entrada livre, a mais antiga é esquecida.
+GlStateProgram* ProgramState(GLuint program)
+{
+    if (program == 0)
+        return NULL;
+
+    GlState& state = g_GlState;
+    for (int i = 0; i < GL_STATE_PROGRAMS; ++i)
+        if (state.programs[i].program == program)
+            return &state.programs[i];
+
+    GlStateProgram* entry = &state.programs[state.next_program];
+    state.next_program = (state.next_program + 1) % GL_STATE_PROGRAMS;
+    memset(entry, 0, sizeof(GlStateProgram));
+    entry->program = program;
+    return entry;
+}
+
+// Guarda o valor do uniform, retornando true se ele mudou (ou se não é
+// possível saber)
+bool ChangeUniform(GLint location, const void* value, size_t size)
+{
+    GlStateProgram* program = g_GlState.program_state;
+    if (program == NULL || location < 0 || location >= GL_STATE_UNIFORMS)
+        return true;
+
+    GlStateUniform& uniform = program->uniforms[location];
+    if (uniform.valid && uniform.size == size && memcmp(uniform.value, value, size) == 0)
+    {
+        GlStats_CountRedundant(GL_STATS_UNIFORM);
+        return false;
+    }
+
+    uniform.valid = true;
+    uniform.size = (uint8_t)size;
+    memcpy(uniform.value, value, size);
+    return true;
+}
+
+int CapIndex(GLenum cap)
+{
+    for (int i = 0; i < num_cached_caps; ++i)
+        if (cached_caps[i] == cap)
+            return i;
+    return -1;
+}
+
+} // namespace
+
+void GlState_UseProgram(GLuint program)
+{
+    if (Change(g_GlState.program, program, GL_STATS_PROGRAM))
+    {
+        g_GlState.program_state = ProgramState(program);
+        glUseProgram(program);
+    }
+}
+
+void GlState_DeleteProgram(GLuint program)
+{
+    GlState& state = g_GlState;
+    for (int i = 0; i < GL_STATE_PROGRAMS; ++i)
+        if (state.programs[i].program == program)
+            memset(&state.programs[i], 0, sizeof(GlStateProgram));
+
+    // Apagar o programa atual não o desliga, mas o id pode voltar em outro
+    if (state.program == program)
+    {
+        state.program = GL_STATE_UNKNOWN;
+        state.program_state = NULL;
+    }
+    glDeleteProgram(program);
+}
+
+void GlState_BindVertexArray(GLuint vertex_array)
+{
+    if (Change(g_GlState.vertex_array, vertex_array, GL_STATS_BIND_VAO))
+        glBindVertexArray(vertex_array);
+}
+
+// Apagar o VAO ligado volta o binding para 0
+void GlState_DeleteVertexArray(GLuint vertex_array)
+{
+    if (g_GlState.vertex_array == vertex_array)
+        g_GlState.vertex_array = 0;
+    glDeleteVertexArrays(1, &vertex_array);
+}
+
+void GlState_BindBuffer(GLenum target, GLuint buffer)
+{
+    if (target == GL_ARRAY_BUFFER && !Change(g_GlState.array_buffer, buffer, GL_STATS_BIND_BUFFER))
+        return;
+    if (target == GL_UNIFORM_BUFFER && !Change(g_GlState.uniform_buffer, buffer, GL_STATS_BIND_BUFFER))
+        return;
+    glBindBuffer(target, buffer);
+}
+
+void GlState_DeleteBuffer(GLuint buffer)
+{
+    if (g_GlState.array_buffer == buffer)
+        g_GlState.array_buffer = 0;
+    if (g_GlState.uniform_buffer == buffer)
+        g_GlState.uniform_buffer = 0;
+    for (int i = 0; i < GL_STATE_UNIFORM_BINDINGS; ++i)
+        if (g_GlState.uniform_bindings[i] == buffer)
+            g_GlState.uniform_bindings[i] = 0;
+    glDeleteBuffers(1, &buffer);
+}
+
+void GlState_BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    if (target == GL_UNIFORM_BUFFER)
+    {
+        bool cached = index < GL_STATE_UNIFORM_BINDINGS;
+        if (cached && g_GlState.uniform_bindings[index] == buffer && g_GlState.uniform_buffer == buffer)
+        {
+            GlStats_CountRedundant(GL_STATS_BIND_BUFFER);
+            return;
+        }
+        if (cached)
+            g_GlState.uniform_bindings[index] = buffer;
+        g_GlState.uniform_buffer = buffer;
+    }
+    glBindBufferBase(target, index, buffer);
+}
+
+void GlState_BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    GlState& state = g_GlState;
+    if (unit < GL_STATE_TEXTURE_UNITS && state.textures[unit] == texture && state.texture_targets[unit] == target)
+    {
+        GlStats_CountRedundant(GL_STATS_BIND_TEXTURE);
+        return;
+    }
+
+    if (Change(state.active_texture, unit, GL_STATS_BIND_TEXTURE))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+
+    if (unit < GL_STATE_TEXTURE_UNITS)
+    {
+        state.textures[unit] = texture;
+        state.texture_targets[unit] = target;
+    }
+}
+
+void GlState_BindSampler(GLuint unit, GLuint sampler)
+{
+    if (unit >= GL_STATE_TEXTURE_UNITS || Change(g_GlState.samplers[unit], sampler, GL_STATS_BIND_TEXTURE))
+        glBindSampler(unit, sampler);
+}
+
+void GlState_Enable(GLenum cap)
+{
+    int index = CapIndex(cap);
+    if (index < 0 || Change(g_GlState.caps[index], GL_TRUE, GL_STATS_ENABLE))
+        glEnable(cap);
+}
+
+void GlState_Disable(GLenum cap)
+{
+    int index = CapIndex(cap);
+    if (index < 0 || Change(g_GlState.caps[index], GL_FALSE, GL_STATS_ENABLE))
+        glDisable(cap);
+}
+
+void GlState_BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    GlState& state = g_GlState;
+    if (state.blend_src == sfactor && state.blend_dst == dfactor)
+    {
+        GlStats_CountRedundant(GL_STATS_STATE);
+        return;
+    }
+    state.blend_src = sfactor;
+    state.blend_dst = dfactor;
+    glBlendFunc(sfactor, dfactor);
+}
+
+void GlState_DepthFunc(GLenum func)
+{
+    if (Change(g_GlState.depth_func, func, GL_STATS_STATE))
+        glDepthFunc(func);
+}
+
+void GlState_DepthMask(GLboolean flag)
+{
+    if (Change(g_GlState.depth_mask, flag, GL_STATS_STATE))
+        glDepthMask(flag);
+}
+
+void GlState_CullFace(GLenum mode)
+{
+    if (Change(g_GlState.cull_face, mode, GL_STATS_STATE))
+        glCullFace(mode);
+}
+
+void GlState_FrontFace(GLenum mode)
+{
+    if (Change(g_GlState.front_face, mode, GL_STATS_STATE))
+        glFrontFace(mode);
+}
+
+void GlState_PolygonMode(GLenum mode)
+{
+    if (Change(g_GlState.polygon_mode, mode, GL_STATS_STATE))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GlState_Uniform1i(GLint location, GLint value)
+{
+    if (ChangeUniform(location, &value, sizeof(value)))
+    {
+        glUniform1i(location, value);
+        PROFILE_COUNT("uniforms", 1);
+    }
+}
+
+void GlState_Uniform1f(GLint location, GLfloat value)
+{
+    if (ChangeUniform(location, &value, sizeof(value)))
+    {
+        glUniform1f(location, value);
+        PROFILE_COUNT("uniforms", 1);
+    }
+}
+
+void GlState_Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+    const GLfloat value[4] = { x, y, z, w };
+    if (ChangeUniform(location, value, sizeof(value)))
+    {
+        glUniform4f(location, x, y, z, w);
+        PROFILE_COUNT("uniforms", 1);
+    }
+}
+
+void GlState_UniformMatrix4fv(GLint location, const GLfloat* value)
+{
+    if (ChangeUniform(location, value, 16 * sizeof(GLfloat)))
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+        PROFILE_COUNT("uniforms", 1);
+    }
+}
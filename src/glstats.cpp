@@ -0,0 +1,62 @@
+// Estatísticas das chamadas OpenGL por quadro (veja glstats.h)
+#include <cstdio>
+#include <cstring>
+
+#include "glstats.h"
+
+GlStats g_GlStats;
+
+void GlStats_EndFrame()
+{
+#if GL_STATS_ENABLED
+    memcpy(&g_GlStats.last, &g_GlStats.current, sizeof(GlStatsFrame));
+    memset(&g_GlStats.current, 0, sizeof(GlStatsFrame));
+#endif
+}
+
+void GlStats_Print()
+{
+#if GL_STATS_ENABLED
+    static const char* const columns[GL_STATS_CALL_COUNT] = {
+        "desenho", "uniform", "programa", "vao", "buffer", "textura", "enable", "estado", "upload", "criação"
+    };
+
+    const GlStatsFrame& frame = g_GlStats.last;
+    GlStatsFrame total;
+    memset(&total, 0, sizeof(total));
+
+    printf("Chamadas OpenGL do último quadro (enviadas/descartadas por repetir o estado):\n%-16s", "zona");
+    for (int c = 0; c < GL_STATS_CALL_COUNT; ++c)
+        printf(" %10s", columns[c]);
+    printf(" %10s\n", "bytes");
+
+    int zones = g_Profiler.zone_count.load();
+    for (int z = 0; z < GL_STATS_ZONES; ++z)
+    {
+        bool used = frame.bytes[z] != 0;
+        for (int c = 0; c < GL_STATS_CALL_COUNT; ++c)
+        {
+            used = used || frame.calls[z][c] != 0;
+            total.calls[0][c] += frame.calls[z][c];
+            total.redundant[0][c] += frame.redundant[z][c];
+        }
+        total.bytes[0] += frame.bytes[z];
+        if (!used)
+            continue;
+
+        const char* name = z < zones ? g_Profiler.zone_names[z] : "(fora de zonas)";
+        printf("%-16s", name);
+        for (int c = 0; c < GL_STATS_CALL_COUNT; ++c)
+            printf(" %5u/%-4u", frame.calls[z][c], frame.redundant[z][c]);
+        printf(" %10llu\n", (unsigned long long)frame.bytes[z]);
+    }
+
+    printf("%-16s", "total");
+    for (int c = 0; c < GL_STATS_CALL_COUNT; ++c)
+        printf(" %5u/%-4u", total.calls[0][c], total.redundant[0][c]);
+    printf(" %10llu\n", (unsigned long long)total.bytes[0]);
+    fflush(stdout);
+#else
+    printf("Estatísticas OpenGL desligadas nesta compilação (veja glstats.h).\n");
+#endif
+}
@@ -0,0 +1,214 @@
+// Queries de tempo e de estatísticas da GPU por passo do desenho (veja
+// gputimer.h).
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "utils.h"
+#include "profiler.h"
+#include "gputimer.h"
+
+// ARB_pipeline_statistics_query não está no glad.h deste projeto
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB   0x82F0
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+
+namespace {
+
+// Queries de um quadro. Cada passo tem uma query de tempo, um timestamp do
+// seu início (para posicionar o passo nos traces) e, se suportado, as
+// contagens de execuções dos shaders.
+struct GpuFrameQueries
+{
+    GLuint elapsed[GPU_PASS_COUNT];
+    GLuint timestamp[GPU_PASS_COUNT];
+    GLuint vertices[GPU_PASS_COUNT];
+    GLuint fragments[GPU_PASS_COUNT];
+    bool   used[GPU_PASS_COUNT]; // Passo medido e ainda não lido
+};
+
+struct GpuTimer
+{
+    bool             initialized;
+    bool             statistics;   // ARB_pipeline_statistics_query
+    GpuFrameQueries  frames[GPU_TIMER_LATENCY];
+    GpuFrameQueries* current;      // Queries do quadro atual
+    uint64_t         frame;        // Quadros começados
+    int              active;       // Passo sendo medido, ou -1
+    int64_t          clock_offset; // Profiler_Now() menos o relógio da GPU, em ns
+    ProfileThread*   track;
+    uint16_t         zones[GPU_PASS_COUNT];
+    uint16_t         vertex_counters[GPU_PASS_COUNT];
+    uint16_t         fragment_counters[GPU_PASS_COUNT];
+};
+
+GpuTimer g_GpuTimer;
+
+const char* const pass_zones[GPU_PASS_COUNT] = {
+    "gpu carro", "gpu cenario", "gpu ceu", "gpu pista", "gpu fantasmas", "gpu texto"
+};
+const char* const pass_vertex_counters[GPU_PASS_COUNT] = {
+    "vertices carro", "vertices cenario", "vertices ceu", "vertices pista", "vertices fantasmas", "vertices texto"
+};
+const char* const pass_fragment_counters[GPU_PASS_COUNT] = {
+    "fragmentos carro", "fragmentos cenario", "fragmentos ceu", "fragmentos pista", "fragmentos fantasmas", "fragmentos texto"
+};
+
+bool HasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+            return true;
+    return false;
+}
+
+// Relaciona o relógio da GPU com o do profiler. Os dois andam juntos, então
+// basta refazer de vez em quando.
+void Calibrate(GpuTimer& timer)
+{
+    GLint64 gpu_ns = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+    timer.clock_offset = (int64_t)Profiler_Now() - (int64_t)gpu_ns;
+}
+
+bool Available(GLuint query)
+{
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available == GL_TRUE;
+}
+
+GLuint64 Result(GLuint query)
+{
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+    return result;
+}
+
+// Passa os resultados de um quadro para o profiler. Resultados que ainda não
+// ficaram prontos depois de GPU_TIMER_LATENCY quadros são descartados.
+void Collect(GpuTimer& timer, GpuFrameQueries& queries)
+{
+    for (int pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        if (!queries.used[pass])
+            continue;
+        queries.used[pass] = false;
+
+        if (!Available(queries.elapsed[pass]) || !Available(queries.timestamp[pass]))
+            continue;
+
+        uint64_t begin_ns = (uint64_t)((int64_t)Result(queries.timestamp[pass]) + timer.clock_offset);
+        Profiler_RecordOn(timer.track, timer.zones[pass], begin_ns, begin_ns + Result(queries.elapsed[pass]));
+
+        if (timer.statistics && Available(queries.vertices[pass]) && Available(queries.fragments[pass]))
+        {
+            Profiler_Count(timer.vertex_counters[pass], (int64_t)Result(queries.vertices[pass]));
+            Profiler_Count(timer.fragment_counters[pass], (int64_t)Result(queries.fragments[pass]));
+        }
+    }
+}
+
+} // namespace
+
+void GpuTimer_Init()
+{
+#if PROFILER_ENABLED
+    GpuTimer& timer = g_GpuTimer;
+    timer.statistics = HasExtension("GL_ARB_pipeline_statistics_query");
+
+    for (int f = 0; f < GPU_TIMER_LATENCY; ++f)
+    {
+        GpuFrameQueries& queries = timer.frames[f];
+        glGenQueries(GPU_PASS_COUNT, queries.elapsed);
+        glGenQueries(GPU_PASS_COUNT, queries.timestamp);
+        if (timer.statistics)
+        {
+            glGenQueries(GPU_PASS_COUNT, queries.vertices);
+            glGenQueries(GPU_PASS_COUNT, queries.fragments);
+        }
+        for (int pass = 0; pass < GPU_PASS_COUNT; ++pass)
+            queries.used[pass] = false;
+    }
+
+    timer.track = Profiler_AddTrack("GPU");
+    for (int pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        timer.zones[pass] = Profiler_RegisterZone(pass_zones[pass]);
+        if (timer.statistics)
+        {
+            timer.vertex_counters[pass] = Profiler_RegisterCounter(pass_vertex_counters[pass]);
+            timer.fragment_counters[pass] = Profiler_RegisterCounter(pass_fragment_counters[pass]);
+        }
+    }
+
+    timer.current = NULL;
+    timer.frame = 0;
+    timer.active = -1;
+    Calibrate(timer);
+    timer.initialized = true;
+    glCheckError();
+
+    printf("Estatísticas da GPU por passo: %s.\n", timer.statistics ? "sim" : "não (sem ARB_pipeline_statistics_query)");
+#endif
+}
+
+void GpuTimer_BeginFrame()
+{
+#if PROFILER_ENABLED
+    GpuTimer& timer = g_GpuTimer;
+    if (!timer.initialized)
+        return;
+
+    if (timer.frame % PROFILER_HISTORY == 0)
+        Calibrate(timer);
+
+    // As queries deste quadro foram usadas GPU_TIMER_LATENCY quadros atrás
+    timer.current = &timer.frames[timer.frame % GPU_TIMER_LATENCY];
+    Collect(timer, *timer.current);
+    timer.frame += 1;
+#endif
+}
+
+void GpuTimer_BeginPass(GpuPass pass)
+{
+#if PROFILER_ENABLED
+    GpuTimer& timer = g_GpuTimer;
+    if (timer.current == NULL || timer.active >= 0 || !g_Profiler.enabled.load(std::memory_order_relaxed))
+        return;
+
+    GpuFrameQueries& queries = *timer.current;
+    glQueryCounter(queries.timestamp[pass], GL_TIMESTAMP);
+    glBeginQuery(GL_TIME_ELAPSED, queries.elapsed[pass]);
+    if (timer.statistics)
+    {
+        glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, queries.vertices[pass]);
+        glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, queries.fragments[pass]);
+    }
+    queries.used[pass] = true;
+    timer.active = pass;
+#endif
+}
+
+void GpuTimer_EndPass()
+{
+#if PROFILER_ENABLED
+    GpuTimer& timer = g_GpuTimer;
+    if (!timer.initialized || timer.active < 0)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    if (timer.statistics)
+    {
+        glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+        glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+    }
+    timer.active = -1;
+#endif
+}
+
+bool GpuTimer_HasPipelineStatistics()
+{
+    return g_GpuTimer.statistics;
+}
@@ -0,0 +1,241 @@
+#include "headless.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "simulation.h"
+#include "replay.h"
+#include "ghost.h"
+#include "alloctrack.h"
+
+namespace {
+
+// Passos iniciais em que as alocações não são contadas: buffers que crescem
+// sob demanda (pares do broadphase, poses do fantasma etc.) atingem o
+// tamanho final aqui.
+const long alloc_warmup_steps = 240;
+
+struct ScriptEntry
+{
+    long    steps;
+    uint8_t input;
+};
+
+bool LoadScript(const char* filename, std::vector<ScriptEntry>& script)
+{
+    FILE* file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open input script \"%s\".\n", filename);
+        return false;
+    }
+
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        ++line_number;
+        char* p = line;
+        while (*p == ' ' || *p == '\t')
+            ++p;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+            continue;
+
+        ScriptEntry entry;
+        char keys[32];
+        if (sscanf(p, "%ld %31s", &entry.steps, keys) != 2 || entry.steps <= 0)
+        {
+            fprintf(stderr, "ERROR: Invalid line %d in input script \"%s\".\n", line_number, filename);
+            fclose(file);
+            return false;
+        }
+
+        entry.input = 0;
+        if (strpbrk(keys, "Ww")) entry.input |= INPUT_KEY_W;
+        if (strpbrk(keys, "Ss")) entry.input |= INPUT_KEY_S;
+        if (strpbrk(keys, "Aa")) entry.input |= INPUT_KEY_A;
+        if (strpbrk(keys, "Dd")) entry.input |= INPUT_KEY_D;
+        if (strpbrk(keys, "Rr")) entry.input |= INPUT_REWIND;
+        script.push_back(entry);
+    }
+
+    fclose(file);
+    return true;
+}
+
+} // namespace
+
+int Headless_Run(int argc, char* argv[])
+{
+    const char* script_filename = NULL;
+    const char* record_filename = NULL;
+    const char* replay_filename = NULL;
+    const char* ghost_filename  = NULL;
+    int  laps      = 1;
+    int  bonuses   = -1; // Negativo: não escolhido (0, ou o valor gravado no replay)
+    int  opponents = -1;
+    long max_steps = 120L * 60 * 60; // Uma hora de jogo
+    bool assert_no_alloc = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            continue;
+        else if (strcmp(argv[i], "--laps") == 0 && i + 1 < argc)
+            laps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc)
+            max_steps = atol(argv[++i]);
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_filename = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay_filename = argv[++i];
+        else if (strcmp(argv[i], "--opponents") == 0 && i + 1 < argc)
+            opponents = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bonuses") == 0 && i + 1 < argc)
+            bonuses = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ghost") == 0 && i + 1 < argc)
+            ghost_filename = argv[++i];
+        else if (strcmp(argv[i], "--assert-no-alloc") == 0)
+            assert_no_alloc = true;
+        else
+            script_filename = argv[i];
+    }
+
+    if ((script_filename == NULL) == (replay_filename == NULL))
+    {
+        fprintf(stderr, "Uso: %s --headless (<roteiro.txt> | --replay <arquivo>) [--laps N] [--max-steps N] [--record <arquivo>] [--ghost <arquivo>] [--bonuses N] [--opponents N] [--assert-no-alloc]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<ScriptEntry> script;
+    ReplayPlayer player;
+    if (replay_filename != NULL)
+    {
+        if (!Replay_Load(player, replay_filename) || !Replay_ApplySetup(player, &opponents, &bonuses))
+            return EXIT_FAILURE;
+    }
+    else
+    {
+        if (!LoadScript(script_filename, script))
+            return EXIT_FAILURE;
+        if (script.empty())
+        {
+            fprintf(stderr, "ERROR: Input script \"%s\" is empty.\n", script_filename);
+            return EXIT_FAILURE;
+        }
+    }
+
+    opponents = std::max(opponents, 0);
+    bonuses   = std::max(bonuses, 0);
+
+    ReplayRecorder recorder;
+    recorder.file = NULL;
+    if (record_filename != NULL && !Replay_BeginRecording(recorder, record_filename, opponents, bonuses))
+        return EXIT_FAILURE;
+
+    ObjModel trackmodel("../../data/track/track.obj");
+    ComputeNormals(&trackmodel);
+    ObjModel planemodel("../../data/plane/plane.obj");
+    ComputeNormals(&planemodel);
+    Simulation_BuildTrack(&trackmodel, &planemodel);
+
+    InitializeBonusObjects(bonuses);
+    resetCar();
+    Simulation_SpawnOpponents(opponents);
+
+    GhostRecorder ghost_recorder;
+    ghost_recorder.filename = NULL;
+    if (ghost_filename != NULL)
+        Ghost_BeginRecording(ghost_recorder, ghost_filename);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    long steps = 0;
+    size_t entry = 0;
+    long entry_steps = 0;
+    AllocCounters alloc_start = AllocTrack_Read();
+    uint64_t allocations = 0;
+    while (steps < max_steps)
+    {
+        if (steps == alloc_warmup_steps)
+            alloc_start = AllocTrack_Read();
+
+        uint8_t input;
+        if (replay_filename != NULL)
+        {
+            // Um replay é reproduzido até o fim, independente de "--laps"
+            if (!Replay_NextInput(player, &input))
+                break;
+        }
+        else
+        {
+            if ((int)g_LapTimes.size() >= laps)
+                break;
+
+            input = script[entry].input;
+            if (++entry_steps == script[entry].steps)
+            {
+                entry_steps = 0;
+                entry = (entry + 1) % script.size();
+            }
+        }
+
+        Simulation_Step(input, SIMULATION_TIMESTEP);
+        ++steps;
+
+        if (replay_filename != NULL)
+            Replay_VerifyStep(player);
+        Replay_RecordStep(recorder, input);
+        Ghost_RecordStep(ghost_recorder);
+    }
+    if (steps > alloc_warmup_steps)
+        allocations = AllocTrack_Since(alloc_start);
+
+    double real_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Replay_EndRecording(recorder);
+
+    for (size_t i = 0; i < g_LapTimes.size(); ++i)
+        printf("Volta %d: %.3f s\n", (int)i + 1, g_LapTimes[i]);
+    if (replay_filename == NULL && (int)g_LapTimes.size() < laps)
+        printf("Limite de %ld passos atingido antes de completar %d volta(s).\n", max_steps, laps);
+
+    printf("Pontuação: %d (multiplicador %.0fx)\n", car.pontuation, car.pontuation_multiplier);
+    if (g_Fleet.count > 0)
+    {
+        uint32_t most_laps = *std::max_element(g_Fleet.laps.begin(), g_Fleet.laps.end());
+        printf("Adversários: %d, mais voltas: %u, contatos entre carros: %u\n", (int)g_Fleet.count, most_laps, g_CarContacts);
+    }
+    printf("Passos: %ld, tempo simulado: %.3f s, tempo real: %.3f s (%.0fx tempo real)\n",
+           steps, g_SimulationTime, real_time, real_time > 0.0 ? g_SimulationTime / real_time : 0.0);
+    if (steps > alloc_warmup_steps)
+        printf("Alocações no heap após %ld passos de aquecimento: %llu (%.3f por passo)\n", alloc_warmup_steps,
+               (unsigned long long)allocations, (double)allocations / (steps - alloc_warmup_steps));
+
+    Arena_PrintStats(g_StepArena);
+    Simulation_Shutdown();
+
+    if (assert_no_alloc && steps <= alloc_warmup_steps)
+    {
+        fprintf(stderr, "ERROR: --assert-no-alloc needs more than the %ld warm-up steps; only %ld ran.\n", alloc_warmup_steps, steps);
+        return EXIT_FAILURE;
+    }
+    if (assert_no_alloc && allocations > 0)
+    {
+        fprintf(stderr, "ERROR: The simulation loop allocated heap memory %llu times after warm-up.\n", (unsigned long long)allocations);
+        return EXIT_FAILURE;
+    }
+
+    if (replay_filename != NULL)
+    {
+        printf("Replay: %llu checksums conferidos, %s.\n", (unsigned long long)player.checksums,
+               player.desync ? "DIVERGIU" : "sem divergências");
+        return player.desync ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    return (int)g_LapTimes.size() >= laps ? EXIT_SUCCESS : EXIT_FAILURE;
+}
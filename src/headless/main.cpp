@@ -0,0 +1,9 @@
+// Executável somente com a simulação, sem dependência de OpenGL ou GLFW.
+// Veja headless.h.
+
+#include "headless.h"
+
+int main(int argc, char* argv[])
+{
+    return Headless_Run(argc, argv);
+}
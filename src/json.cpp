@@ -0,0 +1,24 @@
+#include "json.h"
+
+void Json_WriteString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (const char* c = text ? text : ""; *c; ++c)
+    {
+        unsigned char ch = (unsigned char)*c;
+        if (ch == '"' || ch == '\\')
+        {
+            fputc('\\', file);
+            fputc(ch, file);
+        }
+        else if (ch == '\n')
+            fputs("\\n", file);
+        else if (ch == '\t')
+            fputs("\\t", file);
+        else if (ch < 0x20)
+            fprintf(file, "\\u%04x", ch);
+        else
+            fputc(ch, file);
+    }
+    fputc('"', file);
+}
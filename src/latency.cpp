@@ -0,0 +1,59 @@
+#include "latency.h"
+
+#include <cstdio>
+#include <cstring>
+
+void Latency_Init(LatencyProbe& probe, const char* name)
+{
+    memset(&probe, 0, sizeof(probe));
+    probe.name = name;
+}
+
+void Latency_Add(LatencyProbe& probe, double seconds)
+{
+    double us = seconds > 0.0 ? seconds * 1e6 : 0.0;
+    probe.samples += 1;
+    probe.sum_us  += us;
+    probe.last_us  = us;
+    if (us > probe.max_us)
+        probe.max_us = us;
+
+    size_t bucket = (size_t)(us / LATENCY_BUCKET_US);
+    if (bucket >= LATENCY_BUCKETS)
+        bucket = LATENCY_BUCKETS - 1;
+    probe.buckets[bucket] += 1;
+}
+
+double Latency_Percentile(const LatencyProbe& probe, double fraction)
+{
+    if (probe.samples == 0)
+        return 0.0;
+
+    uint64_t target = (uint64_t)(fraction * probe.samples + 0.5);
+    if (target < 1)
+        target = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS - 1; ++i)
+    {
+        seen += probe.buckets[i];
+        if (seen >= target)
+        {
+            double end = (double)(i + 1) * LATENCY_BUCKET_US;
+            return end < probe.max_us ? end : probe.max_us;
+        }
+    }
+    return probe.max_us;
+}
+
+void Latency_Print(const LatencyProbe& probe)
+{
+    if (probe.samples == 0)
+    {
+        printf("Latência \"%s\": nenhuma amostra.\n", probe.name);
+        return;
+    }
+    printf("Latência \"%s\": %llu amostras, média %.0f us, p50 %.0f us, p99 %.0f us, máx %.0f us.\n",
+           probe.name, (unsigned long long)probe.samples, probe.sum_us / probe.samples,
+           Latency_Percentile(probe, 0.50), Latency_Percentile(probe, 0.99), probe.max_us);
+}
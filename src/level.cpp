@@ -0,0 +1,396 @@
+#include "level.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "collisions.h"
+
+#define LEVEL_MAGIC   0x4c56454cu // "LEVL"
+#define LEVEL_VERSION 1u
+
+namespace {
+
+const float pi = 3.14159265f;
+
+// Colisores de cada tipo de objeto, no espaço do objeto (a posição é
+// escalada e girada junto com ele; o raio não)
+struct PropColliders
+{
+    const char* name;
+    int         count;
+    glm::vec2   offset[2];
+    float       radius;
+};
+
+const PropColliders prop_colliders[PROP_KIND_COUNT] = {
+    { "tree",    1, { glm::vec2(0.0f),            glm::vec2(0.0f)           }, 0.27f }, // Tronco
+    { "outdoor", 2, { glm::vec2(-2.4f, 0.0f),     glm::vec2(2.4f, 0.0f)     }, 0.2f  }, // Postes
+    { "finish",  0, { glm::vec2(0.0f),            glm::vec2(0.0f)           }, 0.0f  },
+};
+
+// Meias dimensões da área de detecção da linha de chegada
+const glm::vec3 finish_half_extents(5.24f, 0.1f, 0.32f);
+
+// Tamanho das células da grade de colisores, em metros
+const float grid_cell_size = 4.0f;
+
+struct LevelFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t source_hash;
+    uint32_t props;
+    uint32_t colliders;
+    uint32_t bonuses;
+    float    finish_min[3];
+    float    finish_max[3];
+};
+
+// Mesma rotação de Matrix_Rotate_Y()
+glm::vec2 RotateY(glm::vec2 p, float angle)
+{
+    float c = std::cos(angle), s = std::sin(angle);
+    return glm::vec2(c * p.x + s * p.y, -s * p.x + c * p.y);
+}
+
+uint32_t HashText(const std::vector<char>& text)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < text.size(); ++i)
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    return (hash ^ LEVEL_VERSION) * 16777619u;
+}
+
+bool ReadText(const char* filename, std::vector<char>& text)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return false;
+
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.insert(text.end(), buffer, buffer + size);
+    fclose(file);
+    return true;
+}
+
+void Clear(Level& level)
+{
+    level.prop_kind.clear();
+    level.prop_x.clear();
+    level.prop_y.clear();
+    level.prop_z.clear();
+    level.prop_rotation.clear();
+    level.prop_scale.clear();
+    level.collider_x.clear();
+    level.collider_z.clear();
+    level.collider_radius.clear();
+    level.bonus_x.clear();
+    level.bonus_y.clear();
+    level.bonus_z.clear();
+    level.finish_min = glm::vec3(0.0f);
+    level.finish_max = glm::vec3(0.0f);
+}
+
+void AddCollider(Level& level, float x, float z, float radius)
+{
+    level.collider_x.push_back(x);
+    level.collider_z.push_back(z);
+    level.collider_radius.push_back(radius);
+}
+
+void AddProp(Level& level, PropKind kind, glm::vec3 position, float rotation, float scale)
+{
+    level.prop_kind.push_back((uint8_t)kind);
+    level.prop_x.push_back(position.x);
+    level.prop_y.push_back(position.y);
+    level.prop_z.push_back(position.z);
+    level.prop_rotation.push_back(rotation);
+    level.prop_scale.push_back(scale);
+
+    const PropColliders& colliders = prop_colliders[kind];
+    for (int k = 0; k < colliders.count; ++k)
+    {
+        glm::vec2 p = RotateY(colliders.offset[k] * scale, rotation);
+        AddCollider(level, position.x + p.x, position.z + p.y, colliders.radius);
+    }
+
+    if (kind == PROP_FINISH_LINE)
+    {
+        // Caixa alinhada aos eixos que envolve a área girada
+        glm::vec3 half = finish_half_extents * scale;
+        float c = std::fabs(std::cos(rotation)), s = std::fabs(std::sin(rotation));
+        glm::vec3 extent(c * half.x + s * half.z, half.y, s * half.x + c * half.z);
+        level.finish_min = position - extent;
+        level.finish_max = position + extent;
+    }
+}
+
+bool Parse(Level& level, const std::vector<char>& text, const char* filename)
+{
+    Clear(level);
+
+    size_t begin = 0;
+    int line_number = 0;
+    while (begin < text.size())
+    {
+        size_t end = begin;
+        while (end < text.size() && text[end] != '\n')
+            ++end;
+        ++line_number;
+
+        char line[256];
+        size_t length = std::min(end - begin, sizeof(line) - 1);
+        memcpy(line, &text[begin], length);
+        line[length] = '\0';
+        begin = end + 1;
+
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        char  keyword[32];
+        float v[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+        int   fields = sscanf(line, "%31s %f %f %f %f %f", keyword, &v[0], &v[1], &v[2], &v[3], &v[4]);
+        if (fields <= 0)
+            continue;
+
+        int kind = -1;
+        for (int k = 0; k < PROP_KIND_COUNT; ++k)
+            if (strcmp(keyword, prop_colliders[k].name) == 0)
+                kind = k;
+
+        bool ok;
+        if (kind >= 0)
+        {
+            ok = fields >= 4 && v[4] > 0.0f;
+            if (ok)
+                AddProp(level, (PropKind)kind, glm::vec3(v[0], v[1], v[2]), v[3] * pi / 180.0f, v[4]);
+        }
+        else if (strcmp(keyword, "collider") == 0)
+        {
+            ok = fields == 4 && v[2] > 0.0f;
+            if (ok)
+                AddCollider(level, v[0], v[1], v[2]);
+        }
+        else if (strcmp(keyword, "bonus") == 0)
+        {
+            ok = fields == 4;
+            if (ok)
+            {
+                level.bonus_x.push_back(v[0]);
+                level.bonus_y.push_back(v[1]);
+                level.bonus_z.push_back(v[2]);
+            }
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            fprintf(stderr, "ERROR: Invalid line %d in level file \"%s\".\n", line_number, filename);
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void WriteArray(FILE* file, const std::vector<T>& array)
+{
+    if (!array.empty())
+        fwrite(array.data(), sizeof(T), array.size(), file);
+}
+
+template <typename T>
+bool ReadArray(FILE* file, std::vector<T>& array, size_t count)
+{
+    array.resize(count);
+    return count == 0 || fread(array.data(), sizeof(T), count, file) == count;
+}
+
+bool LoadBinary(Level& level, const char* filename, uint32_t source_hash)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return false;
+
+    LevelFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+           && header.magic == LEVEL_MAGIC
+           && header.version == LEVEL_VERSION
+           && header.source_hash == source_hash;
+
+    ok = ok && ReadArray(file, level.prop_kind, header.props)
+            && ReadArray(file, level.prop_x, header.props)
+            && ReadArray(file, level.prop_y, header.props)
+            && ReadArray(file, level.prop_z, header.props)
+            && ReadArray(file, level.prop_rotation, header.props)
+            && ReadArray(file, level.prop_scale, header.props)
+            && ReadArray(file, level.collider_x, header.colliders)
+            && ReadArray(file, level.collider_z, header.colliders)
+            && ReadArray(file, level.collider_radius, header.colliders)
+            && ReadArray(file, level.bonus_x, header.bonuses)
+            && ReadArray(file, level.bonus_y, header.bonuses)
+            && ReadArray(file, level.bonus_z, header.bonuses);
+    if (ok)
+    {
+        level.finish_min = glm::vec3(header.finish_min[0], header.finish_min[1], header.finish_min[2]);
+        level.finish_max = glm::vec3(header.finish_max[0], header.finish_max[1], header.finish_max[2]);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+void SaveBinary(const Level& level, const char* filename, uint32_t source_hash)
+{
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write level cache \"%s\".\n", filename);
+        return;
+    }
+
+    LevelFileHeader header;
+    header.magic       = LEVEL_MAGIC;
+    header.version     = LEVEL_VERSION;
+    header.source_hash = source_hash;
+    header.props       = (uint32_t)level.prop_kind.size();
+    header.colliders   = (uint32_t)level.collider_x.size();
+    header.bonuses     = (uint32_t)level.bonus_x.size();
+    for (int k = 0; k < 3; ++k)
+    {
+        header.finish_min[k] = level.finish_min[k];
+        header.finish_max[k] = level.finish_max[k];
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    WriteArray(file, level.prop_kind);
+    WriteArray(file, level.prop_x);
+    WriteArray(file, level.prop_y);
+    WriteArray(file, level.prop_z);
+    WriteArray(file, level.prop_rotation);
+    WriteArray(file, level.prop_scale);
+    WriteArray(file, level.collider_x);
+    WriteArray(file, level.collider_z);
+    WriteArray(file, level.collider_radius);
+    WriteArray(file, level.bonus_x);
+    WriteArray(file, level.bonus_y);
+    WriteArray(file, level.bonus_z);
+    fclose(file);
+}
+
+int CellOf(const Level& level, float x, float z, int* cx, int* cz)
+{
+    *cx = std::min(std::max((int)std::floor((x - level.grid_origin.x) / level.grid_cell_size), 0), level.grid_width - 1);
+    *cz = std::min(std::max((int)std::floor((z - level.grid_origin.y) / level.grid_cell_size), 0), level.grid_height - 1);
+    return *cz * level.grid_width + *cx;
+}
+
+// Ordena os colisores por célula (counting sort). Cada colisor entra somente
+// na célula do seu centro; a consulta expande a caixa pelo maior raio.
+void BuildGrid(Level& level)
+{
+    size_t n = level.collider_x.size();
+    level.grid_cell_size  = grid_cell_size;
+    level.grid_max_radius = 0.0f;
+    level.grid_origin     = glm::vec2(0.0f);
+    level.grid_width      = 1;
+    level.grid_height     = 1;
+
+    glm::vec2 bmin(0.0f), bmax(0.0f);
+    for (size_t i = 0; i < n; ++i)
+    {
+        glm::vec2 p(level.collider_x[i], level.collider_z[i]);
+        bmin = i == 0 ? p : glm::min(bmin, p);
+        bmax = i == 0 ? p : glm::max(bmax, p);
+        level.grid_max_radius = std::max(level.grid_max_radius, level.collider_radius[i]);
+    }
+    if (n > 0)
+    {
+        level.grid_origin = bmin;
+        level.grid_width  = (int)((bmax.x - bmin.x) / grid_cell_size) + 1;
+        level.grid_height = (int)((bmax.y - bmin.y) / grid_cell_size) + 1;
+    }
+
+    size_t cells = (size_t)level.grid_width * level.grid_height;
+    level.grid_start.assign(cells + 1, 0);
+    level.grid_items.resize(n);
+
+    std::vector<int> cell_of(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        int cx, cz;
+        cell_of[i] = CellOf(level, level.collider_x[i], level.collider_z[i], &cx, &cz);
+        ++level.grid_start[cell_of[i] + 1];
+    }
+    for (size_t c = 0; c < cells; ++c)
+        level.grid_start[c + 1] += level.grid_start[c];
+
+    std::vector<uint32_t> next(level.grid_start.begin(), level.grid_start.end() - 1);
+    for (size_t i = 0; i < n; ++i)
+        level.grid_items[next[cell_of[i]]++] = (uint32_t)i;
+}
+
+} // namespace
+
+bool Level_Load(Level& level, const char* text_filename, const char* binary_filename)
+{
+    printf("Carregando pista \"%s\"... ", text_filename);
+    fflush(stdout);
+
+    std::vector<char> text;
+    if (!ReadText(text_filename, text))
+    {
+        fprintf(stderr, "ERROR: Cannot open level file \"%s\".\n", text_filename);
+        return false;
+    }
+
+    uint32_t source_hash = HashText(text);
+    if (!LoadBinary(level, binary_filename, source_hash))
+    {
+        printf("compilando... ");
+        fflush(stdout);
+        if (!Parse(level, text, text_filename))
+            return false;
+        SaveBinary(level, binary_filename, source_hash);
+    }
+
+    BuildGrid(level);
+    printf("OK (%d objetos, %d colisores, %d bônus).\n",
+           (int)level.prop_kind.size(), (int)level.collider_x.size(), (int)level.bonus_x.size());
+    return true;
+}
+
+bool Level_Intersect(const Level& level, glm::vec3 bbox_min, glm::vec3 bbox_max)
+{
+    if (level.collider_x.empty())
+        return false;
+
+    int x0, z0, x1, z1;
+    float r = level.grid_max_radius;
+    CellOf(level, bbox_min.x - r, bbox_min.z - r, &x0, &z0);
+    CellOf(level, bbox_max.x + r, bbox_max.z + r, &x1, &z1);
+
+    for (int cz = z0; cz <= z1; ++cz)
+    {
+        for (int cx = x0; cx <= x1; ++cx)
+        {
+            size_t cell = (size_t)cz * level.grid_width + cx;
+            for (uint32_t k = level.grid_start[cell]; k < level.grid_start[cell + 1]; ++k)
+            {
+                uint32_t i = level.grid_items[k];
+                glm::vec3 center(level.collider_x[i], 0.0f, level.collider_z[i]);
+                if (cube_cilinder_intersect(bbox_min, bbox_max, center, level.collider_radius[i]))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
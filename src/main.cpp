@@ -18,6 +18,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 // Headers abaixo são específicos de C++
 #include <map>
@@ -29,6 +30,9 @@
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 // Headers das bibliotecas OpenGL
 #include <glad/glad.h>   // Criação de contexto OpenGL 3.3
@@ -46,6 +50,20 @@
 #include "utils.h"
 #include "matrices.h"
 #include "collisions.h"
+#include "objmodel.h"
+#include "simulation.h"
+#include "headless.h"
+#include "replay.h"
+#include "ghost.h"
+#include "alloctrack.h"
+#include "arena.h"
+#include "spsc.h"
+#include "latency.h"
+#include "profiler.h"
+#include "gputimer.h"
+#include "glstate.h"
+#include "glstats.h"
+#include "startup.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -67,8 +85,6 @@
 #define OUTDOOR_POST 14
 #define FINISH_LINE 15
 
-#define PI 3.141592f
-
 // Camera look-at: valores maximos e minimos da camera em relação a z/y
 #define MIN_DISTANCE_LOOK_AT_Z 3.0f
 #define MAX_DISTANCE_LOOK_AT_Z 8.0f
@@ -84,135 +100,9 @@ const std::vector<std::string> selected_objects = {
     "Bottom_panel.001",
 };
 
-void InitializeBonusObjects();
-
-void UpdateBonusObjects(float deltaTime); 
-
-// Estrutura que representa um modelo geométrico carregado a partir de um
-// arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
-
-struct ObjModel
-{
-    tinyobj::attrib_t                 attrib;
-    std::vector<tinyobj::shape_t>     shapes;
-    std::vector<tinyobj::material_t>  materials;
-
-    // Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
-    // Veja: https://github.com/syoyo/tinyobjloader
-    ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true)
-    {
-        printf("Carregando objetos do arquivo \"%s\"...\n", filename);
-
-        // Se basepath == NULL, então setamos basepath como o dirname do
-        // filename, para que os arquivos MTL sejam corretamente carregados caso
-        // estejam no mesmo diretório dos arquivos OBJ.
-        std::string fullpath(filename);
-        std::string dirname;
-        if (basepath == NULL)
-        {
-            auto i = fullpath.find_last_of("/");
-            if (i != std::string::npos)
-            {
-                dirname = fullpath.substr(0, i+1);
-                basepath = dirname.c_str();
-            }
-        }
-
-        std::string warn;
-        std::string err;
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, basepath, triangulate);
 
-        if (!err.empty())
-            fprintf(stderr, "\n%s\n", err.c_str());
 
-        if (!ret)
-            throw std::runtime_error("Erro ao carregar modelo.");
 
-        for (size_t shape = 0; shape < shapes.size(); ++shape)
-        {
-            if (shapes[shape].name.empty())
-            {
-                fprintf(stderr,
-                        "*********************************************\n"
-                        "Erro: Objeto sem nome dentro do arquivo '%s'.\n"
-                        "Veja https://www.inf.ufrgs.br/~eslgastal/fcg-faq-etc.html#Modelos-3D-no-formato-OBJ .\n"
-                        "*********************************************\n",
-                    filename);
-                throw std::runtime_error("Objeto sem nome.");
-            }
-            printf("- Objeto '%s'\n", shapes[shape].name.c_str());
-        }
-
-        printf("OK.\n");
-    }
-};
-
-struct Car
-{
-    glm::vec3 carPosition; 
-    glm::vec3 carVelocity;
-    glm::vec3 carAcceleration;
-    glm::vec3 carDirection;
-    
-    float speed; // Velocidade atual do carro
-    float acceleration; // Aceleração (ou RPM) do carro
-    float acceleration_rate; // Taxa de aceleração
-    float deceleration_rate; // Taxa de desaceleração
-    
-    float max_speed; // Velocidade máxima do carro
-    float max_acceleration; // Aceleracao Máxima do carro
-    
-    float wheel_rotation_angle; // Angulo atual de rotacao das rodas (foi feita simplificacao de todas rodas terem a mesma rotacao)
-    float rotation_angle; // Angulo de rotacao do carro
-
-    float front_wheel_angle; // Angulo atual de rotação das rodas dianteiras
-    float max_front_wheel_angle; // Ângulo máximo de rotação das rodas dianteiras
-    float negative_camber_angle; // Ângulo de cambagem das rodas
-
-    glm::vec3 frontLeftWheelPosition; // Posição da roda dianteira esquerda
-    glm::vec3 frontRightWheelPosition; // Posição da roda dianteira direita
-    glm::vec3 rearLeftWheelPosition; // Posição da roda traseira esquerda
-    glm::vec3 rearRightWheelPosition; // Posição da roda traseira direita
-
-    glm::mat4 frontLeftWheelTransform; 
-    glm::mat4 frontRightWheelTransform; 
-    glm::mat4 rearLeftWheelTransform; 
-    glm::mat4 rearRightWheelTransform; 
-
-    int pontuation;
-    float pontuation_multiplier;
-
-    // Construtor
-    Car() 
-        : carPosition(0.0f, -0.95f, 0.0f),
-          carVelocity(0.0f, 0.0f, 0.0f), 
-          carAcceleration(0.0f, 0.0f, 0.0f), 
-          carDirection(0.0f, 0.0f, -1.0f),
-          speed(0.0f), 
-          acceleration(0.0f), 
-          acceleration_rate(10.0f), 
-          deceleration_rate(5.0f),
-          max_speed(20.0f), 
-          max_acceleration(20.0f),
-          wheel_rotation_angle(0.0f),
-          rotation_angle(0.0f),
-          front_wheel_angle(0.0f),
-          max_front_wheel_angle(glm::radians(40.0f)),
-          negative_camber_angle(glm::radians(10.0f)),
-          frontLeftWheelPosition(-1.11f, -0.5503f, 0.1809f),
-          frontRightWheelPosition(-1.11f, 0.5393f, 0.1858f),          
-          rearLeftWheelPosition(0.5940f, -0.5501f, 0.19642f ),
-          rearRightWheelPosition(0.59399f, 0.54683f, 0.20197f),
-          frontLeftWheelTransform(1.0f),
-          frontRightWheelTransform(1.0f),
-          rearLeftWheelTransform(1.0f),
-          rearRightWheelTransform(1.0f),
-          pontuation(0),
-          pontuation_multiplier(1.0f)
-    {}
-};
-
-Car car;
 
 // Declaração de funções utilizadas para pilha de matrizes de modelagem.
 void PushMatrix(glm::mat4 M);
@@ -221,24 +111,46 @@ void PopMatrix(glm::mat4& M);
 // Declaração de várias funções utilizadas em main().  Essas estão definidas
 // logo após a definição de main() neste arquivo.
 void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos para renderização
-void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
 void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
-void LoadTextureImage(const char* filename);
+// Imagem de textura decodificada por uma tarefa (DecodeTextureImage()) e
+// enviada para a GPU pela thread principal (UploadTextureImage())
+struct TextureImage
+{
+    const char*    filename;
+    GLuint         texture_unit;
+    JobCounter*    counter;
+    unsigned char* data;
+    int            width, height;
+};
+void DecodeTextureImage(void* context, size_t, size_t);
+void UploadTextureImage(void* context, size_t, size_t);
+
+// Modelo lido e com as normais calculadas por uma tarefa (LoadModel())
+struct ModelLoad
+{
+    const char* filename;
+    ObjModel*   model;
+};
+void LoadModel(void* context, size_t, size_t);
+void BuildTrackJob(void* context, size_t, size_t); // Simulation_BuildTrack() em uma tarefa
 GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
 GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
 void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
 void PrintObjModelInfo(ObjModel*); // Função para debugging
 
+struct SceneObject;
+SceneObject& FindVirtualObject(const char* object_name); // Procura um objeto em g_VirtualScene sem alocar memória
 void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
-void DrawBoundingBox(const std::string& object_name);
+void DrawVirtualObject(const SceneObject& obj);
+void DrawBoundingBox(const char* object_name);
 
 // Declaração de funções auxiliares para renderizar texto dentro da janela
 // OpenGL. Estas funções estão definidas no arquivo "textrendering.cpp".
 void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float = 1.0f);
+void TextRendering_PrintString(GLFWwindow* window, const char* str, float x, float y, float = 1.0f);
 void TextRendering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f);
 void TextRendering_PrintVector(GLFWwindow* window, glm::vec4 v, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProduct(GLFWwindow* window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
@@ -247,33 +159,43 @@ void TextRendering_PrintMatrixVectorProductDivW(GLFWwindow* window, glm::mat4 M,
 
 // Funções abaixo renderizam como texto na janela OpenGL algumas matrizes e
 // outras informações do programa. Definidas após main().
-void TextRendering_ShowVelocity(GLFWwindow* window);
-void TextRendering_ShowPontuation(GLFWwindow* window);
+void TextRendering_ShowVelocity(GLFWwindow* window, const Car& car);
+void TextRendering_ShowPontuation(GLFWwindow* window, const Car& car);
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window);
+void TextRendering_ShowInputLatency(GLFWwindow* window, double latency_us);
+
+// Painel do profiler (veja profiler.h), definido no arquivo "profileroverlay.cpp"
+void ProfilerOverlay_Init();
+void ProfilerOverlay_Draw(GLFWwindow* window);
 
 // Funções callback para comunicação com o sistema operacional e interação do
 // usuário. Veja mais comentários nas definições das mesmas, abaixo.
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
+void WindowSizeCallback(GLFWwindow* window, int width, int height);
 void ErrorCallback(int error, const char* description);
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode);
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
-void DrawCar();
-void DrawOutdoors();
-void DrawBonus();
-void DrawTrees();
-void DrawWheelsWithTransform(const char* object_name, glm::mat4 transform);
-
-std::pair<glm::vec3, glm::vec3> ComputeCarAABB(const Car& car);
-void resetCar();
-
-// Atualizacoes no carro
-void UpdateCarSpeedAndPosition(Car &car, bool key_W_pressed, bool key_S_pressed, bool key_A_pressed, bool key_D_pressed, float deltaTime);
-void UpdateFrontWheelsAngle(Car &car, bool key_A_pressed, bool key_D_pressed, float deltaTime);
-void UpdateWheelsTransforms(Car &car, float deltaTime);
-void UpdatePontuation(Car &car, float deltaTime);
+void DrawCar(const Car& car, float alpha = 1.0f);
+struct CarPose;
+void DrawGhosts(double lap_time);
+void DrawOpponents(const std::vector<CarPose>& opponents);
+void DrawScene(const std::vector<Renderable>& renderables); // Desenha as entidades do cenário com um Renderable (veja ecs.h)
+void DrawWheelsWithTransform(const SceneObject& obj, glm::mat4 transform);
+
+// Atualiza as matrizes de transformação das rodas, usadas somente para desenhar
+void UpdateWheelsTransforms(Car &car);
+
+// Threads da simulação e do desenho (veja main())
+struct RenderState;
+struct InputEvent;
+void CaptureRenderState(RenderState& state);
+void ApplySimulationKey(const InputEvent& event, uint8_t* held, uint8_t* pending);
+void ApplyRenderEvent(const InputEvent& event);
+void SimulationThread();
+void RenderThread(GLFWwindow* window);
 
 // Definimos uma estrutura que armazenará dados necessários para renderizar
 // cada objeto da cena virtual.
@@ -291,8 +213,9 @@ struct SceneObject
 // estrutura auxiliar para desenhar os objetos do carro
 struct ObjectConfig {
     int object_id;
-    std::string object_name;
+    const char* object_name;
     int uv_mapping_type;
+    int wheel; // Índice da roda (veja DrawCar()), ou -1
 };
 
 // Abaixo definimos variáveis globais utilizadas em várias funções do código.
@@ -303,6 +226,13 @@ struct ObjectConfig {
 // estes são acessados.
 std::map<std::string, SceneObject> g_VirtualScene;
 
+// Alocações no heap feitas no último quadro (veja alloctrack.h)
+uint64_t g_FrameAllocations = 0;
+
+// Memória temporária de um quadro (vértices do texto, por exemplo), liberada
+// ao fim de cada iteração do laço principal. Veja arena.h.
+FrameArena g_FrameArena;
+
 // Pilha que guardará as matrizes de modelagem.
 std::stack<glm::mat4>  g_MatrixStack;
 
@@ -335,63 +265,58 @@ float g_TorsoPositionY = 0.0f;
 bool g_ShowInfoText = false;
 // Variável que controla se as bounding boxes serao desenhadas na tela
 bool g_Show_BBOX = false;
+// Variável que controla se o painel do profiler será mostrado na tela
+bool g_ShowProfiler = false;
+
+// Medida da inicialização (veja startup.h). Com "--startup-exit" a janela
+// fica escondida, o primeiro quadro não é apresentado (só esperamos a GPU
+// terminá-lo) e o jogo fecha logo depois dele; "--startup-json <arquivo>"
+// grava o tempo das fases. Usados por bench/bench_startup.cpp.
+bool g_StartupExit = false;
+const char* g_StartupJson = NULL;
+int g_FirstFramePhase = -1; // Termina na thread do desenho
+
+// Teste das alocações do laço do jogo: com "--assert-no-alloc <quadros>" a
+// janela fica escondida, como com "--startup-exit", e o jogo fecha depois de
+// desenhar o número de quadros pedido. As alocações no heap feitas depois dos
+// primeiros RENDER_ALLOC_WARMUP_FRAMES quadros (pelo desenho e pela
+// simulação) são somadas em g_RenderAllocations, e o jogo termina com erro se
+// houver alguma.
+#define RENDER_ALLOC_WARMUP_FRAMES 120
+int g_AllocCheckFrames = 0;
+uint64_t g_RenderAllocations = 0;
 
 // Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
 GLuint g_GpuProgramID = 0;
 GLint g_model_uniform;
-GLint g_view_uniform;
-GLint g_projection_uniform;
 GLint g_object_id_uniform;
 GLint g_bbox_min_uniform;
 GLint g_bbox_max_uniform;
 GLuint g_uv_mapping_type_uniform;
+GLint g_alpha_uniform;
+
+// Uniform buffer com as matrizes "view" e "projection" (bloco "Camera" dos
+// shaders), escrito uma vez por quadro, logo antes dos desenhos
+#define CAMERA_UNIFORM_BINDING 0
+GLuint g_CameraUniformBuffer = 0;
 
-// Número de texturas carregadas pela função LoadTextureImage()
+// Tempo entre um evento de entrada e o glfwSwapBuffers() do primeiro quadro
+// desenhado com um passo da simulação que o usou (veja RenderThread())
+LatencyProbe g_InputLatency;
+
+// Número de texturas carregadas pela função UploadTextureImage()
 GLuint g_NumLoadedTextures = 0;
 
-// Movimentacao do carro
-bool key_W_pressed = false;
-bool key_S_pressed = false;
-bool key_A_pressed = false;
-bool key_D_pressed = false;
-
-
-    struct BezierCurve {
-        glm::vec3 p0; // Starting point
-        glm::vec3 p1; // Control point 1
-        glm::vec3 p2; // Control point 2
-        glm::vec3 p3; // Ending point
-
-        // Evaluate the Bezier curve at parameter t ∈ [0, 1]
-        glm::vec3 evaluate(float t) const {
-            float u = 1.0f - t;
-            float tt = t * t;
-            float uu = u * u;
-            float uuu = uu * u;
-            float ttt = tt * t;
-
-            glm::vec3 point = uuu * p0;
-            point += 3.0f * uu * t * p1;
-            point += 3.0f * u * tt * p2;
-            point += ttt * p3;
-
-            return point;
-     }
-    };  
-
-    struct BonusObject {
-        glm::vec3 initialPosition;
-        BezierCurve pathCurve;
-        float t; // Parameter to track the object's position along the curve
-        float speed; // Speed at which 't' progresses
-        bool active; // Whether the bonus is active (for optional reuse)
-        glm::vec3 currentPostion;
-
-        BonusObject(glm::vec3 initPos, BezierCurve curve, float spd)
-            : initialPosition(initPos), pathCurve(curve), t(0.0f), speed(spd), active(true), currentPostion(initPos) {}
-    };// Vector to hold all bonus objects
-std::vector<BonusObject> bonusObjects;
+// Gravação e reprodução de replays (opções "--record" e "--replay")
+ReplayRecorder g_ReplayRecorder = { NULL, 0, 0, 0 };
+ReplayPlayer g_ReplayPlayer;
+bool g_ReplayPlaying = false;
 
+// Melhor volta da pista, gravada a cada sessão e reproduzida como um carro
+// translúcido, junto de outros fantasmas passados com "--ghost <arquivo>".
+#define BEST_GHOST_FILENAME "../../data/track/best.ghost"
+GhostRecorder g_GhostRecorder;
+std::vector<GhostPlayer> g_Ghosts;
 
 // Camera look-at: define fator de progressão ao usar scroll para zoom
 float delta_look_at_y = MAX_DISTANCE_LOOK_AT_Y - MIN_DISTANCE_LOOK_AT_Y; 
@@ -407,23 +332,105 @@ bool key_DOWN_pressed = false;
 bool key_LEFT_pressed = false;
 bool key_RIGHT_pressed = false;
 
-#define TIMEOUT_FINISH_LINE 5.0f
-
-double last_bonus = glfwGetTime();
-bool can_receive_finish_line = false;
-
-// Toggle do tipo de camera
-// true para look at, false para livre
-bool type_camera_look_at = true;
 float camera_speed = 3.0f;
 // Camera look at: valor inicial de offset em relação ao carro
 glm::vec3 camera_offset(0.0f, MAX_DISTANCE_LOOK_AT_Y, MAX_DISTANCE_LOOK_AT_Z);
 
-glm::vec3 finish_line_min(-5.24f, -0.95f, 2.68f);
-glm::vec3 finish_line_max(5.24f, -0.95f, 3.32f);
+// O jogo roda em três threads:
+//  - a thread principal trata os eventos da janela (os callbacks da GLFW só
+//    são chamados nela) e repassa cada evento de entrada por uma fila sem
+//    travas (veja spsc.h) para a thread que o usa;
+//  - a thread da simulação avança em passos fixos de SIMULATION_TIMESTEP e,
+//    ao fim de cada passo, copia o que é preciso para desenhar o quadro em um
+//    RenderState, publicado em um buffer triplo;
+//  - a thread do desenho tem o contexto OpenGL e desenha sempre o RenderState
+//    mais recente.
+// Assim, um quadro lento (recarregar os shaders com R, por exemplo) não atrasa
+// a física nem a leitura do teclado. O carro, a frota, o cenário, os replays
+// e o gravador de fantasmas só são usados pela thread da simulação; a câmera,
+// os fantasmas e as variáveis acima são da thread do desenho.
+
+enum InputEventType
+{
+    INPUT_EVENT_KEY         = 0,
+    INPUT_EVENT_CAMERA_DRAG = 1, // Mouse movido com o botão esquerdo pressionado
+    INPUT_EVENT_SCROLL      = 2
+};
+
+struct InputEvent
+{
+    double  time;   // glfwGetTime() quando o callback foi chamado
+    uint8_t type;   // InputEventType
+    int     key;    // INPUT_EVENT_KEY: GLFW_KEY_*
+    int     action; // INPUT_EVENT_KEY: GLFW_PRESS, GLFW_RELEASE ou GLFW_REPEAT
+    float   dx, dy; // Deslocamento do cursor ou da "rodinha"
+};
+
+#define INPUT_QUEUE_CAPACITY 256
+SpscQueue<InputEvent, INPUT_QUEUE_CAPACITY> g_SimulationInput; // Teclas do carro, espaço, L e backspace
+SpscQueue<InputEvent, INPUT_QUEUE_CAPACITY> g_RenderInput;     // Câmera e teclas de depuração
+std::atomic<uint32_t> g_DroppedInputEvents(0); // Eventos perdidos com alguma fila cheia
+
+// Pose de um carro, o suficiente para desenhá-lo
+struct CarPose
+{
+    glm::vec3 position;
+    float     rotation_angle;
+    float     front_wheel_angle;
+    float     wheel_rotation_angle;
+};
+
+// Tudo que a thread do desenho lê de um passo da simulação. Os vetores são
+// reaproveitados entre os passos, sem alocar depois dos primeiros.
+struct RenderState
+{
+    uint64_t                step;           // Passos simulados desde o início
+    double                  lap_time;       // Tempo da volta atual (veja DrawGhosts())
+    uint64_t                input_events;   // Eventos de entrada usados pela simulação até este passo
+    double                  input_time;     // glfwGetTime() do último deles (veja g_InputLatency)
+    bool                    camera_look_at; // true para look at, false para livre (tecla L)
+    Car                     car;
+    std::vector<CarPose>    opponents;
+    std::vector<Renderable> renderables;    // Entidades visíveis do cenário
+
+    RenderState() : step(0), lap_time(0.0), input_events(0), input_time(0.0), camera_look_at(true) {}
+};
+TripleBuffer<RenderState> g_RenderStates;
+
+// Sinaliza para as threads da simulação e do desenho que a janela foi fechada
+std::atomic<bool> g_Quit(false);
+
+// Tamanhos da janela, lidos pela thread do desenho (a GLFW só permite
+// consultá-los na thread principal). Veja FramebufferSizeCallback().
+std::atomic<int> g_FramebufferWidth(0), g_FramebufferHeight(0);
+std::atomic<int> g_WindowWidth(0), g_WindowHeight(0);
 
 int main(int argc, char* argv[])
 {
+    // Com "--headless", executamos somente a simulação, sem abrir janela.
+    // Veja headless.h.
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+        return Headless_Run(argc, argv);
+
+    // A janela é criada de acordo com "--startup-exit", então estas opções
+    // são lidas antes das outras
+    Startup_Init();
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--startup-exit") == 0)
+            g_StartupExit = true;
+        else if (strcmp(argv[i], "--startup-json") == 0 && i + 1 < argc)
+            g_StartupJson = argv[++i];
+        else if (strcmp(argv[i], "--assert-no-alloc") == 0 && i + 1 < argc)
+            g_AllocCheckFrames = atoi(argv[++i]);
+    }
+    if (g_AllocCheckFrames != 0 && g_AllocCheckFrames <= RENDER_ALLOC_WARMUP_FRAMES)
+    {
+        fprintf(stderr, "ERROR: --assert-no-alloc needs more than the %d warm-up frames.\n", RENDER_ALLOC_WARMUP_FRAMES);
+        std::exit(EXIT_FAILURE);
+    }
+    int glfw_phase = Startup_Begin("glfw");
+
     // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
     // sistema operacional, onde poderemos renderizar com OpenGL.
     int success = glfwInit();
@@ -448,6 +455,9 @@ int main(int argc, char* argv[])
     // funções modernas de OpenGL.
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    if (g_StartupExit || g_AllocCheckFrames > 0)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     GLFWwindow* window;
     window = glfwCreateWindow(1000, 800, "Necessidade por Velocidade (UFRGS Edition)", NULL, NULL);
     if (!window)
@@ -473,12 +483,15 @@ int main(int argc, char* argv[])
     // Carregamento de todas funções definidas por OpenGL 3.3, utilizando a
     // biblioteca GLAD.
     gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+    Startup_End(glfw_phase);
 
     // Definimos a função de callback que será chamada sempre que a janela for
     // redimensionada, por consequência alterando o tamanho do "framebuffer"
     // (região de memória onde são armazenados os pixels da imagem).
     glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-    FramebufferSizeCallback(window, 1000, 800); // Forçamos a chamada do callback acima, para definir g_ScreenRatio.
+    FramebufferSizeCallback(window, 1000, 800); // Forçamos a chamada do callback acima, para que a thread do desenho defina o viewport e g_ScreenRatio.
+    glfwSetWindowSizeCallback(window, WindowSizeCallback);
+    WindowSizeCallback(window, 1000, 800);
 
     // Imprimimos no terminal informações sobre a GPU do sistema
     const GLubyte *vendor      = glGetString(GL_VENDOR);
@@ -491,98 +504,511 @@ int main(int argc, char* argv[])
     // Carregamos os shaders de vértices e de fragmentos que serão utilizados
     // para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
     //
+    int shaders_phase = Startup_Begin("shaders");
     LoadShadersFromFiles();
+    Startup_End(shaders_phase);
+
+    // Buffer das matrizes da câmera, ligado ao ponto usado pelo bloco
+    // "Camera" dos shaders (veja LoadShadersFromFiles())
+    glGenBuffers(1, &g_CameraUniformBuffer);
+    GlState_BindBuffer(GL_UNIFORM_BUFFER, g_CameraUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+    GlState_BindBuffer(GL_UNIFORM_BUFFER, 0);
+    GlState_BindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, g_CameraUniformBuffer);
+    Latency_Init(g_InputLatency, "entrada até o quadro");
+
+    // O carregamento é dividido em tarefas (veja threadpool.h): as imagens
+    // são decodificadas e os modelos lidos em paralelo, e cada imagem é
+    // enviada para a GPU pela thread principal assim que fica pronta.
+    ThreadPool_Start(g_ThreadPool);
+    stbi_set_flip_vertically_on_load(true);
 
-    LoadTextureImage("../../data/background/kloofendal_48d_partly_cloudy_puresky_4k.hdr"); // TextureSkybox
+    // Texturas, na ordem das unidades de textura usadas pelos shaders
+    static TextureImage textures[] = {
+        { "../../data/background/kloofendal_48d_partly_cloudy_puresky_4k.hdr" }, // TextureSkybox
+
+        // Texturas do carro
+        { "../../data/car/car-textures/Naval_Ensign_of_Japan.png" }, // TextureCarHood
+        { "../../data/car/car-textures/1K-Silver_Base Color.jpg" }, // TextureCarMetalic
+        { "../../data/car/car-textures/SolidBlack.png" }, // TextureCarGlass
+        { "../../data/car/car-textures/Metal049A_1K-JPG_Color.jpg" }, // TextureCarPainting
+        { "../../data/car/car-textures/Rubber004_1K-JPG_Color.jpg" }, // TextureCarWheel
+        { "../../data/car/car-textures/Metal027_1K-JPG_Color.jpg" }, // TextureCarNotPaintedParts
+
+        // Outras texturas
+        { "../../data/plane/Grass004_1K-JPG_Color.jpg" }, // TextureGrass
+        { "../../data/track/Asphalt026C_1K-JPG_Color.jpg" }, // TextureTrack
+        { "../../data/tree/Bark012_1K-JPG_Color.jpg" }, // TextureTree
+        { "../../data/bonus/Metal048A_1K-JPG_Color.jpg" }, // TextureBonus
+        { "../../data/outdoor/jdm-japan-flag.png" }, // TextureOutdoorFace
+        { "../../data/line/white-texture.jpg" } // TextureFinishLine
+    };
+
+    // Construímos a representação de objetos geométricos através de malhas de triângulos
+    static ModelLoad models[] = {
+        { "../../data/background/skysemisphere.obj" },
+        { "../../data/track/track.obj" },
+        { "../../data/plane/plane.obj" },
+        { "../../data/car/supratunadov5.obj" },
+        { "../../data/tree/tree.obj" },
+        { "../../data/bonus/bonus-compressed.obj" },
+        { "../../data/outdoor/outdoor.obj" },
+        { "../../data/line/finish-line.obj" }
+    };
+    const size_t num_textures = sizeof(textures) / sizeof(textures[0]);
+    const size_t num_models = sizeof(models) / sizeof(models[0]);
+
+    JobCounter loading;
+    for (size_t i = 0; i < num_textures; ++i)
+    {
+        textures[i].texture_unit = (GLuint)i;
+        textures[i].counter = &loading;
+        Job_Spawn(g_ThreadPool, DecodeTextureImage, &textures[i], &loading);
+    }
+    for (size_t i = 0; i < num_models; ++i)
+        Job_Spawn(g_ThreadPool, LoadModel, &models[i], &loading);
+    Job_Wait(g_ThreadPool, loading);
+
+    // Construímos a BVH do chão e o campo de superfícies com as mesmas
+    // transformações usadas para desenhar a pista e a grama, enquanto a
+    // thread principal envia as malhas para a GPU.
+    JobCounter track;
+    ObjModel* track_models[2] = { models[1].model, models[2].model };
+    Job_Spawn(g_ThreadPool, BuildTrackJob, track_models, &track);
+
+    for (size_t i = 0; i < num_models; ++i)
+    {
+        StartupScope phase("malha", models[i].filename);
+        BuildTrianglesAndAddToVirtualScene(models[i].model);
+    }
+    Job_Wait(g_ThreadPool, track);
+
+    for (size_t i = 0; i < num_models; ++i)
+        delete models[i].model;
+
+    // "--record <arquivo>" grava as entradas da partida e "--replay <arquivo>"
+    // reproduz uma partida gravada, com o número de adversários gravado nela. "--trace <arquivo>" grava os primeiros
+    // quadros (PROFILER_CAPTURE_FRAMES, ou "--trace-frames N") para o
+    // chrome://tracing (veja profiler.h). Qualquer outro argumento é um
+    // modelo ".obj" extra a ser carregado.
+    int opponents = -1; // Negativo: não escolhido
+    int bonuses   = -1;
+    const char* record_filename = NULL;
+    const char* trace_filename = NULL;
+    int trace_frames = PROFILER_CAPTURE_FRAMES;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            record_filename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            g_ReplayPlaying = Replay_Load(g_ReplayPlayer, argv[++i]);
+        }
+        else if (strcmp(argv[i], "--opponents") == 0 && i + 1 < argc)
+        {
+            opponents = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_filename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc)
+        {
+            trace_frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--startup-json") == 0 && i + 1 < argc)
+        {
+            ++i; // Lido no início de main(), assim como "--startup-exit"
+        }
+        else if (strcmp(argv[i], "--startup-exit") == 0)
+        {
+        }
+        else if (strcmp(argv[i], "--assert-no-alloc") == 0 && i + 1 < argc)
+        {
+            ++i;
+        }
+        else if (strcmp(argv[i], "--ghost") == 0 && i + 1 < argc)
+        {
+            GhostPlayer ghost;
+            if (Ghost_Open(ghost, argv[++i]))
+                g_Ghosts.push_back(ghost);
+        }
+        else
+        {
+            ObjModel model(argv[i]);
+            BuildTrianglesAndAddToVirtualScene(&model);
+        }
+    }
 
-    // Texturas do carro
-    LoadTextureImage("../../data/car/car-textures/Naval_Ensign_of_Japan.png"); // TextureCarHood
-    LoadTextureImage("../../data/car/car-textures/1K-Silver_Base Color.jpg"); // TextureCarMetalic
-    LoadTextureImage("../../data/car/car-textures/SolidBlack.png"); // TextureCarGlass
-    LoadTextureImage("../../data/car/car-textures/Metal049A_1K-JPG_Color.jpg"); // TextureCarPainting
-    LoadTextureImage("../../data/car/car-textures/Rubber004_1K-JPG_Color.jpg"); // TextureCarWheel
-    LoadTextureImage("../../data/car/car-textures/Metal027_1K-JPG_Color.jpg"); // TextureCarNotPaintedParts
+    // Inicializamos o código para renderização de texto.
+    int text_phase = Startup_Begin("texto");
+    TextRendering_Init();
+    Startup_End(text_phase);
+    ProfilerOverlay_Init();
+    GpuTimer_Init();
 
-    // Outras texturas
-    LoadTextureImage("../../data/plane/Grass004_1K-JPG_Color.jpg"); // TextureGrass
-    LoadTextureImage("../../data/track/Asphalt026C_1K-JPG_Color.jpg"); // TextureTrack
-    LoadTextureImage("../../data/tree/Bark012_1K-JPG_Color.jpg"); // TextureTree
-    LoadTextureImage("../../data/bonus/Metal048A_1K-JPG_Color.jpg"); // TextureBonus
-    LoadTextureImage("../../data/outdoor/jdm-japan-flag.png"); // TextureOutdoorFace
-    LoadTextureImage("../../data/line/white-texture.jpg"); // TextureFinishLine
+    Arena_Init(g_FrameArena, "quadro", 1024 * 1024, true);
 
+    // Habilitamos o Z-buffer. Veja slides 104-116 do documento Aula_09_Projecoes.pdf.
+    GlState_Enable(GL_DEPTH_TEST);
 
-    // Construímos a representação de objetos geométricos através de malhas de triângulos
-    ObjModel skyboxmodel("../../data/background/skysemisphere.obj");
-    ComputeNormals(&skyboxmodel);
-    BuildTrianglesAndAddToVirtualScene(&skyboxmodel);
+    // Habilitamos o Backface Culling. Veja slides 8-13 do documento Aula_02_Fundamentos_Matematicos.pdf, slides 23-34 do documento Aula_13_Clipping_and_Culling.pdf e slides 112-123 do documento Aula_14_Laboratorio_3_Revisao.pdf.
+    GlState_Enable(GL_CULL_FACE);
+    GlState_CullFace(GL_BACK);
+    GlState_FrontFace(GL_CCW);
+    
+    if (g_ReplayPlaying && !Replay_ApplySetup(g_ReplayPlayer, &opponents, &bonuses))
+        g_ReplayPlaying = false;
+    opponents = std::max(opponents, 0);
+    bonuses   = std::max(bonuses, 0);
+    if (record_filename != NULL)
+        Replay_BeginRecording(g_ReplayRecorder, record_filename, opponents, bonuses);
+
+    InitializeBonusObjects(bonuses);
+    Simulation_SpawnOpponents(opponents);
+
+    GhostPlayer best_ghost;
+    if (Ghost_Open(best_ghost, BEST_GHOST_FILENAME))
+        g_Ghosts.push_back(best_ghost);
+    Ghost_BeginRecording(g_GhostRecorder, BEST_GHOST_FILENAME);
+
+    // Primeiro estado, desenhado até a simulação publicar o seu primeiro passo
+    Simulation_UpdateScene();
+    CaptureRenderState(TripleBuffer_Back(g_RenderStates));
+    TripleBuffer_Publish(g_RenderStates);
+
+    // As zonas do profiler são medidas durante todo o jogo; o painel só é
+    // mostrado com a tecla P
+    Profiler_SetEnabled(true);
+    if (trace_filename != NULL)
+        Profiler_BeginCapture(trace_filename, trace_frames);
+
+    // O contexto OpenGL passa para a thread do desenho
+    g_FirstFramePhase = Startup_Begin("primeiro quadro");
+    glfwMakeContextCurrent(NULL);
+    std::thread simulation_thread(SimulationThread);
+    std::thread render_thread(RenderThread, window);
+
+    // A thread principal só trata os eventos da janela, até que o usuário a feche
+    while (!glfwWindowShouldClose(window))
+        glfwWaitEvents();
 
-    ObjModel trackmodel("../../data/track/track.obj");
-    ComputeNormals(&trackmodel);
-    BuildTrianglesAndAddToVirtualScene(&trackmodel);
+    g_Quit = true;
+    render_thread.join();
+    simulation_thread.join();
 
-    ObjModel planemodel("../../data/plane/plane.obj");
-    ComputeNormals(&planemodel);
-    BuildTrianglesAndAddToVirtualScene(&planemodel);
+    Latency_Print(g_InputLatency);
 
-    ObjModel carmodel("../../data/car/supratunadov5.obj");
-    ComputeNormals(&carmodel);
-    BuildTrianglesAndAddToVirtualScene(&carmodel);
+    Replay_EndRecording(g_ReplayRecorder);
+    for (size_t i = 0; i < g_Ghosts.size(); ++i)
+        Ghost_Close(g_Ghosts[i]);
+    Arena_PrintStats(g_FrameArena);
+    Arena_PrintStats(g_StepArena);
+    Arena_Free(g_FrameArena);
+    Simulation_Shutdown();
 
-    ObjModel treemodel("../../data/tree/tree.obj");
-    ComputeNormals(&treemodel);
-    BuildTrianglesAndAddToVirtualScene(&treemodel);
+    glfwTerminate();
 
-    ObjModel bonusmodel("../../data/bonus/bonus-compressed.obj");
-    ComputeNormals(&bonusmodel);
-    BuildTrianglesAndAddToVirtualScene(&bonusmodel);
+    if (g_AllocCheckFrames > 0)
+    {
+        printf("Alocações no heap após %d quadros de aquecimento: %llu (%.3f por quadro)\n", RENDER_ALLOC_WARMUP_FRAMES,
+               (unsigned long long)g_RenderAllocations, (double)g_RenderAllocations / (g_AllocCheckFrames - RENDER_ALLOC_WARMUP_FRAMES));
+        if (g_RenderAllocations > 0)
+        {
+            fprintf(stderr, "ERROR: The game loop allocated heap memory %llu times after warm-up.\n", (unsigned long long)g_RenderAllocations);
+            return EXIT_FAILURE;
+        }
+    }
 
-    ObjModel outdoormodel("../../data/outdoor/outdoor.obj");
-    ComputeNormals(&outdoormodel);
-    BuildTrianglesAndAddToVirtualScene(&outdoormodel);
+    return 0;
+}
 
-    ObjModel finishlinemodel("../../data/line/finish-line.obj");
-    ComputeNormals(&finishlinemodel);
-    BuildTrianglesAndAddToVirtualScene(&finishlinemodel);
+// Copia para "state" o que a thread do desenho precisa do passo atual da
+// simulação. As matrizes do cenário devem ter sido atualizadas antes (veja
+// Simulation_UpdateScene()).
+void CaptureRenderState(RenderState& state)
+{
+    state.lap_time = g_SimulationTime - g_LapStartTime;
+    state.car      = car;
 
-    if ( argc > 1 )
+    state.opponents.resize(g_Fleet.count);
+    for (size_t i = 0; i < g_Fleet.count; ++i)
     {
-        ObjModel model(argv[1]);
-        BuildTrianglesAndAddToVirtualScene(&model);
+        CarPose& pose = state.opponents[i];
+        pose.position             = glm::vec3(g_Fleet.x[i], g_Fleet.y[i], g_Fleet.z[i]);
+        pose.rotation_angle       = g_Fleet.rotation_angle[i];
+        pose.front_wheel_angle    = g_Fleet.front_wheel_angle[i];
+        pose.wheel_rotation_angle = g_Fleet.wheel_rotation_angle[i];
     }
 
-    // Inicializamos o código para renderização de texto.
-    TextRendering_Init();
+    state.renderables.clear();
+    for (size_t a = 0; a < g_Scene.archetypes.size(); ++a)
+    {
+        const Archetype& archetype = g_Scene.archetypes[a];
+        const Renderable* renderables = World_Column<Renderable>(archetype);
+        if (renderables == NULL)
+            continue;
+        for (size_t i = 0; i < archetype.count; ++i)
+            if (renderables[i].visible)
+                state.renderables.push_back(renderables[i]);
+    }
+}
 
-    // Habilitamos o Z-buffer. Veja slides 104-116 do documento Aula_09_Projecoes.pdf.
-    glEnable(GL_DEPTH_TEST);
+// Aplica um evento de g_SimulationInput às teclas pressionadas ("held") e aos
+// eventos do próximo passo ("pending")
+void ApplySimulationKey(const InputEvent& event, uint8_t* held, uint8_t* pending)
+{
+    uint8_t bit = 0;
+    switch (event.key)
+    {
+        case GLFW_KEY_W:         bit = INPUT_KEY_W; break;
+        case GLFW_KEY_S:         bit = INPUT_KEY_S; break;
+        case GLFW_KEY_A:         bit = INPUT_KEY_A; break;
+        case GLFW_KEY_D:         bit = INPUT_KEY_D; break;
+        case GLFW_KEY_BACKSPACE: bit = INPUT_REWIND; break; // Volta no tempo (veja Simulation_Rewind())
+
+        // Se o usuário apertar a tecla espaço, reseta a a posicao do carro com sua velocidade e etc
+        case GLFW_KEY_SPACE:
+            if (event.action == GLFW_PRESS)
+                *pending |= INPUT_RESET;
+            return;
+
+        // Toggle do tipo de camera
+        case GLFW_KEY_L:
+            if (event.action == GLFW_PRESS)
+                *pending |= INPUT_CAMERA_TOGGLE;
+            return;
+    }
+
+    if (event.action == GLFW_PRESS)
+        *held |= bit;
+    else if (event.action == GLFW_RELEASE)
+        *held &= ~bit;
+}
 
-    // Habilitamos o Backface Culling. Veja slides 8-13 do documento Aula_02_Fundamentos_Matematicos.pdf, slides 23-34 do documento Aula_13_Clipping_and_Culling.pdf e slides 112-123 do documento Aula_14_Laboratorio_3_Revisao.pdf.
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    
-    InitializeBonusObjects();
+// Thread da simulação: avança em passos fixos de SIMULATION_TIMESTEP no ritmo
+// do relógio, independente dos quadros desenhados, e publica o estado de cada
+// passo em g_RenderStates.
+void SimulationThread()
+{
+    // Teclas mantidas pressionadas e eventos (espaço e L) desde o último
+    // passo. Os eventos são consumidos pelo próximo passo, para que fiquem
+    // gravados no replay no passo correto.
+    uint8_t held = 0;
+    uint8_t pending = 0;
+
+    bool     camera_look_at = true;
+    uint64_t input_events = 0;
+    double   input_time = 0.0;
+    uint64_t steps = 0;
+
+    Profiler_SetThreadName("simulação");
+
+    // A frota e os sistemas do cenário são divididos em tarefas a cada passo;
+    // com uma fila própria, elas não passam pela fila compartilhada do pool
+    // (veja ThreadPool_AttachThread()), que aloca a cada tarefa
+    if (!ThreadPool_AttachThread(g_ThreadPool))
+        fprintf(stderr, "WARNING: The simulation thread has no job queue of its own.\n");
+
+    double next_step = glfwGetTime();
+    while (!g_Quit.load())
+    {
+        double now = glfwGetTime();
+        if (now < next_step)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(next_step - now));
+            continue;
+        }
 
-    // Ficamos em um loop infinito, renderizando, até que o usuário feche a janela
-    while (!glfwWindowShouldClose(window))
+        // Limitamos o atraso para que uma pausa longa (ex: o processo parado
+        // em um depurador) não dispare centenas de passos de uma vez
+        if (now - next_step > 0.25)
+            next_step = now - 0.25;
+
+        InputEvent event;
+        while (SpscQueue_Pop(g_SimulationInput, &event))
+        {
+            ApplySimulationKey(event, &held, &pending);
+            input_events += 1;
+            input_time = event.time;
+        }
+        uint8_t input = held | pending;
+        pending = 0;
+
+        // Durante um replay o teclado é ignorado. Ao fim do replay, o
+        // controle volta para o jogador.
+        if (g_ReplayPlaying && !Replay_NextInput(g_ReplayPlayer, &input))
+        {
+            g_ReplayPlaying = false;
+            printf("Fim do replay: %llu passos, %llu checksums conferidos, %s.\n",
+                   (unsigned long long)g_ReplayPlayer.steps, (unsigned long long)g_ReplayPlayer.checksums,
+                   g_ReplayPlayer.desync ? "DIVERGIU" : "sem divergências");
+        }
+
+        if (input & INPUT_CAMERA_TOGGLE)
+            camera_look_at = !camera_look_at;
+
+        Simulation_Step(input, SIMULATION_TIMESTEP);
+        next_step += SIMULATION_TIMESTEP;
+        ++steps;
+
+        if (g_ReplayPlaying)
+            Replay_VerifyStep(g_ReplayPlayer);
+        Replay_RecordStep(g_ReplayRecorder, input);
+        Ghost_RecordStep(g_GhostRecorder);
+
+        // Atrasada, a simulação só publica o último dos passos que faltam
+        if (next_step > glfwGetTime())
+        {
+            Simulation_UpdateScene();
+            RenderState& state = TripleBuffer_Back(g_RenderStates);
+            {
+                PROFILE_ZONE("capture");
+                CaptureRenderState(state);
+            }
+            state.step           = steps;
+            state.camera_look_at = camera_look_at;
+            state.input_events   = input_events;
+            state.input_time     = input_time;
+            TripleBuffer_Publish(g_RenderStates);
+        }
+    }
+}
+
+// Aplica um evento de g_RenderInput à câmera e às opções de depuração
+void ApplyRenderEvent(const InputEvent& event)
+{
+    if (event.type == INPUT_EVENT_CAMERA_DRAG)
+    {
+        // Atualizamos parâmetros da câmera com os deslocamentos
+        g_CameraTheta -= 0.01f*event.dx;
+        g_CameraPhi   += 0.01f*event.dy;
+
+        // Em coordenadas esféricas, o ângulo phi deve ficar entre -pi/2 e +pi/2.
+        float phimax = PI/2;
+        float phimin = -phimax;
+
+        if (g_CameraPhi > phimax)
+            g_CameraPhi = phimax;
+
+        if (g_CameraPhi < phimin)
+            g_CameraPhi = phimin;
+        return;
+    }
+
+    if (event.type == INPUT_EVENT_SCROLL)
+    {
+        float scrollSensitivity = 1.0f; // Camera look at: usar scroll para aumentar/diminuir distancia
+        camera_offset.z -= event.dy * scrollSensitivity;
+        camera_offset.y -= event.dy * scrollSensitivity * relation_delta_yz;
+        camera_offset.z = std::min(std::max(camera_offset.z, MIN_DISTANCE_LOOK_AT_Z), MAX_DISTANCE_LOOK_AT_Z);
+        camera_offset.y = std::min(std::max(camera_offset.y, MIN_DISTANCE_LOOK_AT_Y), MAX_DISTANCE_LOOK_AT_Y);
+        return;
+    }
+
+    // Movimentacao da camera livre
+    bool pressed = event.action != GLFW_RELEASE;
+    if (event.key == GLFW_KEY_UP)
+        key_UP_pressed = pressed;
+    if (event.key == GLFW_KEY_DOWN)
+        key_DOWN_pressed = pressed;
+    if (event.key == GLFW_KEY_LEFT)
+        key_LEFT_pressed = pressed;
+    if (event.key == GLFW_KEY_RIGHT)
+        key_RIGHT_pressed = pressed;
+
+    if (event.action != GLFW_PRESS)
+        return;
+
+    // Se o usuário apertar a tecla H, fazemos um "toggle" do texto informativo mostrado na tela.
+    if (event.key == GLFW_KEY_H)
+        g_ShowInfoText = !g_ShowInfoText;
+
+    // Se o usuário apertar a tecla B, fazemos um "toggle" dos bbox dos objetos.
+    if (event.key == GLFW_KEY_B)
+        g_Show_BBOX = !g_Show_BBOX;
+
+    // Se o usuário apertar a tecla P, fazemos um "toggle" do painel do profiler.
+    if (event.key == GLFW_KEY_P)
+        g_ShowProfiler = !g_ShowProfiler;
+
+    // Se o usuário apertar a tecla G, imprimimos as chamadas OpenGL do último quadro (veja glstats.h).
+    if (event.key == GLFW_KEY_G)
+        GlStats_Print();
+
+    // Se o usuário apertar a tecla T, gravamos os próximos quadros em "trace.json" (veja Profiler_BeginCapture()).
+    if (event.key == GLFW_KEY_T)
+        Profiler_BeginCapture("trace.json", PROFILER_CAPTURE_FRAMES);
+
+    // Se o usuário apertar a tecla R, recarregamos os shaders dos arquivos "shader_fragment.glsl" e "shader_vertex.glsl".
+    if (event.key == GLFW_KEY_R)
+    {
+        LoadShadersFromFiles();
+        fprintf(stdout,"Shaders recarregados!\n");
+        fflush(stdout);
+    }
+}
+
+// Thread do desenho: dona do contexto OpenGL, desenha o RenderState mais
+// recente publicado pela simulação, sem esperar por ela.
+void RenderThread(GLFWwindow* window)
+{
+    glfwMakeContextCurrent(window);
+    Profiler_SetThreadName("desenho");
+
+    int viewport_width = 0, viewport_height = 0;
+    double previousTime = glfwGetTime();
+    uint64_t shown_input_events = 0;
+    bool first_frame = true;
+    int frames = 0;
+
+    while (!g_Quit.load())
     {
-        static double previousTime = glfwGetTime();
+        AllocCounters frame_allocations = AllocTrack_Read();
+
         double currentTime = glfwGetTime();
         float deltaTime = static_cast<float>(currentTime - previousTime);
         previousTime = currentTime;
 
-        // Funcoes de atualizacao das propriedades do carro
-        UpdateCarSpeedAndPosition(car, key_W_pressed, key_S_pressed, key_A_pressed, key_D_pressed, deltaTime);        
-        UpdateFrontWheelsAngle(car, key_A_pressed, key_D_pressed, deltaTime);
-        UpdateWheelsTransforms(car, deltaTime);
-        UpdatePontuation(car, deltaTime);
+        // A janela foi redimensionada (veja FramebufferSizeCallback())
+        int width = g_FramebufferWidth.load();
+        int height = g_FramebufferHeight.load();
+        if ((width != viewport_width || height != viewport_height) && height > 0)
+        {
+            glViewport(0, 0, width, height);
+            g_ScreenRatio = (float)width / height;
+            viewport_width = width;
+            viewport_height = height;
+        }
+
+        // Resultados da GPU de quadros anteriores (veja gputimer.h)
+        GpuTimer_BeginFrame();
 
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
+        // O glClear() só limpa o Z-buffer com a escrita nele ligada
+        GlState_DepthMask(GL_TRUE);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(g_GpuProgramID);
+        // Estado do desenho 3D. O quadro anterior terminou com o estado do
+        // texto, que não é restaurado (veja glstate.h).
+        GlState_Enable(GL_DEPTH_TEST);
+        GlState_DepthFunc(GL_LESS);
+        GlState_Disable(GL_BLEND);
+        GlState_UseProgram(g_GpuProgramID);
+
+        // Tudo acima independe da entrada. Os eventos da câmera e o estado
+        // mais recente da simulação são lidos o mais tarde possível, logo
+        // antes dos desenhos, para que o quadro mostre a entrada mais nova.
+        InputEvent event;
+        while (SpscQueue_Pop(g_RenderInput, &event))
+            ApplyRenderEvent(event);
+
+        RenderState& state = TripleBuffer_Front(g_RenderStates);
+        Car& car = state.car;
+        UpdateWheelsTransforms(car);
 
         // Computamos a posição da câmera utilizando coordenadas esféricas.  As
         // variáveis g_CameraDistance, g_CameraPhi, e g_CameraTheta são
@@ -597,7 +1023,7 @@ int main(int argc, char* argv[])
         glm::vec4 camera_lookat_l;
         glm::vec4 camera_view_vector;
         glm::vec4 camera_up_vector   = glm::vec4(0.0f,1.0f,0.0f,0.0f); // Vetor "up" fixado para apontar para o "céu" (eito Y global)
-        if (type_camera_look_at) {
+        if (state.camera_look_at) {
             camera_lookat_l  = glm::vec4(car.carPosition.x, car.carPosition.y, car.carPosition.z, 1.0f); // Camera look-at
             glm::vec3 car_direction = glm::normalize(car.carDirection);
             glm::vec3 camera_offset_rotated = glm::vec3(
@@ -637,80 +1063,145 @@ int main(int argc, char* argv[])
 
         glm::mat4 model = Matrix_Identity(); 
 
-        glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-        glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+        // As matrizes da câmera vão para a GPU uma única vez, valendo para
+        // todos os programas que usam o bloco "Camera"
+        GlState_BindBuffer(GL_UNIFORM_BUFFER, g_CameraUniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(view));
+        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(projection));
+        PROFILE_COUNT("bytes enviados", 2 * sizeof(glm::mat4));
 
-        UpdateBonusObjects(deltaTime); // Update positions based on Bezier curves
-
-        DrawCar();
-     
-        DrawTrees();
-
-        DrawBonus();
-
-        DrawOutdoors();
-
-        // skybox
-        model = Matrix_Rotate_Y(-PI/4) *
-                Matrix_Scale(350.0f, 350.0f, 350.0f);
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, SKYBOX);
-        glUniform1i(g_uv_mapping_type_uniform, 99);
-        DrawVirtualObject("the_skysemisphere");
+        {
+            PROFILE_ZONE("submit");
+
+            GpuTimer_BeginPass(GPU_PASS_CAR);
+            DrawCar(car);
+            GpuTimer_EndPass();
+
+            GpuTimer_BeginPass(GPU_PASS_PROPS);
+            DrawOpponents(state.opponents);
+            DrawScene(state.renderables);
+            GpuTimer_EndPass();
+
+            // skybox
+            GpuTimer_BeginPass(GPU_PASS_SKYBOX);
+            model = Matrix_Rotate_Y(-PI/4) *
+                    Matrix_Scale(350.0f, 350.0f, 350.0f);
+            GlState_UniformMatrix4fv(g_model_uniform, glm::value_ptr(model));
+            GlState_Uniform1i(g_object_id_uniform, SKYBOX);
+            GlState_Uniform1i(g_uv_mapping_type_uniform, 99);
+            DrawVirtualObject("the_skysemisphere");
+            GpuTimer_EndPass();
+
+            // pista
+            GpuTimer_BeginPass(GPU_PASS_GROUND);
+            model = Matrix_Translate(0.0f, TRACK_HEIGHT, 0.0f);
+            GlState_UniformMatrix4fv(g_model_uniform, glm::value_ptr(model));
+            GlState_Uniform1i(g_object_id_uniform, TRACK);
+            GlState_Uniform1i(g_uv_mapping_type_uniform, 1);
+            DrawVirtualObject("the_track");
+
+            // plano da grama
+            model = Matrix_Translate(0.0f, PLANE_HEIGHT, 0.0f)
+                  * Matrix_Scale(1.0f, 1.0f, 1.0f);
+            GlState_UniformMatrix4fv(g_model_uniform, glm::value_ptr(model));
+            GlState_Uniform1i(g_object_id_uniform, PLANE);
+            GlState_Uniform1i(g_uv_mapping_type_uniform, 1);
+            DrawVirtualObject("the_plane");
+            GpuTimer_EndPass();
+
+            // Os fantasmas são translúcidos, e por isso desenhados por último
+            GpuTimer_BeginPass(GPU_PASS_GHOSTS);
+            DrawGhosts(state.lap_time);
+            GpuTimer_EndPass();
+        }
 
-        // pista
-        model = Matrix_Translate(0.0f, -0.98f, 0.0f);
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, TRACK);
-        glUniform1i(g_uv_mapping_type_uniform, 1);
-        DrawVirtualObject("the_track");
+        {
+            PROFILE_ZONE("text");
+            GpuTimer_BeginPass(GPU_PASS_TEXT);
+            TextRendering_ShowVelocity(window, car);
+            TextRendering_ShowPontuation(window, car);
+            TextRendering_ShowFramesPerSecond(window);
+            TextRendering_ShowInputLatency(window, g_InputLatency.last_us);
+            if (g_ShowProfiler)
+                ProfilerOverlay_Draw(window);
+            GpuTimer_EndPass();
+        }
 
-        // plano da grama
-        model = Matrix_Translate(0.0f, -1.0f, 0.0f)
-              * Matrix_Scale(1.0f, 1.0f, 1.0f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, PLANE);
-        glUniform1i(g_uv_mapping_type_uniform, 1);
-        DrawVirtualObject("the_plane");
+        {
+            PROFILE_ZONE("swap");
+            if (g_StartupExit || g_AllocCheckFrames > 0)
+                glFinish();
+            else
+                glfwSwapBuffers(window);
+        }
 
-        model = Matrix_Translate(0.0f, -0.95f, 3.0f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, FINISH_LINE);
-        glUniform1i(g_uv_mapping_type_uniform, 1);
-        DrawVirtualObject("finish_line");
+        if (first_frame)
+        {
+            first_frame = false;
+            Startup_End(g_FirstFramePhase);
+            Startup_Print();
+            if (g_StartupJson != NULL)
+                Startup_WriteJson(g_StartupJson);
+            if (g_StartupExit)
+            {
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+                glfwPostEmptyEvent(); // Acorda a thread principal
+            }
+        }
 
-        TextRendering_ShowVelocity(window);
-        TextRendering_ShowPontuation(window);
-        TextRendering_ShowFramesPerSecond(window);
+        // Este é o primeiro quadro com os eventos de entrada usados desde o
+        // anterior: medimos a latência do mais novo deles
+        if (state.input_events != shown_input_events)
+        {
+            Latency_Add(g_InputLatency, glfwGetTime() - state.input_time);
+            shown_input_events = state.input_events;
+        }
 
-        glfwSwapBuffers(window);
+        Profiler_EndFrame();
+        GlStats_EndFrame();
+        Arena_Reset(g_FrameArena);
+        g_FrameAllocations = AllocTrack_Since(frame_allocations);
 
-        glfwPollEvents();
+        if (g_AllocCheckFrames > 0)
+        {
+            if (++frames > RENDER_ALLOC_WARMUP_FRAMES)
+                g_RenderAllocations += g_FrameAllocations;
+            if (frames == g_AllocCheckFrames)
+            {
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+                glfwPostEmptyEvent(); // Acorda a thread principal
+            }
+        }
     }
 
-    glfwTerminate();
-
-    return 0;
+    glfwMakeContextCurrent(NULL);
 }
 
-void LoadTextureImage(const char* filename)
+void DecodeTextureImage(void* context, size_t, size_t)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    TextureImage& image = *static_cast<TextureImage*>(context);
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
     int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+    int phase = Startup_Begin("decodificar imagem", image.filename);
+    image.data = stbi_load(image.filename, &image.width, &image.height, &channels, 3);
+    Startup_End(phase);
 
-    if ( data == NULL )
+    if ( image.data == NULL )
     {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
+        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", image.filename);
         std::exit(EXIT_FAILURE);
     }
 
-    printf("OK (%dx%d).\n", width, height);
+    printf("Carregando imagem \"%s\"... OK (%dx%d).\n", image.filename, image.width, image.height);
+
+    // Chamadas OpenGL só podem ser feitas na thread principal
+    Job_SpawnOnMainThread(g_ThreadPool, UploadTextureImage, &image, image.counter);
+}
+
+void UploadTextureImage(void* context, size_t, size_t)
+{
+    TextureImage& image = *static_cast<TextureImage*>(context);
+    StartupScope phase("enviar imagem", image.filename);
 
     // Agora criamos objetos na GPU com OpenGL para armazenar a textura
     GLuint texture_id;
@@ -732,35 +1223,79 @@ void LoadTextureImage(const char* filename)
     glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
     glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 
-    GLuint textureunit = g_NumLoadedTextures;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    // As imagens ficam prontas em qualquer ordem, mas cada uma tem a sua
+    // unidade de textura fixa
+    GLuint textureunit = image.texture_unit;
+    GlState_BindTexture(textureunit, GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
     glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
+    GlState_BindSampler(textureunit, sampler_id);
 
-    stbi_image_free(data);
+    stbi_image_free(image.data);
+    image.data = NULL;
 
     g_NumLoadedTextures += 1;
 }
+
+void LoadModel(void* context, size_t, size_t)
+{
+    ModelLoad& load = *static_cast<ModelLoad*>(context);
+    {
+        StartupScope phase("ler obj", load.filename);
+        load.model = new ObjModel(load.filename);
+    }
+    StartupScope phase("normais", load.filename);
+    ComputeNormals(load.model);
+}
+
+void BuildTrackJob(void* context, size_t, size_t)
+{
+    ObjModel** models = static_cast<ObjModel**>(context);
+    StartupScope phase("pista");
+    Simulation_BuildTrack(models[0], models[1]);
+}
+
+// Procura um objeto em g_VirtualScene. A chave é montada em uma string
+// reaproveitada entre chamadas, com espaço reservado para nomes comuns, para
+// que a busca não aloque memória a cada quadro (g_VirtualScene[object_name]
+// criaria uma std::string nova, e um objeto vazio se o nome não existisse).
+SceneObject& FindVirtualObject(const char* object_name)
+{
+    static std::string key(64, '\0');
+    key.assign(object_name);
+
+    // Um nome que não existe é incluído vazio (e não desenha nada), como
+    // fazia g_VirtualScene[object_name]
+    std::map<std::string, SceneObject>::iterator it = g_VirtualScene.find(key);
+    if (it == g_VirtualScene.end())
+        return g_VirtualScene[key];
+    return it->second;
+}
+
 // Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
 // dos objetos na função BuildTrianglesAndAddToVirtualScene().
 void DrawVirtualObject(const char* object_name)
+{
+    DrawVirtualObject(FindVirtualObject(object_name));
+}
+
+void DrawVirtualObject(const SceneObject& obj)
 {
     // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
     // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
     // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
+    // A caixa é desenhada antes, porque ela liga o seu próprio VAO
+    if (g_Show_BBOX == true) 
+        DrawBoundingBox(obj.name.c_str());
+
+    GlState_BindVertexArray(obj.vertex_array_object_id);
 
     // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
     // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
-
-    if (g_Show_BBOX == true) 
-        DrawBoundingBox(object_name);
+    glm::vec3 bbox_min = obj.bbox_min;
+    glm::vec3 bbox_max = obj.bbox_max;
+    GlState_Uniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
+    GlState_Uniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
 
     // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
     // apontados pelo VAO como linhas. Veja a definição de
@@ -768,22 +1303,22 @@ void DrawVirtualObject(const char* object_name)
     // a documentação da função glDrawElements() em
     // http://docs.gl/gl3/glDrawElements.
     glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
+        obj.rendering_mode,
+        (GLsizei)obj.num_indices,
         GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
+        (void*)(obj.first_index * sizeof(GLuint))
     );
+    PROFILE_COUNT("chamadas de desenho", 1);
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+    // O VAO continua ligado: o próximo objeto só chama o OpenGL se usar
+    // outro (veja glstate.h)
 }
 
-void DrawBoundingBox(const std::string& object_name)
+void DrawBoundingBox(const char* object_name)
 {
-
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
+    const SceneObject& obj = FindVirtualObject(object_name);
+    glm::vec3 bbox_min = obj.bbox_min;
+    glm::vec3 bbox_max = obj.bbox_max;
 
     GLfloat vertices[] = {
         bbox_min.x, bbox_min.y, bbox_min.z, // 0
@@ -807,29 +1342,26 @@ void DrawBoundingBox(const std::string& object_name)
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
 
-    glBindVertexArray(vao);
+    GlState_BindVertexArray(vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    GlState_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
     glEnableVertexAttribArray(0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
     // Draw the bounding box
-    glBindVertexArray(vao);
     glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    PROFILE_COUNT("chamadas de desenho", 1);
+    PROFILE_COUNT("bytes enviados", sizeof(vertices) + sizeof(indices));
 
     // Cleanup
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
+    GlState_DeleteVertexArray(vao);
+    GlState_DeleteBuffer(vbo);
+    GlState_DeleteBuffer(ebo);
 }
 
 
@@ -861,7 +1393,7 @@ void LoadShadersFromFiles()
 
     // Deletamos o programa de GPU anterior, caso ele exista.
     if ( g_GpuProgramID != 0 )
-        glDeleteProgram(g_GpuProgramID);
+        GlState_DeleteProgram(g_GpuProgramID);
 
     // Criamos um programa de GPU utilizando os shaders carregados acima.
     g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
@@ -870,32 +1402,41 @@ void LoadShadersFromFiles()
     // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
     // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
     g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
     g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id"); // Variável "object_id" em shader_fragment.glsl
     g_bbox_min_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_min");
     g_bbox_max_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_max");
 
+    // As matrizes "view" e "projection" ficam no bloco "Camera", lido de
+    // g_CameraUniformBuffer (veja RenderThread())
+    GLuint camera_block = glGetUniformBlockIndex(g_GpuProgramID, "Camera");
+    if (camera_block != GL_INVALID_INDEX)
+        glUniformBlockBinding(g_GpuProgramID, camera_block, CAMERA_UNIFORM_BINDING);
+
     // Nova variável para o tipo de mapeamento UV
     g_uv_mapping_type_uniform = glGetUniformLocation(g_GpuProgramID, "uv_mapping_type");
 
+    // Opacidade dos objetos; menor que 1 somente para os carros fantasmas
+    g_alpha_uniform = glGetUniformLocation(g_GpuProgramID, "alpha");
+
     // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
-    glUseProgram(g_GpuProgramID);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureSkybox"), 0);
-
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarHood"), 1);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarMetalic"), 2);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarGlass"), 3);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarPainting"), 4);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarWheel"), 5);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarNotPaintedParts"), 6);
+    GlState_UseProgram(g_GpuProgramID);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureSkybox"), 0);
+
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarHood"), 1);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarMetalic"), 2);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarGlass"), 3);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarPainting"), 4);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarWheel"), 5);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureCarNotPaintedParts"), 6);
     
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureGrass"), 7);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureTrack"), 8);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureTree"), 9);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureBonus"), 10);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureOutdoorFace"), 11);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureFinishLine"), 12);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureGrass"), 7);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureTrack"), 8);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureTree"), 9);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureBonus"), 10);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureOutdoorFace"), 11);
+    GlState_Uniform1i(glGetUniformLocation(g_GpuProgramID, "TextureFinishLine"), 12);
+
+    GlState_Uniform1f(g_alpha_uniform, 1.0f);
 
 }
 
@@ -919,208 +1460,84 @@ void PopMatrix(glm::mat4& M)
     }
 }
 
-// Função que computa as normais de um ObjModel, caso elas não tenham sido
-// especificadas dentro do arquivo ".obj"
-void ComputeNormals(ObjModel* model)
-{
-    if ( !model->attrib.normals.empty() )
-        return;
-
-    // Primeiro computamos as normais para todos os TRIÂNGULOS.
-    // Segundo, computamos as normais dos VÉRTICES através do método proposto
-    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
-    // todas as faces que compartilham este vértice.
-
-    size_t num_vertices = model->attrib.vertices.size() / 3;
-
-    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
-    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
-
-    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
-    {
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            glm::vec4  vertices[3];
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
-            }
-
-            const glm::vec4  a = vertices[0];
-            const glm::vec4  b = vertices[1];
-            const glm::vec4  c = vertices[2];
 
-            // PREENCHA AQUI o cálculo da normal de um triângulo cujos vértices
-            // estão nos pontos "a", "b", e "c", definidos no sentido anti-horário.
-            glm::vec3 edge1 = glm::vec3(b - a);
-            glm::vec3 edge2 = glm::vec3(c - a);
-            glm::vec3 normal = glm::normalize(glm::cross(edge1, edge2));
-            const glm::vec4  n = glm::vec4(normal, 0.0f);
-
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                num_triangles_per_vertex[idx.vertex_index] += 1;
-                vertex_normals[idx.vertex_index] += n;
-                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
-            }
-        }
-    }
-
-    model->attrib.normals.resize( 3*num_vertices );
-
-    for (size_t i = 0; i < vertex_normals.size(); ++i)
-    {
-        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
-        n /= norm(n);
-        model->attrib.normals[3*i + 0] = n.x;
-        model->attrib.normals[3*i + 1] = n.y;
-        model->attrib.normals[3*i + 2] = n.z;
-    }
-}
 
 // Constrói triângulos para futura renderização a partir de um ObjModel.
 void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
 {
     GLuint vertex_array_object_id;
     glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
+    GlState_BindVertexArray(vertex_array_object_id);
 
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
+    // Os vértices e índices são montados sem OpenGL (veja objmodel.h)
+    TriangleMesh mesh;
+    BuildTriangleMesh(model, mesh);
+    const std::vector<GLuint>& indices              = mesh.indices;
+    const std::vector<float>&  model_coefficients   = mesh.model_coefficients;
+    const std::vector<float>&  normal_coefficients  = mesh.normal_coefficients;
+    const std::vector<float>&  texture_coefficients = mesh.texture_coefficients;
 
-    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    for (size_t i = 0; i < mesh.objects.size(); ++i)
     {
-        size_t first_index = indices.size();
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
-
-        const float minval = std::numeric_limits<float>::min();
-        const float maxval = std::numeric_limits<float>::max();
-
-        glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
-        glm::vec3 bbox_max = glm::vec3(minval,minval,minval);
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-
-                indices.push_back(first_index + 3*triangle + vertex);
-
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
-
-                bbox_min.x = std::min(bbox_min.x, vx);
-                bbox_min.y = std::min(bbox_min.y, vy);
-                bbox_min.z = std::min(bbox_min.z, vz);
-                bbox_max.x = std::max(bbox_max.x, vx);
-                bbox_max.y = std::max(bbox_max.y, vy);
-                bbox_max.z = std::max(bbox_max.z, vz);
-
-                // Inspecionando o código da tinyobjloader, o aluno Bernardo
-                // Sulzbach (2017/1) apontou que a maneira correta de testar se
-                // existem normais e coordenadas de textura no ObjModel é
-                // comparando se o índice retornado é -1. Fazemos isso abaixo.
-
-                if ( idx.normal_index != -1 )
-                {
-                    const float nx = model->attrib.normals[3*idx.normal_index + 0];
-                    const float ny = model->attrib.normals[3*idx.normal_index + 1];
-                    const float nz = model->attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
-                }
-
-                if ( idx.texcoord_index != -1 )
-                {
-                    const float u = model->attrib.texcoords[2*idx.texcoord_index + 0];
-                    const float v = model->attrib.texcoords[2*idx.texcoord_index + 1];
-                    texture_coefficients.push_back( u );
-                    texture_coefficients.push_back( v );
-                }
-            }
-        }
-
-        size_t last_index = indices.size() - 1;
+        const TriangleMeshObject& object = mesh.objects[i];
 
         SceneObject theobject;
-        theobject.name           = model->shapes[shape].name;
-        theobject.first_index    = first_index; // Primeiro índice
-        theobject.num_indices    = last_index - first_index + 1; // Número de indices
+        theobject.name           = object.name;
+        theobject.first_index    = object.first_index; // Primeiro índice
+        theobject.num_indices    = object.num_indices; // Número de indices
         theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
         theobject.vertex_array_object_id = vertex_array_object_id;
 
-        theobject.bbox_min = bbox_min;
-        theobject.bbox_max = bbox_max;
+        theobject.bbox_min = object.bbox_min;
+        theobject.bbox_max = object.bbox_max;
 
-        g_VirtualScene[model->shapes[shape].name] = theobject;
+        g_VirtualScene[object.name] = theobject;
     }
 
     GLuint VBO_model_coefficients_id;
     glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
     glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
     GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
     GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
     glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, 0);
 
     if ( !normal_coefficients.empty() )
     {
         GLuint VBO_normal_coefficients_id;
         glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
+        GlState_BindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
         glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
         glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
         location = 1; // "(location = 1)" em "shader_vertex.glsl"
         number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
         glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
         glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GlState_BindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
     if ( !texture_coefficients.empty() )
     {
         GLuint VBO_texture_coefficients_id;
         glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
+        GlState_BindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
         glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
         glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
         location = 2; // "(location = 1)" em "shader_vertex.glsl"
         number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
         glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
         glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GlState_BindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
 
     // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
+    GlState_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
     // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
@@ -1128,7 +1545,7 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
 
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a
     // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+    GlState_BindVertexArray(0);
 }
 
 // Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
@@ -1285,20 +1702,39 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
 // "framebuffer" (região de memória onde são armazenados os pixels da imagem).
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-    // Indicamos que queremos renderizar em toda região do framebuffer. A
-    // função "glViewport" define o mapeamento das "normalized device
-    // coordinates" (NDC) para "pixel coordinates".  Essa é a operação de
-    // "Screen Mapping" ou "Viewport Mapping" vista em aula ({+ViewportMapping2+}).
-    glViewport(0, 0, width, height);
-
-    // Atualizamos também a razão que define a proporção da janela (largura /
+    // A thread do desenho, dona do contexto OpenGL, compara o tamanho abaixo
+    // com o do quadro anterior e chama "glViewport" com ele, definindo o
+    // mapeamento das "normalized device coordinates" (NDC) para "pixel
+    // coordinates".  Essa é a operação de "Screen Mapping" ou "Viewport
+    // Mapping" vista em aula ({+ViewportMapping2+}). Ela também atualiza
+    // g_ScreenRatio, a razão que define a proporção da janela (largura /
     // altura), a qual será utilizada na definição das matrizes de projeção,
     // tal que não ocorra distorções durante o processo de "Screen Mapping"
     // acima, quando NDC é mapeado para coordenadas de pixels. Veja slides 205-215 do documento Aula_09_Projecoes.pdf.
-    //
-    // O cast para float é necessário pois números inteiros são arredondados ao
-    // serem divididos!
-    g_ScreenRatio = (float)width / height;
+    g_FramebufferWidth = width;
+    g_FramebufferHeight = height;
+}
+
+// Tamanho da janela em coordenadas de tela, usado para desenhar texto
+void WindowSizeCallback(GLFWwindow* window, int width, int height)
+{
+    g_WindowWidth = width;
+    g_WindowHeight = height;
+}
+
+// Tamanho da janela para a thread do desenho (veja textrendering.cpp)
+void GetWindowSize(GLFWwindow* window, int* width, int* height)
+{
+    *width = g_WindowWidth.load();
+    *height = g_WindowHeight.load();
+}
+
+// Entrega um evento de entrada para a thread que o usa
+void PushInputEvent(SpscQueue<InputEvent, INPUT_QUEUE_CAPACITY>& queue, uint8_t type, int key, int action, float dx, float dy)
+{
+    InputEvent event = { glfwGetTime(), type, key, action, dx, dy };
+    if (!SpscQueue_Push(queue, event))
+        g_DroppedInputEvents.fetch_add(1);
 }
 
 // Variáveis globais que armazenam a última posição do cursor do mouse, para
@@ -1375,19 +1811,9 @@ void CursorPosCallback(GLFWwindow* window, double xpos, double ypos)
         float dx = xpos - g_LastCursorPosX;
         float dy = ypos - g_LastCursorPosY;
     
-        // Atualizamos parâmetros da câmera com os deslocamentos
-        g_CameraTheta -= 0.01f*dx;
-        g_CameraPhi   += 0.01f*dy;
-    
-        // Em coordenadas esféricas, o ângulo phi deve ficar entre -pi/2 e +pi/2.
-        float phimax = PI/2;
-        float phimin = -phimax;
-    
-        if (g_CameraPhi > phimax)
-            g_CameraPhi = phimax;
-    
-        if (g_CameraPhi < phimin)
-            g_CameraPhi = phimin;
+        // Os parâmetros da câmera são atualizados com os deslocamentos pela
+        // thread do desenho (veja ApplyRenderEvent())
+        PushInputEvent(g_RenderInput, INPUT_EVENT_CAMERA_DRAG, 0, 0, dx, dy);
     
         // Atualizamos as variáveis globais para armazenar a posição atual do
         // cursor como sendo a última posição conhecida do cursor.
@@ -1442,28 +1868,9 @@ void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
     // o qual foi detectado pelo aluno Vinicius Fraga (2017/2).
     //const float verysmallnumber = std::numeric_limits<float>::epsilon();
     
-    float scrollSensitivity = 1.0f; // Camera look at: usar scroll para aumentar/diminuir distancia
-    camera_offset.z -= yoffset * scrollSensitivity;
-    camera_offset.y -= yoffset * scrollSensitivity * relation_delta_yz;
-    //if (g_CameraDistance < verysmallnumber)
-    //    g_CameraDistance = verysmallnumber;
-    if (camera_offset.z < MIN_DISTANCE_LOOK_AT_Z)
-    {
-        camera_offset.z = MIN_DISTANCE_LOOK_AT_Z;
-    }
-    if (camera_offset.z > MAX_DISTANCE_LOOK_AT_Z)
-    {
-        camera_offset.z = MAX_DISTANCE_LOOK_AT_Z;
-    }
-    if (camera_offset.y < MIN_DISTANCE_LOOK_AT_Y)
-    {
-        camera_offset.y = MIN_DISTANCE_LOOK_AT_Y;
-    }
-    if (camera_offset.y > MAX_DISTANCE_LOOK_AT_Y)
-    {
-        camera_offset.y = MAX_DISTANCE_LOOK_AT_Y;
-    }
-
+    // A distância da câmera look-at para o carro é atualizada pela thread do
+    // desenho (veja ApplyRenderEvent())
+    PushInputEvent(g_RenderInput, INPUT_EVENT_SCROLL, 0, 0, (float)xoffset, (float)yoffset);
 }
 
 // Definição da função que será chamada sempre que o usuário pressionar alguma
@@ -1482,136 +1889,34 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
-    // Movimentacao do Carro
-    if (key == GLFW_KEY_W)
-    {
-        if (action == GLFW_PRESS)
-            key_W_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_W_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-
-    if (key == GLFW_KEY_S)
-    {
-        if (action == GLFW_PRESS)
-            key_S_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_S_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-
-    if (key == GLFW_KEY_A)
-    {
-        if (action == GLFW_PRESS)
-            key_A_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_A_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-        if (key == GLFW_KEY_D)
-    {
-        if (action == GLFW_PRESS)
-            key_D_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_D_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-
-    // Movimentacao da camera livre
-    if (key == GLFW_KEY_UP)
-    {
-        if (action == GLFW_PRESS)
-            key_UP_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_UP_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-    if (key == GLFW_KEY_DOWN)
-    {
-        if (action == GLFW_PRESS)
-            key_DOWN_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_DOWN_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-    if (key == GLFW_KEY_LEFT)
-    {
-        if (action == GLFW_PRESS)
-            key_LEFT_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_LEFT_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-    if (key == GLFW_KEY_RIGHT)
-    {
-        if (action == GLFW_PRESS)
-            key_RIGHT_pressed = true;
-
-        else if (action == GLFW_RELEASE)
-            key_RIGHT_pressed = false;
-
-        else if (action == GLFW_REPEAT)
-            ;
-    }
-
-      // Se o usuário apertar a tecla espaço, reseta a a posicao do carro com sua velocidade e etc
-    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
-    {
-        car.carPosition = glm::vec3(0.0f, -0.95f, 0.0f);
-        car.carVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
-        car.carAcceleration = glm::vec3(0.0f, 0.0f, 0.0f);
-        car.speed = 0.0f;
-        car.acceleration = 0.0f;
-        car.wheel_rotation_angle = 0.0f;
-        car.rotation_angle = 0.0f;
-        car.front_wheel_angle = 0.0f;
-        car.pontuation = 0;
-    }
-    // Se o usuário apertar a tecla H, fazemos um "toggle" do texto informativo mostrado na tela.
-    if (key == GLFW_KEY_H && action == GLFW_PRESS)
-    {
-        g_ShowInfoText = !g_ShowInfoText;
-    }
-
-    // Se o usuário apertar a tecla B, fazemos um "toggle" dos bbox dos objetos.
-    if (key == GLFW_KEY_B && action == GLFW_PRESS)
-    {
-        g_Show_BBOX = !g_Show_BBOX;
-    }
-
-    // Se o usuário apertar a tecla R, recarregamos os shaders dos arquivos "shader_fragment.glsl" e "shader_vertex.glsl".
-    if (key == GLFW_KEY_R && action == GLFW_PRESS)
-    {
-        LoadShadersFromFiles();
-        fprintf(stdout,"Shaders recarregados!\n");
-        fflush(stdout);
-    }
-
-    if (key == GLFW_KEY_L && action == GLFW_PRESS)
+    // As teclas do carro, de reset (espaço), da câmera (L) e de voltar no
+    // tempo (backspace) fazem parte das entradas da simulação, gravadas nos
+    // replays (veja ApplySimulationKey()). As outras só mudam o que é
+    // desenhado (veja ApplyRenderEvent()).
+    switch (key)
     {
-        type_camera_look_at = !type_camera_look_at;
+        case GLFW_KEY_W:
+        case GLFW_KEY_S:
+        case GLFW_KEY_A:
+        case GLFW_KEY_D:
+        case GLFW_KEY_BACKSPACE:
+        case GLFW_KEY_SPACE:
+        case GLFW_KEY_L:
+            PushInputEvent(g_SimulationInput, INPUT_EVENT_KEY, key, action, 0.0f, 0.0f);
+            break;
+
+        case GLFW_KEY_UP:
+        case GLFW_KEY_DOWN:
+        case GLFW_KEY_LEFT:
+        case GLFW_KEY_RIGHT:
+        case GLFW_KEY_H:
+        case GLFW_KEY_B:
+        case GLFW_KEY_P:
+        case GLFW_KEY_G:
+        case GLFW_KEY_T:
+        case GLFW_KEY_R:
+            PushInputEvent(g_RenderInput, INPUT_EVENT_KEY, key, action, 0.0f, 0.0f);
+            break;
     }
 }
 
@@ -1622,7 +1927,7 @@ void ErrorCallback(int error, const char* description)
 }
 
 // Mostra velocidade atual do carro
-void TextRendering_ShowVelocity(GLFWwindow* window)
+void TextRendering_ShowVelocity(GLFWwindow* window, const Car& car)
 {
 
     float lineheight = TextRendering_LineHeight(window);
@@ -1653,9 +1958,12 @@ void TextRendering_ShowVelocity(GLFWwindow* window)
     snprintf(buffer, 50, "Vec Direction: (%.2f, %.2f, %.2f)", car.carDirection.x, car.carDirection.y, car.carDirection.z);
     TextRendering_PrintString(window, buffer, -1.0f + charwidth, 1.0f - 10 * lineheight, 1.0f);
 
+    snprintf(buffer, 50, "Track Distance: %.2f (%s)", car.surface.distance, car.surface.off_track ? "grass" : "asphalt");
+    TextRendering_PrintString(window, buffer, -1.0f + charwidth, 1.0f - 11 * lineheight, 1.0f);
+
 }
 
-void TextRendering_ShowPontuation(GLFWwindow* window)
+void TextRendering_ShowPontuation(GLFWwindow* window, const Car& car)
 {
     float pad = TextRendering_LineHeight(window);
     char buffer[50];
@@ -1699,6 +2007,23 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
     float charwidth = TextRendering_CharWidth(window);
 
     TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-lineheight, 1.0f);
+
+    // Alocações no heap do quadro anterior; o esperado é zero
+    char allocations[32];
+    int allocchars = snprintf(allocations, sizeof(allocations), "%llu alloc/frame", (unsigned long long)g_FrameAllocations);
+    TextRendering_PrintString(window, allocations, 1.0f-(allocchars + 1)*charwidth, 1.0f-2*lineheight, 1.0f);
+}
+
+// Escrevemos na tela a latência do último evento de teclado até a troca de
+// buffers do quadro que o mostrou (veja g_InputLatency)
+void TextRendering_ShowInputLatency(GLFWwindow* window, double latency_us)
+{
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    char buffer[32];
+    int numchars = snprintf(buffer, sizeof(buffer), "%.0f us input", latency_us);
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-3*lineheight, 1.0f);
 }
 
 // Função para debugging: imprime no terminal todas informações de um modelo
@@ -1904,401 +2229,223 @@ void DrawAxes(const glm::mat4& model)
     glGenVertexArrays(1, &vao);
     glGenBuffers(2, vbo);
 
-    glBindVertexArray(vao);
+    GlState_BindVertexArray(vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, vbo[0]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, vbo[1]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(1);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
     // Draw the axes
-    glBindVertexArray(vao);
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
+    GlState_UniformMatrix4fv(g_model_uniform, glm::value_ptr(model));
     glLineWidth(3.0f); // Increase the line width
     glDrawArrays(GL_LINES, 0, 6);
-    glBindVertexArray(0);
 
     // Cleanup
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(2, vbo);
+    GlState_DeleteVertexArray(vao);
+    GlState_DeleteBuffer(vbo[0]);
+    GlState_DeleteBuffer(vbo[1]);
 }
 
-void DrawCar()
+void DrawCar(const Car& car, float alpha)
 {
     glm::mat4 model = Matrix_Translate(car.carPosition.x, car.carPosition.y, car.carPosition.z)
                     * Matrix_Rotate_Y(car.rotation_angle)
                     * Matrix_Rotate_Y(-PI/2)
                     * Matrix_Rotate_X(-PI/2);
 
-    std::vector<ObjectConfig> car_objects = {
-        {CAR_HOOD, "hood", 0}, // X
+    static const ObjectConfig car_objects[] = {
+        {CAR_HOOD, "hood", 0, -1}, // X
         
-        {CAR_METALIC, "back_toyota_logo", 99},
-        {CAR_METALIC, "front_toyota_logo", 99},
-        {CAR_METALIC, "exhaust", 5},
-        {CAR_METALIC, "license_plate", 2},
+        {CAR_METALIC, "back_toyota_logo", 99, -1},
+        {CAR_METALIC, "front_toyota_logo", 99, -1},
+        {CAR_METALIC, "exhaust", 5, -1},
+        {CAR_METALIC, "license_plate", 2, -1},
         
-        {CAR_GLASS, "front_window", 0},
-        {CAR_GLASS, "side_smaller_window", 1},
-        {CAR_GLASS, "side_window", 1},
-        {CAR_GLASS, "tail_window", 0},
-        {CAR_GLASS, "front_light_glass", 2},
-        {CAR_GLASS, "tail_lights_glass", 2},
-
-        {CAR_PAINTING, "body", 3},
-        {CAR_PAINTING, "door", 1},
-        {CAR_PAINTING, "front_bumper", 0},
-        {CAR_PAINTING, "front_fender", 0},
-        {CAR_PAINTING, "side_panel", 0},
-        {CAR_PAINTING, "trunk", 0},
-        {CAR_PAINTING, "mirrors", 0},
-        {CAR_PAINTING, "Wing", 0},
-
-        {CAR_PAINTING, "front_window_frame", 0},
-        {CAR_PAINTING, "side_smaller_window_frame", 0},
-        {CAR_PAINTING, "side_window_frame", 0},
-        {CAR_PAINTING, "tail_window_frame", 0},
-
-        {CAR_NOT_PAINTED_PARTS, "Bottom_panel", 0},
-        {CAR_NOT_PAINTED_PARTS, "front_skirts", 0},
-        {CAR_NOT_PAINTED_PARTS, "tank", 3},
-        {CAR_NOT_PAINTED_PARTS, "Bottom_panel", 0},
-        {CAR_NOT_PAINTED_PARTS, "Bottom_panel.001", 0},
-        {CAR_NOT_PAINTED_PARTS, "side_skirts", 0},
-        {CAR_NOT_PAINTED_PARTS, "cooler_holes", 0},
+        {CAR_GLASS, "front_window", 0, -1},
+        {CAR_GLASS, "side_smaller_window", 1, -1},
+        {CAR_GLASS, "side_window", 1, -1},
+        {CAR_GLASS, "tail_window", 0, -1},
+        {CAR_GLASS, "front_light_glass", 2, -1},
+        {CAR_GLASS, "tail_lights_glass", 2, -1},
+
+        {CAR_PAINTING, "body", 3, -1},
+        {CAR_PAINTING, "door", 1, -1},
+        {CAR_PAINTING, "front_bumper", 0, -1},
+        {CAR_PAINTING, "front_fender", 0, -1},
+        {CAR_PAINTING, "side_panel", 0, -1},
+        {CAR_PAINTING, "trunk", 0, -1},
+        {CAR_PAINTING, "mirrors", 0, -1},
+        {CAR_PAINTING, "Wing", 0, -1},
+
+        {CAR_PAINTING, "front_window_frame", 0, -1},
+        {CAR_PAINTING, "side_smaller_window_frame", 0, -1},
+        {CAR_PAINTING, "side_window_frame", 0, -1},
+        {CAR_PAINTING, "tail_window_frame", 0, -1},
+
+        {CAR_NOT_PAINTED_PARTS, "Bottom_panel", 0, -1},
+        {CAR_NOT_PAINTED_PARTS, "front_skirts", 0, -1},
+        {CAR_NOT_PAINTED_PARTS, "tank", 3, -1},
+        {CAR_NOT_PAINTED_PARTS, "Bottom_panel", 0, -1},
+        {CAR_NOT_PAINTED_PARTS, "Bottom_panel.001", 0, -1},
+        {CAR_NOT_PAINTED_PARTS, "side_skirts", 0, -1},
+        {CAR_NOT_PAINTED_PARTS, "cooler_holes", 0, -1},
         
-        {CAR_WHEEL, "wheel_front_left", 3},
-        {CAR_WHEEL, "wheel_back_left", 3},
-        {CAR_WHEEL, "wheel_front_right", 3},
-        {CAR_WHEEL, "wheel_back_right", 3}
+        {CAR_WHEEL, "wheel_front_left", 3, 0},
+        {CAR_WHEEL, "wheel_back_left", 3, 1},
+        {CAR_WHEEL, "wheel_front_right", 3, 2},
+        {CAR_WHEEL, "wheel_back_right", 3, 3}
+    };
+    const size_t num_car_objects = sizeof(car_objects) / sizeof(car_objects[0]);
+
+    // Os objetos são procurados em g_VirtualScene uma única vez; os ponteiros
+    // continuam válidos porque a cena não muda depois de carregada.
+    static const SceneObject* scene_objects[num_car_objects] = { NULL };
+    if (scene_objects[0] == NULL)
+        for (size_t i = 0; i < num_car_objects; ++i)
+            scene_objects[i] = &FindVirtualObject(car_objects[i].object_name);
+
+    const glm::mat4* wheel_transforms[4] = {
+        &car.frontLeftWheelTransform,
+        &car.rearLeftWheelTransform,
+        &car.frontRightWheelTransform,
+        &car.rearRightWheelTransform
     };
 
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    for (const auto& obj : car_objects) {
-        glUniform1i(g_object_id_uniform, obj.object_id);
-        glUniform1i(g_uv_mapping_type_uniform, obj.uv_mapping_type);
+    GlState_Uniform1f(g_alpha_uniform, alpha);
+    GlState_UniformMatrix4fv(g_model_uniform, glm::value_ptr(model));
+    for (size_t i = 0; i < num_car_objects; ++i) {
+        const ObjectConfig& obj = car_objects[i];
+        GlState_Uniform1i(g_object_id_uniform, obj.object_id);
+        GlState_Uniform1i(g_uv_mapping_type_uniform, obj.uv_mapping_type);
 
-        if (obj.object_name == "wheel_front_left") {
-            glm::mat4 frontLeftWheelModel = model * car.frontLeftWheelTransform;
-            DrawWheelsWithTransform(obj.object_name.c_str(), frontLeftWheelModel);
-        }
-        else if (obj.object_name == "wheel_front_right") {
-            glm::mat4 frontRightWheelModel = model * car.frontRightWheelTransform;
-            DrawWheelsWithTransform(obj.object_name.c_str(), frontRightWheelModel);
-        }
-        else if (obj.object_name == "wheel_back_left") {
-            glm::mat4 rearLeftWheelModel = model * car.rearLeftWheelTransform;
-            DrawWheelsWithTransform(obj.object_name.c_str(), rearLeftWheelModel);
-        }
-        else if (obj.object_name == "wheel_back_right") {
-            glm::mat4 rearRightWheelModel = model * car.rearRightWheelTransform;
-            DrawWheelsWithTransform(obj.object_name.c_str(), rearRightWheelModel);
-        }
+        if (obj.wheel >= 0)
+            DrawWheelsWithTransform(*scene_objects[i], model * *wheel_transforms[obj.wheel]);
         else
-            DrawVirtualObject(obj.object_name.c_str());
+            DrawVirtualObject(*scene_objects[i]);
 
         if (g_Show_BBOX)
-            DrawBoundingBox(obj.object_name.c_str());
+            DrawBoundingBox(obj.object_name);
     }
+    GlState_Uniform1f(g_alpha_uniform, 1.0f);
 }
-void DrawOutdoors() 
+
+// Desenha os carros da frota de IA, reaproveitando a geometria do jogador
+void DrawOpponents(const std::vector<CarPose>& opponents)
 {
-    // outdoor main
-    glm::mat4 model = Matrix_Translate(0.0f, 5.0f, -30.0f)
-        * Matrix_Scale(2.5f, 2.5f, 2.5f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, OUTDOOR_FACE);
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_face");
-    glUniform1i(g_object_id_uniform, OUTDOOR_POST);
-    glUniform1i(g_uv_mapping_type_uniform, 3);
-    DrawVirtualObject("outdoor_post1");
-    DrawVirtualObject("outdoor_post2");
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_back");
-
-    // outros outdoors
-    model = Matrix_Translate(30.0f, 0.7f, -100.0f) * Matrix_Scale(0.7f, 0.7f, 0.7f);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, OUTDOOR_FACE);
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_face");
-    glUniform1i(g_object_id_uniform, OUTDOOR_POST);
-    glUniform1i(g_uv_mapping_type_uniform, 3);
-    DrawVirtualObject("outdoor_post1");
-    DrawVirtualObject("outdoor_post2");
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_back");
-
-    model = Matrix_Translate(22.0f, 0.7f, -44.0f) * Matrix_Scale(0.7f, 0.7f, 0.7f) * Matrix_Rotate_Y(PI/2);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, OUTDOOR_FACE);
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_face");
-    glUniform1i(g_object_id_uniform, OUTDOOR_POST);
-    glUniform1i(g_uv_mapping_type_uniform, 3);
-    DrawVirtualObject("outdoor_post1");
-    DrawVirtualObject("outdoor_post2");
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_back");
-
-    model = Matrix_Translate(-0.0f, 0.7f, 55.0f) * Matrix_Scale(0.7f, 0.7f, 0.7f) * Matrix_Rotate_Y(3*PI/4);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, OUTDOOR_FACE);
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_face");
-    glUniform1i(g_object_id_uniform, OUTDOOR_POST);
-    glUniform1i(g_uv_mapping_type_uniform, 3);
-    DrawVirtualObject("outdoor_post1");
-    DrawVirtualObject("outdoor_post2");
-    glUniform1i(g_uv_mapping_type_uniform, 0);
-    DrawVirtualObject("outdoor_back");
+    for (size_t i = 0; i < opponents.size(); ++i)
+    {
+        Car opponent;
+        opponent.carPosition          = opponents[i].position;
+        opponent.rotation_angle       = opponents[i].rotation_angle;
+        opponent.front_wheel_angle    = opponents[i].front_wheel_angle;
+        opponent.wheel_rotation_angle = opponents[i].wheel_rotation_angle;
+        UpdateWheelsTransforms(opponent);
+        DrawCar(opponent);
+    }
 }
 
-void DrawBonus()
+// Desenha os fantasmas na pose correspondente ao tempo da volta atual do
+// jogador, para que os dois carros larguem juntos.
+void DrawGhosts(double lap_time)
 {
-    glm::mat4 model = Matrix_Identity();
-
-    for (const auto& bonus : bonusObjects) {
-        if (bonus.active) {
-            model = Matrix_Translate(bonus.currentPostion.x, bonus.currentPostion.y, bonus.currentPostion.z)
-                    * Matrix_Scale(0.6f, 0.6f, 0.6f);
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BONUS);
-            glUniform1i(g_uv_mapping_type_uniform, 0);
-            DrawVirtualObject("the_bonus");
-            
-            if (g_Show_BBOX)
-                DrawBoundingBox("the_bonus");
-        }
+    if (g_Ghosts.empty())
+        return;
+
+    GlState_Enable(GL_BLEND);
+    GlState_BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GlState_DepthMask(GL_FALSE);
+
+    for (size_t i = 0; i < g_Ghosts.size(); ++i)
+    {
+        GhostPose pose;
+        Ghost_Sample(g_Ghosts[i], (float)lap_time, &pose);
+
+        Car ghost;
+        ghost.carPosition          = pose.position;
+        ghost.rotation_angle       = pose.rotation_angle;
+        ghost.front_wheel_angle    = pose.front_wheel_angle;
+        ghost.wheel_rotation_angle = pose.wheel_rotation_angle;
+        UpdateWheelsTransforms(ghost);
+        DrawCar(ghost, 0.35f);
     }
 }
-
-void DrawTrees()
+void DrawScene(const std::vector<Renderable>& renderables)
 {
-    glm::mat4 model = Matrix_Identity();
-
-    std::vector<glm::vec3> tree_positions = {
-        glm::vec3(6.0f,-1.0f,-8.0f), 
-        glm::vec3(-6.0f,-1.0f,-8.0f),
-        glm::vec3(78.0f, -1.0f, -74.0f),
-        glm::vec3(96.0f, -1.0f, -74.0f),
-        glm::vec3(17.0f, -1.0f, -70.0f),
-        glm::vec3(41.0f, -1.0f, -42.0f),
-        glm::vec3(47.0f, -1.0f, -4.0f),
-        glm::vec3(39.0f, -1.0f, 31.0f),
-        glm::vec3(10.0f, -1.0f, 35.0f),
+    // Partes de cada malha, na ordem de RenderMesh
+    static const ObjectConfig tree_parts[] = {
+        {TREE_BODY, "tree_body", 5, -1},
+        {TREE_LEAVES, "tree_leaves", 5, -1}
+    };
+    static const ObjectConfig outdoor_parts[] = {
+        {OUTDOOR_FACE, "outdoor_face", 0, -1},
+        {OUTDOOR_POST, "outdoor_post1", 3, -1},
+        {OUTDOOR_POST, "outdoor_post2", 3, -1},
+        {OUTDOOR_POST, "outdoor_back", 0, -1}
+    };
+    static const ObjectConfig finish_line_parts[] = {
+        {FINISH_LINE, "finish_line", 1, -1}
     };
-    for (const auto& pos : tree_positions) {
-        model = Matrix_Translate(pos.x, pos.y, pos.z);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, TREE_BODY);
-        glUniform1i(g_uv_mapping_type_uniform, 5);
-        DrawVirtualObject("tree_body");
-        glUniform1i(g_object_id_uniform, TREE_LEAVES);
-        glUniform1i(g_uv_mapping_type_uniform, 5);
-        DrawVirtualObject("tree_leaves");
-
-        if (g_Show_BBOX) {
-            DrawBoundingBox("tree_body");
+    static const ObjectConfig bonus_parts[] = {
+        {BONUS, "the_bonus", 0, -1}
+    };
+    static const ObjectConfig* const parts[MESH_COUNT] = { tree_parts, outdoor_parts, finish_line_parts, bonus_parts };
+    static const int num_parts[MESH_COUNT] = { 2, 4, 1, 1 };
+
+    // Caixa mostrada com g_Show_BBOX, ou NULL
+    static const char* const bbox_names[MESH_COUNT] = { "tree_body", NULL, NULL, "the_bonus" };
+
+    // Os objetos são procurados em g_VirtualScene uma única vez (veja DrawCar())
+    static const SceneObject* scene_objects[MESH_COUNT][4] = { { NULL } };
+    if (scene_objects[0][0] == NULL)
+        for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+            for (int p = 0; p < num_parts[mesh]; ++p)
+                scene_objects[mesh][p] = &FindVirtualObject(parts[mesh][p].object_name);
+
+    // As matrizes de modelo foram calculadas pela simulação, para todas as
+    // entidades de uma vez (veja Simulation_UpdateScene() e CaptureRenderState())
+    for (size_t i = 0; i < renderables.size(); ++i) {
+        const Renderable& renderable = renderables[i];
+
+        GlState_UniformMatrix4fv(g_model_uniform, glm::value_ptr(renderable.model));
+        for (int p = 0; p < num_parts[renderable.mesh]; ++p) {
+            GlState_Uniform1i(g_object_id_uniform, parts[renderable.mesh][p].object_id);
+            GlState_Uniform1i(g_uv_mapping_type_uniform, parts[renderable.mesh][p].uv_mapping_type);
+            DrawVirtualObject(*scene_objects[renderable.mesh][p]);
         }
+
+        if (g_Show_BBOX && bbox_names[renderable.mesh] != NULL)
+            DrawBoundingBox(bbox_names[renderable.mesh]);
     }
 }
 
-void DrawWheelsWithTransform(const char* object_name, glm::mat4 transform)
+void DrawWheelsWithTransform(const SceneObject& obj, glm::mat4 transform)
 {
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
+    glm::vec3 bbox_min = obj.bbox_min;
+    glm::vec3 bbox_max = obj.bbox_max;
+    GlState_Uniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
+    GlState_Uniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
     // if (g_Show_BBOX == true) 
     //     DrawBoundingBox(bbox_min, bbox_max);
         
-    SceneObject& obj = g_VirtualScene[object_name];
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(transform));
-    glUniform1i(g_object_id_uniform, CAR_WHEEL);
-    glBindVertexArray(obj.vertex_array_object_id);
-    glUniform1i(g_uv_mapping_type_uniform, 0);
+    GlState_UniformMatrix4fv(g_model_uniform, glm::value_ptr(transform));
+    GlState_Uniform1i(g_object_id_uniform, CAR_WHEEL);
+    GlState_BindVertexArray(obj.vertex_array_object_id);
+    GlState_Uniform1i(g_uv_mapping_type_uniform, 0);
 
     glDrawElements(obj.rendering_mode, obj.num_indices, GL_UNSIGNED_INT, (void*)(obj.first_index * sizeof(GLuint)));
-    glBindVertexArray(0);
-}
-
-// Lógica para atualização da velocidade e posição do carro
-void UpdateCarSpeedAndPosition(Car &car, bool key_W_pressed, bool key_S_pressed, bool key_A_pressed, bool key_D_pressed, float deltaTime)
-{
-    const float epsilon = 0.1f;
-    const float drift_factor = 0.99f; // Intensidade do drift (quanto maior, mais "ensaboado")
-    const float stability = 0.5f; // Fator de estabilização do drift
-
-    // Direção atual baseada na orientação do carro
-    glm::vec3 forward_direction = glm::normalize(glm::vec3(
-        -sin(car.rotation_angle), 
-        0.0f, 
-        -cos(car.rotation_angle)
-    ));
-
-    glm::vec3 right_direction = glm::normalize(crossproduct3(forward_direction, glm::vec3(0.0f, 1.0f, 0.0f)));
-
-    car.carDirection = forward_direction;
-
-    // Controle de aceleração
-    if (key_W_pressed)
-    {
-        if (car.acceleration < 0.0f) {
-            car.carAcceleration = glm::vec3(0.0f);
-        }
-        float speed_factor = 1.0f - (glm::length(car.carVelocity) / car.max_speed);
-        car.carAcceleration += forward_direction * car.acceleration_rate * speed_factor * deltaTime;
-        if (glm::length(car.carAcceleration) > car.max_acceleration)
-            car.carAcceleration = glm::normalize(car.carAcceleration) * car.max_acceleration;
-    }
-    else if (key_S_pressed)
-    {
-        if (car.acceleration > 0.0f) {
-            car.carAcceleration = glm::vec3(0.0f);
-        }
-        car.carAcceleration -= forward_direction * car.acceleration_rate * deltaTime;
-        if (glm::length(car.carAcceleration) > car.max_acceleration)
-            car.carAcceleration = -glm::normalize(car.carAcceleration) * car.max_acceleration;
-    }
-    else
-    {
-        if (glm::length(car.carVelocity) > epsilon)
-        {
-            car.carAcceleration = -glm::normalize(car.carVelocity) * car.deceleration_rate;
-        }
-        else
-        {
-            car.carAcceleration = glm::vec3(0.0f);
-            car.carVelocity = glm::vec3(0.0f);
-        }
-    }
-
-    // Atualiza a velocidade do carro com base na aceleração
-    car.carVelocity += car.carAcceleration * deltaTime;
-
-    // Limita a velocidade máxima
-    if (glm::length(car.carVelocity) > car.max_speed)
-        car.carVelocity = glm::normalize(car.carVelocity) * car.max_speed;
-
-    // Simulação de drift (deslizamento lateral)
-    glm::vec3 lateral_velocity = dotproduct3(car.carVelocity, right_direction) * right_direction;
-    glm::vec3 forward_velocity = dotproduct3(car.carVelocity, forward_direction) * forward_direction;
-
-    // Aplica o fator de drift e estabilidade
-    lateral_velocity *= drift_factor;
-    car.carVelocity = forward_velocity + lateral_velocity;
-
-    // Gradualmente reduz o deslizamento lateral para estabilizar o carro
-    car.carVelocity -= lateral_velocity * stability * deltaTime;
-
-    // Atualiza a rotação do carro (direção geral)
-    if (glm::length(car.carVelocity) > epsilon)
-    {
-        float rotation_angle = glm::tan(car.front_wheel_angle);
-        car.rotation_angle += rotation_angle * deltaTime;
-    }
-
-    // Atualiza a posição do carro
-    car.carPosition += car.carVelocity * deltaTime;
-
-    std::pair<glm::vec3, glm::vec3> bbox = ComputeCarAABB(car);
-    glm::vec3 bbox_min = bbox.first;
-    glm::vec3 bbox_max = bbox.second;
-    
-    // Verifica colisão com arvores
-    if(cube_cilinder_intersect_tree(bbox_min, bbox_max)){
-        car.carPosition -= car.carVelocity * deltaTime;
-        car.carVelocity = glm::vec3(0.0f);
-        resetCar(); 
-    }
-    
-    // Verifica colisão com outdoor
-    if(cube_cilinder_intersect_outdoor(bbox_min, bbox_max)){
-        car.carPosition -= car.carVelocity * deltaTime;
-        car.carVelocity = glm::vec3(0.0f); 
-        resetCar();
-    }
-
-    // Verifica colisão com bonus
-    for(int i=0; i<5; i++){
-        if(cube_sphere_intersect_bonus(bbox_min, bbox_max, bonusObjects[i].currentPostion) && bonusObjects[i].active){   
-            car.pontuation_multiplier += 0.1;
-            bonusObjects[i].active = false;
-        }
-    }
-    
-    if((glfwGetTime() - last_bonus) > TIMEOUT_FINISH_LINE){
-        can_receive_finish_line = true;
-    }
-
-    // Verifica colisão com linha de chegada
-    if(point_cube_intersect(car.carPosition, finish_line_min, finish_line_max) && can_receive_finish_line){
-        car.pontuation += 1000;
-        can_receive_finish_line = false;
-        last_bonus = glfwGetTime();
-        for (auto& bonus : bonusObjects) {
-            bonus.active = true;
-        }    
-    }
-
-    // Atualiza valores escalares
-    car.speed = glm::length(car.carVelocity);
-    car.acceleration = glm::length(car.carAcceleration);
-    car.acceleration = (dotproduct3(car.carAcceleration, forward_direction) < 0) ? -car.acceleration : car.acceleration;
+    PROFILE_COUNT("chamadas de desenho", 1);
 }
 
-void UpdateFrontWheelsAngle(Car &car, bool key_A_pressed, bool key_D_pressed, float deltaTime) 
-{
-    float turn_speed = glm::radians(200.0f); // Velocidade de ajuste das rodas
-    float return_speed = glm::radians(100.0f); // Velocidade de retorno ao neutro
 
-    if (key_A_pressed)
-    {
-        car.front_wheel_angle += turn_speed * deltaTime;
-        if (car.front_wheel_angle > car.max_front_wheel_angle)
-            car.front_wheel_angle = car.max_front_wheel_angle;
-    }
-    else if (key_D_pressed)
-    {
-        car.front_wheel_angle -= turn_speed * deltaTime;
-        if (car.front_wheel_angle < -car.max_front_wheel_angle)
-            car.front_wheel_angle = -car.max_front_wheel_angle;
-    }
-    else
-    {
-        if (car.front_wheel_angle > 0.0f)
-        {
-            car.front_wheel_angle -= return_speed * deltaTime;
-            if (car.front_wheel_angle < 0.0f)
-                car.front_wheel_angle = 0.0f;
-        }
-        else if (car.front_wheel_angle < 0.0f)
-        {
-            car.front_wheel_angle += return_speed * deltaTime;
-            if (car.front_wheel_angle > 0.0f)
-                car.front_wheel_angle = 0.0f;
-        }
-    }
-}
 
-void UpdateWheelsTransforms(Car &car, float deltaTime) 
+void UpdateWheelsTransforms(Car &car)
 {
-    // Calcula a rotação das rodas com base na distância percorrida
-    float rotation_direction = (dotproduct3(car.carVelocity, glm::vec3(0.0f, 0.0f, -1.0f)) < 0) ? 1.0f : -1.0f;
-    float distance = rotation_direction * car.speed * deltaTime;
-    float wheel_radius = 0.4f;
-    car.wheel_rotation_angle += distance / wheel_radius;
-
     // Atualiza as matrizes de transformação das 4 rodas
     car.frontLeftWheelTransform = Matrix_Translate(
                                     car.frontLeftWheelPosition.x, 
@@ -2348,120 +2495,4 @@ void UpdateWheelsTransforms(Car &car, float deltaTime)
                             -car.rearLeftWheelPosition.y,
                             -car.rearLeftWheelPosition.z);
     
-}
-
-void UpdatePontuation(Car &car, float deltaTime)
-{
-    // Atualiza a pontuação do carro baseada na velocidade e só aumenta quando o carro fizer curvas
-    float abs_wheel_angle = glm::abs(car.front_wheel_angle);
-    if (abs_wheel_angle > 0.3f)
-    {
-        car.pontuation += abs_wheel_angle * 50 * car.speed * deltaTime * car.pontuation_multiplier;
-    }
-}
-
-std::pair<glm::vec3, glm::vec3> ComputeCarAABB(const Car& car) {
-    // 1. Define the local (unrotated) bounding box corners relative to the car's center
-    float halfWidth  = 0.64f;
-
-    // Local space corners
-    std::vector<glm::vec3> localCorners = {
-        // Bottom face
-        glm::vec3(-halfWidth, 0.0f, -1.8f),
-        glm::vec3( halfWidth, 0.0f, -1.8f),
-        glm::vec3( halfWidth, 0.0f,  1.3f),
-        glm::vec3(-halfWidth, 0.0f,  1.3f),
-        // Top face
-        glm::vec3(-halfWidth,  0.8f, -1.8f),
-        glm::vec3( halfWidth,  0.8f, -1.8f),
-        glm::vec3( halfWidth,  0.8f,  1.3f),
-        glm::vec3(-halfWidth,  0.8f,  1.3f)
-    };
-
-    // 2. Create the rotation matrix (assuming rotation around the Y-axis)
-    glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), car.rotation_angle, glm::vec3(0.0f, 1.0f, 0.0f));
-
-    // 3. Initialize min and max points with extreme values
-    glm::vec3 aabb_min(std::numeric_limits<float>::max());
-    glm::vec3 aabb_max(std::numeric_limits<float>::lowest());
-
-    // 4. Transform each corner and update the AABB
-    for (const auto& corner : localCorners) {
-        // Apply rotation
-        glm::vec4 rotatedCorner = rotationMatrix * glm::vec4(corner, 1.0f);
-
-        // Apply translation to world space
-        glm::vec3 worldCorner = glm::vec3(rotatedCorner) + car.carPosition;
-
-        // Update AABB min
-        aabb_min.x = std::min(aabb_min.x, worldCorner.x);
-        aabb_min.y = std::min(aabb_min.y, worldCorner.y);
-        aabb_min.z = std::min(aabb_min.z, worldCorner.z);
-
-        // Update AABB max
-        aabb_max.x = std::max(aabb_max.x, worldCorner.x);
-        aabb_max.y = std::max(aabb_max.y, worldCorner.y);
-        aabb_max.z = std::max(aabb_max.z, worldCorner.z);
-    }
-
-    return { aabb_min, aabb_max };
-}
-
-void resetCar(){
-    car.carPosition = glm::vec3(0.0f, -0.95f, 0.0f);
-    car.carVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
-    car.carAcceleration = glm::vec3(0.0f, 0.0f, 0.0f);
-    car.speed = 0.0f;
-    car.acceleration = 0.0f;
-    car.wheel_rotation_angle = 0.0f;
-    car.rotation_angle = 0.0f;
-    car.front_wheel_angle = 0.0f;
-    car.pontuation = 0;
-    car.pontuation_multiplier = 1;
-    for (auto& bonus : bonusObjects) {
-        bonus.active = true;
-    }
-}
-
-void InitializeBonusObjects() {
-
-    std::vector<glm::vec3> bonus_positions = {
-        glm::vec3(16.0f, -0.9f, -89.0f), // curva 1
-        glm::vec3(90.0f, -0.9f, -74.0f), // curva 2
-        glm::vec3(27.0f, -0.9f, -44.0f), // curva 3
-        glm::vec3(63.0f, -0.9f, -4.0f), // curva 4
-        glm::vec3(10.0f, -0.9f, 53.0f), // curva 5
-        // glm::vec3(0.0f, -0.9f, -2.0f) // posicao padrao
-    };
-
-    for(const auto& pos : bonus_positions) {
-        BezierCurve curve = {
-            pos, // p0: Start position
-            pos + glm::vec3(-1.0f, 0.0f, 0.3f),  // p1: Control point 1
-            pos + glm::vec3(1.0f, 0.0f, 0.3f),  // p2: Control point 2'1
-            pos   // p3: End position
-        };
-
-        // Create a BonusObject and add it to the vector
-        bonusObjects.emplace_back(pos, curve, 1.0f); // Adjust speed as needed
-    }
-}
-
-void UpdateBonusObjects(float deltaTime) {
-    for (auto& bonus : bonusObjects) {
-        if (bonus.active) {
-            bonus.t += bonus.speed * deltaTime; // Progress along the curve
-
-            if (bonus.t > 1.0f) {
-                bonus.t = 0.0f;
-            }
-
-            bonus.currentPostion = bonus.pathCurve.evaluate(bonus.t);
-
-            // Update the model matrix or position of the bonus object
-            // Assuming you have a function to update the object's position
-            // For example:
-            // UpdateBonusModelMatrix(bonusModel, newPosition);
-        }
-    }
 }
\ No newline at end of file
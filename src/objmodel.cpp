@@ -0,0 +1,191 @@
+#include "objmodel.h"
+
+#include <cassert>
+#include <limits>
+#include <algorithm>
+
+#include <glm/vec4.hpp>
+
+// Função que computa as normais de um ObjModel, caso elas não tenham sido
+// especificadas dentro do arquivo ".obj"
+void ComputeNormals(ObjModel* model)
+{
+    if ( !model->attrib.normals.empty() )
+        return;
+
+    // Primeiro computamos as normais para todos os TRIÂNGULOS.
+    // Segundo, computamos as normais dos VÉRTICES através do método proposto
+    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
+    // todas as faces que compartilham este vértice.
+
+    size_t num_vertices = model->attrib.vertices.size() / 3;
+
+    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
+    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+            glm::vec4  vertices[3];
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+                vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
+            }
+
+            const glm::vec4  a = vertices[0];
+            const glm::vec4  b = vertices[1];
+            const glm::vec4  c = vertices[2];
+
+            // PREENCHA AQUI o cálculo da normal de um triângulo cujos vértices
+            // estão nos pontos "a", "b", e "c", definidos no sentido anti-horário.
+            glm::vec3 edge1 = glm::vec3(b - a);
+            glm::vec3 edge2 = glm::vec3(c - a);
+            glm::vec3 normal = glm::normalize(glm::cross(edge1, edge2));
+            const glm::vec4  n = glm::vec4(normal, 0.0f);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                num_triangles_per_vertex[idx.vertex_index] += 1;
+                vertex_normals[idx.vertex_index] += n;
+                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
+            }
+        }
+    }
+
+    model->attrib.normals.resize( 3*num_vertices );
+
+    for (size_t i = 0; i < vertex_normals.size(); ++i)
+    {
+        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
+        n /= glm::length(n); // n.w == 0
+        model->attrib.normals[3*i + 0] = n.x;
+        model->attrib.normals[3*i + 1] = n.y;
+        model->attrib.normals[3*i + 2] = n.z;
+    }
+}
+
+void AddObjModelTrianglesToList(ObjModel* model, const char* object_name, glm::mat4 transform, std::vector<glm::vec3>& triangles)
+{
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        if (model->shapes[shape].name != object_name)
+            continue;
+
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+                triangles.push_back(glm::vec3(transform * glm::vec4(vx, vy, vz, 1.0f)));
+            }
+        }
+    }
+}
+
+// Vértices e índices dos triângulos de todos os objetos do modelo, um vértice
+// por canto de cada triângulo
+void BuildTriangleMesh(const ObjModel* model, TriangleMesh& mesh)
+{
+    mesh.indices.clear();
+    mesh.model_coefficients.clear();
+    mesh.normal_coefficients.clear();
+    mesh.texture_coefficients.clear();
+    mesh.objects.clear();
+
+    size_t num_vertices = 0;
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+        num_vertices += model->shapes[shape].mesh.indices.size();
+    mesh.indices.reserve(num_vertices);
+    mesh.model_coefficients.reserve(4 * num_vertices);
+    mesh.objects.reserve(model->shapes.size());
+
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        size_t first_index = mesh.indices.size();
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+
+        const float minval = std::numeric_limits<float>::min();
+        const float maxval = std::numeric_limits<float>::max();
+
+        glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
+        glm::vec3 bbox_max = glm::vec3(minval,minval,minval);
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+
+                mesh.indices.push_back(first_index + 3*triangle + vertex);
+
+                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+                //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
+                mesh.model_coefficients.push_back( vx ); // X
+                mesh.model_coefficients.push_back( vy ); // Y
+                mesh.model_coefficients.push_back( vz ); // Z
+                mesh.model_coefficients.push_back( 1.0f ); // W
+
+                bbox_min.x = std::min(bbox_min.x, vx);
+                bbox_min.y = std::min(bbox_min.y, vy);
+                bbox_min.z = std::min(bbox_min.z, vz);
+                bbox_max.x = std::max(bbox_max.x, vx);
+                bbox_max.y = std::max(bbox_max.y, vy);
+                bbox_max.z = std::max(bbox_max.z, vz);
+
+                // Inspecionando o código da tinyobjloader, o aluno Bernardo
+                // Sulzbach (2017/1) apontou que a maneira correta de testar se
+                // existem normais e coordenadas de textura no ObjModel é
+                // comparando se o índice retornado é -1. Fazemos isso abaixo.
+
+                if ( idx.normal_index != -1 )
+                {
+                    const float nx = model->attrib.normals[3*idx.normal_index + 0];
+                    const float ny = model->attrib.normals[3*idx.normal_index + 1];
+                    const float nz = model->attrib.normals[3*idx.normal_index + 2];
+                    mesh.normal_coefficients.push_back( nx ); // X
+                    mesh.normal_coefficients.push_back( ny ); // Y
+                    mesh.normal_coefficients.push_back( nz ); // Z
+                    mesh.normal_coefficients.push_back( 0.0f ); // W
+                }
+
+                if ( idx.texcoord_index != -1 )
+                {
+                    const float u = model->attrib.texcoords[2*idx.texcoord_index + 0];
+                    const float v = model->attrib.texcoords[2*idx.texcoord_index + 1];
+                    mesh.texture_coefficients.push_back( u );
+                    mesh.texture_coefficients.push_back( v );
+                }
+            }
+        }
+
+        size_t last_index = mesh.indices.size() - 1;
+
+        TriangleMeshObject object;
+        object.name        = model->shapes[shape].name;
+        object.first_index = first_index; // Primeiro índice
+        object.num_indices = last_index - first_index + 1; // Número de indices
+        object.bbox_min    = bbox_min;
+        object.bbox_max    = bbox_max;
+        mesh.objects.push_back(object);
+    }
+}
@@ -0,0 +1,311 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "json.h"
+
+Profiler g_Profiler;
+thread_local uint16_t g_ProfileZone = PROFILER_NO_ZONE;
+
+namespace {
+
+thread_local ProfileThread* tls_thread = NULL;
+thread_local const char*    tls_name   = NULL;
+
+// Cria uma fila nova. Retorna NULL se já há PROFILER_MAX_THREADS filas.
+ProfileThread* AddThread(const char* name)
+{
+    std::lock_guard<std::mutex> lock(g_Profiler.registry);
+    int count = g_Profiler.thread_count.load();
+    if (count >= PROFILER_MAX_THREADS)
+        return NULL;
+
+    ProfileThread* thread = new ProfileThread;
+    thread->name = name;
+    g_Profiler.threads[count] = thread;
+    g_Profiler.thread_count.store(count + 1);
+    return thread;
+}
+
+// Fila da thread atual, criada na primeira medida
+ProfileThread* CurrentThread()
+{
+    if (tls_thread == NULL)
+        tls_thread = AddThread(tls_name);
+    return tls_thread;
+}
+
+} // namespace
+
+uint64_t Profiler_Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler_SetEnabled(bool enabled)
+{
+    g_Profiler.enabled = enabled;
+}
+
+uint16_t Profiler_RegisterZone(const char* name)
+{
+    std::lock_guard<std::mutex> lock(g_Profiler.registry);
+    int count = g_Profiler.zone_count.load();
+    for (int i = 0; i < count; ++i)
+        if (strcmp(g_Profiler.zone_names[i], name) == 0)
+            return (uint16_t)i;
+
+    // Sem espaço: as medidas vão para a última zona
+    if (count >= PROFILER_MAX_ZONES)
+        return PROFILER_MAX_ZONES - 1;
+
+    g_Profiler.zone_names[count] = name;
+    g_Profiler.zone_count.store(count + 1);
+    return (uint16_t)count;
+}
+
+uint16_t Profiler_RegisterCounter(const char* name)
+{
+    std::lock_guard<std::mutex> lock(g_Profiler.registry);
+    int count = g_Profiler.counter_count.load();
+    for (int i = 0; i < count; ++i)
+        if (strcmp(g_Profiler.counter_names[i], name) == 0)
+            return (uint16_t)i;
+
+    if (count >= PROFILER_MAX_COUNTERS)
+        return PROFILER_MAX_COUNTERS - 1;
+
+    g_Profiler.counter_names[count] = name;
+    g_Profiler.counter_count.store(count + 1);
+    return (uint16_t)count;
+}
+
+void Profiler_SetThreadName(const char* name)
+{
+    tls_name = name;
+    if (tls_thread != NULL)
+        tls_thread->name = name;
+}
+
+ProfileThread* Profiler_AddTrack(const char* name)
+{
+    return AddThread(name);
+}
+
+void Profiler_Record(uint16_t zone, uint64_t begin_ns, uint64_t end_ns)
+{
+    Profiler_RecordOn(CurrentThread(), zone, begin_ns, end_ns);
+}
+
+void Profiler_RecordOn(ProfileThread* track, uint16_t zone, uint64_t begin_ns, uint64_t end_ns)
+{
+    if (track == NULL)
+        return;
+
+    ProfileEvent event = { begin_ns, end_ns, zone };
+    if (!SpscQueue_Push(track->events, event))
+        track->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler_EndFrame()
+{
+    Profiler& profiler = g_Profiler;
+    uint64_t now = Profiler_Now();
+
+    // Zonas registradas durante o quadro também são zeradas
+    size_t slot = profiler.frames % PROFILER_HISTORY;
+    for (int z = 0; z < PROFILER_MAX_ZONES; ++z)
+    {
+        profiler.zone_ms[z][slot] = 0.0f;
+        profiler.zone_calls[z] = 0;
+    }
+
+    bool capturing = profiler.capture_remaining > 0;
+
+    int threads = profiler.thread_count.load();
+    for (int t = 0; t < threads; ++t)
+    {
+        ProfileEvent event;
+        while (SpscQueue_Pop(profiler.threads[t]->events, &event))
+        {
+            profiler.zone_ms[event.zone][slot] += (float)((event.end_ns - event.begin_ns) * 1e-6);
+            profiler.zone_calls[event.zone] += 1;
+
+            // Medidas que começaram antes da captura ficam de fora. Quando o
+            // espaço reservado acaba, as medidas são descartadas em vez de
+            // alocar no meio do quadro.
+            if (capturing && event.begin_ns >= profiler.capture_begin_ns)
+            {
+                ProfileCaptureEvent captured = { event, (uint8_t)t };
+                if (profiler.capture_events.size() < profiler.capture_events.capacity())
+                    profiler.capture_events.push_back(captured);
+                else
+                    profiler.capture_dropped += 1;
+            }
+        }
+    }
+
+    for (int c = 0; c < PROFILER_MAX_COUNTERS; ++c)
+        profiler.counter_values[c] = profiler.counters[c].exchange(0, std::memory_order_relaxed);
+
+    if (capturing)
+    {
+        ProfileCaptureFrame frame;
+        frame.begin_ns = std::max(profiler.frame_begin_ns, profiler.capture_begin_ns);
+        frame.end_ns = now;
+        memcpy(frame.counters, profiler.counter_values, sizeof(frame.counters));
+        profiler.capture_frames.push_back(frame);
+
+        profiler.capture_remaining -= 1;
+        if (profiler.capture_remaining == 0)
+        {
+            if (Profiler_WriteCapture(profiler.capture_filename))
+                printf("Trace de %d quadros salvo em \"%s\".\n", (int)profiler.capture_frames.size(), profiler.capture_filename);
+            if (profiler.capture_dropped > 0)
+                fprintf(stderr, "WARNING: Trace dropped %llu zone events (capture buffer full).\n",
+                        (unsigned long long)profiler.capture_dropped);
+            profiler.capture_events.clear();
+            profiler.capture_frames.clear();
+        }
+    }
+
+    // O primeiro quadro só marca o início do próximo
+    if (profiler.frame_begin_ns != 0)
+    {
+        profiler.frame_ms[slot] = (float)((now - profiler.frame_begin_ns) * 1e-6);
+        profiler.frames += 1;
+    }
+    profiler.frame_begin_ns = now;
+}
+
+bool Profiler_BeginCapture(const char* filename, int frames)
+{
+    Profiler& profiler = g_Profiler;
+    if (profiler.capture_remaining > 0 || frames <= 0)
+        return false;
+
+    // Reserva o espaço antes, para que a captura não aloque a cada quadro.
+    // Cada quadro tem ao menos uma medida de cada zona registrada, ou as
+    // medidas do último quadro se foram mais; o dobro disso deixa folga para
+    // quadros mais pesados.
+    size_t per_frame = (size_t)std::max(profiler.zone_count.load(), 1);
+    size_t last_frame = 0;
+    for (int z = 0; z < PROFILER_MAX_ZONES; ++z)
+        last_frame += profiler.zone_calls[z];
+    per_frame = 2 * std::max(per_frame, last_frame);
+    profiler.capture_events.reserve((size_t)frames * per_frame);
+    profiler.capture_frames.reserve((size_t)frames);
+
+    profiler.capture_filename = filename;
+    profiler.capture_remaining = frames;
+    profiler.capture_dropped = 0;
+    profiler.capture_begin_ns = Profiler_Now();
+    printf("Capturando %d quadros para \"%s\".\n", frames, filename);
+    return true;
+}
+
+// Os tempos do trace são em microssegundos desde o início da captura. Cada
+// thread do profiler é uma "tid" (a 0 mostra os quadros), e cada contador é
+// um gráfico próprio.
+bool Profiler_WriteCapture(const char* filename)
+{
+    const Profiler& profiler = g_Profiler;
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open trace file \"%s\" for writing.\n", filename);
+        return false;
+    }
+
+    const double origin = (double)profiler.capture_begin_ns;
+    const int pid = 1;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"trabalho-fcg\"}},\n", pid);
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"quadros\"}}", pid);
+
+    int threads = profiler.thread_count.load();
+    for (int t = 0; t < threads; ++t)
+    {
+        const char* name = profiler.threads[t]->name != NULL ? profiler.threads[t]->name : "thread";
+        char label[64];
+        snprintf(label, sizeof(label), "%s %d", name, t + 1);
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", pid, t + 1);
+        Json_WriteString(file, label);
+        fprintf(file, "}}");
+    }
+
+    int counters = profiler.counter_count.load();
+    for (size_t f = 0; f < profiler.capture_frames.size(); ++f)
+    {
+        const ProfileCaptureFrame& frame = profiler.capture_frames[f];
+        double begin_us = (frame.begin_ns - origin) * 1e-3;
+        fprintf(file, ",\n{\"name\":\"quadro %d\",\"ph\":\"X\",\"pid\":%d,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+                (int)f, pid, begin_us, (frame.end_ns - frame.begin_ns) * 1e-3);
+
+        for (int c = 0; c < counters; ++c)
+        {
+            fprintf(file, ",\n{\"name\":");
+            Json_WriteString(file, profiler.counter_names[c]);
+            fprintf(file, ",\"ph\":\"C\",\"pid\":%d,\"ts\":%.3f,\"args\":{\"valor\":%lld}}",
+                    pid, begin_us, (long long)frame.counters[c]);
+        }
+    }
+
+    for (size_t e = 0; e < profiler.capture_events.size(); ++e)
+    {
+        const ProfileCaptureEvent& captured = profiler.capture_events[e];
+        fprintf(file, ",\n{\"name\":");
+        Json_WriteString(file, profiler.zone_names[captured.event.zone]);
+        fprintf(file, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", pid, captured.thread + 1,
+                (captured.event.begin_ns - origin) * 1e-3, (captured.event.end_ns - captured.event.begin_ns) * 1e-3);
+    }
+
+    fprintf(file, "\n]}\n");
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    if (!ok)
+        fprintf(stderr, "ERROR: Failed writing trace file \"%s\".\n", filename);
+    return ok;
+}
+
+size_t Profiler_HistorySize()
+{
+    return (size_t)std::min<uint64_t>(g_Profiler.frames, PROFILER_HISTORY);
+}
+
+size_t Profiler_HistoryIndex(size_t i)
+{
+    return (size_t)((g_Profiler.frames - Profiler_HistorySize() + i) % PROFILER_HISTORY);
+}
+
+float Profiler_FramePercentile(float fraction)
+{
+    size_t count = Profiler_HistorySize();
+    if (count == 0)
+        return 0.0f;
+
+    float sorted[PROFILER_HISTORY];
+    for (size_t i = 0; i < count; ++i)
+        sorted[i] = g_Profiler.frame_ms[Profiler_HistoryIndex(i)];
+
+    size_t k = (size_t)(fraction * (count - 1) + 0.5f);
+    std::nth_element(sorted, sorted + k, sorted + count);
+    return sorted[k];
+}
+
+float Profiler_ZoneAverage(int zone)
+{
+    size_t count = Profiler_HistorySize();
+    if (count == 0)
+        return 0.0f;
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+        sum += g_Profiler.zone_ms[zone][Profiler_HistoryIndex(i)];
+    return sum / count;
+}
@@ -0,0 +1,163 @@
+// Painel do profiler (veja profiler.h): percentis do tempo de quadro, tempo
+// médio de cada zona, contadores do último quadro e um gráfico dos últimos
+// PROFILER_HISTORY quadros.
+// Mostrado com a tecla P.
+#include <cstdio>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "utils.h"
+#include "arena.h"
+#include "profiler.h"
+#include "glstate.h"
+#include "glstats.h"
+
+GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id); // Função definida em textrendering.cpp
+float TextRendering_LineHeight(GLFWwindow* window);
+float TextRendering_CharWidth(GLFWwindow* window);
+void TextRendering_PrintString(GLFWwindow* window, const char* str, float x, float y, float scale);
+extern FrameArena g_FrameArena; // Definida em main.cpp
+
+// Tamanho do texto formatado em "buffer": snprintf() retorna o tamanho que o
+// texto teria sem o truncamento
+int FormattedLength(int numchars, size_t buffer_size)
+{
+    if (numchars < 0)
+        return 0;
+    return numchars < (int)buffer_size ? numchars : (int)buffer_size - 1;
+}
+
+const GLchar* const overlayvertexshader_source = ""
+"#version 330\n"
+"layout (location = 0) in vec2 position;\n"
+"void main()\n"
+"{\n"
+    "gl_Position = vec4(position, 0, 1);\n"
+"}\n"
+"\0";
+
+const GLchar* const overlayfragmentshader_source = ""
+"#version 330\n"
+"uniform vec4 color;\n"
+"out vec4 fragColor;\n"
+"void main()\n"
+"{\n"
+    "fragColor = color;\n"
+"}\n"
+"\0";
+
+GLuint overlayVAO;
+GLuint overlayVBO;
+GLuint overlayprogram_id;
+GLint  overlaycolor_uniform;
+
+// Retângulo do gráfico, em NDC
+const float graph_left   = 0.35f;
+const float graph_right  = 0.98f;
+const float graph_bottom = -0.98f;
+const float graph_top    = -0.60f;
+
+void ProfilerOverlay_Init()
+{
+    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    TextRendering_LoadShader(overlayvertexshader_source, vertex_shader_id);
+    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    TextRendering_LoadShader(overlayfragmentshader_source, fragment_shader_id);
+    overlayprogram_id = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+    overlaycolor_uniform = glGetUniformLocation(overlayprogram_id, "color");
+    glCheckError();
+
+    glGenVertexArrays(1, &overlayVAO);
+    glGenBuffers(1, &overlayVBO);
+    GlState_BindVertexArray(overlayVAO);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    glBufferData(GL_ARRAY_BUFFER, (PROFILER_HISTORY + 4) * 2 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, 0);
+    GlState_BindVertexArray(0);
+    glCheckError();
+}
+
+// Desenha "count" vértices 2D como GL_LINE_STRIP ou GL_LINES
+void ProfilerOverlay_DrawLines(GLenum mode, const float* vertices, size_t count, float r, float g, float b)
+{
+    GlState_BindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * 2 * sizeof(float), vertices);
+    GlState_Uniform4f(overlaycolor_uniform, r, g, b, 1.0f);
+    glDrawArrays(mode, 0, (GLsizei)count);
+    PROFILE_COUNT("chamadas de desenho", 1);
+    PROFILE_COUNT("bytes enviados", count * 2 * sizeof(float));
+}
+
+void ProfilerOverlay_Draw(GLFWwindow* window)
+{
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    // Texto: percentis do tempo de quadro e tempo médio por zona, à direita,
+    // abaixo do fps
+    char buffer[64];
+    int numchars = snprintf(buffer, sizeof(buffer), "frame p50 %.1f p95 %.1f p99 %.1f ms",
+                            Profiler_FramePercentile(0.50f), Profiler_FramePercentile(0.95f),
+                            Profiler_FramePercentile(0.99f));
+    numchars = FormattedLength(numchars, sizeof(buffer));
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-5*lineheight, 1.0f);
+
+    int zones = g_Profiler.zone_count.load();
+    for (int z = 0; z < zones; ++z)
+    {
+        numchars = snprintf(buffer, sizeof(buffer), "%s %6.2f ms %4u x", g_Profiler.zone_names[z],
+                            Profiler_ZoneAverage(z), g_Profiler.zone_calls[z]);
+        numchars = FormattedLength(numchars, sizeof(buffer));
+        TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-(6 + z)*lineheight, 1.0f);
+    }
+
+    // Contadores do último quadro, abaixo das zonas
+    int counters = g_Profiler.counter_count.load();
+    for (int c = 0; c < counters; ++c)
+    {
+        numchars = snprintf(buffer, sizeof(buffer), "%s %lld", g_Profiler.counter_names[c],
+                            (long long)g_Profiler.counter_values[c]);
+        numchars = FormattedLength(numchars, sizeof(buffer));
+        TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-(7 + zones + c)*lineheight, 1.0f);
+    }
+
+    // Gráfico: a escala vertical cobre pelo menos 33 ms (dois quadros a 60 Hz)
+    size_t count = Profiler_HistorySize();
+    if (count < 2)
+        return;
+
+    float scale_ms = 33.3f;
+    for (size_t i = 0; i < count; ++i)
+        if (g_Profiler.frame_ms[i] > scale_ms)
+            scale_ms = g_Profiler.frame_ms[i];
+
+    float* vertices = Arena_New<float>(g_FrameArena, 2 * PROFILER_HISTORY);
+    if (vertices == NULL)
+        return;
+
+    GlState_Disable(GL_DEPTH_TEST);
+    GlState_UseProgram(overlayprogram_id);
+    GlState_BindVertexArray(overlayVAO);
+
+    // Moldura e a linha de 16.7 ms (60 Hz)
+    float reference = graph_bottom + (graph_top - graph_bottom) * (16.7f / scale_ms);
+    const float frame[] = {
+        graph_left,  graph_bottom, graph_right, graph_bottom,
+        graph_right, graph_top,    graph_left,  graph_top
+    };
+    const float line[] = { graph_left, reference, graph_right, reference };
+    ProfilerOverlay_DrawLines(GL_LINE_LOOP, frame, 4, 0.0f, 0.0f, 0.0f);
+    ProfilerOverlay_DrawLines(GL_LINES, line, 2, 0.8f, 0.0f, 0.0f);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        float ms = g_Profiler.frame_ms[Profiler_HistoryIndex(i)];
+        vertices[2*i + 0] = graph_left + (graph_right - graph_left) * i / (PROFILER_HISTORY - 1);
+        vertices[2*i + 1] = graph_bottom + (graph_top - graph_bottom) * (ms / scale_ms);
+    }
+    ProfilerOverlay_DrawLines(GL_LINE_STRIP, vertices, count, 0.0f, 0.0f, 0.0f);
+}
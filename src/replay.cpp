@@ -0,0 +1,239 @@
+#include "replay.h"
+
+#include <cstring>
+
+#include "simulation.h"
+
+#define REPLAY_MAGIC   0x594c5052u // "RPLY"
+#define REPLAY_VERSION 2u
+
+namespace {
+
+void WriteVarint(FILE* file, uint64_t value)
+{
+    uint8_t bytes[10];
+    int n = 0;
+    do
+    {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes[n++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    fwrite(bytes, 1, n, file);
+}
+
+bool ReadVarint(const ReplayPlayer& player, size_t& offset, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && offset < player.data.size(); shift += 7)
+    {
+        uint8_t byte = player.data[offset++];
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+void FlushRun(ReplayRecorder& recorder)
+{
+    if (recorder.run == 0)
+        return;
+    fputc(recorder.input, recorder.file);
+    WriteVarint(recorder.file, recorder.run);
+    recorder.run = 0;
+}
+
+} // namespace
+
+bool Replay_BeginRecording(ReplayRecorder& recorder, const char* filename, int opponents, int bonuses)
+{
+    recorder.file  = fopen(filename, "wb");
+    recorder.input = 0;
+    recorder.run   = 0;
+    recorder.steps = 0;
+    if (recorder.file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open replay file \"%s\" for writing.\n", filename);
+        return false;
+    }
+
+    ReplayHeader header;
+    header.magic             = REPLAY_MAGIC;
+    header.version           = REPLAY_VERSION;
+    header.timestep          = SIMULATION_TIMESTEP;
+    header.checksum_interval = REPLAY_CHECKSUM_INTERVAL;
+    header.opponents         = opponents;
+    header.bonuses           = bonuses;
+    fwrite(&header, sizeof(header), 1, recorder.file);
+
+    printf("Gravando replay em \"%s\".\n", filename);
+    return true;
+}
+
+void Replay_RecordStep(ReplayRecorder& recorder, uint8_t input)
+{
+    if (recorder.file == NULL)
+        return;
+
+    input &= INPUT_MASK;
+    if (input != recorder.input)
+    {
+        FlushRun(recorder);
+        recorder.input = input;
+    }
+    ++recorder.run;
+    ++recorder.steps;
+
+    if (recorder.steps % REPLAY_CHECKSUM_INTERVAL == 0)
+    {
+        // O trecho atual é gravado antes do checksum, para que a ordem dos
+        // registros no arquivo seja a mesma dos passos.
+        FlushRun(recorder);
+        uint32_t checksum = Simulation_Checksum();
+        fputc(REPLAY_CHECKSUM_TAG, recorder.file);
+        WriteVarint(recorder.file, recorder.steps);
+        fwrite(&checksum, sizeof(checksum), 1, recorder.file);
+        fflush(recorder.file);
+    }
+}
+
+void Replay_EndRecording(ReplayRecorder& recorder)
+{
+    if (recorder.file == NULL)
+        return;
+
+    FlushRun(recorder);
+    long size = ftell(recorder.file);
+    fclose(recorder.file);
+    recorder.file = NULL;
+    printf("Replay gravado: %llu passos, %ld bytes.\n", (unsigned long long)recorder.steps, size);
+}
+
+bool Replay_Load(ReplayPlayer& player, const char* filename)
+{
+    player.data.clear();
+    player.offset    = sizeof(ReplayHeader);
+    player.input     = 0;
+    player.remaining = 0;
+    player.steps     = 0;
+    player.checksums = 0;
+    player.desync    = false;
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open replay file \"%s\".\n", filename);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size > 0)
+    {
+        player.data.resize(size);
+        if (fread(player.data.data(), 1, size, file) != (size_t)size)
+            player.data.clear();
+    }
+    fclose(file);
+
+    ReplayHeader header;
+    if (player.data.size() < sizeof(header))
+    {
+        fprintf(stderr, "ERROR: Replay file \"%s\" is truncated.\n", filename);
+        return false;
+    }
+    memcpy(&header, player.data.data(), sizeof(header));
+    player.header = header;
+    if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION)
+    {
+        fprintf(stderr, "ERROR: \"%s\" is not a replay file.\n", filename);
+        return false;
+    }
+    if (header.timestep != SIMULATION_TIMESTEP)
+    {
+        fprintf(stderr, "ERROR: Replay \"%s\" was recorded with a timestep of %f s.\n", filename, header.timestep);
+        return false;
+    }
+
+    printf("Reproduzindo replay \"%s\" (%d bytes).\n", filename, (int)player.data.size());
+    return true;
+}
+
+bool Replay_ApplySetup(const ReplayPlayer& player, int* opponents, int* bonuses)
+{
+    if ((*opponents >= 0 && *opponents != player.header.opponents) ||
+        (*bonuses >= 0 && *bonuses != player.header.bonuses))
+    {
+        fprintf(stderr, "ERROR: The replay was recorded with --opponents %d --bonuses %d.\n",
+                player.header.opponents, player.header.bonuses);
+        return false;
+    }
+    *opponents = player.header.opponents;
+    *bonuses   = player.header.bonuses;
+    return true;
+}
+
+bool Replay_NextInput(ReplayPlayer& player, uint8_t* input)
+{
+    while (player.remaining == 0)
+    {
+        if (player.offset >= player.data.size())
+            return false;
+
+        uint8_t tag = player.data[player.offset];
+        if (tag == REPLAY_CHECKSUM_TAG)
+        {
+            // Checksum de um passo anterior que não foi conferido; pulamos.
+            uint64_t step;
+            ++player.offset;
+            if (!ReadVarint(player, player.offset, &step))
+                return false;
+            player.offset += sizeof(uint32_t);
+            continue;
+        }
+
+        ++player.offset;
+        player.input = tag;
+        if (!ReadVarint(player, player.offset, &player.remaining))
+            return false;
+    }
+
+    --player.remaining;
+    ++player.steps;
+    *input = player.input;
+    return true;
+}
+
+bool Replay_VerifyStep(ReplayPlayer& player)
+{
+    // O checksum, se houver, vem logo depois do trecho que termina no passo
+    // em que foi gravado.
+    if (player.remaining != 0)
+        return true;
+
+    size_t offset = player.offset;
+    if (offset >= player.data.size() || player.data[offset] != REPLAY_CHECKSUM_TAG)
+        return true;
+
+    uint64_t step;
+    ++offset;
+    if (!ReadVarint(player, offset, &step) || offset + sizeof(uint32_t) > player.data.size())
+        return true;
+
+    uint32_t expected;
+    memcpy(&expected, &player.data[offset], sizeof(expected));
+    player.offset = offset + sizeof(expected);
+    ++player.checksums;
+
+    // Um checksum fora do lugar indica um arquivo corrompido
+    if (step != player.steps || expected != Simulation_Checksum())
+    {
+        if (!player.desync)
+            fprintf(stderr, "WARNING: Replay diverged at step %llu.\n", (unsigned long long)step);
+        player.desync = true;
+        return false;
+    }
+    return true;
+}
@@ -17,10 +17,15 @@ in vec2 texcoords;
 
 in float gouraud_lambert;
 
-// Matrizes computadas no código C++ e enviadas para a GPU
+// Matrizes computadas no código C++ e enviadas para a GPU. As da câmera
+// ficam em um uniform buffer, escrito uma vez por quadro (veja
+// RenderThread() em "main.cpp").
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+};
 
 // Identificador que define qual objeto está sendo desenhado no momento
 #define SKYBOX 0
@@ -44,6 +49,9 @@ uniform mat4 projection;
 uniform int object_id;
 uniform int uv_mapping_type;
 
+// Opacidade do objeto (menor que 1 para os carros fantasmas)
+uniform float alpha;
+
 // Parâmetros da axis-aligned bounding box (AABB) do modelo
 uniform vec4 bbox_min;
 uniform vec4 bbox_max;
@@ -359,6 +367,6 @@ void main()
     {
         color.rgb = Kd * I * gouraud_lambert + ambient_term + phong_specular_term;
     }
-    color.a = 1;
+    color.a = alpha;
     color.rgb = pow(color.rgb, vec3(1.0,1.0,1.0)/2.2);
 } 
\ No newline at end of file
@@ -0,0 +1,791 @@
+#include "simulation.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "collisions.h"
+#include "broadphase.h"
+#include "tire.h"
+#include "profiler.h"
+
+Car car;
+
+BonusSystem g_Bonuses;
+
+RacingLine g_RacingLine;
+Fleet g_Fleet;
+ThreadPool g_ThreadPool;
+
+BVH g_TrackBVH;
+TrackField g_TrackField;
+Level g_Level;
+World g_Scene;
+
+double g_SimulationTime = 0.0;
+std::vector<float> g_LapTimes;
+
+double last_bonus = 0.0;
+bool can_receive_finish_line = false;
+
+// Instante em que a volta atual começou
+double g_LapStartTime = 0.0;
+
+SnapshotRing g_Rewind;
+
+// Bits dos bônus da fotografia sendo gravada ou restaurada (veja snapshot.h)
+std::vector<uint32_t> g_RewindBonuses;
+
+SweepAndPrune g_CarBroadphase;
+ContactTracker g_CarContactState;
+uint32_t g_CarContacts = 0;
+
+FrameArena g_StepArena;
+
+namespace {
+
+// Passos seguidos sem se tocar até que dois carros saiam de contato
+const uint32_t car_contact_exit_steps = (uint32_t)(0.25f / SIMULATION_TIMESTEP);
+
+const RenderMesh prop_mesh[PROP_KIND_COUNT] = { MESH_TREE, MESH_OUTDOOR, MESH_FINISH_LINE };
+
+// Número de bônus criados por InitializeBonusObjects()
+size_t BonusCount()
+{
+    Archetype* bonuses = World_FindArchetype(g_Scene, ENTITY_BONUS);
+    return bonuses == NULL ? 0 : bonuses->count;
+}
+
+// Entidades dos objetos e colisores de g_Level. Os bônus são criados por
+// InitializeBonusObjects().
+void BuildScene()
+{
+    World_Clear(g_Scene);
+
+    const Level& level = g_Level;
+    for (size_t i = 0; i < level.prop_kind.size(); ++i)
+    {
+        PropKind kind = (PropKind)level.prop_kind[i];
+        Entity entity = World_Create(g_Scene, kind == PROP_FINISH_LINE ? ENTITY_FINISH_LINE : ENTITY_PROP);
+
+        Transform* transform = World_Get<Transform>(g_Scene, entity);
+        transform->position = glm::vec3(level.prop_x[i], level.prop_y[i], level.prop_z[i]);
+        transform->rotation = level.prop_rotation[i];
+        transform->scale = level.prop_scale[i];
+
+        Renderable* renderable = World_Get<Renderable>(g_Scene, entity);
+        renderable->mesh = (uint8_t)prop_mesh[kind];
+        renderable->visible = 1;
+
+        // A área da linha de chegada é centrada nela (veja level.cpp)
+        if (kind == PROP_FINISH_LINE)
+        {
+            ScoringTrigger* trigger = World_Get<ScoringTrigger>(g_Scene, entity);
+            trigger->kind = TRIGGER_FINISH_LINE;
+            trigger->active = 1;
+            trigger->extent = 0.5f * (level.finish_max - level.finish_min);
+        }
+    }
+
+    for (size_t i = 0; i < level.collider_x.size(); ++i)
+    {
+        Entity entity = World_Create(g_Scene, ENTITY_COLLIDER);
+        Transform* transform = World_Get<Transform>(g_Scene, entity);
+        transform->position = glm::vec3(level.collider_x[i], 0.0f, level.collider_z[i]);
+        transform->scale = 1.0f;
+        World_Get<Collider>(g_Scene, entity)->radius = level.collider_radius[i];
+    }
+}
+
+void ActivateBonuses()
+{
+    Archetype* bonuses = World_FindArchetype(g_Scene, ENTITY_BONUS);
+    if (bonuses == NULL)
+        return;
+    ScoringTrigger* triggers = World_Column<ScoringTrigger>(*bonuses);
+    for (size_t i = 0; i < bonuses->count; ++i)
+        triggers[i].active = 1;
+}
+
+void MoveBonuses(void* context, Archetype& archetype, size_t begin, size_t end)
+{
+    double time = *static_cast<double*>(context);
+    Bonus_EvaluateBatch(g_Bonuses, World_Column<BezierMover>(archetype) + begin,
+                        World_Column<ScoringTrigger>(archetype) + begin,
+                        World_Column<Transform>(archetype) + begin, end - begin, time);
+}
+
+void UpdateRenderables(void* context, Archetype& archetype, size_t begin, size_t end)
+{
+    const Transform*      transforms  = World_Column<Transform>(archetype);
+    const ScoringTrigger* triggers    = World_Column<ScoringTrigger>(archetype);
+    Renderable*           renderables = World_Column<Renderable>(archetype);
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const Transform& t = transforms[i];
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), t.position);
+        model = glm::rotate(model, t.rotation, glm::vec3(0.0f, 1.0f, 0.0f));
+        renderables[i].model = glm::scale(model, glm::vec3(t.scale));
+
+        // Bônus coletados somem até a próxima volta
+        bool collected = triggers != NULL && triggers[i].kind == TRIGGER_BONUS && !triggers[i].active;
+        renderables[i].visible = collected ? 0 : 1;
+    }
+}
+
+} // namespace
+
+void Simulation_BuildTrack(ObjModel* trackmodel, ObjModel* planemodel)
+{
+    if (!Level_Load(g_Level, "../../data/level/level.txt", "../../data/level/level.bin"))
+        std::exit(EXIT_FAILURE);
+    BuildScene();
+
+    // Construímos a BVH do chão com as mesmas transformações usadas para
+    // desenhar a pista e a grama.
+    std::vector<glm::vec3> ground_triangles;
+    AddObjModelTrianglesToList(trackmodel, "the_track", glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, TRACK_HEIGHT, 0.0f)), ground_triangles);
+
+    // O campo de superfícies usa somente os triângulos da pista: células de
+    // 25 cm, com 20 m de grama ao redor.
+    if (!TrackField_LoadOrBake(g_TrackField, ground_triangles, "../../data/track/track.field", 0.25f, 20.0f))
+        fprintf(stderr, "WARNING: No track field; the whole ground is treated as asphalt.\n");
+
+    AddObjModelTrianglesToList(planemodel, "the_plane", glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, PLANE_HEIGHT, 0.0f)), ground_triangles);
+    BVH_Build(g_TrackBVH, ground_triangles);
+    printf("BVH do chão: %d triângulos, %d nós.\n", (int)g_TrackBVH.triangles.size(), (int)g_TrackBVH.nodes.size());
+
+    // A trajetória dos adversários parte da largada do jogador, no sentido -z
+    if (!RacingLine_Build(g_RacingLine, g_TrackField, glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, -1.0f)))
+        fprintf(stderr, "WARNING: Cannot trace the racing line; opponents are disabled.\n");
+}
+
+void Simulation_UpdateScene()
+{
+    PROFILE_ZONE("scene");
+
+    // Os bônus andam antes de as matrizes serem calculadas: os dois sistemas
+    // usam o Transform, então rodam em fases separadas
+    static double time;
+    static const System systems[] = {
+        { "bonus_mover", COMPONENT_BIT(COMPONENT_BEZIER_MOVER) | COMPONENT_BIT(COMPONENT_SCORING_TRIGGER) | COMPONENT_BIT(COMPONENT_TRANSFORM),
+          COMPONENT_BIT(COMPONENT_BEZIER_MOVER) | COMPONENT_BIT(COMPONENT_SCORING_TRIGGER), COMPONENT_BIT(COMPONENT_TRANSFORM),
+          MoveBonuses, &time },
+        { "renderables", COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_RENDERABLE),
+          COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_SCORING_TRIGGER), COMPONENT_BIT(COMPONENT_RENDERABLE),
+          UpdateRenderables, NULL }
+    };
+    time = g_SimulationTime;
+    World_RunSystems(g_Scene, g_ThreadPool, systems, sizeof(systems) / sizeof(systems[0]), 256);
+}
+
+void Simulation_SpawnOpponents(int count)
+{
+    if (count <= 0 || g_RacingLine.points.empty())
+        return;
+
+    ThreadPool_Start(g_ThreadPool);
+    Fleet_Init(g_Fleet, (size_t)count, g_RacingLine, 0.0f);
+    printf("%d adversários, atualizados por %d threads.\n", count, ThreadPool_Size(g_ThreadPool));
+}
+
+void Simulation_Shutdown()
+{
+    ThreadPool_Stop(g_ThreadPool);
+    Arena_Free(g_StepArena);
+}
+
+namespace {
+
+// Carro parado na largada, com a pontuação zerada. O multiplicador de
+// pontuação é mantido; resetCar() também o reinicia.
+void PlaceCarAtStart()
+{
+    float pontuation_multiplier = car.pontuation_multiplier;
+    car = Car();
+    car.pontuation_multiplier = pontuation_multiplier;
+    g_LapStartTime = g_SimulationTime;
+}
+
+// Velocidade de um carro no plano XZ. O corpo "g_Fleet.count" é o jogador.
+glm::vec2 BodyVelocity(size_t body)
+{
+    if (body == g_Fleet.count)
+        return glm::vec2(car.carVelocity.x, car.carVelocity.z);
+    float heading = g_Fleet.rotation_angle[body];
+    return glm::vec2(-std::sin(heading), -std::cos(heading)) * g_Fleet.speed[body];
+}
+
+void SetBodyVelocity(size_t body, glm::vec2 velocity)
+{
+    if (body == g_Fleet.count)
+    {
+        car.carVelocity.x = velocity.x;
+        car.carVelocity.z = velocity.y;
+        return;
+    }
+    // Os carros da IA só andam para frente, na direção em que apontam
+    float heading = g_Fleet.rotation_angle[body];
+    glm::vec2 forward(-std::sin(heading), -std::cos(heading));
+    g_Fleet.speed[body] = std::max(0.0f, glm::dot(velocity, forward));
+}
+
+void MoveBody(size_t body, glm::vec3 offset)
+{
+    if (body == g_Fleet.count)
+    {
+        car.carPosition += offset;
+        return;
+    }
+    g_Fleet.x[body] += offset.x;
+    g_Fleet.z[body] += offset.z;
+}
+
+// Colisões entre carros: a frota e o jogador passam pelo sweep-and-prune, e
+// cada par candidato é testado com as caixas orientadas. Os carros de um par
+// que se sobrepõe são afastados pela metade da penetração cada um, e a
+// velocidade de aproximação é trocada como em um choque pouco elástico entre
+// massas iguais. Os pares são resolvidos em ordem, na thread principal, para
+// que o resultado seja determinístico.
+void ResolveCarContacts()
+{
+    PROFILE_ZONE("contacts");
+
+    const float restitution = 0.2f;
+
+    size_t bodies = g_Fleet.count + 1;
+    if (bodies < 2)
+        return;
+
+    // A arena é dimensionada para a frota no primeiro passo (veja
+    // Simulation_Step()); se a frota crescer depois disso, as caixas vão para
+    // o heap em vez de as colisões serem ignoradas
+    OrientedBox* boxes = Arena_New<OrientedBox>(g_StepArena, bodies);
+    if (boxes == NULL)
+    {
+        static std::vector<OrientedBox> overflow_boxes;
+        if (overflow_boxes.size() < bodies)
+        {
+            fprintf(stderr, "WARNING: Step arena too small for %zu car boxes; using the heap.\n", bodies);
+            overflow_boxes.resize(bodies);
+        }
+        boxes = overflow_boxes.data();
+    }
+
+    if (g_CarBroadphase.order_x.size() != bodies)
+        Contacts_Reset(g_CarContactState, bodies, car_contact_exit_steps);
+    SweepAndPrune_Resize(g_CarBroadphase, bodies);
+    for (size_t i = 0; i < bodies; ++i)
+    {
+        if (i == g_Fleet.count)
+            boxes[i] = car_oriented_box(car.carPosition, car.rotation_angle);
+        else
+            boxes[i] = car_oriented_box(glm::vec3(g_Fleet.x[i], g_Fleet.y[i], g_Fleet.z[i]), g_Fleet.rotation_angle[i]);
+
+        glm::vec3 bbox_min, bbox_max;
+        oriented_box_bounds(boxes[i], &bbox_min, &bbox_max);
+        g_CarBroadphase.min_x[i] = bbox_min.x;
+        g_CarBroadphase.max_x[i] = bbox_max.x;
+        g_CarBroadphase.min_z[i] = bbox_min.z;
+        g_CarBroadphase.max_z[i] = bbox_max.z;
+    }
+    SweepAndPrune_Update(g_CarBroadphase);
+
+    for (size_t k = 0; k < g_CarBroadphase.pairs.size(); ++k)
+    {
+        uint32_t a = g_CarBroadphase.pairs[k].first;
+        uint32_t b = g_CarBroadphase.pairs[k].second;
+        glm::vec3 separation;
+        if (!obb_obb_intersect(boxes[a], boxes[b], &separation) || glm::dot(separation, separation) == 0.0f)
+            continue;
+
+        if (Contacts_Touch(g_CarContactState, a, b))
+            ++g_CarContacts;
+        MoveBody(a, -0.5f * separation);
+        MoveBody(b, 0.5f * separation);
+        boxes[a].center -= 0.5f * separation;
+        boxes[b].center += 0.5f * separation;
+
+        glm::vec2 normal = glm::normalize(glm::vec2(separation.x, separation.z));
+        glm::vec2 velocity_a = BodyVelocity(a);
+        glm::vec2 velocity_b = BodyVelocity(b);
+        float approaching = glm::dot(velocity_b - velocity_a, normal);
+        if (approaching < 0.0f)
+        {
+            float impulse = -0.5f * (1.0f + restitution) * approaching;
+            SetBodyVelocity(a, velocity_a - normal * impulse);
+            SetBodyVelocity(b, velocity_b + normal * impulse);
+        }
+    }
+    Contacts_EndStep(g_CarContactState);
+}
+
+} // namespace
+
+void Simulation_Step(uint8_t input, float deltaTime)
+{
+    PROFILE_ZONE("simulation");
+
+    bool key_W_pressed = (input & INPUT_KEY_W) != 0;
+    bool key_S_pressed = (input & INPUT_KEY_S) != 0;
+    bool key_A_pressed = (input & INPUT_KEY_A) != 0;
+    bool key_D_pressed = (input & INPUT_KEY_D) != 0;
+
+    // Buffers preparados no primeiro passo, para que os seguintes não aloquem
+    // memória (veja alloctrack.h). As fotografias guardam um bit por bônus,
+    // então são refeitas se os bônus forem recriados.
+    size_t bonus_count = BonusCount();
+    if (g_Rewind.capacity == 0 || g_Rewind.bonus_count != bonus_count)
+    {
+        Snapshot_Init(g_Rewind, REWIND_SECONDS * (size_t)(1.0f / SIMULATION_TIMESTEP + 0.5f), REWIND_DELTA_BYTES, bonus_count);
+        g_RewindBonuses.assign(Snapshot_BonusWords(bonus_count), 0);
+    }
+    if (g_StepArena.capacity == 0)
+    {
+        g_LapTimes.reserve(256);
+        size_t arena_bytes = (g_Fleet.count + 1) * sizeof(OrientedBox) + 4096;
+        Arena_Init(g_StepArena, "passo da simulação", std::max(arena_bytes, (size_t)SIMULATION_STEP_ARENA_BYTES));
+    }
+    Arena_Reset(g_StepArena);
+
+    // Enquanto a tecla estiver pressionada, o jogador volta no tempo. Os
+    // adversários ficam parados.
+    if (input & INPUT_REWIND)
+    {
+        Simulation_Rewind(REWIND_SPEED);
+        return;
+    }
+
+    // A tecla espaço mantém o multiplicador de pontuação e os bônus
+    if (input & INPUT_RESET)
+        PlaceCarAtStart();
+
+    // Funcoes de atualizacao das propriedades do carro
+    UpdateCarSpeedAndPosition(car, key_W_pressed, key_S_pressed, key_A_pressed, key_D_pressed, deltaTime);
+    UpdateCarGroundContact(car);
+    UpdateFrontWheelsAngle(car, key_A_pressed, key_D_pressed, deltaTime);
+    UpdateWheelsRotation(car, deltaTime);
+    UpdatePontuation(car, deltaTime);
+
+    Fleet_Step(g_Fleet, g_RacingLine, g_ThreadPool, deltaTime);
+    ResolveCarContacts();
+
+    g_SimulationTime += deltaTime;
+
+    SimulationSnapshot snapshot;
+    Simulation_CaptureSnapshot(&snapshot, g_RewindBonuses.data());
+    Snapshot_Push(g_Rewind, snapshot, g_RewindBonuses.data());
+}
+
+void Simulation_CaptureSnapshot(SimulationSnapshot* snapshot, uint32_t* bonus_active)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->simulation_time         = g_SimulationTime;
+    snapshot->lap_start_time          = g_LapStartTime;
+    snapshot->last_bonus              = last_bonus;
+    snapshot->position                = car.carPosition;
+    snapshot->velocity                = car.carVelocity;
+    snapshot->acceleration_vector     = car.carAcceleration;
+    snapshot->direction               = car.carDirection;
+    snapshot->ground_normal           = car.groundNormal;
+    snapshot->speed                   = car.speed;
+    snapshot->acceleration            = car.acceleration;
+    snapshot->wheel_rotation_angle    = car.wheel_rotation_angle;
+    snapshot->rotation_angle          = car.rotation_angle;
+    snapshot->yaw_rate                = car.yaw_rate;
+    snapshot->drift_angle             = car.drift_angle;
+    snapshot->front_wheel_angle       = car.front_wheel_angle;
+    snapshot->pontuation              = car.pontuation;
+    snapshot->pontuation_multiplier   = car.pontuation_multiplier;
+    snapshot->laps                    = (uint32_t)g_LapTimes.size();
+    snapshot->can_receive_finish_line = can_receive_finish_line ? 1 : 0;
+
+    Archetype* bonuses = World_FindArchetype(g_Scene, ENTITY_BONUS);
+    size_t count = BonusCount();
+    std::fill(bonus_active, bonus_active + Snapshot_BonusWords(count), 0u);
+    for (size_t i = 0; i < count; ++i)
+        if (World_Column<ScoringTrigger>(*bonuses)[i].active)
+            bonus_active[i / 32] |= 1u << (i % 32);
+}
+
+void Simulation_ApplySnapshot(const SimulationSnapshot& snapshot, const uint32_t* bonus_active)
+{
+    g_SimulationTime             = snapshot.simulation_time;
+    g_LapStartTime               = snapshot.lap_start_time;
+    last_bonus                   = snapshot.last_bonus;
+    car.carPosition              = snapshot.position;
+    car.carVelocity              = snapshot.velocity;
+    car.carAcceleration          = snapshot.acceleration_vector;
+    car.carDirection             = snapshot.direction;
+    car.groundNormal             = snapshot.ground_normal;
+    car.speed                    = snapshot.speed;
+    car.acceleration             = snapshot.acceleration;
+    car.wheel_rotation_angle     = snapshot.wheel_rotation_angle;
+    car.rotation_angle           = snapshot.rotation_angle;
+    car.yaw_rate                 = snapshot.yaw_rate;
+    car.drift_angle              = snapshot.drift_angle;
+    car.front_wheel_angle        = snapshot.front_wheel_angle;
+    car.pontuation               = snapshot.pontuation;
+    car.pontuation_multiplier    = snapshot.pontuation_multiplier;
+    car.surface                  = TrackField_Sample(g_TrackField, car.carPosition.x, car.carPosition.z);
+    can_receive_finish_line      = snapshot.can_receive_finish_line != 0;
+
+    // As voltas só são acrescentadas, então voltar no tempo só remove as últimas
+    if (g_LapTimes.size() > snapshot.laps)
+        g_LapTimes.resize(snapshot.laps);
+
+    Archetype* bonuses = World_FindArchetype(g_Scene, ENTITY_BONUS);
+    size_t count = BonusCount();
+    for (size_t i = 0; i < count; ++i)
+        World_Column<ScoringTrigger>(*bonuses)[i].active = (bonus_active[i / 32] >> (i % 32)) & 1u;
+}
+
+int Simulation_Rewind(int steps)
+{
+    steps = std::min(steps, (int)Snapshot_Available(g_Rewind));
+    SimulationSnapshot snapshot;
+    if (steps <= 0 || !Snapshot_Rewind(g_Rewind, (size_t)steps, &snapshot, g_RewindBonuses.data()))
+        return 0;
+    Simulation_ApplySnapshot(snapshot, g_RewindBonuses.data());
+    return steps;
+}
+
+namespace {
+
+void HashBytes(uint32_t& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+}
+
+} // namespace
+
+uint32_t Simulation_Checksum()
+{
+    // Somente os campos que evoluem com a simulação. Não usamos o Car inteiro
+    // porque os bytes de preenchimento entre os campos não são definidos.
+    uint32_t hash = 2166136261u;
+    HashBytes(hash, &car.carPosition, sizeof(car.carPosition));
+    HashBytes(hash, &car.carVelocity, sizeof(car.carVelocity));
+    HashBytes(hash, &car.carAcceleration, sizeof(car.carAcceleration));
+    HashBytes(hash, &car.speed, sizeof(car.speed));
+    HashBytes(hash, &car.acceleration, sizeof(car.acceleration));
+    HashBytes(hash, &car.rotation_angle, sizeof(car.rotation_angle));
+    HashBytes(hash, &car.yaw_rate, sizeof(car.yaw_rate));
+    HashBytes(hash, &car.front_wheel_angle, sizeof(car.front_wheel_angle));
+    HashBytes(hash, &car.wheel_rotation_angle, sizeof(car.wheel_rotation_angle));
+    HashBytes(hash, &car.pontuation, sizeof(car.pontuation));
+    HashBytes(hash, &car.pontuation_multiplier, sizeof(car.pontuation_multiplier));
+    if (Archetype* bonuses = World_FindArchetype(g_Scene, ENTITY_BONUS))
+        for (size_t i = 0; i < bonuses->count; ++i)
+            HashBytes(hash, &World_Column<ScoringTrigger>(*bonuses)[i].active, 1);
+    if (g_Fleet.count > 0)
+    {
+        HashBytes(hash, g_Fleet.x.data(), g_Fleet.count * sizeof(float));
+        HashBytes(hash, g_Fleet.z.data(), g_Fleet.count * sizeof(float));
+        HashBytes(hash, g_Fleet.rotation_angle.data(), g_Fleet.count * sizeof(float));
+    }
+    HashBytes(hash, &g_SimulationTime, sizeof(g_SimulationTime));
+    uint32_t laps = (uint32_t)g_LapTimes.size();
+    HashBytes(hash, &laps, sizeof(laps));
+    return hash;
+}
+
+// Lógica para atualização da velocidade e posição do carro
+void UpdateCarSpeedAndPosition(Car &car, bool key_W_pressed, bool key_S_pressed, bool key_A_pressed, bool key_D_pressed, float deltaTime)
+{
+    // Superfície embaixo do carro: fora do asfalto a aderência dos pneus é
+    // menor, o que limita a velocidade máxima, a aceleração e as curvas.
+    car.surface = TrackField_Sample(g_TrackField, car.carPosition.x, car.carPosition.z);
+
+    // Velocidade, rotação e posição vêm do modelo de pneus (veja tire.h)
+    TireControls controls;
+    controls.throttle = key_W_pressed ? 1.0f : 0.0f;
+    controls.brake = (key_S_pressed && !key_W_pressed) ? 1.0f : 0.0f;
+    Tire_Step(car, controls, car.surface.friction, deltaTime);
+
+    // Direção atual baseada na orientação do carro
+    glm::vec3 forward_direction = glm::normalize(glm::vec3(
+        -sin(car.rotation_angle), 
+        0.0f, 
+        -cos(car.rotation_angle)
+    ));
+
+    car.carDirection = forward_direction;
+
+    std::pair<glm::vec3, glm::vec3> bbox = ComputeCarAABB(car);
+    glm::vec3 bbox_min = bbox.first;
+    glm::vec3 bbox_max = bbox.second;
+    
+    // Verifica colisão com árvores, postes dos outdoors e outros colisores
+    if(Level_Intersect(g_Level, bbox_min, bbox_max)){
+        car.carPosition -= car.carVelocity * deltaTime;
+        car.carVelocity = glm::vec3(0.0f); 
+        resetCar();
+    }
+
+    // Verifica colisão com bonus
+    int collected = 0;
+    if (Archetype* bonuses = World_FindArchetype(g_Scene, ENTITY_BONUS))
+        collected = Bonus_Collect(g_Bonuses, World_Column<BezierMover>(*bonuses), World_Column<ScoringTrigger>(*bonuses),
+                                  bonuses->count, bbox_min, bbox_max, g_SimulationTime);
+    car.pontuation_multiplier += 0.1 * collected;
+    
+    if((g_SimulationTime - last_bonus) > TIMEOUT_FINISH_LINE){
+        can_receive_finish_line = true;
+    }
+
+    // Verifica colisão com linha de chegada
+    bool finish_line = false;
+    if (Archetype* lines = World_FindArchetype(g_Scene, ENTITY_FINISH_LINE))
+    {
+        const Transform*      transforms = World_Column<Transform>(*lines);
+        const ScoringTrigger* triggers   = World_Column<ScoringTrigger>(*lines);
+        for (size_t i = 0; i < lines->count && !finish_line; ++i)
+            finish_line = point_cube_intersect(car.carPosition, transforms[i].position - triggers[i].extent,
+                                               transforms[i].position + triggers[i].extent);
+    }
+    if(finish_line && can_receive_finish_line){
+        car.pontuation += 1000;
+        can_receive_finish_line = false;
+        last_bonus = g_SimulationTime;
+        g_LapTimes.push_back((float)(g_SimulationTime - g_LapStartTime));
+        g_LapStartTime = g_SimulationTime;
+        ActivateBonuses();
+    }
+
+    // Atualiza valores escalares
+    car.speed = glm::length(car.carVelocity);
+    car.acceleration = glm::length(car.carAcceleration);
+    car.acceleration = (glm::dot(car.carAcceleration, forward_direction) < 0) ? -car.acceleration : car.acceleration;
+}
+
+void UpdateFrontWheelsAngle(Car &car, bool key_A_pressed, bool key_D_pressed, float deltaTime) 
+{
+    float turn_speed = glm::radians(200.0f); // Velocidade de ajuste das rodas
+    float return_speed = glm::radians(100.0f); // Velocidade de retorno ao neutro
+
+    if (key_A_pressed)
+    {
+        car.front_wheel_angle += turn_speed * deltaTime;
+        if (car.front_wheel_angle > car.max_front_wheel_angle)
+            car.front_wheel_angle = car.max_front_wheel_angle;
+    }
+    else if (key_D_pressed)
+    {
+        car.front_wheel_angle -= turn_speed * deltaTime;
+        if (car.front_wheel_angle < -car.max_front_wheel_angle)
+            car.front_wheel_angle = -car.max_front_wheel_angle;
+    }
+    else
+    {
+        if (car.front_wheel_angle > 0.0f)
+        {
+            car.front_wheel_angle -= return_speed * deltaTime;
+            if (car.front_wheel_angle < 0.0f)
+                car.front_wheel_angle = 0.0f;
+        }
+        else if (car.front_wheel_angle < 0.0f)
+        {
+            car.front_wheel_angle += return_speed * deltaTime;
+            if (car.front_wheel_angle > 0.0f)
+                car.front_wheel_angle = 0.0f;
+        }
+    }
+}
+
+void UpdateWheelsRotation(Car &car, float deltaTime)
+{
+    // Calcula a rotação das rodas com base na distância percorrida
+    float rotation_direction = (glm::dot(car.carVelocity, glm::vec3(0.0f, 0.0f, -1.0f)) < 0) ? 1.0f : -1.0f;
+    float distance = rotation_direction * car.speed * deltaTime;
+    float wheel_radius = 0.4f;
+    car.wheel_rotation_angle += distance / wheel_radius;
+}
+
+void UpdatePontuation(Car &car, float deltaTime)
+{
+    // Fora da pista não há pontuação
+    if (car.surface.off_track)
+        return;
+
+    // Atualiza a pontuação do carro baseada na velocidade e só aumenta quando o
+    // carro derrapa: o ângulo de drift é o ângulo entre a direção do carro e a
+    // do movimento, calculado pelo modelo de pneus.
+    float abs_drift_angle = glm::abs(car.drift_angle);
+    if (abs_drift_angle > 0.15f)
+    {
+        car.pontuation += abs_drift_angle * 100 * car.speed * deltaTime * car.pontuation_multiplier;
+    }
+}
+
+// Lança um segmento vertical por roda contra a BVH do chão e apoia o carro na
+// altura média encontrada. As quatro consultas são feitas em um único pacote.
+void UpdateCarGroundContact(Car &car)
+{
+    // Mesma transformação de DrawCar(), sem a translação: leva as posições
+    // das rodas do sistema do modelo para o sistema global.
+    glm::mat4 body = glm::rotate(glm::mat4(1.0f), car.rotation_angle, glm::vec3(0.0f, 1.0f, 0.0f))
+                   * glm::rotate(glm::mat4(1.0f), -PI/2, glm::vec3(0.0f, 1.0f, 0.0f))
+                   * glm::rotate(glm::mat4(1.0f), -PI/2, glm::vec3(1.0f, 0.0f, 0.0f));
+
+    const glm::vec3* wheels[4] = {
+        &car.frontLeftWheelPosition,
+        &car.frontRightWheelPosition,
+        &car.rearLeftWheelPosition,
+        &car.rearRightWheelPosition
+    };
+
+    const float probe_above = 1.0f; // Início do segmento acima da roda
+    const float probe_below = 2.0f; // Fim do segmento abaixo da roda
+
+    glm::vec3 from[4];
+    glm::vec3 to[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        glm::vec3 wheel = car.carPosition + glm::vec3(body * glm::vec4(*wheels[i], 0.0f));
+        from[i] = glm::vec3(wheel.x, car.carPosition.y + probe_above, wheel.z);
+        to[i]   = glm::vec3(wheel.x, car.carPosition.y - probe_below, wheel.z);
+    }
+
+    BvhHit hits[4];
+    BVH_SegmentBatch(g_TrackBVH, from, to, hits, 4);
+
+    float height = 0.0f;
+    glm::vec3 normal(0.0f);
+    int num_hits = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (hits[i].triangle < 0)
+            continue;
+        height += hits[i].position.y;
+        normal += hits[i].normal;
+        num_hits += 1;
+    }
+
+    // Fora da geometria (nenhuma roda tocou o chão) mantemos a altura atual.
+    if (num_hits == 0)
+        return;
+
+    car.carPosition.y = height / num_hits + CAR_RIDE_HEIGHT;
+    car.groundNormal = glm::normalize(normal);
+}
+
+std::pair<glm::vec3, glm::vec3> ComputeCarAABB(const Car& car) {
+    // 1. Define the local (unrotated) bounding box corners relative to the car's center
+    const float halfWidth = 0.64f;
+
+    // Local space corners (constantes: nada é alocado a cada passo)
+    static const glm::vec3 localCorners[] = {
+        // Bottom face
+        glm::vec3(-halfWidth, 0.0f, -1.8f),
+        glm::vec3( halfWidth, 0.0f, -1.8f),
+        glm::vec3( halfWidth, 0.0f,  1.3f),
+        glm::vec3(-halfWidth, 0.0f,  1.3f),
+        // Top face
+        glm::vec3(-halfWidth,  0.8f, -1.8f),
+        glm::vec3( halfWidth,  0.8f, -1.8f),
+        glm::vec3( halfWidth,  0.8f,  1.3f),
+        glm::vec3(-halfWidth,  0.8f,  1.3f)
+    };
+
+    // 2. Create the rotation matrix (assuming rotation around the Y-axis)
+    glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), car.rotation_angle, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // 3. Initialize min and max points with extreme values
+    glm::vec3 aabb_min(std::numeric_limits<float>::max());
+    glm::vec3 aabb_max(std::numeric_limits<float>::lowest());
+
+    // 4. Transform each corner and update the AABB
+    for (const auto& corner : localCorners) {
+        // Apply rotation
+        glm::vec4 rotatedCorner = rotationMatrix * glm::vec4(corner, 1.0f);
+
+        // Apply translation to world space
+        glm::vec3 worldCorner = glm::vec3(rotatedCorner) + car.carPosition;
+
+        // Update AABB min
+        aabb_min.x = std::min(aabb_min.x, worldCorner.x);
+        aabb_min.y = std::min(aabb_min.y, worldCorner.y);
+        aabb_min.z = std::min(aabb_min.z, worldCorner.z);
+
+        // Update AABB max
+        aabb_max.x = std::max(aabb_max.x, worldCorner.x);
+        aabb_max.y = std::max(aabb_max.y, worldCorner.y);
+        aabb_max.z = std::max(aabb_max.z, worldCorner.z);
+    }
+
+    return { aabb_min, aabb_max };
+}
+
+void resetCar(){
+    PlaceCarAtStart();
+    car.pontuation_multiplier = 1;
+    ActivateBonuses();
+}
+
+void InitializeBonusObjects(int count) {
+
+    // Bônus descritos na pista (um em cada curva)
+    std::vector<glm::vec3> bonus_positions;
+    for (size_t i = 0; i < g_Level.bonus_x.size(); ++i)
+        bonus_positions.push_back(glm::vec3(g_Level.bonus_x[i], g_Level.bonus_y[i], g_Level.bonus_z[i]));
+
+    // Bônus extras em células de asfalto escolhidas por um gerador
+    // congruencial com semente fixa, para que os testes sejam reproduzíveis
+    uint32_t seed = 12345u;
+    size_t cells = g_TrackField.surface.size();
+    for (int attempts = 0; (int)bonus_positions.size() < count && cells > 0 && attempts < count * 100; ++attempts)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        size_t cell = (seed >> 8) % cells;
+        if (g_TrackField.surface[cell] != SURFACE_ASPHALT)
+            continue;
+        float x = g_TrackField.origin.x + ((cell % g_TrackField.width) + 0.5f) * g_TrackField.cell_size;
+        float z = g_TrackField.origin.y + ((cell / g_TrackField.width) + 0.5f) * g_TrackField.cell_size;
+        bonus_positions.push_back(glm::vec3(x, -0.9f, z));
+    }
+
+    // Todos os bônus percorrem a mesma curva, transladada para a sua posição
+    BezierCurve curve = {
+        glm::vec3(0.0f), // p0: Start position
+        glm::vec3(-1.0f, 0.0f, 0.3f),  // p1: Control point 1
+        glm::vec3(1.0f, 0.0f, 0.3f),  // p2: Control point 2'1
+        glm::vec3(0.0f)   // p3: End position
+    };
+
+    Bonus_Clear(g_Bonuses);
+    uint32_t shape = Bonus_AddShape(g_Bonuses, curve);
+
+    // Uma volta por segundo na curva, como antes da parametrização por
+    // comprimento de arco
+    float speed = g_Bonuses.shapes[shape].length;
+
+    World_DestroyAll(g_Scene, ENTITY_BONUS);
+    World_Reserve(g_Scene, ENTITY_BONUS, bonus_positions.size());
+    for (size_t i = 0; i < bonus_positions.size(); ++i)
+    {
+        Entity entity = World_Create(g_Scene, ENTITY_BONUS);
+
+        Transform* transform = World_Get<Transform>(g_Scene, entity);
+        transform->position = bonus_positions[i];
+        transform->scale = 0.6f;
+
+        Renderable* renderable = World_Get<Renderable>(g_Scene, entity);
+        renderable->mesh = MESH_BONUS;
+        renderable->visible = 1;
+
+        *World_Get<BezierMover>(g_Scene, entity) = Bonus_Mover(g_Bonuses, shape, bonus_positions[i], 0.0f, speed);
+
+        ScoringTrigger* trigger = World_Get<ScoringTrigger>(g_Scene, entity);
+        trigger->kind = TRIGGER_BONUS;
+        trigger->active = 1;
+        trigger->extent = glm::vec3(bonus_radius);
+    }
+}
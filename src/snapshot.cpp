@@ -0,0 +1,173 @@
+#include "snapshot.h"
+
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<SimulationSnapshot>::value, "SimulationSnapshot must be copyable byte by byte");
+static_assert(sizeof(SimulationSnapshot) % sizeof(uint32_t) == 0, "SimulationSnapshot must be made of 32-bit words");
+
+namespace {
+
+// Cada delta é uma máscara com um bit por palavra da fotografia, seguida das
+// palavras que mudaram (XOR com o keyframe, para que os bits iguais sejam
+// zero e a mesma rotina sirva para codificar e decodificar). As palavras dos
+// bônus vêm depois das de SimulationSnapshot.
+const size_t snapshot_words = sizeof(SimulationSnapshot) / sizeof(uint32_t);
+
+size_t MaskBytes(const SnapshotRing& ring)
+{
+    return (ring.words + 7) / 8;
+}
+
+size_t MaxDelta(const SnapshotRing& ring)
+{
+    return MaskBytes(ring) + ring.words * sizeof(uint32_t);
+}
+
+size_t KeyframeCount(const SnapshotRing& ring)
+{
+    return ring.keyframes.size() / ring.words;
+}
+
+uint32_t* KeyframeOf(SnapshotRing& ring, uint64_t step)
+{
+    return &ring.keyframes[(step / SNAPSHOT_KEYFRAME_INTERVAL) % KeyframeCount(ring) * ring.words];
+}
+
+// Copia "size" bytes de/para o buffer circular a partir da posição absoluta "at"
+void WriteBytes(SnapshotRing& ring, uint64_t at, const uint8_t* data, size_t size)
+{
+    size_t offset = (size_t)(at % ring.bytes.size());
+    size_t first = std::min(size, ring.bytes.size() - offset);
+    memcpy(&ring.bytes[offset], data, first);
+    memcpy(&ring.bytes[0], data + first, size - first);
+}
+
+void ReadBytes(const SnapshotRing& ring, uint64_t at, uint8_t* data, size_t size)
+{
+    size_t offset = (size_t)(at % ring.bytes.size());
+    size_t first = std::min(size, ring.bytes.size() - offset);
+    memcpy(data, &ring.bytes[offset], first);
+    memcpy(data + first, &ring.bytes[0], size - first);
+}
+
+bool DeltaIntact(const SnapshotRing& ring, uint64_t step)
+{
+    return ring.written - ring.delta_start[step % ring.capacity] <= ring.bytes.size();
+}
+
+} // namespace
+
+size_t Snapshot_BonusWords(size_t bonus_count)
+{
+    return (bonus_count + 31) / 32;
+}
+
+void Snapshot_Init(SnapshotRing& ring, size_t capacity, size_t delta_bytes, size_t bonus_count)
+{
+    ring.capacity    = std::max(capacity, (size_t)1);
+    ring.bonus_count = bonus_count;
+    ring.words       = snapshot_words + Snapshot_BonusWords(bonus_count);
+    ring.keyframes.assign((ring.capacity / SNAPSHOT_KEYFRAME_INTERVAL + 2) * ring.words, 0);
+    ring.bytes.assign(std::max(delta_bytes + ring.capacity * MaskBytes(ring), MaxDelta(ring)), 0);
+    ring.delta_start.assign(ring.capacity, 0);
+    ring.delta_size.assign(ring.capacity, 0);
+    ring.current.assign(ring.words, 0);
+    ring.record.assign(MaxDelta(ring), 0);
+    Snapshot_Clear(ring);
+}
+
+void Snapshot_Clear(SnapshotRing& ring)
+{
+    ring.steps   = 0;
+    ring.oldest  = 0;
+    ring.written = 0;
+}
+
+void Snapshot_Push(SnapshotRing& ring, const SimulationSnapshot& snapshot, const uint32_t* bonus_active)
+{
+    uint64_t step = ring.steps;
+    size_t   slot = (size_t)(step % ring.capacity);
+
+    uint32_t* current = ring.current.data();
+    memcpy(current, &snapshot, sizeof(snapshot));
+    if (ring.words > snapshot_words)
+        memcpy(current + snapshot_words, bonus_active, (ring.words - snapshot_words) * sizeof(uint32_t));
+
+    size_t size = 0;
+    if (step % SNAPSHOT_KEYFRAME_INTERVAL == 0)
+    {
+        memcpy(KeyframeOf(ring, step), current, ring.words * sizeof(uint32_t));
+    }
+    else
+    {
+        const uint32_t* keyframe = KeyframeOf(ring, step);
+        uint8_t* record = ring.record.data();
+        uint8_t* mask = record;
+        memset(mask, 0, MaskBytes(ring));
+        size = MaskBytes(ring);
+        for (size_t w = 0; w < ring.words; ++w)
+        {
+            uint32_t diff = current[w] ^ keyframe[w];
+            if (diff == 0)
+                continue;
+            mask[w / 8] |= (uint8_t)(1u << (w % 8));
+            memcpy(record + size, &diff, sizeof(diff));
+            size += sizeof(diff);
+        }
+        WriteBytes(ring, ring.written, record, size);
+    }
+
+    ring.delta_start[slot] = ring.written;
+    ring.delta_size[slot]  = (uint32_t)size;
+    ring.written += size;
+    ring.steps = step + 1;
+
+    // Passos que saíram da janela, ou cujos deltas foram sobrescritos
+    if (ring.steps - ring.oldest > ring.capacity)
+        ring.oldest = ring.steps - ring.capacity;
+    while (ring.oldest < step && !DeltaIntact(ring, ring.oldest))
+        ++ring.oldest;
+}
+
+size_t Snapshot_Available(const SnapshotRing& ring)
+{
+    return ring.steps == 0 ? 0 : (size_t)(ring.steps - 1 - ring.oldest);
+}
+
+bool Snapshot_Rewind(SnapshotRing& ring, size_t steps_back, SimulationSnapshot* out, uint32_t* bonus_active)
+{
+    if (ring.steps == 0 || steps_back > Snapshot_Available(ring))
+        return false;
+
+    uint64_t step = ring.steps - 1 - steps_back;
+    size_t   slot = (size_t)(step % ring.capacity);
+
+    uint32_t* words = ring.current.data();
+    memcpy(words, KeyframeOf(ring, step), ring.words * sizeof(uint32_t));
+    if (ring.delta_size[slot] > 0)
+    {
+        uint8_t* record = ring.record.data();
+        ReadBytes(ring, ring.delta_start[slot], record, ring.delta_size[slot]);
+
+        size_t offset = MaskBytes(ring);
+        for (size_t w = 0; w < ring.words; ++w)
+        {
+            if ((record[w / 8] & (1u << (w % 8))) == 0)
+                continue;
+            uint32_t diff;
+            memcpy(&diff, record + offset, sizeof(diff));
+            words[w] ^= diff;
+            offset += sizeof(diff);
+        }
+    }
+    memcpy(out, words, sizeof(*out));
+    if (ring.words > snapshot_words)
+        memcpy(bonus_active, words + snapshot_words, (ring.words - snapshot_words) * sizeof(uint32_t));
+
+    // O passo restaurado passa a ser o último gravado
+    ring.steps   = step + 1;
+    ring.written = ring.delta_start[slot] + ring.delta_size[slot];
+    return true;
+}
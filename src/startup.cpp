@@ -0,0 +1,157 @@
+// Tempo das fases da inicialização (veja startup.h)
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "startup.h"
+#include "json.h"
+
+namespace {
+
+struct StartupTimer
+{
+    std::mutex                            lock;
+    std::chrono::steady_clock::time_point origin;
+    StartupPhase                          phases[STARTUP_MAX_PHASES];
+    int                                   count;
+    std::thread::id                       threads[STARTUP_MAX_THREADS];
+    int                                   num_threads;
+};
+
+StartupTimer g_Startup;
+
+// Índice da thread atual. Deve ser chamada com g_Startup.lock travado.
+int ThreadIndex()
+{
+    std::thread::id id = std::this_thread::get_id();
+    for (int i = 0; i < g_Startup.num_threads; ++i)
+        if (g_Startup.threads[i] == id)
+            return i;
+    if (g_Startup.num_threads == STARTUP_MAX_THREADS)
+        return STARTUP_MAX_THREADS - 1;
+    g_Startup.threads[g_Startup.num_threads] = id;
+    return g_Startup.num_threads++;
+}
+
+double Duration(const StartupPhase& phase)
+{
+    return phase.end_ms >= 0.0 ? phase.end_ms - phase.begin_ms : 0.0;
+}
+
+// Fim da última fase terminada
+double TotalMs()
+{
+    double total = 0.0;
+    for (int i = 0; i < g_Startup.count; ++i)
+        if (g_Startup.phases[i].end_ms > total)
+            total = g_Startup.phases[i].end_ms;
+    return total;
+}
+
+} // namespace
+
+void Startup_Init()
+{
+    std::lock_guard<std::mutex> guard(g_Startup.lock);
+    g_Startup.origin = std::chrono::steady_clock::now();
+    g_Startup.count = 0;
+    g_Startup.num_threads = 0;
+    ThreadIndex();
+}
+
+double Startup_Now()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - g_Startup.origin).count();
+}
+
+int Startup_Begin(const char* name, const char* detail)
+{
+    double now = Startup_Now();
+    std::lock_guard<std::mutex> guard(g_Startup.lock);
+    if (g_Startup.count == STARTUP_MAX_PHASES)
+        return -1;
+
+    StartupPhase& phase = g_Startup.phases[g_Startup.count];
+    phase.name     = name;
+    phase.detail   = detail;
+    phase.begin_ms = now;
+    phase.end_ms   = -1.0;
+    phase.thread   = ThreadIndex();
+    return g_Startup.count++;
+}
+
+void Startup_End(int phase)
+{
+    double now = Startup_Now();
+    std::lock_guard<std::mutex> guard(g_Startup.lock);
+    if (phase >= 0 && phase < g_Startup.count)
+        g_Startup.phases[phase].end_ms = now;
+}
+
+void Startup_Print()
+{
+    std::lock_guard<std::mutex> guard(g_Startup.lock);
+
+    printf("Inicialização (ms desde o início de main()):\n");
+    printf("%-22s %7s %10s %10s  %s\n", "fase", "thread", "início", "duração", "detalhe");
+    for (int i = 0; i < g_Startup.count; ++i)
+    {
+        const StartupPhase& phase = g_Startup.phases[i];
+        printf("%-22s %7d %10.2f %10.2f  %s\n", phase.name, phase.thread, phase.begin_ms, Duration(phase),
+               phase.detail ? phase.detail : "");
+    }
+
+    // Fases repetidas (uma por arquivo) somadas. Como rodam em paralelo, a
+    // soma pode passar do tempo total.
+    printf("\n%-22s %7s %10s\n", "soma por fase", "vezes", "duração");
+    for (int i = 0; i < g_Startup.count; ++i)
+    {
+        const char* name = g_Startup.phases[i].name;
+        bool seen = false;
+        for (int j = 0; j < i && !seen; ++j)
+            seen = strcmp(g_Startup.phases[j].name, name) == 0;
+        if (seen)
+            continue;
+
+        int times = 0;
+        double sum = 0.0;
+        for (int j = i; j < g_Startup.count; ++j)
+        {
+            if (strcmp(g_Startup.phases[j].name, name) != 0)
+                continue;
+            times += 1;
+            sum += Duration(g_Startup.phases[j]);
+        }
+        printf("%-22s %7d %10.2f\n", name, times, sum);
+    }
+    printf("%-22s %7s %10.2f\n", "total", "", TotalMs());
+    fflush(stdout);
+}
+
+bool Startup_WriteJson(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot write startup timings to \"%s\".\n", filename);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(g_Startup.lock);
+    fprintf(file, "{\n  \"total_ms\": %.3f,\n  \"phases\": [\n", TotalMs());
+    for (int i = 0; i < g_Startup.count; ++i)
+    {
+        const StartupPhase& phase = g_Startup.phases[i];
+        fprintf(file, "    {\"name\": ");
+        Json_WriteString(file, phase.name);
+        fprintf(file, ", \"detail\": ");
+        Json_WriteString(file, phase.detail);
+        fprintf(file, ", \"thread\": %d, \"begin_ms\": %.3f, \"duration_ms\": %.3f}%s\n", phase.thread,
+                phase.begin_ms, Duration(phase), i + 1 < g_Startup.count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
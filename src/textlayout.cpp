@@ -0,0 +1,60 @@
+// Posicionamento dos caracteres do texto (veja textlayout.h)
+#include <cstring>
+#include <cstdint>
+
+#include "textlayout.h"
+#include "dejavufont.h"
+
+const TextFont& TextLayout_Font()
+{
+    static const TextFont font = {
+        dejavufont.tex_width, dejavufont.tex_height, dejavufont.tex_data,
+        dejavufont.height, dejavufont.glyphs[32].advance_x
+    };
+    return font;
+}
+
+size_t TextLayout_BuildQuads(const char* str, size_t length, float x, float y, float sx, float sy, TextVertex* vertices)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        // Find the glyph for the character we are looking for
+        texture_glyph_t *glyph = 0;
+        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+        {
+            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
+            {
+                glyph = &dejavufont.glyphs[j];
+                break;
+            }
+        }
+        if (!glyph) {
+            continue;
+        }
+        x += glyph->kerning[0].kerning;
+        float x0 = (float) (x + glyph->offset_x * sx);
+        float y0 = (float) (y + glyph->offset_y * sy);
+        float x1 = (float) (x0 + glyph->width * sx);
+        float y1 = (float) (y0 - glyph->height * sy);
+
+        float s0 = glyph->s0 - 0.5f/dejavufont.tex_width;
+        float t0 = glyph->t0 - 0.5f/dejavufont.tex_height;
+        float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
+        float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
+
+        TextVertex quad[6] = {
+            { x0, y0, s0, t0 },
+            { x0, y1, s0, t1 },
+            { x1, y1, s1, t1 },
+            { x0, y0, s0, t0 },
+            { x1, y1, s1, t1 },
+            { x1, y0, s1, t0 }
+        };
+        memcpy(&vertices[count], quad, sizeof(quad));
+        count += 6;
+
+        x += (glyph->advance_x * sx);
+    }
+    return count;
+}
@@ -1,6 +1,7 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <cstring>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -9,9 +10,15 @@
 #include <glm/vec4.hpp>
 
 #include "utils.h"
-#include "dejavufont.h"
+#include "textlayout.h"
+#include "arena.h"
+#include "profiler.h"
+#include "glstate.h"
+#include "glstats.h"
 
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+void GetWindowSize(GLFWwindow* window, int* width, int* height); // Função definida em main.cpp
+extern FrameArena g_FrameArena; // Definida em main.cpp
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
@@ -118,111 +125,81 @@ void TextRendering_Init()
     glCheckError();
 
     GLuint textureunit = 31;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texttexture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, dejavufont.tex_width, dejavufont.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, dejavufont.tex_data);
-    glBindSampler(textureunit, sampler);
+    GlState_BindTexture(textureunit, GL_TEXTURE_2D, texttexture_id);
+    const TextFont& font = TextLayout_Font();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, font.tex_width, font.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, font.tex_data);
+    GlState_BindSampler(textureunit, sampler);
     glCheckError();
 
-    glBindVertexArray(textVAO);
+    GlState_BindVertexArray(textVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, textVBO);
     glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
     glCheckError();
 
-    glUseProgram(textprogram_id);
-    glUniform1i(texttex_uniform, textureunit);
-    glUseProgram(0);
+    GlState_UseProgram(textprogram_id);
+    GlState_Uniform1i(texttex_uniform, textureunit);
+    GlState_UseProgram(0);
     glCheckError();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, 0);
+    GlState_BindVertexArray(0);
     glCheckError();
 }
 
 float textscale = 2.0f;
 
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+void TextRendering_PrintString(GLFWwindow* window, const char* str, float x, float y, float scale = 1.0f)
 {
     scale *= textscale;
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
+    GetWindowSize(window, &width, &height);
     float sx = scale / width;
     float sy = scale / height;
 
-    for (size_t i = 0; i < str.size(); i++)
-    {
-        // Find the glyph for the character we are looking for
-        texture_glyph_t *glyph = 0;
-        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
-        {
-            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-            {
-                glyph = &dejavufont.glyphs[j];
-                break;
-            }
-        }
-        if (!glyph) {
-            continue;
-        }
-        x += glyph->kerning[0].kerning;
-        float x0 = (float) (x + glyph->offset_x * sx);
-        float y0 = (float) (y + glyph->offset_y * sy);
-        float x1 = (float) (x0 + glyph->width * sx);
-        float y1 = (float) (y0 - glyph->height * sy);
-
-        float s0 = glyph->s0 - 0.5f/dejavufont.tex_width;
-        float t0 = glyph->t0 - 0.5f/dejavufont.tex_height;
-        float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
-        float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
-
-        struct {float x, y, s, t;} data[6] = {
-            { x0, y0, s0, t0 },
-            { x0, y1, s0, t1 },
-            { x1, y1, s1, t1 },
-            { x0, y0, s0, t0 },
-            { x1, y1, s1, t1 },
-            { x1, y0, s1, t0 }
-        };
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
-
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
-
-        glDisable(GL_BLEND);
-
-        x += (glyph->advance_x * sx);
-    }
+    // Os vértices de todos os caracteres são montados na arena do quadro e
+    // enviados à GPU de uma vez, com uma única chamada de desenho
+    size_t length = strlen(str);
+    TextVertex* vertices = Arena_New<TextVertex>(g_FrameArena, 6 * length);
+    if (vertices == NULL)
+        return;
+
+    size_t count = TextLayout_BuildQuads(str, length, x, y, sx, sy, vertices);
+    if (count == 0)
+        return;
+
+    // O estado do texto só muda na primeira string do quadro, e não é
+    // restaurado depois (veja glstate.h)
+    GlState_Enable(GL_BLEND);
+    GlState_BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    GlState_PolygonMode(GL_FILL);
+    GlState_DepthFunc(GL_ALWAYS);
+    GlState_BindBuffer(GL_ARRAY_BUFFER, textVBO);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(TextVertex), vertices, GL_STREAM_DRAW);
+
+    GlState_UseProgram(textprogram_id);
+    GlState_BindVertexArray(textVAO);
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)count);
+    PROFILE_COUNT("chamadas de desenho", 1);
+    PROFILE_COUNT("bytes enviados", count * sizeof(TextVertex));
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
-    return dejavufont.height / height * textscale;
+    GetWindowSize(window, &width, &height);
+    return TextLayout_Font().height / height * textscale;
 }
 
 float TextRendering_CharWidth(GLFWwindow* window)
 {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
-    return dejavufont.glyphs[32].advance_x / width * textscale;
+    GetWindowSize(window, &width, &height);
+    return TextLayout_Font().char_advance / width * textscale;
 }
 
 void TextRendering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f)
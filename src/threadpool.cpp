@@ -0,0 +1,382 @@
+#include "threadpool.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace {
+
+// Fila desta thread no pool "tls_pool" (veja QueueIndex())
+thread_local const ThreadPool* tls_pool  = NULL;
+thread_local int               tls_index = -1;
+
+// Índice da fila da thread atual em "pool", ou -1 se ela não tem fila
+int QueueIndex(const ThreadPool& pool)
+{
+    if (tls_pool == &pool)
+        return tls_index;
+    if (!pool.queues.empty() && std::this_thread::get_id() == pool.owner)
+        return 0;
+    return -1;
+}
+
+// Somente o dono da fila empilha e desempilha
+bool Push(JobQueue& queue, const Job& job)
+{
+    int64_t b = queue.bottom.load(std::memory_order_relaxed);
+    int64_t t = queue.top.load(std::memory_order_acquire);
+    if (b - t >= JOB_QUEUE_CAPACITY)
+        return false;
+    queue.jobs[b % JOB_QUEUE_CAPACITY] = job;
+    queue.bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+bool Pop(JobQueue& queue, Job* job)
+{
+    int64_t b = queue.bottom.load(std::memory_order_relaxed) - 1;
+    queue.bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = queue.top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        queue.bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    *job = queue.jobs[b % JOB_QUEUE_CAPACITY];
+    if (t < b)
+        return true;
+
+    // Última tarefa: disputada com os ladrões
+    bool won = queue.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    queue.bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+}
+
+// Qualquer thread pode roubar. A cópia lida só vale se o CAS em "top" der
+// certo; caso contrário o dono (ou outro ladrão) já a pegou.
+bool Steal(JobQueue& queue, Job* job)
+{
+    int64_t t = queue.top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = queue.bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return false;
+
+    Job stolen = queue.jobs[t % JOB_QUEUE_CAPACITY];
+    if (!queue.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return false;
+    *job = stolen;
+    return true;
+}
+
+void WakeWorkers(ThreadPool& pool)
+{
+    if (pool.sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(pool.sleep_mutex);
+        pool.wake.notify_all();
+    }
+}
+
+void PushShared(ThreadPool& pool, const Job& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool.shared_mutex);
+        pool.shared_jobs.push_back(job);
+    }
+    pool.queued.fetch_add(1);
+    WakeWorkers(pool);
+}
+
+void Enqueue(ThreadPool& pool, const Job& job)
+{
+    int index = QueueIndex(pool);
+    if (index >= 0 && Push(*pool.queues[index], job))
+    {
+        pool.queued.fetch_add(1);
+        WakeWorkers(pool);
+        return;
+    }
+
+    // Fila cheia: a própria thread executa, a não ser que a tarefa ainda
+    // dependa de outras; essa vai para a fila compartilhada, como em RunOne()
+    if (index >= 0 && (job.dependency == NULL || job.dependency->pending.load() == 0))
+    {
+        job.task(job.context, job.begin, job.end);
+        if (job.counter != NULL)
+            job.counter->pending.fetch_sub(1);
+        return;
+    }
+
+    PushShared(pool, job);
+}
+
+bool TakeShared(ThreadPool& pool, Job* job)
+{
+    std::lock_guard<std::mutex> lock(pool.shared_mutex);
+    if (pool.shared_jobs.empty())
+        return false;
+    *job = pool.shared_jobs.front();
+    pool.shared_jobs.pop_front();
+    return true;
+}
+
+// Próxima tarefa para a thread com a fila "index": da própria fila, roubada
+// de outra, ou da fila compartilhada
+bool Take(ThreadPool& pool, int index, Job* job)
+{
+    bool found = index >= 0 && Pop(*pool.queues[index], job);
+
+    size_t queues = pool.queues.size();
+    size_t start = index >= 0 ? (size_t)index + 1 : 0;
+    for (size_t k = 0; k < queues && !found; ++k)
+    {
+        size_t victim = (start + k) % queues;
+        if ((int)victim != index)
+            found = Steal(*pool.queues[victim], job);
+    }
+
+    if (!found)
+        found = TakeShared(pool, job);
+    if (found)
+        pool.queued.fetch_sub(1);
+    return found;
+}
+
+// Executa uma tarefa, se houver alguma pronta
+bool RunOne(ThreadPool& pool, int index)
+{
+    if (index == 0 && ThreadPool_RunMainThreadJobs(pool) > 0)
+        return true;
+
+    Job job;
+    if (!Take(pool, index, &job))
+        return false;
+
+    // Dependência ainda pendente: a tarefa volta para a fila compartilhada,
+    // que é a última a ser consultada, para que o trabalho de que ela depende
+    // seja executado antes
+    if (job.dependency != NULL && job.dependency->pending.load() > 0)
+    {
+        PushShared(pool, job);
+        std::this_thread::yield();
+        return false;
+    }
+
+    job.task(job.context, job.begin, job.end);
+    if (job.counter != NULL)
+        job.counter->pending.fetch_sub(1);
+    return true;
+}
+
+void WorkerLoop(ThreadPool* pool, int index)
+{
+    tls_pool = pool;
+    tls_index = index;
+    Profiler_SetThreadName("tarefas");
+
+    int idle = 0;
+    while (!pool->quit.load())
+    {
+        if (RunOne(*pool, index))
+        {
+            idle = 0;
+            continue;
+        }
+
+        // Sem tarefas: tenta mais algumas vezes antes de dormir
+        if (++idle < 64)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(pool->sleep_mutex);
+        pool->sleeping.fetch_add(1);
+        pool->wake.wait(lock, [&] { return pool->quit.load() || pool->queued.load() > 0; });
+        pool->sleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+struct ParallelForContext
+{
+    ThreadPool*    pool;
+    ThreadPoolTask task;
+    void*          context;
+    size_t         grain;
+    JobCounter     counter;
+};
+
+// Divide [begin, end) ao meio até restar um bloco, deixando as metades da
+// direita na fila para serem roubadas
+void SplitRange(void* context, size_t begin, size_t end)
+{
+    ParallelForContext& ctx = *static_cast<ParallelForContext*>(context);
+    while (end - begin > ctx.grain)
+    {
+        size_t blocks = (end - begin + ctx.grain - 1) / ctx.grain;
+        size_t middle = begin + (blocks / 2) * ctx.grain;
+
+        Job job = { SplitRange, context, middle, end, &ctx.counter, NULL };
+        ctx.counter.pending.fetch_add(1);
+        Enqueue(*ctx.pool, job);
+        end = middle;
+    }
+    ctx.task(ctx.context, begin, end);
+}
+
+} // namespace
+
+void ThreadPool_Start(ThreadPool& pool, int threads)
+{
+    if (!pool.queues.empty())
+        return;
+
+    if (threads <= 0)
+        threads = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+
+    pool.owner = std::this_thread::get_id();
+    pool.attached = 0;
+    pool.queued = 0;
+    pool.sleeping = 0;
+    pool.quit = false;
+    for (int i = 0; i <= threads + THREADPOOL_MAX_ATTACHED; ++i)
+    {
+        JobQueue* queue = new JobQueue;
+        queue->top = 0;
+        queue->bottom = 0;
+        pool.queues.push_back(queue);
+    }
+    for (int i = 1; i <= threads; ++i)
+        pool.workers.push_back(std::thread(WorkerLoop, &pool, i));
+}
+
+void ThreadPool_Stop(ThreadPool& pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool.sleep_mutex);
+        pool.quit = true;
+    }
+    pool.wake.notify_all();
+    for (size_t i = 0; i < pool.workers.size(); ++i)
+        pool.workers[i].join();
+    pool.workers.clear();
+
+    for (size_t i = 0; i < pool.queues.size(); ++i)
+        delete pool.queues[i];
+    pool.queues.clear();
+    pool.shared_jobs.clear();
+    pool.main_jobs.clear();
+}
+
+bool ThreadPool_AttachThread(ThreadPool& pool)
+{
+    if (pool.queues.empty() || QueueIndex(pool) >= 0)
+        return QueueIndex(pool) >= 0;
+
+    int slot = pool.attached.fetch_add(1);
+    if (slot >= THREADPOOL_MAX_ATTACHED)
+    {
+        pool.attached.fetch_sub(1);
+        return false;
+    }
+
+    tls_pool  = &pool;
+    tls_index = (int)pool.workers.size() + 1 + slot;
+    return true;
+}
+
+int ThreadPool_Size(const ThreadPool& pool)
+{
+    return (int)pool.workers.size() + 1;
+}
+
+void ThreadPool_ParallelFor(ThreadPool& pool, size_t count, size_t grain, ThreadPoolTask task, void* context)
+{
+    grain = std::max<size_t>(grain, 1);
+    if (pool.workers.empty() || count <= grain)
+    {
+        if (count > 0)
+            task(context, 0, count);
+        return;
+    }
+
+    ParallelForContext ctx;
+    ctx.pool    = &pool;
+    ctx.task    = task;
+    ctx.context = context;
+    ctx.grain   = grain;
+    SplitRange(&ctx, 0, count);
+    Job_Wait(pool, ctx.counter);
+}
+
+void Job_Spawn(ThreadPool& pool, ThreadPoolTask task, void* context, JobCounter* counter, JobCounter* dependency)
+{
+    if (pool.workers.empty())
+    {
+        if (dependency != NULL)
+            Job_Wait(pool, *dependency);
+        task(context, 0, 1);
+        return;
+    }
+
+    if (counter != NULL)
+        counter->pending.fetch_add(1);
+    Job job = { task, context, 0, 1, counter, dependency };
+    Enqueue(pool, job);
+}
+
+void Job_SpawnOnMainThread(ThreadPool& pool, ThreadPoolTask task, void* context, JobCounter* counter)
+{
+    if (pool.queues.empty())
+    {
+        task(context, 0, 1);
+        return;
+    }
+
+    if (counter != NULL)
+        counter->pending.fetch_add(1);
+    Job job = { task, context, 0, 1, counter, NULL };
+    std::lock_guard<std::mutex> lock(pool.main_mutex);
+    pool.main_jobs.push_back(job);
+}
+
+void Job_Wait(ThreadPool& pool, JobCounter& counter)
+{
+    int index = QueueIndex(pool);
+    while (counter.pending.load() > 0)
+    {
+        if (!RunOne(pool, index))
+        {
+            // Só tarefas da thread principal podem estar faltando
+            if (pool.workers.empty() && index == 0 && ThreadPool_RunMainThreadJobs(pool) == 0)
+                break;
+            std::this_thread::yield();
+        }
+    }
+}
+
+int ThreadPool_RunMainThreadJobs(ThreadPool& pool)
+{
+    // As tarefas podem criar outras (ou esperar por elas), então a fila é
+    // esvaziada antes de executá-las
+    std::vector<Job> running;
+    {
+        std::lock_guard<std::mutex> lock(pool.main_mutex);
+        if (pool.main_jobs.empty())
+            return 0;
+        running.swap(pool.main_jobs);
+    }
+
+    for (size_t i = 0; i < running.size(); ++i)
+    {
+        const Job& job = running[i];
+        job.task(job.context, job.begin, job.end);
+        if (job.counter != NULL)
+            job.counter->pending.fetch_sub(1);
+    }
+    return (int)running.size();
+}
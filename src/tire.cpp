@@ -0,0 +1,333 @@
+#include "tire.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "simulation.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TIRE_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const float gravity         = 9.81f;
+const float mass            = 1200.0f; // kg
+const float yaw_inertia     = 1100.0f; // kg m^2
+const float cg_height       = 0.45f;   // Altura do centro de massa, em metros
+const float rear_drive      = 0.7f;    // Fração da tração nas rodas traseiras
+const float brake_decel     = 9.0f;    // m/s^2 com o freio no máximo
+const float reverse_speed   = 6.0f;    // Velocidade máxima de ré, em m/s
+const float min_slip_speed  = 0.5f;    // Evita divisão por zero com o carro parado
+const float stop_speed      = 0.1f;    // Abaixo disto, sem comandos, o carro para
+
+const float half_pi = 1.57079633f;
+const float pi      = 3.14159265f;
+
+// Roda i: 0 = dianteira esquerda, 1 = dianteira direita, 2 = traseira
+// esquerda, 3 = traseira direita. Uma roda por posição dos registros SSE.
+struct WheelBatch
+{
+    float forward[4];   // Posição ao longo do carro, a partir do centro (positivo à frente)
+    float right[4];     // Posição lateral (positivo à direita)
+    float cos_steer[4];
+    float sin_steer[4];
+    float peak[4];      // Força máxima do pneu: atrito * carga
+    float drive[4];     // Força longitudinal pedida (tração ou freio)
+};
+
+// atan(x) com um polinômio minimax em [-1, 1] e atan(x) = pi/2 - atan(1/x)
+// fora dele. Erro máximo em torno de 1e-5 rad.
+inline float PolyAtan(float x)
+{
+    float t = std::fabs(x);
+    bool  invert = t > 1.0f;
+    float z = invert ? 1.0f / t : t;
+    float z2 = z * z;
+    float p = -0.01172120f;
+    p = p * z2 + 0.05265332f;
+    p = p * z2 - 0.11643287f;
+    p = p * z2 + 0.19354346f;
+    p = p * z2 - 0.33262347f;
+    p = p * z2 + 0.99997726f;
+    p = p * z;
+    if (invert)
+        p = half_pi - p;
+    return x < 0.0f ? -p : p;
+}
+
+// sin(x) para x em [-pi, pi]: reflexão para [-pi/2, pi/2] e série de Taylor
+// até x^9. Erro máximo em torno de 4e-6.
+inline float PolySin(float x)
+{
+    if (x > half_pi)
+        x = pi - x;
+    else if (x < -half_pi)
+        x = -pi - x;
+    float x2 = x * x;
+    float p = 2.7557319e-6f;
+    p = p * x2 - 1.9841270e-4f;
+    p = p * x2 + 8.3333333e-3f;
+    p = p * x2 - 1.6666667e-1f;
+    p = p * x2 + 1.0f;
+    return p * x;
+}
+
+#ifdef TIRE_USE_SSE
+
+inline __m128 AbsPs(__m128 x)
+{
+    return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+
+inline __m128 SignPs(__m128 x)
+{
+    return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)));
+}
+
+inline __m128 SelectPs(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Mesmas operações de PolyAtan(), quatro valores por vez
+inline __m128 PolyAtanPs(__m128 x)
+{
+    __m128 t = AbsPs(x);
+    __m128 invert = _mm_cmpgt_ps(t, _mm_set1_ps(1.0f));
+    __m128 z = SelectPs(invert, _mm_div_ps(_mm_set1_ps(1.0f), t), t);
+    __m128 z2 = _mm_mul_ps(z, z);
+    __m128 p = _mm_set1_ps(-0.01172120f);
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(0.05265332f));
+    p = _mm_sub_ps(_mm_mul_ps(p, z2), _mm_set1_ps(0.11643287f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(0.19354346f));
+    p = _mm_sub_ps(_mm_mul_ps(p, z2), _mm_set1_ps(0.33262347f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(0.99997726f));
+    p = _mm_mul_ps(p, z);
+    p = SelectPs(invert, _mm_sub_ps(_mm_set1_ps(half_pi), p), p);
+    return _mm_or_ps(p, SignPs(x));
+}
+
+// Mesmas operações de PolySin(), quatro valores por vez
+inline __m128 PolySinPs(__m128 x)
+{
+    __m128 high = _mm_cmpgt_ps(x, _mm_set1_ps(half_pi));
+    __m128 low  = _mm_cmplt_ps(x, _mm_set1_ps(-half_pi));
+    x = SelectPs(high, _mm_sub_ps(_mm_set1_ps(pi), x), x);
+    x = SelectPs(low, _mm_sub_ps(_mm_set1_ps(-pi), x), x);
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 p = _mm_set1_ps(2.7557319e-6f);
+    p = _mm_sub_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.9841270e-4f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(8.3333333e-3f));
+    p = _mm_sub_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.6666667e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(p, x);
+}
+
+#endif
+
+// Forças das quatro rodas para a velocidade (no referencial do carro) e a
+// velocidade de guinada atuais. Retorna as somas: força longitudinal, força
+// lateral (positiva à direita) e torque em torno do eixo vertical (positivo
+// no sentido de rotation_angle, para a esquerda).
+void EvaluateWheels(const WheelBatch& w, float v_long, float v_lat, float yaw_rate,
+                    float* force_long, float* force_lat, float* torque)
+{
+    float out_long[4], out_lat[4], out_torque[4];
+
+#ifdef TIRE_USE_SSE
+    const __m128 a = _mm_loadu_ps(w.forward);
+    const __m128 b = _mm_loadu_ps(w.right);
+    const __m128 c = _mm_loadu_ps(w.cos_steer);
+    const __m128 s = _mm_loadu_ps(w.sin_steer);
+    const __m128 peak = _mm_loadu_ps(w.peak);
+    const __m128 rate = _mm_set1_ps(yaw_rate);
+
+    // Velocidade do ponto de contato, no referencial do carro e da roda
+    __m128 wheel_long = _mm_add_ps(_mm_set1_ps(v_long), _mm_mul_ps(b, rate));
+    __m128 wheel_lat  = _mm_sub_ps(_mm_set1_ps(v_lat), _mm_mul_ps(a, rate));
+    __m128 vx = _mm_sub_ps(_mm_mul_ps(wheel_long, c), _mm_mul_ps(wheel_lat, s));
+    __m128 vy = _mm_add_ps(_mm_mul_ps(wheel_long, s), _mm_mul_ps(wheel_lat, c));
+
+    // Ângulo de deriva e fórmula mágica
+    __m128 slip = PolyAtanPs(_mm_div_ps(vy, _mm_max_ps(AbsPs(vx), _mm_set1_ps(min_slip_speed))));
+    __m128 bx = _mm_mul_ps(_mm_set1_ps(TIRE_PACEJKA_B), slip);
+    __m128 inner = _mm_sub_ps(bx, _mm_mul_ps(_mm_set1_ps(TIRE_PACEJKA_E), _mm_sub_ps(bx, PolyAtanPs(bx))));
+    __m128 fy = _mm_mul_ps(peak, PolySinPs(_mm_mul_ps(_mm_set1_ps(TIRE_PACEJKA_C), PolyAtanPs(inner))));
+    fy = _mm_sub_ps(_mm_setzero_ps(), fy);
+
+    // Elipse de atrito: tração e força lateral dividem o mesmo pico
+    __m128 fx = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(w.drive), _mm_sub_ps(_mm_setzero_ps(), peak)), peak);
+    __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)));
+    __m128 scale = _mm_min_ps(_mm_set1_ps(1.0f), _mm_div_ps(peak, _mm_max_ps(magnitude, _mm_set1_ps(1e-6f))));
+    fx = _mm_mul_ps(fx, scale);
+    fy = _mm_mul_ps(fy, scale);
+
+    // De volta ao referencial do carro
+    __m128 f_long = _mm_add_ps(_mm_mul_ps(fx, c), _mm_mul_ps(fy, s));
+    __m128 f_lat  = _mm_sub_ps(_mm_mul_ps(fy, c), _mm_mul_ps(fx, s));
+    _mm_storeu_ps(out_long, f_long);
+    _mm_storeu_ps(out_lat, f_lat);
+    _mm_storeu_ps(out_torque, _mm_sub_ps(_mm_mul_ps(b, f_long), _mm_mul_ps(a, f_lat)));
+#else
+    for (int i = 0; i < 4; ++i)
+    {
+        float wheel_long = v_long + w.right[i] * yaw_rate;
+        float wheel_lat  = v_lat - w.forward[i] * yaw_rate;
+        float vx = wheel_long * w.cos_steer[i] - wheel_lat * w.sin_steer[i];
+        float vy = wheel_long * w.sin_steer[i] + wheel_lat * w.cos_steer[i];
+
+        float slip = PolyAtan(vy / std::max(std::fabs(vx), min_slip_speed));
+        float fy = -Tire_LateralForce(slip, w.peak[i]);
+
+        float fx = std::min(std::max(w.drive[i], -w.peak[i]), w.peak[i]);
+        float magnitude = std::sqrt(fx * fx + fy * fy);
+        float scale = std::min(1.0f, w.peak[i] / std::max(magnitude, 1e-6f));
+        fx *= scale;
+        fy *= scale;
+
+        out_long[i] = fx * w.cos_steer[i] + fy * w.sin_steer[i];
+        out_lat[i]  = fy * w.cos_steer[i] - fx * w.sin_steer[i];
+        out_torque[i] = w.right[i] * out_long[i] - w.forward[i] * out_lat[i];
+    }
+#endif
+
+    // Soma sempre na mesma ordem, para que o resultado seja determinístico
+    *force_long = (out_long[0] + out_long[1]) + (out_long[2] + out_long[3]);
+    *force_lat  = (out_lat[0] + out_lat[1]) + (out_lat[2] + out_lat[3]);
+    *torque     = (out_torque[0] + out_torque[1]) + (out_torque[2] + out_torque[3]);
+}
+
+} // namespace
+
+float Tire_LateralForce(float slip_angle, float peak)
+{
+    float bx = TIRE_PACEJKA_B * slip_angle;
+    float inner = bx - TIRE_PACEJKA_E * (bx - PolyAtan(bx));
+    return peak * PolySin(TIRE_PACEJKA_C * PolyAtan(inner));
+}
+
+void Tire_Step(Car& car, const TireControls& controls, float grip, float deltaTime)
+{
+    // Posição das rodas em relação ao centro do carro, com a mesma
+    // transformação de DrawCar() (veja UpdateCarGroundContact())
+    glm::mat4 body = glm::rotate(glm::mat4(1.0f), -PI/2, glm::vec3(0.0f, 1.0f, 0.0f))
+                   * glm::rotate(glm::mat4(1.0f), -PI/2, glm::vec3(1.0f, 0.0f, 0.0f));
+    const glm::vec3* wheels[4] = {
+        &car.frontLeftWheelPosition,
+        &car.frontRightWheelPosition,
+        &car.rearLeftWheelPosition,
+        &car.rearRightWheelPosition
+    };
+
+    WheelBatch batch;
+    for (int i = 0; i < 4; ++i)
+    {
+        glm::vec3 offset = glm::vec3(body * glm::vec4(*wheels[i], 0.0f));
+        batch.forward[i] = -offset.z;
+        batch.right[i]   = offset.x;
+    }
+    float steer_cos = std::cos(car.front_wheel_angle);
+    float steer_sin = std::sin(car.front_wheel_angle);
+    for (int i = 0; i < 4; ++i)
+    {
+        batch.cos_steer[i] = (i < 2) ? steer_cos : 1.0f;
+        batch.sin_steer[i] = (i < 2) ? steer_sin : 0.0f;
+    }
+
+    // Carga estática de cada roda, pela distância do centro de massa a cada eixo
+    float front_axle = 0.5f * (batch.forward[0] + batch.forward[1]);
+    float rear_axle  = 0.5f * (batch.forward[2] + batch.forward[3]);
+    float wheelbase  = front_axle - rear_axle;
+    float track      = 0.5f * ((batch.right[1] - batch.right[0]) + (batch.right[3] - batch.right[2]));
+    float static_load[4];
+    static_load[0] = static_load[1] = 0.5f * mass * gravity * (-rear_axle) / wheelbase;
+    static_load[2] = static_load[3] = 0.5f * mass * gravity * front_axle / wheelbase;
+
+    const float h = deltaTime / TIRE_SUBSTEPS;
+    for (int step = 0; step < TIRE_SUBSTEPS; ++step)
+    {
+        glm::vec2 forward(-std::sin(car.rotation_angle), -std::cos(car.rotation_angle));
+        glm::vec2 right(-forward.y, forward.x);
+        glm::vec2 velocity(car.carVelocity.x, car.carVelocity.z);
+        glm::vec2 acceleration(car.carAcceleration.x, car.carAcceleration.z);
+        float v_long = glm::dot(velocity, forward);
+        float v_lat  = glm::dot(velocity, right);
+
+        bool idle = controls.throttle <= 0.0f && controls.brake <= 0.0f;
+        if (idle && glm::length(velocity) < stop_speed)
+        {
+            car.carVelocity = glm::vec3(0.0f);
+            car.carAcceleration = glm::vec3(0.0f);
+            car.yaw_rate = 0.0f;
+            break;
+        }
+
+        // Transferência de carga do passo anterior: acelerando, a traseira fica
+        // mais carregada; em curva, as rodas de fora da curva.
+        float long_transfer = 0.5f * mass * glm::dot(acceleration, forward) * cg_height / wheelbase;
+        float lat_transfer  = 0.5f * mass * glm::dot(acceleration, right) * cg_height / track;
+        float load[4];
+        load[0] = static_load[0] - long_transfer + lat_transfer;
+        load[1] = static_load[1] - long_transfer - lat_transfer;
+        load[2] = static_load[2] + long_transfer + lat_transfer;
+        load[3] = static_load[3] + long_transfer - lat_transfer;
+        float total_load = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            load[i] = std::max(load[i], 0.0f);
+            batch.peak[i] = grip * load[i];
+            total_load += load[i];
+        }
+        total_load = std::max(total_load, 1.0f);
+
+        // Força longitudinal pedida: tração dividida entre os eixos, freio e
+        // resistência ao rolamento proporcionais à carga de cada roda.
+        float drive = 0.0f;
+        float resist = 0.0f;
+        if (controls.throttle > 0.0f && v_long > -min_slip_speed)
+            drive = mass * car.acceleration_rate * controls.throttle * std::max(0.0f, 1.0f - v_long / car.max_speed);
+        else if (controls.brake > 0.0f && v_long < min_slip_speed)
+            drive = -mass * car.acceleration_rate * 0.5f * controls.brake * std::max(0.0f, 1.0f + v_long / reverse_speed);
+        else if (!idle)
+            resist = mass * brake_decel * std::max(controls.throttle, controls.brake);
+        else
+            resist = mass * car.deceleration_rate;
+        resist = std::min(resist, mass * std::fabs(v_long) / h);
+        if (v_long < 0.0f)
+            resist = -resist;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            float share = (i < 2) ? 0.5f * (1.0f - rear_drive) : 0.5f * rear_drive;
+            batch.drive[i] = drive * share - resist * load[i] / total_load;
+        }
+
+        float force_long, force_lat, torque;
+        EvaluateWheels(batch, v_long, v_lat, car.yaw_rate, &force_long, &force_lat, &torque);
+
+        // Fora do asfalto o carro perde velocidade até o limite da superfície
+        if (v_long > car.max_speed * grip)
+            force_long -= mass * car.deceleration_rate * (1.0f - grip) * 4.0f;
+
+        glm::vec2 world_acceleration = (forward * force_long + right * force_lat) / mass;
+        car.carAcceleration = glm::vec3(world_acceleration.x, 0.0f, world_acceleration.y);
+
+        // Euler semi-implícito: velocidades primeiro, posições com as novas velocidades
+        velocity += world_acceleration * h;
+        car.yaw_rate += torque / yaw_inertia * h;
+        car.rotation_angle += car.yaw_rate * h;
+        car.carVelocity = glm::vec3(velocity.x, 0.0f, velocity.y);
+        car.carPosition += car.carVelocity * h;
+    }
+
+    // Ângulo entre a direção do carro e a direção do movimento
+    glm::vec2 forward(-std::sin(car.rotation_angle), -std::cos(car.rotation_angle));
+    glm::vec2 velocity(car.carVelocity.x, car.carVelocity.z);
+    float v_long = glm::dot(velocity, forward);
+    float v_lat  = glm::dot(velocity, glm::vec2(-forward.y, forward.x));
+    car.drift_angle = glm::length(velocity) > 1.0f ? std::atan2(v_lat, std::fabs(v_long)) : 0.0f;
+}
@@ -0,0 +1,333 @@
+#include "trackfield.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+
+#define TRACKFIELD_MAGIC   0x444c4654u // "TFLD"
+#define TRACKFIELD_VERSION 1u
+
+// Aderência de cada tipo de superfície, em relação ao asfalto
+static const float surface_friction[SURFACE_COUNT] = {
+    0.55f, // SURFACE_GRASS
+    1.0f   // SURFACE_ASPHALT
+};
+
+namespace {
+
+struct FieldFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t source_hash;
+    int32_t  width;
+    int32_t  height;
+    float    origin_x;
+    float    origin_z;
+    float    cell_size;
+};
+
+// Hash FNV-1a da geometria e dos parâmetros do campo. Se qualquer um deles
+// mudar, o arquivo em disco é considerado desatualizado.
+uint32_t HashSource(const std::vector<glm::vec3>& triangles, float cell_size, float margin)
+{
+    uint32_t hash = 2166136261u;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(triangles.data());
+    size_t size = triangles.size() * sizeof(glm::vec3);
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+
+    float params[2] = { cell_size, margin };
+    bytes = reinterpret_cast<const unsigned char*>(params);
+    for (size_t i = 0; i < sizeof(params); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+bool LoadField(TrackField& field, const char* filename, uint32_t source_hash)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return false;
+
+    FieldFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+           && header.magic == TRACKFIELD_MAGIC
+           && header.version == TRACKFIELD_VERSION
+           && header.source_hash == source_hash
+           && header.width > 0 && header.height > 0;
+
+    if (ok)
+    {
+        size_t cells = (size_t)header.width * header.height;
+        field.origin    = glm::vec2(header.origin_x, header.origin_z);
+        field.cell_size = header.cell_size;
+        field.width     = header.width;
+        field.height    = header.height;
+        field.distance.resize(cells);
+        field.surface.resize(cells);
+        ok = fread(field.distance.data(), sizeof(float), cells, file) == cells
+          && fread(field.surface.data(), sizeof(uint8_t), cells, file) == cells;
+    }
+
+    fclose(file);
+    return ok;
+}
+
+void SaveField(const TrackField& field, const char* filename, uint32_t source_hash)
+{
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write track field cache \"%s\".\n", filename);
+        return;
+    }
+
+    FieldFileHeader header;
+    header.magic       = TRACKFIELD_MAGIC;
+    header.version     = TRACKFIELD_VERSION;
+    header.source_hash = source_hash;
+    header.width       = field.width;
+    header.height      = field.height;
+    header.origin_x    = field.origin.x;
+    header.origin_z    = field.origin.y;
+    header.cell_size   = field.cell_size;
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(field.distance.data(), sizeof(float), field.distance.size(), file);
+    fwrite(field.surface.data(), sizeof(uint8_t), field.surface.size(), file);
+    fclose(file);
+}
+
+// Transformada de distância euclidiana 1D de Felzenszwalb & Huttenlocher:
+// d[q] = min_p ((q - p)^2 + f[p]). "v" e "z" são buffers de trabalho.
+void DistanceTransform1D(const double* f, double* d, int n, int* v, double* z)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    int k = 0;
+    v[0] = 0;
+    z[0] = -inf;
+    z[1] = +inf;
+    for (int q = 1; q < n; ++q)
+    {
+        double s = ((f[q] + (double)q*q) - (f[v[k]] + (double)v[k]*v[k])) / (2.0*q - 2.0*v[k]);
+        while (s <= z[k])
+        {
+            --k;
+            s = ((f[q] + (double)q*q) - (f[v[k]] + (double)v[k]*v[k])) / (2.0*q - 2.0*v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = +inf;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+        while (z[k+1] < q)
+            ++k;
+        d[q] = (double)(q - v[k])*(q - v[k]) + f[v[k]];
+    }
+}
+
+// Distância (em células, ao quadrado) de cada célula até a célula mais
+// próxima em que mask == target.
+void DistanceTransform2D(const std::vector<uint8_t>& mask, uint8_t target, int width, int height, std::vector<double>& out)
+{
+    const double far = 1e20;
+    int n = std::max(width, height);
+    std::vector<double> f(n), d(n), z(n + 1);
+    std::vector<int> v(n);
+
+    out.resize((size_t)width * height);
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i] = (mask[i] == target) ? 0.0 : far;
+
+    for (int x = 0; x < width; ++x)
+    {
+        for (int y = 0; y < height; ++y)
+            f[y] = out[(size_t)y*width + x];
+        DistanceTransform1D(f.data(), d.data(), height, v.data(), z.data());
+        for (int y = 0; y < height; ++y)
+            out[(size_t)y*width + x] = d[y];
+    }
+
+    for (int y = 0; y < height; ++y)
+    {
+        double* row = &out[(size_t)y*width];
+        std::copy(row, row + width, f.begin());
+        DistanceTransform1D(f.data(), d.data(), width, v.data(), z.data());
+        std::copy(d.begin(), d.begin() + width, row);
+    }
+}
+
+// Retorna false, com o campo vazio, se não houver triângulos: os limites
+// ficariam infinitos e o tamanho da grade, indefinido.
+bool BakeField(TrackField& field, const std::vector<glm::vec3>& triangles, float cell_size, float margin)
+{
+    if (triangles.size() < 3 || !(cell_size > 0.0f))
+    {
+        field.origin    = glm::vec2(0.0f);
+        field.cell_size = 0.0f;
+        field.width     = 0;
+        field.height    = 0;
+        field.distance.clear();
+        field.surface.clear();
+        return false;
+    }
+
+    glm::vec2 bmin( std::numeric_limits<float>::max());
+    glm::vec2 bmax(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        bmin = glm::min(bmin, glm::vec2(triangles[i].x, triangles[i].z));
+        bmax = glm::max(bmax, glm::vec2(triangles[i].x, triangles[i].z));
+    }
+
+    field.cell_size = cell_size;
+    field.origin    = bmin - glm::vec2(margin);
+    field.width     = (int)std::ceil((bmax.x - bmin.x + 2.0f*margin) / cell_size);
+    field.height    = (int)std::ceil((bmax.y - bmin.y + 2.0f*margin) / cell_size);
+
+    size_t cells = (size_t)field.width * field.height;
+    std::vector<uint8_t> mask(cells, 0);
+
+    // Rasterização: uma célula pertence à pista se o seu centro está dentro
+    // de algum triângulo (projetado no plano XZ).
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3)
+    {
+        glm::vec2 a(triangles[t+0].x, triangles[t+0].z);
+        glm::vec2 b(triangles[t+1].x, triangles[t+1].z);
+        glm::vec2 c(triangles[t+2].x, triangles[t+2].z);
+
+        glm::vec2 tmin = glm::min(a, glm::min(b, c));
+        glm::vec2 tmax = glm::max(a, glm::max(b, c));
+        int x0 = std::max(0, (int)std::floor((tmin.x - field.origin.x) / cell_size));
+        int y0 = std::max(0, (int)std::floor((tmin.y - field.origin.y) / cell_size));
+        int x1 = std::min(field.width  - 1, (int)std::floor((tmax.x - field.origin.x) / cell_size));
+        int y1 = std::min(field.height - 1, (int)std::floor((tmax.y - field.origin.y) / cell_size));
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                glm::vec2 p = field.origin + (glm::vec2((float)x, (float)y) + 0.5f) * cell_size;
+                float e0 = (b.x - a.x)*(p.y - a.y) - (b.y - a.y)*(p.x - a.x);
+                float e1 = (c.x - b.x)*(p.y - b.y) - (c.y - b.y)*(p.x - b.x);
+                float e2 = (a.x - c.x)*(p.y - c.y) - (a.y - c.y)*(p.x - c.x);
+                if ((e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) || (e0 <= 0.0f && e1 <= 0.0f && e2 <= 0.0f))
+                    mask[(size_t)y*field.width + x] = 1;
+            }
+        }
+    }
+
+    // Distância de cada célula de fora até a pista e de cada célula de dentro
+    // até a grama. A borda fica no meio do caminho entre as duas células.
+    std::vector<double> to_track, to_grass;
+    DistanceTransform2D(mask, 1, field.width, field.height, to_track);
+    DistanceTransform2D(mask, 0, field.width, field.height, to_grass);
+
+    field.distance.resize(cells);
+    field.surface.resize(cells);
+    for (size_t i = 0; i < cells; ++i)
+    {
+        if (mask[i])
+        {
+            field.distance[i] = -((float)std::sqrt(to_grass[i]) - 0.5f) * cell_size;
+            field.surface[i]  = SURFACE_ASPHALT;
+        }
+        else
+        {
+            field.distance[i] = ((float)std::sqrt(to_track[i]) - 0.5f) * cell_size;
+            field.surface[i]  = SURFACE_GRASS;
+        }
+    }
+    return true;
+}
+
+inline float CellDistance(const TrackField& field, int x, int y)
+{
+    x = std::min(std::max(x, 0), field.width  - 1);
+    y = std::min(std::max(y, 0), field.height - 1);
+    return field.distance[(size_t)y*field.width + x];
+}
+
+} // namespace
+
+bool TrackField_LoadOrBake(TrackField& field, const std::vector<glm::vec3>& track_triangles,
+                           const char* cache_filename, float cell_size, float margin)
+{
+    uint32_t source_hash = HashSource(track_triangles, cell_size, margin);
+
+    printf("Carregando campo de distâncias da pista \"%s\"... ", cache_filename);
+    if (LoadField(field, cache_filename, source_hash))
+    {
+        printf("OK (%dx%d).\n", field.width, field.height);
+        return true;
+    }
+
+    printf("gerando... ");
+    fflush(stdout);
+    if (!BakeField(field, track_triangles, cell_size, margin))
+    {
+        fprintf(stderr, "ERROR: No track triangles to bake the track field from.\n");
+        return false;
+    }
+    SaveField(field, cache_filename, source_hash);
+    printf("OK (%dx%d).\n", field.width, field.height);
+    return true;
+}
+
+float TrackField_Distance(const TrackField& field, float x, float z)
+{
+    if (field.distance.empty() || field.cell_size <= 0.0f)
+        return 0.0f;
+
+    // Coordenadas contínuas relativas aos centros das células
+    float fx = (x - field.origin.x) / field.cell_size - 0.5f;
+    float fz = (z - field.origin.y) / field.cell_size - 0.5f;
+    int   x0 = (int)std::floor(fx);
+    int   z0 = (int)std::floor(fz);
+    float tx = fx - x0;
+    float tz = fz - z0;
+
+    float d00 = CellDistance(field, x0,     z0);
+    float d10 = CellDistance(field, x0 + 1, z0);
+    float d01 = CellDistance(field, x0,     z0 + 1);
+    float d11 = CellDistance(field, x0 + 1, z0 + 1);
+
+    float d0 = d00 + (d10 - d00) * tx;
+    float d1 = d01 + (d11 - d01) * tx;
+    return d0 + (d1 - d0) * tz;
+}
+
+TrackSample TrackField_Sample(const TrackField& field, float x, float z)
+{
+    TrackSample sample;
+
+    // Sem campo (pista não carregada), tudo é asfalto, sem divisão por
+    // cell_size zero
+    if (field.distance.empty() || field.cell_size <= 0.0f)
+    {
+        sample.distance  = 0.0f;
+        sample.off_track = false;
+        sample.surface   = SURFACE_ASPHALT;
+        sample.friction  = surface_friction[SURFACE_ASPHALT];
+        return sample;
+    }
+
+    sample.distance  = TrackField_Distance(field, x, z);
+    sample.off_track = sample.distance > 0.0f;
+    sample.surface   = SURFACE_GRASS;
+
+    // A superfície não é interpolada: usamos a célula que contém o ponto.
+    int cx = (int)std::floor((x - field.origin.x) / field.cell_size);
+    int cz = (int)std::floor((z - field.origin.y) / field.cell_size);
+    if (cx >= 0 && cz >= 0 && cx < field.width && cz < field.height)
+        sample.surface = (SurfaceType)field.surface[(size_t)cz*field.width + cx];
+
+    sample.friction = surface_friction[sample.surface];
+    return sample;
+}